@@ -3,6 +3,9 @@
 #ifndef _SEE_h_eval
 #define _SEE_h_eval
 
+#include <stdio.h>
+#include <see/type.h>
+
 struct SEE_string;
 struct SEE_value;
 struct SEE_interpreter;
@@ -28,4 +31,27 @@ struct SEE_object *SEE_Function_new(struct SEE_interpreter *i,
 	struct SEE_string *name, struct SEE_input *param_input, 
 	struct SEE_input *body_input);
 
+/* A program that has been parsed and compiled, ready to run or save */
+struct SEE_program;
+
+/* Parses and compiles the program text from input, without running it */
+struct SEE_program *SEE_program_compile(struct SEE_interpreter *i,
+	struct SEE_input *input);
+
+/* Evaluates a compiled program in the Global scope */
+void SEE_program_eval(struct SEE_interpreter *i, 
+	struct SEE_program *program, struct SEE_value *res);
+
+/* Serialises a compiled program into a buffer from SEE_malloc_string() */
+void *SEE_program_save(struct SEE_interpreter *i,
+	struct SEE_program *program, SEE_size_t *lenp);
+int SEE_program_save_file(struct SEE_interpreter *i,
+	struct SEE_program *program, FILE *f);
+
+/* Rebuilds a saved program, or returns NULL if it cannot be loaded */
+struct SEE_program *SEE_program_load(struct SEE_interpreter *i,
+	const void *data, SEE_size_t len);
+struct SEE_program *SEE_program_load_file(struct SEE_interpreter *i, 
+	FILE *f);
+
 #endif /* _SEE_h_eval */
@@ -8,7 +8,7 @@
  * used by the lexical analyser.
  *
  * Supported streams:
- *	- ASCII stdio file
+ *	- ASCII, UTF-8, UTF-16 or UCS-32 stdio file
  *	- SEE_string
  *	- UTF-8 C-strings
  *
@@ -31,6 +31,10 @@ struct SEE_inputclass {
 	SEE_unicode_t	(*next)(struct SEE_input *);
 	/* Releases system resources allocated to input */
 	void		(*close)(struct SEE_input *);
+	/* Optional: stores up to len characters in buf, like calling
+	 * next() that many times or until eof. Returns the count. */
+	unsigned int	(*fill)(struct SEE_input *, SEE_unicode_t *buf,
+			    unsigned int len);
 };
 
 struct SEE_input {
@@ -45,6 +49,14 @@ struct SEE_input {
 #define SEE_INPUT_NEXT(i)	(*(i)->inputclass->next)(i)
 #define SEE_INPUT_CLOSE(i)	(*(i)->inputclass->close)(i)
 
+/*
+ * Stores the next len characters of the input in buf, or as many as
+ * there are before eof, and returns how many were stored. Uses the
+ * input class's fill method if it has one, otherwise calls next().
+ */
+unsigned int SEE_input_fill(struct SEE_input *i, SEE_unicode_t *buf,
+			unsigned int len);
+
 /*
  * These input filters are intended for testing and demonstration.
  * Host applications will normally provide their own input class if they
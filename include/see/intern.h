@@ -3,11 +3,27 @@
 #ifndef _SEE_h_intern_
 #define _SEE_h_intern_
 
+#include <see/type.h>
+
 struct SEE_interpreter;
 struct SEE_string;
 
 void _SEE_intern_init(struct SEE_interpreter *i);
 
+/*
+ * Returns the interned decimal string of n if n is small enough to be
+ * kept in the interpreter's cache of integer strings, or else NULL.
+ */
+struct SEE_string *_SEE_intern_uint(struct SEE_interpreter *i,
+	SEE_uint32_t n);
+
+/*
+ * Returns the interned string of the len characters at c, which must
+ * all be below 0x10000.
+ */
+struct SEE_string *_SEE_intern_unicode(struct SEE_interpreter *i,
+	const SEE_unicode_t *c, unsigned int len);
+
 /*
  * Internalises a string local to the intepreter. Returns a string
  * with the same content so that pointer inequality implies 
@@ -13,6 +13,8 @@ struct SEE_scope;
 struct SEE_traceback;
 struct SEE_regex_engine;
 struct SEE_interpreter_state;
+struct SEE_arena;
+struct SEE_output;
 
 enum SEE_trace_event {
 	SEE_TRACE_CALL,
@@ -67,6 +69,8 @@ struct SEE_interpreter {
 	struct SEE_traceback *traceback;/* call chain for traceback */
 	void **module_private;		/* private pointers for each module */
 	void *intern_tab;		/* interned string table */
+	void *shapes;			/* shared layouts of native objects */
+	void *layer;			/* native objects this one may change */
 	unsigned int random_seed;	/* used by Math.random() */
 	const char *locale;		/* current locale (may be NULL) */
 	int recursion_limit;		/* -1 means don't care */
@@ -78,6 +82,11 @@ struct SEE_interpreter {
 
 	/* Regex implementation used by Regex object (experimental) */
 	const struct SEE_regex_engine *regex_engine;
+	int regex_step_limit;		/* -1 means don't care */
+	void *regex_cache;		/* recently compiled regexes */
+	void *enum_cache;		/* recent for-in property lists */
+	struct SEE_arena *arena;	/* allocates all memory, or NULL */
+	struct SEE_output *output;	/* buffers write() output, or NULL */
 };
 
 /* Compatibility flags */
@@ -121,6 +130,19 @@ void SEE_interpreter_init(struct SEE_interpreter *i);
 /* Initialises an interpreter with specific behaviour */
 void SEE_interpreter_init_compat(struct SEE_interpreter *i, int compat_flags);
 
+/* Initialises an interpreter as a copy of an initialised interpreter */
+void SEE_interpreter_clone(struct SEE_interpreter *i,
+	struct SEE_interpreter *orig);
+
+/* Freezes an interpreter's objects, to be shared by its copies */
+void SEE_interpreter_freeze(struct SEE_interpreter *i);
+
+/* Variants of the above that allocate from an arena (see mem.h) */
+void SEE_interpreter_init_arena(struct SEE_interpreter *i,
+	struct SEE_arena *arena);
+void SEE_interpreter_clone_arena(struct SEE_interpreter *i,
+	struct SEE_interpreter *orig, struct SEE_arena *arena);
+
 /* Saves interpreter state for concurrent access */
 struct SEE_interpreter_state *SEE_interpreter_save_state(
 	struct SEE_interpreter *i);
@@ -18,6 +18,12 @@ void *	SEE_malloc_finalize(struct SEE_interpreter *i, SEE_size_t sz,
 void  	SEE_free(struct SEE_interpreter *i, void **memp);
 void  	SEE_gcollect(struct SEE_interpreter *i);
 
+/* Region allocation for short-lived interpreters */
+struct SEE_arena;
+struct SEE_arena *SEE_arena_new(SEE_size_t limit);
+void	SEE_arena_destroy(struct SEE_arena *arena);
+SEE_size_t SEE_arena_used(struct SEE_arena *arena);
+
 /* Debugging variants */
 void *	_SEE_malloc_debug(struct SEE_interpreter *i, SEE_size_t sz, 
 		const char *file, int line);
@@ -23,14 +23,32 @@
 				 SEE_ATTR_DONTENUM)
 
 struct SEE_interpreter;
-struct SEE_property;
 
-/* A native object is a primitive object plus a hash table of properties */
-#define SEE_NATIVE_HASHLEN  257
+struct SEE_shape;
+struct SEE_layer;
+
+/*
+ * A native object is a primitive object plus the values of its
+ * properties. The names and attributes of the properties are kept
+ * in a shape, which is shared with other objects that have the same
+ * layout. The values start out in the inline slots, and move to the
+ * heap, doubling in size, when there are too many of them.
+ * The mutations counter goes up whenever a property is added or
+ * deleted or has its attributes changed, so that together with the
+ * shape it identifies the object's layout even after the object has
+ * been given a private shape.
+ * The layer is that of the interpreter that made the object; other
+ * interpreters that share it copy it before changing it.
+ */
+#define SEE_NATIVE_INLINE   4
 struct SEE_native {
 	struct SEE_object       object;
-	struct SEE_property *   properties[SEE_NATIVE_HASHLEN];
-	struct SEE_property *   lru;
+	struct SEE_shape *	shape;		/* property layout */
+	struct SEE_value *	values;		/* values, indexed by slot */
+	unsigned int		nvalues;	/* slots allocated */
+	unsigned int		mutations;	/* layout changes so far */
+	struct SEE_layer *	layer;		/* owner, see SEE_interpreter_clone */
+	struct SEE_value	inline_values[SEE_NATIVE_INLINE];
 };
 
 /* Object class methods that assume the object is a struct SEE_native */
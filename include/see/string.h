@@ -35,9 +35,11 @@ struct SEE_string {
 	struct SEE_stringclass	*stringclass;	/* NULL means static */
 	struct SEE_interpreter	*interpreter;
 	int 			 flags;
+	unsigned int		 hash;		/* see SEE_string_hash() */
 };
 #define SEE_STRING_FLAG_INTERNED  1
 #define SEE_STRING_FLAG_STATIC    2		/* Deprecated. Do not use. */
+#define SEE_STRING_FLAG_HASHED    4		/* hash field is valid */
 
 #define SEE_STRING_DECL(chararray) \
 	{ sizeof (chararray) / sizeof (SEE_char_t), (chararray), \
@@ -57,6 +59,11 @@ int	SEE_string_cmp(const struct SEE_string *s1,
 			  const struct SEE_string *s2);
 int	SEE_string_cmp_ascii(const struct SEE_string *s1,
 			  const char *s2);
+unsigned int SEE_string_hash(struct SEE_string *s);
+
+/* Steps of SEE_string_hash(), for hashing text held in other forms */
+#define SEE_STRING_HASH_INIT		2166136261U
+#define SEE_STRING_HASH_STEP(h, c)	(((h) ^ (unsigned int)(c)) * 16777619U)
 
 struct SEE_string *SEE_string_new(struct SEE_interpreter *i,
 				unsigned int space);
@@ -80,6 +87,71 @@ void	SEE_string_toutf8(struct SEE_interpreter *i, char *buf,
 			SEE_size_t buflen, const struct SEE_string *s);
 SEE_size_t SEE_string_utf8_size(struct SEE_interpreter *interp,
 			const struct SEE_string *s);
+int	SEE_utf16_to_utf8(const SEE_char_t **srcp, const SEE_char_t *srcend,
+			char **dstp, char *dstend);
+
+/*
+ * A string builder collects characters in private storage that can
+ * be sized up front, and then hands that storage to a new, ungrowable
+ * string without copying it. A builder is usually kept on the stack:
+ *
+ *	struct SEE_strbuf sb;
+ *	SEE_strbuf_init(interp, &sb, expected_length);
+ *	SEE_STRBUF_ADDCH(&sb, '[');
+ *	SEE_strbuf_append(&sb, s);
+ *	return SEE_strbuf_finish(&sb);
+ *
+ * Unlike a growable string, the builder's contents are not a string
+ * until finished, and the builder is empty again afterwards.
+ */
+struct SEE_strbuf {
+	SEE_char_t		*data;
+	unsigned int		 length;
+	unsigned int		 capacity;
+	struct SEE_interpreter	*interpreter;
+};
+
+void	SEE_strbuf_init(struct SEE_interpreter *i, struct SEE_strbuf *sb,
+			unsigned int space);
+void	SEE_strbuf_reserve(struct SEE_strbuf *sb, unsigned int extra);
+void	SEE_strbuf_addch(struct SEE_strbuf *sb, /* SEE_char_t */ int ch);
+void	SEE_strbuf_append(struct SEE_strbuf *sb, const struct SEE_string *s);
+void	SEE_strbuf_append_utf16(struct SEE_strbuf *sb, const SEE_char_t *data,
+			unsigned int len);
+void	SEE_strbuf_append_ascii(struct SEE_strbuf *sb, const char *ascii,
+			SEE_size_t len);
+void	SEE_strbuf_append_utf8(struct SEE_strbuf *sb, const char *utf8,
+			SEE_size_t len);
+void	SEE_strbuf_append_unicode(struct SEE_strbuf *sb, SEE_unicode_t uch);
+struct SEE_string *SEE_strbuf_finish(struct SEE_strbuf *sb);
+
+/* Appends a character, calling SEE_strbuf_reserve() only when full */
+#define SEE_STRBUF_ADDCH(sb, ch) do {					\
+	if ((sb)->length == (sb)->capacity)				\
+	    SEE_strbuf_reserve(sb, 1);					\
+	(sb)->data[(sb)->length++] = (ch);				\
+    } while (0)
+
+/*
+ * An output buffer collects UTF-8 text on its way to a stdio file, so
+ * that many small writes reach the file as a few large ones. Nothing
+ * is written until the buffer fills or is flushed, so a host that
+ * also writes to the file by other means must flush first.
+ */
+#define SEE_OUTPUT_BUFSZ	8192
+struct SEE_output {
+	FILE			*file;
+	SEE_size_t		 length;	/* bytes waiting in data[] */
+	int			 error;		/* a write has failed */
+	char			 data[SEE_OUTPUT_BUFSZ];
+};
+
+void	SEE_output_init(struct SEE_output *out, FILE *file);
+void	SEE_output_bytes(struct SEE_output *out, const char *data,
+			SEE_size_t len);
+void	SEE_output_string(struct SEE_interpreter *i, struct SEE_output *out,
+			const struct SEE_string *s);
+int	SEE_output_flush(struct SEE_output *out);
 
 struct SEE_string *_SEE_string_dup_fix(struct SEE_interpreter *,
 	        struct SEE_string *);
@@ -18,6 +18,7 @@ struct SEE_system {
 	/* Interpreter field defaults */
 	const char *default_locale;		/* default: NULL */
 	int default_recursion_limit;		/* default: -1 (no limit) */
+	int default_regex_step_limit;		/* default: -1 (no limit) */
 	void (*default_trace)(struct SEE_interpreter *, 
 		struct SEE_throw_location *,
 		struct SEE_context *,
@@ -60,6 +61,9 @@ struct SEE_system {
 
 	/* Default regex engine to use (experimental) */
 	const struct SEE_regex_engine *default_regex_engine;
+
+	/* Compiled regexes cached by each interpreter (0 disables) */
+	unsigned int regex_cache_size;		/* default: 64 */
 };
 
 extern struct SEE_system SEE_system;
@@ -68,8 +72,13 @@ void SEE_init(void);	    /* no-op; reserved for API 3.0 */
 
 #define SEE_ABORT(interp, msg) (*SEE_system.abort)(interp, msg)
 
-/* The following two functions are experimental and may change */
+/* The following functions are experimental and may change */
 const char **SEE_regex_engine_list(void);
 const struct SEE_regex_engine *SEE_regex_engine(const char *name);
+void SEE_regex_cache_stats(struct SEE_interpreter *interp,
+	unsigned long *hits, unsigned long *misses);
+int  SEE_simple_gc_install(void);
+void SEE_simple_gc_stats(SEE_size_t *heapsz, SEE_size_t *inuse,
+	unsigned long *collections);
 
 #endif /* _SEE_h_system_ */
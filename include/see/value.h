@@ -38,7 +38,8 @@ enum SEE_type {
 /* This structure is not part of the public API and may change */
 struct _SEE_reference {
 	struct SEE_object *base;
-	struct SEE_string *property;
+	struct SEE_string *property;	/* NULL for an array element */
+	SEE_uint32_t index;		/* array element index */
 };
 
 /* This structure is not part of the public API and may change */
@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2009
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Region allocation for short-lived interpreters.
+ *
+ * An interpreter initialised or copied into an arena (see
+ * SEE_interpreter_init_arena()) takes all of its memory from the
+ * arena instead of from SEE_system. The arena hands out memory by
+ * bumping a pointer through 64kB chunks, with separate chunks for
+ * string (pointer-free) storage, and never frees anything until it
+ * is destroyed. At that point the finalizers registered with it are
+ * run, newest first, and its chunks are kept for the next arena.
+ *
+ * The chunks themselves come from SEE_system.malloc (or malloc_string),
+ * and every live arena is kept on a static list, so that a garbage
+ * collector can see what the arena's objects point to.
+ *
+ * An arena may be given a soft limit. An allocation that would take
+ * the arena past it throws a RangeError that scripts can catch, and
+ * the script then has ARENA_SLACK more bytes to handle it before the
+ * next allocation throws again. The errors and their handling may use
+ * up to ARENA_HEADROOM bytes beyond the limit; going past that calls
+ * SEE_system.mem_exhausted.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#if HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
+#include <see/mem.h>
+#include <see/system.h>
+#include <see/try.h>
+#include <see/error.h>
+#include <see/interpreter.h>
+#include <see/string.h>
+
+#include "arena.h"
+#include "stringdefs.h"
+#include "dprint.h"
+
+#define ARENA_CHUNK	((SEE_size_t)64 * 1024)	/* standard chunk size */
+#define ARENA_LARGE	(ARENA_CHUNK / 4)	/* bigger gets its own block */
+#define ARENA_ALIGN	16
+#define ARENA_MAXSPARE	32		/* chunks of each kind kept */
+#define ARENA_SLACK	((SEE_size_t)32 * 1024)	/* to handle the limit error */
+#define ARENA_HEADROOM	((SEE_size_t)256 * 1024) /* past limit, fatal */
+
+#define ROUNDUP(n)	(((n) + ARENA_ALIGN - 1) & ~(SEE_size_t)(ARENA_ALIGN - 1))
+#define HDRSZ		ROUNDUP(sizeof (struct chunk))
+
+struct chunk {
+	struct chunk *next;
+};
+
+/* A bump-allocated sequence of chunks */
+struct region {
+	struct chunk *chunks;
+	char *next, *end;		/* free space in the newest chunk */
+};
+
+struct finalizer {
+	struct SEE_interpreter *interp;
+	void *ptr;
+	void (*finalizefn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+	struct finalizer *next;
+};
+
+struct SEE_arena {
+	struct region region[2];	/* indexed by 'atomic' */
+	struct chunk *large;		/* blocks of more than ARENA_LARGE */
+	struct finalizer *finalizers;	/* newest first */
+	SEE_size_t used;		/* bytes handed out */
+	SEE_size_t limit;		/* soft limit, or 0 */
+	SEE_size_t threshold;		/* allocating past this throws */
+	int throwing;			/* constructing the limit error */
+	struct SEE_arena *prev, *next;	/* on the live list */
+};
+
+static void *chunk_new(int);
+static void chunk_release(struct chunk *, int);
+static void *region_alloc(struct SEE_arena *, SEE_size_t, int);
+static void limit_reached(struct SEE_interpreter *, struct SEE_arena *);
+
+/*
+ * Live arenas, and chunks kept from destroyed arenas. These are
+ * shared by all threads.
+ */
+static struct SEE_arena *live;
+static struct chunk *spare[2];
+static unsigned int nspare[2];
+
+#if HAVE_PTHREAD_H
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+# define LOCK()		pthread_mutex_lock(&arena_lock)
+# define UNLOCK()	pthread_mutex_unlock(&arena_lock)
+#else
+# define LOCK()		/* nothing */
+# define UNLOCK()	/* nothing */
+#endif
+
+#ifndef NDEBUG
+extern int SEE_mem_debug;
+#endif
+
+/* Returns a standard-sized chunk, preferring one kept for reuse */
+static void *
+chunk_new(atomic)
+	int atomic;
+{
+	struct chunk *c;
+
+	LOCK();
+	if ((c = spare[atomic]) != NULL) {
+		spare[atomic] = c->next;
+		nspare[atomic]--;
+	}
+	UNLOCK();
+	if (c)
+		return c;
+	if (atomic && SEE_system.malloc_string)
+		return (*SEE_system.malloc_string)(NULL, ARENA_CHUNK, 0, 0);
+	return (*SEE_system.malloc)(NULL, ARENA_CHUNK, 0, 0);
+}
+
+/* Keeps a standard-sized chunk for reuse, or frees it */
+static void
+chunk_release(c, atomic)
+	struct chunk *c;
+	int atomic;
+{
+	LOCK();
+	if (nspare[atomic] < ARENA_MAXSPARE) {
+		c->next = spare[atomic];
+		spare[atomic] = c;
+		nspare[atomic]++;
+		c = NULL;
+	}
+	UNLOCK();
+	if (c)
+		(*SEE_system.free)(NULL, c, 0, 0);
+}
+
+/* Allocates from one of the arena's regions. Returns NULL on failure. */
+static void *
+region_alloc(arena, size, atomic)
+	struct SEE_arena *arena;
+	SEE_size_t size;
+	int atomic;
+{
+	struct region *r = &arena->region[atomic];
+	struct chunk *c;
+	void *p;
+
+	size = ROUNDUP(size);
+	if (size > ARENA_LARGE) {
+		if (atomic && SEE_system.malloc_string)
+			c = (*SEE_system.malloc_string)(NULL, HDRSZ + size,
+			    0, 0);
+		else
+			c = (*SEE_system.malloc)(NULL, HDRSZ + size, 0, 0);
+		if (!c)
+			return NULL;
+		c->next = arena->large;
+		arena->large = c;
+		arena->used += size;
+		return (char *)c + HDRSZ;
+	}
+	if (size > (SEE_size_t)(r->end - r->next)) {
+		if (!(c = chunk_new(atomic)))
+			return NULL;
+		c->next = r->chunks;
+		r->chunks = c;
+		r->next = (char *)c + HDRSZ;
+		r->end = (char *)c + ARENA_CHUNK;
+	}
+	p = r->next;
+	r->next += size;
+	arena->used += size;
+	return p;
+}
+
+/* Throws the catchable error for an arena that reached its limit */
+static void
+limit_reached(interp, arena)
+	struct SEE_interpreter *interp;
+	struct SEE_arena *arena;
+{
+	SEE_try_context_t ctxt;
+
+#ifndef NDEBUG
+	if (SEE_mem_debug)
+		dprintf("arena %p: limit %u reached\n", arena,
+		    (unsigned int)arena->limit);
+#endif
+	arena->throwing = 1;
+	SEE_TRY(interp, ctxt) {
+		SEE_error_throw_string(interp, interp->RangeError,
+		    STR(memory_limit_reached));
+	}
+	arena->throwing = 0;
+	arena->threshold = arena->used + ARENA_SLACK;
+	if (arena->threshold > arena->limit + ARENA_HEADROOM)
+		arena->threshold = arena->limit + ARENA_HEADROOM;
+	SEE_DEFAULT_CATCH(interp, ctxt);
+}
+
+/*
+ * Allocates size bytes from interp's arena, throwing a RangeError if
+ * that takes the arena past its limit. Returns NULL if the memory
+ * cannot be had.
+ */
+void *
+_SEE_arena_malloc(interp, size, atomic)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	int atomic;
+{
+	struct SEE_arena *arena = interp->arena;
+
+	if (arena->limit && arena->used + size > arena->threshold) {
+		if (!arena->throwing)
+			limit_reached(interp, arena);
+		else if (arena->used + size > arena->limit + ARENA_HEADROOM)
+			return NULL;
+	}
+	return region_alloc(arena, size, atomic);
+}
+
+/*
+ * Allocates size bytes from interp's arena, and arranges for
+ * finalizefn to be called on them when the arena is destroyed.
+ */
+void *
+_SEE_arena_malloc_finalize(interp, size, finalizefn, closure)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	void (*finalizefn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+{
+	struct SEE_arena *arena = interp->arena;
+	struct finalizer *f;
+	void *p;
+
+	p = _SEE_arena_malloc(interp, size, 0);
+	if (!p)
+		return NULL;
+	f = region_alloc(arena, sizeof *f, 0);
+	if (!f)
+		return NULL;
+	f->interp = interp;
+	f->ptr = p;
+	f->finalizefn = finalizefn;
+	f->closure = closure;
+	f->next = arena->finalizers;
+	arena->finalizers = f;
+	return p;
+}
+
+/**
+ * Creates an arena to allocate interpreters from. A non-zero limit
+ * is the number of bytes after which allocations throw a RangeError.
+ * Returns NULL if there is no memory for it.
+ */
+struct SEE_arena *
+SEE_arena_new(limit)
+	SEE_size_t limit;
+{
+	struct SEE_arena *arena;
+
+	arena = (*SEE_system.malloc)(NULL, sizeof *arena, 0, 0);
+	if (!arena)
+		return NULL;
+	arena->region[0].chunks = arena->region[1].chunks = NULL;
+	arena->region[0].next = arena->region[0].end = NULL;
+	arena->region[1].next = arena->region[1].end = NULL;
+	arena->large = NULL;
+	arena->finalizers = NULL;
+	arena->used = 0;
+	arena->limit = arena->threshold = limit;
+	arena->throwing = 0;
+
+	LOCK();
+	arena->prev = NULL;
+	arena->next = live;
+	if (live)
+		live->prev = arena;
+	live = arena;
+	UNLOCK();
+	return arena;
+}
+
+/**
+ * Runs the finalizers of everything allocated from the arena, then
+ * releases all its memory. The interpreters allocated from it must
+ * not be used again, but must still exist while this is called,
+ * because the finalizers are given them.
+ */
+void
+SEE_arena_destroy(arena)
+	struct SEE_arena *arena;
+{
+	struct finalizer *f;
+	struct chunk *c;
+	int atomic;
+
+	/* Finalizers may allocate, but not hit the limit */
+	arena->throwing = 1;
+	arena->limit = 0;
+	while ((f = arena->finalizers) != NULL) {
+		arena->finalizers = f->next;
+		(*f->finalizefn)(f->interp, f->ptr, f->closure);
+	}
+
+#ifndef NDEBUG
+	if (SEE_mem_debug)
+		dprintf("arena %p: destroyed, %u bytes used\n", arena,
+		    (unsigned int)arena->used);
+#endif
+
+	LOCK();
+	if (arena->prev)
+		arena->prev->next = arena->next;
+	else
+		live = arena->next;
+	if (arena->next)
+		arena->next->prev = arena->prev;
+	UNLOCK();
+
+	for (atomic = 0; atomic < 2; atomic++)
+		while ((c = arena->region[atomic].chunks) != NULL) {
+			arena->region[atomic].chunks = c->next;
+			chunk_release(c, atomic);
+		}
+	while ((c = arena->large) != NULL) {
+		arena->large = c->next;
+		(*SEE_system.free)(NULL, c, 0, 0);
+	}
+	(*SEE_system.free)(NULL, arena, 0, 0);
+}
+
+/**
+ * Returns the number of bytes allocated from the arena so far.
+ */
+SEE_size_t
+SEE_arena_used(arena)
+	struct SEE_arena *arena;
+{
+	return arena->used;
+}
@@ -0,0 +1,16 @@
+/* Copyright (c) 2009, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_arena_
+#define _SEE_h_arena_
+
+#include <see/type.h>
+
+struct SEE_interpreter;
+
+void *_SEE_arena_malloc(struct SEE_interpreter *interp, SEE_size_t size,
+	int atomic);
+void *_SEE_arena_malloc_finalize(struct SEE_interpreter *interp,
+	SEE_size_t size, void (*finalizefn)(struct SEE_interpreter *,
+	void *, void *), void *closure);
+
+#endif /* _SEE_h_arena_ */
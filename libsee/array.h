@@ -16,5 +16,13 @@ void	SEE_Array_push(struct SEE_interpreter *i, struct SEE_object *a,
 SEE_uint32_t SEE_Array_length(struct SEE_interpreter *i, struct SEE_object *a);
 int	SEE_to_array_index(struct SEE_string *, SEE_uint32_t *);
 
+/* Element access by index, for arrays only */
+void	SEE_Array_getindex(struct SEE_interpreter *i, struct SEE_object *a,
+		SEE_uint32_t index, struct SEE_value *res);
+void	SEE_Array_putindex(struct SEE_interpreter *i, struct SEE_object *a,
+		SEE_uint32_t index, struct SEE_value *val);
+struct SEE_string *SEE_Array_indexname(struct SEE_interpreter *i,
+		SEE_uint32_t index);
+
 
 #endif /* _SEE_h_array_ */
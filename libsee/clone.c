@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2009
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Objects shared between an interpreter and its copies.
+ *
+ * SEE_interpreter_clone() does not copy the objects of the original.
+ * Instead, it freezes them: the original's layer of objects becomes
+ * read-only, and both the original and the copy are given new, empty
+ * layers on top of it. Objects are copied into an interpreter's own
+ * layer only when it first changes them (copy on write). Because the
+ * frozen layers never change again, any number of copies may read
+ * them at once, and making a copy takes about as long as making the
+ * two empty layers.
+ *
+ * An object keeps its address when it is copied, so that references
+ * to it stay valid in every interpreter. Each layer has a map from
+ * objects to the struct (the 'view') that holds their fields as seen
+ * from that layer: its own copy, or a copy or original in a frozen
+ * layer below. Lookups that had to search the layers below are
+ * remembered in the map too.
+ *
+ * Only native objects (struct SEE_native) are layered. The classes
+ * that keep more in their objects than the native part, and change
+ * it, have a copy function in the module that defines them. The
+ * function returns NULL for objects that are not of its classes;
+ * copy_object() tries each in turn. Other objects are copied as far
+ * as their native part.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <see/mem.h>
+#include <see/type.h>
+#include <see/object.h>
+#include <see/native.h>
+#include <see/interpreter.h>
+#include <see/error.h>
+#include <see/system.h>
+
+#include "clone.h"
+#include "init.h"
+
+struct layer_entry {
+	struct SEE_native *orig;	/* NULL if unused */
+	struct SEE_native *view;
+	int own;			/* view is this layer's copy */
+};
+
+#define LAYER_MINSIZE	64	/* initial map size (power of 2) */
+
+static unsigned int hashfn(const void *);
+static struct SEE_layer *layer_new(struct SEE_interpreter *,
+	struct SEE_layer *);
+static struct layer_entry *layer_find(struct SEE_layer *,
+	struct SEE_native *);
+static struct layer_entry *layer_insert(struct SEE_interpreter *,
+	struct SEE_layer *, struct SEE_native *, struct SEE_native *);
+static struct layer_entry *lookup(struct SEE_interpreter *,
+	struct SEE_native *);
+static struct SEE_native *copy_object(struct SEE_interpreter *,
+	struct SEE_native *);
+
+/* Copy functions for objects with more than a native part, in order */
+static struct SEE_native *(*const copy_fns[])(struct SEE_interpreter *,
+	struct SEE_native *) = {
+	SEE_Array_copy,
+	SEE_Function_copy,
+	SEE_Date_copy,
+	SEE_RegExp_copy
+};
+
+static unsigned int
+hashfn(p)
+	const void *p;
+{
+	unsigned int h = (unsigned)((const char *)p - (const char *)0);
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
+
+/* Returns a new, empty layer */
+static struct SEE_layer *
+layer_new(interp, parent)
+	struct SEE_interpreter *interp;
+	struct SEE_layer *parent;
+{
+	struct SEE_layer *layer;
+
+	layer = SEE_NEW(interp, struct SEE_layer);
+	layer->parent = parent;
+	layer->frozen = 0;
+	layer->nobjects = 0;
+	layer->ncopies = 0;
+	layer->tab = NULL;
+	layer->ntab = 0;
+	layer->size = 0;
+	return layer;
+}
+
+/* Returns the map entry for an object, or NULL */
+static struct layer_entry *
+layer_find(layer, n)
+	struct SEE_layer *layer;
+	struct SEE_native *n;
+{
+	unsigned int i, mask;
+
+	if (!layer->ntab)
+		return NULL;
+	mask = layer->size - 1;
+	for (i = hashfn(n) & mask; layer->tab[i].orig; i = (i + 1) & mask)
+		if (layer->tab[i].orig == n)
+			return &layer->tab[i];
+	return NULL;
+}
+
+/* Enters an object that is not yet in the map, growing the map */
+static struct layer_entry *
+layer_insert(interp, layer, n, view)
+	struct SEE_interpreter *interp;
+	struct SEE_layer *layer;
+	struct SEE_native *n, *view;
+{
+	struct layer_entry *old, *tab;
+	unsigned int i, j, mask, size;
+
+	/* The new map is filled before it replaces the old, in case of throws */
+	if ((layer->ntab + 1) * 2 > layer->size) {
+		size = layer->size ? layer->size * 2 : LAYER_MINSIZE;
+		tab = SEE_NEW_ARRAY(interp, struct layer_entry, size);
+		for (i = 0; i < size; i++)
+			tab[i].orig = NULL;
+		mask = size - 1;
+		for (j = 0; j < layer->size; j++)
+		    if (layer->tab[j].orig) {
+			for (i = hashfn(layer->tab[j].orig) & mask;
+			     tab[i].orig; i = (i + 1) & mask)
+				;
+			tab[i] = layer->tab[j];
+		    }
+		old = layer->tab;
+		layer->tab = tab;
+		layer->size = size;
+		if (old)
+			SEE_free(interp, (void **)&old);
+	}
+	mask = layer->size - 1;
+	for (i = hashfn(n) & mask; layer->tab[i].orig; i = (i + 1) & mask)
+		;
+	layer->tab[i].orig = n;
+	layer->tab[i].view = view;
+	layer->tab[i].own = 0;
+	layer->ntab++;
+	return &layer->tab[i];
+}
+
+/*
+ * Returns the entry of the interpreter's own layer for an object of
+ * another layer, searching the frozen layers below if there is none
+ * yet. Returns NULL if the object is not from a layer below, but from
+ * an unrelated interpreter; such objects are used as they are.
+ */
+static struct layer_entry *
+lookup(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct SEE_layer *layer = (struct SEE_layer *)interp->layer;
+	struct SEE_layer *l;
+	struct layer_entry *e;
+
+	if ((e = layer_find(layer, n)) != NULL)
+		return e;
+	for (l = layer->parent; l; l = l->parent) {
+		if (l == n->layer)
+			return layer_insert(interp, layer, n, n);
+		if ((e = layer_find(l, n)) != NULL)
+			return layer_insert(interp, layer, n, e->view);
+	}
+	return NULL;
+}
+
+/* Returns the struct holding the fields of an object, for reading */
+struct SEE_native *
+_SEE_native_read(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct layer_entry *e;
+
+	if (n->layer == (struct SEE_layer *)interp->layer)
+		return n;
+	e = lookup(interp, n);
+	return e ? e->view : n;
+}
+
+/*
+ * Returns the struct holding the fields of an object, for changing.
+ * The first time an object of a frozen layer is changed, its fields
+ * are copied into the interpreter's own layer.
+ */
+struct SEE_native *
+_SEE_native_write(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct SEE_layer *layer = (struct SEE_layer *)interp->layer;
+	struct layer_entry *e;
+	struct SEE_native *copy;
+
+	if (n->layer == layer)
+		return n;
+	e = lookup(interp, n);
+	if (!e)
+		return n;
+	if (!e->own) {
+		copy = copy_object(interp, e->view);
+		copy->layer = layer;
+		e->view = copy;		/* the map did not grow */
+		e->own = 1;
+		layer->ncopies++;
+	}
+	return e->view;
+}
+
+/* Returns a copy of an object's fields, made in interp */
+static struct SEE_native *
+copy_object(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct SEE_native *copy;
+	unsigned int i;
+
+	for (i = 0; i < sizeof copy_fns / sizeof copy_fns[0]; i++)
+		if ((copy = (*copy_fns[i])(interp, n)) != NULL)
+			return copy;
+	return _SEE_native_copy(interp, n, sizeof (struct SEE_native));
+}
+
+/* Gives a new interpreter its first layer */
+void
+_SEE_layer_init(interp)
+	struct SEE_interpreter *interp;
+{
+	interp->layer = layer_new(interp, NULL);
+}
+
+/*
+ * Freezes the objects of an interpreter's layer so that copies of
+ * the interpreter can share them, and puts a new layer on top. Does
+ * nothing if the interpreter has neither made nor changed anything
+ * since it was last frozen.
+ */
+void
+_SEE_layer_freeze(interp)
+	struct SEE_interpreter *interp;
+{
+	struct SEE_layer *layer = (struct SEE_layer *)interp->layer;
+
+	if (layer->parent && !layer->nobjects && !layer->ncopies &&
+	    !_SEE_intern_count(interp))
+		return;
+	layer->frozen = 1;
+	interp->layer = layer_new(interp, layer);
+	interp->shapes = NULL;		/* shape tables grow in place */
+	_SEE_intern_freeze(interp);
+}
+
+/* Gives a copy of a frozen interpreter its own layer */
+void
+_SEE_layer_clone(interp, orig)
+	struct SEE_interpreter *interp, *orig;
+{
+	struct SEE_layer *parent = ((struct SEE_layer *)orig->layer)->parent;
+
+	SEE_ASSERT(orig, parent && parent->frozen);
+	interp->layer = layer_new(interp, parent);
+	interp->shapes = NULL;
+}
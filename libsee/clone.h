@@ -0,0 +1,69 @@
+/* Copyright (c) 2009, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_clone_
+#define _SEE_h_clone_
+
+#include <see/type.h>
+
+struct SEE_interpreter;
+struct SEE_native;
+struct layer_entry;
+
+/*
+ * Layers of objects shared between interpreters (see clone.c).
+ *
+ * Every native object belongs to the layer of the interpreter that
+ * made it. An interpreter changes the objects of its own layer in
+ * place. Objects of the frozen layers below its own are only read;
+ * the first change an interpreter makes to one is made to a private
+ * copy, which it uses from then on. _SEE_NATIVE_READ() and
+ * _SEE_NATIVE_WRITE() return the struct that an interpreter is to
+ * read or change in place of a native object. The struct returned
+ * is not the object: it must not be passed on, stored or returned
+ * to scripts.
+ */
+struct SEE_layer {
+	struct SEE_layer *parent;	/* frozen layer below, or NULL */
+	int frozen;			/* never changes again */
+	unsigned int nobjects;		/* objects made in this layer */
+	unsigned int ncopies;		/* objects copied into this layer */
+	struct layer_entry *tab;	/* open-addressed map of views */
+	unsigned int ntab, size;
+};
+
+#define _SEE_NATIVE_READ(interp, n)					\
+	((n)->layer == (struct SEE_layer *)(interp)->layer ? (n)	\
+	    : _SEE_native_read(interp, n))
+#define _SEE_NATIVE_WRITE(interp, n)					\
+	((n)->layer == (struct SEE_layer *)(interp)->layer ? (n)	\
+	    : _SEE_native_write(interp, n))
+
+/* True if the interpreter made the object and may change it in place */
+#define _SEE_NATIVE_IS_OWN(interp, n)					\
+	((n)->layer == (struct SEE_layer *)(interp)->layer)
+
+struct SEE_native *_SEE_native_read(struct SEE_interpreter *interp,
+	struct SEE_native *n);
+struct SEE_native *_SEE_native_write(struct SEE_interpreter *interp,
+	struct SEE_native *n);
+
+void  _SEE_layer_init(struct SEE_interpreter *interp);
+void  _SEE_layer_freeze(struct SEE_interpreter *interp);
+void  _SEE_layer_clone(struct SEE_interpreter *interp,
+	struct SEE_interpreter *orig);
+
+/* native.c */
+struct SEE_native *_SEE_native_copy(struct SEE_interpreter *interp,
+	struct SEE_native *n, SEE_size_t size);
+
+/* intern.c */
+int  _SEE_intern_count(struct SEE_interpreter *interp);
+void _SEE_intern_freeze(struct SEE_interpreter *interp);
+void _SEE_intern_clone(struct SEE_interpreter *interp,
+	struct SEE_interpreter *orig);
+
+/* regex.c */
+void _SEE_regex_cache_clone(struct SEE_interpreter *interp,
+	struct SEE_interpreter *orig);
+
+#endif /* _SEE_h_clone_ */
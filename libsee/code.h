@@ -30,7 +30,9 @@ enum SEE_code_op1 {
 	SEE_CODE_CALL, 			/* any any1..anyn | val */
 	SEE_CODE_END,			/*              - | -   */
 	SEE_CODE_VREF, 			/*                | ref */
-	SEE_CODE_PUTVALUEA		/*        ref val | -   */
+	SEE_CODE_PUTVALUEA,		/*        ref val | -   */
+	SEE_CODE_GETLOCAL,		/*              - | val */
+	SEE_CODE_PUTLOCAL		/*            val | -   */
 };
 
 /* Operand-less operators that work on the stack, virtual registers etc. */
@@ -48,6 +50,7 @@ enum SEE_code_op0 {
 	SEE_CODE_ARRAY,			/*           - | obj	    */
 	SEE_CODE_REGEXP,		/*           - | obj	    */
 	SEE_CODE_REF,			/*     obj str | ref	    */
+	SEE_CODE_EREF,			/*     obj val | ref	    */
 	SEE_CODE_GETVALUE,		/*         ref | val	    */
 	SEE_CODE_LOOKUP,		/*         str | ref	    */
 	SEE_CODE_PUTVALUE,		/*     ref val | -	    */
@@ -166,4 +169,10 @@ struct SEE_code {
 
 struct SEE_code *_SEE_code1_alloc(struct SEE_interpreter *interp);
 
+/* Serialises a compiled function and the functions nested in it */
+void _SEE_code1_save(struct SEE_interpreter *interp, struct function *f,
+		unsigned char **bufp, unsigned int *lenp);
+struct function *_SEE_code1_load(struct SEE_interpreter *interp,
+		const unsigned char *buf, unsigned int len);
+
 #endif /* _SEE_h_code_ */
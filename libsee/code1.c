@@ -51,6 +51,7 @@
 #include <see/system.h>
 #include <see/intern.h>
 #include <see/eval.h>
+#include <see/native.h>
 
 #include "dprint.h"
 #include "code.h"
@@ -61,6 +62,8 @@
 #include "enumerate.h"
 #include "code1.h"
 #include "replace.h"
+#include "shape.h"
+#include "array.h"
 
 struct block {
     enum { 
@@ -78,14 +81,17 @@ struct block {
 	} enum_context;
 	struct SEE_scope *with;
 	struct {
-	    SEE_try_context_t context;
+	    struct SEE_value thrown;	/* exception to rethrow at ENDF */
+	    struct SEE_traceback *traceback; /* where thrown was thrown */
+	    const char *throw_file;
+	    int throw_line;
+	    int pending;		/* true if thrown is valid */
 	    struct block *last_try_block;
 	    SEE_int32_t handler;
 	    unsigned int stack;
 	    SEE_int32_t resume;
 	} finally;
 	struct {
-	    SEE_try_context_t context;
 	    struct block *last_try_block;
 	    SEE_int32_t handler;
 	    unsigned int stack;
@@ -127,7 +133,18 @@ static unsigned int add_location(struct code1 *code,
 static unsigned int add_function(struct code1 *code, struct function *f);
 static unsigned int add_var(struct code1 *code, struct SEE_string *ident);
 static void add_byte(struct code1 *code, unsigned int c);
+static SEE_int32_t add_ic(struct code1 *code);
 static unsigned int here(struct code1 *code);
+static void decode(struct code1 *code);
+static void fuse(struct code1 *code);
+
+struct writer;
+struct reader;
+static void save_code(struct writer *w, struct code1 *co);
+static void save_function(struct writer *w, struct function *f);
+static struct SEE_code *load_code(struct reader *r, unsigned int nslots);
+static struct function *load_function(struct reader *r);
+static int verify(struct code1 *co, unsigned int nslots);
 
 
 static struct SEE_code_class code1_class = {
@@ -147,6 +164,19 @@ static struct SEE_code_class code1_class = {
     code1_exec
 };
 
+/* Fetch next instruction byte into op,arg and increment pc */
+#define FETCH_INST(pc, op, arg)	 do {			    \
+            op = *pc++;					    \
+            if ((op & INST_ARG_MASK) == INST_ARG_NONE) 	    \
+                arg = 0;				    \
+            else if ((op & INST_ARG_MASK) == INST_ARG_BYTE) \
+                arg = *pc++;				    \
+            else {					    \
+                memcpy(&arg, pc, sizeof arg);		    \
+                pc += sizeof arg;			    \
+            }						    \
+        } while (0)
+
 #ifndef NDEBUG
 extern int SEE_eval_debug;
 int SEE_code_debug;
@@ -171,6 +201,8 @@ _SEE_code1_alloc(interp)
     co->maxstack = -1;
     co->maxblock = -1;
     co->maxargc = 0;
+    co->ic = NULL;
+    co->nic = 0;
     return (struct SEE_code *)co;
 }
 
@@ -315,6 +347,16 @@ add_byte(code, c)
     code->inst[offset] = c;
 }
 
+/* Allocates an inline cache, returning its number in operand position */
+static SEE_int32_t
+add_ic(code)
+    struct code1 *code;
+{
+    if (code->nic >= INST_IC_MAX)
+	return 0;
+    return (SEE_int32_t)++code->nic << INST_IC_SHIFT;
+}
+
 static unsigned int
 here(code)
     struct code1 *code;
@@ -412,9 +454,12 @@ code1_gen_op0(sco, op)
 	case SEE_CODE_ARRAY:	add_byte(co, INST_ARRAY); break;
 	case SEE_CODE_REGEXP:	add_byte(co, INST_REGEXP); break;
 	case SEE_CODE_REF:	add_byte(co, INST_REF); break;
-	case SEE_CODE_GETVALUE:	add_byte(co, INST_GETVALUE); break;
+	case SEE_CODE_EREF:	add_byte_arg(co, INST_REF, 1); break;
+	case SEE_CODE_GETVALUE:	add_byte_arg(co, INST_GETVALUE, add_ic(co));
+				break;
 	case SEE_CODE_LOOKUP:	add_byte(co, INST_LOOKUP); break;
-	case SEE_CODE_PUTVALUE:	add_byte(co, INST_PUTVALUE); break;
+	case SEE_CODE_PUTVALUE:	add_byte_arg(co, INST_PUTVALUE, add_ic(co));
+				break;
 	case SEE_CODE_DELETE:	add_byte(co, INST_DELETE); break;
 	case SEE_CODE_TYPEOF:	add_byte(co, INST_TYPEOF); break;
 	case SEE_CODE_TOOBJECT:	add_byte(co, INST_TOOBJECT); break;
@@ -470,10 +515,17 @@ code1_gen_op1(sco, op, n)
 
 	switch (op) {
 	case SEE_CODE_NEW:	add_byte_arg(co, INST_NEW, n); break;
-	case SEE_CODE_CALL:	add_byte_arg(co, INST_CALL, n); break;
+	case SEE_CODE_CALL:	if (n > INST_IC_ARG(~0))
+				    SEE_error_throw_string(sco->interpreter,
+					sco->interpreter->SyntaxError,
+					STR(too_many_args));
+				add_byte_arg(co, INST_CALL, n | add_ic(co));
+				break;
 	case SEE_CODE_END:	add_byte_arg(co, INST_END, n); break;
 	case SEE_CODE_VREF:	add_byte_arg(co, INST_VREF, n); break;
 	case SEE_CODE_PUTVALUEA:add_byte_arg(co, INST_PUTVALUE, n); break;
+	case SEE_CODE_GETLOCAL:	add_byte_arg(co, INST_GETLOCAL, n); break;
+	case SEE_CODE_PUTLOCAL:	add_byte_arg(co, INST_PUTLOCAL, n); break;
 	default: SEE_ASSERT(sco->interpreter, !"bad op1");
 	}
 
@@ -645,7 +697,630 @@ static void
 code1_close(sco)
 	struct SEE_code *sco;
 {
-	/* Not implemented */
+	struct code1 *co = CAST_CODE(sco);
+
+	if (co->nic) {
+	    co->ic = SEE_NEW_ARRAY(sco->interpreter, struct SEE_ic, co->nic);
+	    memset(co->ic, 0, co->nic * sizeof co->ic[0]);
+	}
+	decode(co);
+	fuse(co);
+#if HAVE_COMPUTED_GOTO
+	code1_exec(sco, NULL, NULL);	/* threads the instructions */
+#endif
+}
+
+/* Decodes the byte stream into the instruction array used by exec */
+static void
+decode(co)
+	struct code1 *co;
+{
+	struct SEE_interpreter *interp = co->code.interpreter;
+	unsigned char *pc, *end, op;
+	SEE_int32_t arg, *index;
+	unsigned int n;
+
+	/* Number the instructions by their byte offsets */
+	index = SEE_NEW_ARRAY(interp, SEE_int32_t, co->ninst + 1);
+	end = co->inst + co->ninst;
+	n = 0;
+	for (pc = co->inst; pc < end; n++) {
+	    index[pc - co->inst] = n;
+	    FETCH_INST(pc, op, arg);
+	}
+	index[co->ninst] = n;
+
+	co->dinst = SEE_NEW_ARRAY(interp, struct code1_inst, n);
+	co->ndinst = n;
+	n = 0;
+	for (pc = co->inst; pc < end; n++) {
+#ifndef NDEBUG
+	    co->dinst[n].offset = pc - co->inst;
+#endif
+	    FETCH_INST(pc, op, arg);
+	    op &= INST_OP_MASK;
+	    switch (op) {
+	    case INST_B_ALWAYS:
+	    case INST_B_TRUE:
+	    case INST_B_ENUM:
+	    case INST_S_TRYC:
+	    case INST_S_TRYF:
+		SEE_ASSERT(interp, arg >= 0 && arg <= co->ninst);
+		arg = index[arg];
+		break;
+	    }
+	    co->dinst[n].op = op;
+	    co->dinst[n].arg = arg;
+	}
+	SEE_free(interp, (void **)&index);
+}
+
+/*
+ * Replaces common instruction sequences with superinstructions.
+ * Only the first instruction of a sequence is changed, and the
+ * superinstruction reads the operands of the others from where
+ * they are. That way, sequences may overlap, and branches to the
+ * following instructions need no adjustment.
+ */
+static void
+fuse(co)
+	struct code1 *co;
+{
+	struct code1_inst *d = co->dinst;
+	unsigned int i, n = co->ndinst;
+
+	for (i = 0; i + 1 < n; i++)
+	    switch (d[i].op) {
+	    case INST_VREF:
+		if (d[i + 1].op == INST_GETVALUE)
+		    d[i].op = INST_VREF_GETVALUE;
+		break;
+	    case INST_DUP:
+		if (d[i + 1].op == INST_GETVALUE)
+		    d[i].op = INST_DUP_GETVALUE;
+		break;
+	    case INST_LITERAL:
+		if (d[i + 1].op == INST_LOOKUP)
+		    d[i].op = INST_LITERAL_LOOKUP;
+		else if (d[i + 1].op == INST_ADD)
+		    d[i].op = INST_LITERAL_ADD;
+		break;
+	    case INST_EXCH:
+		if (i + 3 < n && d[i + 2].op == INST_EXCH &&
+		    d[i + 1].op == d[i + 3].op)
+		{
+		    if (d[i + 1].op == INST_TONUMBER)
+			d[i].op = INST_TONUMBER2;
+		    else if (d[i + 1].op == INST_TOPRIMITIVE)
+			d[i].op = INST_TOPRIMITIVE2;
+		}
+		break;
+	    case INST_LT:
+	    case INST_GT:
+	    case INST_LE:
+	    case INST_GE:
+	    case INST_EQ:
+	    case INST_SEQ:
+		if (d[i + 1].op != INST_B_TRUE)
+		    break;
+		switch (d[i].op) {
+		case INST_LT:	d[i].op = INST_LT_B_TRUE; break;
+		case INST_GT:	d[i].op = INST_GT_B_TRUE; break;
+		case INST_LE:	d[i].op = INST_LE_B_TRUE; break;
+		case INST_GE:	d[i].op = INST_GE_B_TRUE; break;
+		case INST_EQ:	d[i].op = INST_EQ_B_TRUE; break;
+		case INST_SEQ:	d[i].op = INST_SEQ_B_TRUE; break;
+		}
+		break;
+	    }
+}
+
+/*------------------------------------------------------------
+ * Saving and loading
+ *
+ * A function is saved as its name, parameter and local names,
+ * and then, if it has a body, the body's byte stream and tables.
+ * Nested functions are saved recursively in the func table.
+ * Unsigned integers are written in 7-bit groups, least significant
+ * first, with the top bit set on all but the last group; signed
+ * integers are first folded so that small negatives stay short.
+ * Strings are written as their length plus one (0 is NULL) and
+ * then their UTF-16 units. Numbers and the byte stream's word
+ * operands are in host order; the caller's header identifies the
+ * host. The decoded instructions and inline caches are rebuilt by
+ * code1_close() on loading.
+ */
+
+struct writer {
+    struct SEE_interpreter *interp;
+    unsigned char *buf;
+    unsigned int len;
+    struct SEE_growable grow;
+};
+
+struct reader {
+    struct SEE_interpreter *interp;
+    const unsigned char *p, *end;
+    int bad;			/* set by reading past the end */
+};
+
+#define LIT_UNDEFINED	0
+#define LIT_NULL	1
+#define LIT_FALSE	2
+#define LIT_TRUE	3
+#define LIT_NUMBER	4
+#define LIT_STRING	5
+
+static void
+put_byte(w, c)
+    struct writer *w;
+    unsigned int c;
+{
+    SEE_GROW_TO(w->interp, &w->grow, w->len + 1);
+    w->buf[w->len - 1] = c;
+}
+
+static void
+put_uint(w, n)
+    struct writer *w;
+    SEE_uint32_t n;
+{
+    while (n >= 0x80) {
+	put_byte(w, (n & 0x7f) | 0x80);
+	n >>= 7;
+    }
+    put_byte(w, n);
+}
+
+static void
+put_int(w, n)
+    struct writer *w;
+    SEE_int32_t n;
+{
+    put_uint(w, n < 0 ? ((~(SEE_uint32_t)n) << 1) | 1 : (SEE_uint32_t)n << 1);
+}
+
+static void
+put_bytes(w, p, len)
+    struct writer *w;
+    const void *p;
+    unsigned int len;
+{
+    unsigned int pos = w->len;
+
+    SEE_GROW_TO(w->interp, &w->grow, w->len + len);
+    memcpy(w->buf + pos, p, len);
+}
+
+static void
+put_string(w, s)
+    struct writer *w;
+    const struct SEE_string *s;
+{
+    unsigned int i;
+
+    if (!s) {
+	put_uint(w, 0);
+	return;
+    }
+    put_uint(w, s->length + 1);
+    for (i = 0; i < s->length; i++)
+	put_uint(w, s->data[i]);
+}
+
+static void
+save_code(w, co)
+    struct writer *w;
+    struct code1 *co;
+{
+    struct SEE_interpreter *interp = w->interp;
+    struct SEE_value *v;
+    unsigned int i;
+
+    put_uint(w, co->ninst);
+    put_bytes(w, co->inst, co->ninst);
+
+    put_uint(w, co->nliteral);
+    for (i = 0; i < co->nliteral; i++) {
+	v = &co->literal[i];
+	switch (SEE_VALUE_GET_TYPE(v)) {
+	case SEE_UNDEFINED: 
+	    put_byte(w, LIT_UNDEFINED); 
+	    break;
+	case SEE_NULL:
+	    put_byte(w, LIT_NULL);
+	    break;
+	case SEE_BOOLEAN:
+	    put_byte(w, v->u.boolean ? LIT_TRUE : LIT_FALSE);
+	    break;
+	case SEE_NUMBER:
+	    put_byte(w, LIT_NUMBER);
+	    put_bytes(w, &v->u.number, sizeof v->u.number);
+	    break;
+	case SEE_STRING:
+	    put_byte(w, LIT_STRING);
+	    put_string(w, v->u.string);
+	    break;
+	default:
+	    SEE_error_throw_string(interp, interp->Error,
+		STR(program_not_saveable));
+	}
+    }
+
+    put_uint(w, co->nlocation);
+    for (i = 0; i < co->nlocation; i++) {
+	put_string(w, co->location[i].filename);
+	put_int(w, co->location[i].lineno);
+    }
+
+    put_uint(w, co->nfunc);
+    for (i = 0; i < co->nfunc; i++)
+	save_function(w, co->func[i]);
+
+    put_uint(w, co->nvar);
+    for (i = 0; i < co->nvar; i++)
+	put_uint(w, co->var[i]);
+
+    put_int(w, co->maxstack);
+    put_int(w, co->maxblock);
+    put_int(w, co->maxargc);
+    put_uint(w, co->nic);
+}
+
+static void
+save_function(w, f)
+    struct writer *w;
+    struct function *f;
+{
+    int i;
+
+    put_string(w, f->name);
+    put_uint(w, f->nparams);
+    for (i = 0; i < f->nparams; i++)
+	put_string(w, f->params[i]);
+    put_uint(w, f->nlocals);
+    for (i = 0; i < f->nlocals; i++)
+	put_string(w, f->locals[i]);
+    if (f->body) {
+	put_byte(w, 1);
+	save_code(w, CAST_CODE((struct SEE_code *)f->body));
+    } else
+	put_byte(w, 0);
+}
+
+/*
+ * Serialises a function compiled by the code1 generator, and all the
+ * functions nested inside it. Returns the bytes in *bufp and *lenp.
+ * Throws an Error if the code holds a literal that cannot be saved.
+ */
+void
+_SEE_code1_save(interp, f, bufp, lenp)
+    struct SEE_interpreter *interp;
+    struct function *f;
+    unsigned char **bufp;
+    unsigned int *lenp;
+{
+    struct writer w;
+
+    w.interp = interp;
+    SEE_GROW_INIT(interp, &w.grow, w.buf, w.len);
+    w.grow.is_string = 1;
+    save_function(&w, f);
+    *bufp = w.buf;
+    *lenp = w.len;
+}
+
+static unsigned int
+get_byte(r)
+    struct reader *r;
+{
+    if (r->p >= r->end) {
+	r->bad = 1;
+	return 0;
+    }
+    return *r->p++;
+}
+
+static SEE_uint32_t
+get_uint(r)
+    struct reader *r;
+{
+    SEE_uint32_t n = 0;
+    unsigned int c, shift;
+
+    for (shift = 0; shift < 32; shift += 7) {
+	c = get_byte(r);
+	n |= (SEE_uint32_t)(c & 0x7f) << shift;
+	if (!(c & 0x80))
+	    return n;
+    }
+    r->bad = 1;
+    return 0;
+}
+
+static SEE_int32_t
+get_int(r)
+    struct reader *r;
+{
+    SEE_uint32_t n = get_uint(r);
+
+    return (n & 1) ? (SEE_int32_t)~(n >> 1) : (SEE_int32_t)(n >> 1);
+}
+
+/* Reads a count of items, each at least one byte long */
+static unsigned int
+get_count(r)
+    struct reader *r;
+{
+    SEE_uint32_t n = get_uint(r);
+
+    if (n > (SEE_uint32_t)(r->end - r->p)) {
+	r->bad = 1;
+	return 0;
+    }
+    return n;
+}
+
+static void
+get_bytes(r, p, len)
+    struct reader *r;
+    void *p;
+    unsigned int len;
+{
+    if (len > (unsigned int)(r->end - r->p)) {
+	r->bad = 1;
+	memset(p, 0, len);
+	return;
+    }
+    memcpy(p, r->p, len);
+    r->p += len;
+}
+
+/* Reads a string, returning it interned */
+static struct SEE_string *
+get_string(r)
+    struct reader *r;
+{
+    struct SEE_string *s;
+    unsigned int i, len;
+
+    len = get_count(r);
+    if (len-- == 0)
+	return NULL;
+    s = SEE_string_new(r->interp, len);
+    for (i = 0; i < len; i++)
+	s->data[i] = get_uint(r);
+    s->length = len;
+    return SEE_intern(r->interp, s);
+}
+
+/*
+ * Checks that every instruction lies inside the byte stream, that
+ * branches land on instructions and that operands index the tables
+ * that were loaded with it.
+ */
+static int
+verify(co, nslots)
+    struct code1 *co;
+    unsigned int nslots;
+{
+    struct SEE_interpreter *interp = co->code.interpreter;
+    unsigned char *pc, *end, *start, op;
+    SEE_int32_t arg;
+    char *boundary;
+    unsigned int i, size;
+
+    end = co->inst + co->ninst;
+    boundary = SEE_NEW_STRING_ARRAY(interp, char, co->ninst + 1);
+    memset(boundary, 0, co->ninst + 1);
+    for (pc = co->inst; pc < end; ) {
+	boundary[pc - co->inst] = 1;
+	op = *pc;
+	size = (op & INST_ARG_MASK) == INST_ARG_NONE ? 1 :
+	       (op & INST_ARG_MASK) == INST_ARG_BYTE ? 2 : 1 + sizeof arg;
+	if ((op & INST_ARG_MASK) == INST_ARG_MASK || 
+		size > (unsigned int)(end - pc))
+	    return 0;
+	pc += size;
+    }
+    boundary[co->ninst] = 1;
+
+    for (i = 0; i < co->nvar; i++)
+	if (co->var[i] >= co->nliteral ||
+	    SEE_VALUE_GET_TYPE(&co->literal[co->var[i]]) != SEE_STRING)
+		return 0;
+
+    for (pc = co->inst; pc < end; ) {
+	start = pc;
+	FETCH_INST(pc, op, arg);
+	switch (op & INST_OP_MASK) {
+	case INST_B_ALWAYS: case INST_B_TRUE: case INST_B_ENUM:
+	case INST_S_TRYC: case INST_S_TRYF:
+	    if ((op & INST_ARG_MASK) != INST_ARG_WORD ||
+		    arg < 0 || (unsigned int)arg > co->ninst ||
+		    !boundary[arg])
+		return 0;
+	    break;
+	case INST_LITERAL:
+	    if (arg < 0 || (unsigned int)arg >= co->nliteral)
+		return 0;
+	    break;
+	case INST_FUNC:
+	    if (arg < 0 || (unsigned int)arg >= co->nfunc)
+		return 0;
+	    break;
+	case INST_LOC:
+	    if (arg < 0 || (unsigned int)arg >= co->nlocation)
+		return 0;
+	    break;
+	case INST_VREF:
+	    if (arg < 0 || (unsigned int)arg >= co->nvar)
+		return 0;
+	    break;
+	case INST_GETLOCAL:
+	case INST_PUTLOCAL:
+	    if (arg < 0 || (unsigned int)arg >= nslots)
+		return 0;
+	    break;
+	case INST_GETVALUE:
+	case INST_PUTVALUE:
+	case INST_CALL:
+	    if (arg < 0 || (unsigned int)INST_IC(arg) > co->nic)
+		return 0;
+	    break;
+	default:
+	    if ((op & INST_OP_MASK) > INST_PUTLOCAL)
+		return 0;
+	}
+    }
+    return 1;
+}
+
+static struct SEE_code *
+load_code(r, nslots)
+    struct reader *r;
+    unsigned int nslots;
+{
+    struct SEE_interpreter *interp = r->interp;
+    struct code1 *co;
+    struct SEE_value *v;
+    unsigned int i, n;
+
+    co = (struct code1 *)_SEE_code1_alloc(interp);
+
+    n = get_count(r);
+    SEE_GROW_TO(interp, &co->ginst, n);
+    get_bytes(r, co->inst, n);
+
+    n = get_count(r);
+    SEE_GROW_TO(interp, &co->gliteral, n);
+    for (i = 0; i < n; i++) {
+	v = &co->literal[i];
+	switch (get_byte(r)) {
+	case LIT_UNDEFINED: SEE_SET_UNDEFINED(v); break;
+	case LIT_NULL:	    SEE_SET_NULL(v); break;
+	case LIT_FALSE:	    SEE_SET_BOOLEAN(v, 0); break;
+	case LIT_TRUE:	    SEE_SET_BOOLEAN(v, 1); break;
+	case LIT_NUMBER:
+	    SEE_SET_NUMBER(v, 0);
+	    get_bytes(r, &v->u.number, sizeof v->u.number);
+	    break;
+	case LIT_STRING:
+	    SEE_SET_STRING(v, get_string(r));
+	    if (!v->u.string)
+		r->bad = 1;
+	    break;
+	default:
+	    SEE_SET_UNDEFINED(v);
+	    r->bad = 1;
+	}
+    }
+
+    n = get_count(r);
+    SEE_GROW_TO(interp, &co->glocation, n);
+    for (i = 0; i < n; i++) {
+	co->location[i].filename = get_string(r);
+	co->location[i].lineno = get_int(r);
+    }
+
+    n = get_count(r);
+    SEE_GROW_TO(interp, &co->gfunc, n);
+    for (i = 0; i < n && !r->bad; i++)
+	co->func[i] = load_function(r);
+    if (r->bad)
+	return NULL;
+
+    n = get_count(r);
+    SEE_GROW_TO(interp, &co->gvar, n);
+    for (i = 0; i < n; i++)
+	co->var[i] = get_uint(r);
+
+    co->maxstack = get_int(r);
+    co->maxblock = get_int(r);
+    co->maxargc = get_int(r);
+    co->nic = get_uint(r);
+
+    if (r->bad || co->maxstack < 0 || co->maxblock < 0 || 
+	    co->maxargc < 0 || co->nic > INST_IC_MAX || !verify(co, nslots))
+    {
+	r->bad = 1;
+	return NULL;
+    }
+    code1_close((struct SEE_code *)co);
+    return (struct SEE_code *)co;
+}
+
+static struct function *
+load_function(r)
+    struct reader *r;
+{
+    struct SEE_interpreter *interp = r->interp;
+    struct SEE_string *name, **locals;
+    struct var *params, **vp;
+    struct function *f;
+    void *body;
+    unsigned int i, nparams, nlocals;
+
+    name = get_string(r);
+    nparams = get_count(r);
+    params = NULL;
+    vp = &params;
+    for (i = 0; i < nparams; i++) {
+	*vp = SEE_NEW(interp, struct var);
+	(*vp)->name = get_string(r);
+	(*vp)->next = NULL;
+	if (!(*vp)->name)
+	    r->bad = 1;
+	vp = &(*vp)->next;
+    }
+    nlocals = get_count(r);
+    locals = nlocals ? 
+	SEE_NEW_ARRAY(interp, struct SEE_string *, nlocals) : NULL;
+    for (i = 0; i < nlocals; i++)
+	if (!(locals[i] = get_string(r)))
+	    r->bad = 1;
+
+    body = NULL;
+    switch (get_byte(r)) {
+    case 0:
+	break;
+    case 1:
+	if (!r->bad)
+	    body = load_code(r, nparams + nlocals);
+	break;
+    default:
+	r->bad = 1;
+    }
+    if (r->bad)
+	return NULL;
+
+    f = SEE_function_make(interp, name, params, body);
+    f->nlocals = nlocals;
+    f->locals = locals;
+    return f;
+}
+
+/*
+ * Rebuilds a function saved by _SEE_code1_save(). 
+ * Returns NULL if the bytes are malformed.
+ */
+struct function *
+_SEE_code1_load(interp, buf, len)
+    struct SEE_interpreter *interp;
+    const unsigned char *buf;
+    unsigned int len;
+{
+    struct reader r;
+    struct function *f;
+
+    r.interp = interp;
+    r.p = buf;
+    r.end = buf + len;
+    r.bad = 0;
+    f = load_function(&r);
+    if (r.bad || r.p != r.end)
+	return NULL;
+    return f;
 }
 
 /*------------------------------------------------------------
@@ -663,10 +1338,43 @@ GetValue(interp, vp)
 	    struct SEE_string *prop = vp->u.reference.property;
 	    if (base == NULL)
 		SEE_error_throw_string(interp, interp->ReferenceError, prop);
-	    SEE_OBJECT_GET(interp, base, SEE_intern(interp, prop), vp);
+	    if (prop == NULL)
+		SEE_Array_getindex(interp, base, vp->u.reference.index, vp);
+	    else
+		SEE_OBJECT_GET(interp, base, SEE_intern(interp, prop), vp);
 	}
 }
 
+/* Returns the property name of a reference, for the slow paths */
+static struct SEE_string *
+RefName(interp, vp)
+	struct SEE_interpreter *interp;
+	struct SEE_value *vp;
+{
+	if (vp->u.reference.property == NULL)
+	    return SEE_Array_indexname(interp, vp->u.reference.index);
+	return SEE_intern(interp, vp->u.reference.property);
+}
+
+/* Converts a reference to a value, in situ, using an inline cache */
+static void
+GetValueIC(interp, ic, vp)
+	struct SEE_interpreter *interp;
+	struct SEE_ic *ic;
+	struct SEE_value *vp;
+{
+	struct SEE_object *base;
+
+	if (ic && SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE &&
+	    (base = vp->u.reference.base) != NULL &&
+	    base->objectclass->Get == SEE_native_get &&
+	    vp->u.reference.property != NULL)
+	    _SEE_native_ic_get(interp, ic, base, vp->u.reference.property,
+		vp);
+	else
+	    GetValue(interp, vp);
+}
+
 static void
 AbstractRelational(interp, x, y, res)
 	struct SEE_interpreter *interp;
@@ -802,29 +1510,107 @@ Eq(interp, x, y)
                 return 0;
 }
 
+#ifndef NDEBUG
+/* Prints the machine state before an instruction is executed */
+static void
+trace_inst(interp, co, insn, res, stackbottom, stack, blockbottom, blocklevel)
+	struct SEE_interpreter *interp;
+	struct code1 *co;
+	struct code1_inst *insn;
+	struct SEE_value *res, *stackbottom, *stack;
+	struct block *blockbottom;
+	int blocklevel;
+{
+	struct block *block;
+	int i;
+
+	dprintf("C=");
+	dprintv(interp, res);
+	dprintf(" stack=");
+	if (stack == stackbottom)
+	    dprintf("[]");
+	else {
+	    dprintf("[");
+	    if (stack < stackbottom + 4)
+	        i = 0;
+	    else {
+	        i = stack - (stackbottom + 4);
+	        dprintf(" ...");
+	    }
+	    for (; i < stack - stackbottom; i++) {
+	        dprintf(" ");
+	        dprintv(interp, stackbottom + i);
+	    }
+	    dprintf(" ]");
+	}
+	dprintf(" blocks=");
+	if (blocklevel == 0)
+	    dprintf("[]");
+	else {
+	    dprintf("[");
+	    for (i = 0; i < blocklevel; i++)
+	        switch((block = &blockbottom[i])->type) {
+	        case BLOCK_ENUM: 
+	            dprintf(" ENUM"); 
+	            break;
+	        case BLOCK_WITH: 
+	            dprintf(" WITH"); 
+	            break; 
+	        case BLOCK_CATCH: 
+	            dprintf(" CATCH<%x>", block->u.catch.handler); 
+	            break; 
+	        case BLOCK_FINALLY: 
+	            dprintf(" FINALLY<%x/%u>", 
+	                    block->u.finally.handler,
+	                    block->u.finally.stack); 
+	            break; 
+	        case BLOCK_FINALLY2: 
+	            dprintf(" FINALLY2<%x/%u>", 
+	                    block->u.finally.resume,
+	                    block->u.finally.stack); 
+	            break;
+	        default:
+	            dprintf(" ?");
+	        }
+	    dprintf(" ]");
+	}
+	dprintf("\n");
+	if (insn->op > INST_OP_MASK)
+	    dprintf("[super 0x%02x] ", insn->op);
+	disasm(co, insn->offset);
+}
+#endif
+
 static void
 code1_exec(sco, ctxt, res)
 	struct SEE_code *sco;
 	struct SEE_context *ctxt;
 	struct SEE_value *res;
 {
-	struct SEE_interpreter * const interp = ctxt->interpreter;
+	struct SEE_interpreter * const interp =
+	    ctxt ? ctxt->interpreter : sco->interpreter;
 	struct code1 * const co = CAST_CODE(sco);
+	struct SEE_ic * const ics =
+	    co->code.interpreter == interp ? co->ic : NULL;
 	struct SEE_string *str;
 	struct SEE_value t, u, v;		/* scratch values */
 	struct SEE_value *up, *vp, *wp;
 	struct SEE_value **argv;
 	struct SEE_value undefined, Number;
 	struct SEE_object *obj, *baseobj;
+	struct SEE_ic *ic;
 	struct SEE_throw_location *location = NULL;
+	struct code1_inst *insn;
+#if !HAVE_COMPUTED_GOTO
 	unsigned char op;
+#endif
 	SEE_int32_t arg;
 	SEE_int32_t int32;
 	SEE_uint32_t uint32;
 	int i, new_blocklevel;
 	SEE_number_t number;
 #define VOLATILE /* volatile */
-	VOLATILE unsigned char *pc;
+	VOLATILE struct code1_inst *ip;
 	VOLATILE struct SEE_value *stackbottom;
 	VOLATILE struct SEE_value *stack;
 	VOLATILE struct block *blockbottom, *block;
@@ -832,6 +1618,12 @@ code1_exec(sco, ctxt, res)
 	VOLATILE int blocklevel;
 	VOLATILE struct enum_context *enum_context = NULL;
 	VOLATILE struct SEE_scope *scope;
+	VOLATILE int armed = 0;
+	SEE_try_context_t frame_try;
+	struct SEE_traceback *traceback;	/* of the exception in t */
+	const char *throw_file;
+	int throw_line;
+	struct SEE_value *slots = NULL;
 
 /*
  * The PUSH() and POP() macros work by setting /pointers/ into
@@ -904,6 +1696,99 @@ code1_exec(sco, ctxt, res)
 	SEE_error_throw_string(interp, interp->Error,	\
 	    STR(not_implemented));
 
+/*
+ * Instruction dispatch. With computed goto, every handler ends by
+ * jumping straight to the handler of the next instruction (direct
+ * threading). Otherwise the handlers are the cases of a switch
+ * inside a loop. GOTO_OP() continues with the handler of another
+ * instruction; superinstructions use it when their fast path does
+ * not apply.
+ */
+#if HAVE_COMPUTED_GOTO
+# define CASE(name)	L_##name
+# define DEFAULT	L_bad
+# define GOTO_OP(name)	goto L_##name
+# define NEXT do {					\
+	FETCH();					\
+	goto *insn->label;				\
+    } while (0)
+#else
+# define CASE(name)	case INST_##name
+# define DEFAULT	default
+# define GOTO_OP(name)	do { op = INST_##name; goto dispatch; } while (0)
+# define NEXT		continue
+#endif
+
+/* Fetches the next instruction into insn and arg, advancing ip */
+#define FETCH() do {					\
+	SEE_ASSERT(interp, ip >= co->dinst);		\
+	SEE_ASSERT(interp, ip < co->dinst + co->ndinst); \
+	insn = (struct code1_inst *)ip++;		\
+	arg = insn->arg;				\
+	TRACE_INST();					\
+    } while (0)
+
+#ifndef NDEBUG
+# define TRACE_INST() do {				\
+	if (SEE_eval_debug > 1)				\
+	    trace_inst(interp, co, insn, res, stackbottom, \
+		stack, blockbottom, blocklevel);	\
+    } while (0)
+#else
+# define TRACE_INST() /* nothing */
+#endif
+
+/*
+ * The inline cache of an instruction, or NULL. The caches remember
+ * the shapes of one interpreter's objects, so they are not used when
+ * copies of the interpreter run its code (see clone.c).
+ */
+#define INST_CACHE(arg) (INST_IC(arg) && ics ? &ics[INST_IC(arg) - 1] : NULL)
+
+/* True when the top two stack values are numbers */
+#define NUMBERS2() (SEE_VALUE_GET_TYPE(stack - 2) == SEE_NUMBER &&	\
+		    SEE_VALUE_GET_TYPE(stack - 1) == SEE_NUMBER)
+
+#if HAVE_COMPUTED_GOTO
+    /*
+     * Called by code1_close() without a context, to point each
+     * instruction at its handler. This is not left until the first
+     * run, because copies of the interpreter (see clone.c) share the
+     * code and may run it at the same time.
+     */
+    if (!ctxt) {
+	static const void * const labels[] = {
+	    &&L_NOP, &&L_DUP, &&L_POP, &&L_EXCH,			/* 0x00 */
+	    &&L_ROLL3, &&L_THROW, &&L_SETC, &&L_GETC,
+	    &&L_THIS, &&L_OBJECT, &&L_ARRAY, &&L_REGEXP,
+	    &&L_REF, &&L_GETVALUE, &&L_LOOKUP, &&L_PUTVALUE,
+	    &&L_VREF, &&L_GETLOCAL, &&L_DELETE, &&L_TYPEOF,		/* 0x10 */
+	    &&L_TOOBJECT, &&L_TONUMBER, &&L_TOBOOLEAN, &&L_TOSTRING,
+	    &&L_TOPRIMITIVE, &&L_NEG, &&L_INV, &&L_NOT,
+	    &&L_MUL, &&L_DIV, &&L_MOD, &&L_ADD,
+	    &&L_SUB, &&L_LSHIFT, &&L_RSHIFT, &&L_URSHIFT,		/* 0x20 */
+	    &&L_LT, &&L_GT, &&L_LE, &&L_GE,
+	    &&L_INSTANCEOF, &&L_IN, &&L_EQ, &&L_SEQ,
+	    &&L_BAND, &&L_BXOR, &&L_BOR, &&L_S_ENUM,
+	    &&L_S_WITH, &&L_NEW, &&L_CALL, &&L_END,			/* 0x30 */
+	    &&L_B_ALWAYS, &&L_B_TRUE, &&L_B_ENUM, &&L_S_TRYC,
+	    &&L_S_TRYF, &&L_FUNC, &&L_LITERAL, &&L_LOC,
+	    &&L_S_CATCH, &&L_ENDF, &&L_PUTLOCAL, &&L_bad,
+	    &&L_VREF_GETVALUE, &&L_DUP_GETVALUE,			/* 0x40 */
+	    &&L_LITERAL_LOOKUP, &&L_LITERAL_ADD,
+	    &&L_TONUMBER2, &&L_TOPRIMITIVE2,
+	    &&L_LT_B_TRUE, &&L_GT_B_TRUE, &&L_LE_B_TRUE, &&L_GE_B_TRUE,
+	    &&L_EQ_B_TRUE, &&L_SEQ_B_TRUE
+	};
+
+	SEE_ASSERT(interp, 
+	    sizeof labels / sizeof labels[0] == INST_NDECODED);
+	for (i = 0; i < co->ndinst; i++)
+	    co->dinst[i].label = labels[co->dinst[i].op];
+	return;
+    }
+#endif
+
 #ifndef NDEBUG
     /*SEE_eval_debug = 2; */
     if (SEE_eval_debug) {
@@ -968,188 +1853,155 @@ code1_exec(sco, ctxt, res)
 	                        ctxt->varattr);
     }
 
-    pc = co->inst;
+    /* Params and locals of a function body live in activation slots */
+    if (ctxt->variable && IS_ACTIVATION_OBJECT(ctxt->variable))
+	slots = SEE_activation_slots(interp, ctxt->variable);
+
+    ip = co->dinst;
     stack = stackbottom;
     scope = ctxt->scope;
-    for (;;) {
-
-	SEE_ASSERT(interp, pc >= co->inst);
-	SEE_ASSERT(interp, pc < co->inst + co->ninst);
 
-#ifndef NDEBUG
-	if (SEE_eval_debug > 1) {
-	    dprintf("C=");
-	    dprintv(interp, res);
-	    dprintf(" stack=");
-	    if (stack == stackbottom)
-		dprintf("[]");
-	    else {
-		dprintf("[");
-		if (stack < stackbottom + 4)
-		    i = 0;
-		else {
-		    i = stack - (stackbottom + 4);
-		    dprintf(" ...");
-		}
-		for (; i < stack - stackbottom; i++) {
-		    dprintf(" ");
-		    dprintv(interp, stackbottom + i);
-		}
-		dprintf(" ]");
-	    }
-	    dprintf(" blocks=");
-            if (blocklevel == 0)
-                dprintf("[]");
-            else {
-                dprintf("[");
-                for (i = 0; i < blocklevel; i++)
-                    switch((block = &blockbottom[i])->type) {
-                    case BLOCK_ENUM: 
-                        dprintf(" ENUM"); 
-                        break;
-                    case BLOCK_WITH: 
-                        dprintf(" WITH"); 
-                        break; 
-                    case BLOCK_CATCH: 
-                        dprintf(" CATCH<%x>", block->u.catch.handler); 
-                        break; 
-                    case BLOCK_FINALLY: 
-                        dprintf(" FINALLY<%x/%u>", 
-                                block->u.finally.handler,
-                                block->u.finally.stack); 
-                        break; 
-                    case BLOCK_FINALLY2: 
-                        dprintf(" FINALLY2<%x/%u>", 
-                                block->u.finally.resume,
-                                block->u.finally.stack); 
-                        break;
-                    default:
-                        dprintf(" ?");
-                    }
-                dprintf(" ]");
-            }
-            dprintf("\n");
-	    disasm(co, pc - co->inst);
-	}
+    for (;;) {
+#if HAVE_COMPUTED_GOTO
+	NEXT;
+	{
+#else
+	FETCH();
+	op = insn->op;
+    dispatch:
+	switch (op) {
 #endif
+	CASE(NOP):
+	    NEXT;
 
-	/* Fetch next instruction byte into op,arg and increment pc */
-#define FETCH_INST(pc, op, arg)	 do {			    \
-            op = *pc++;					    \
-            if ((op & INST_ARG_MASK) == INST_ARG_NONE) 	    \
-                arg = 0;				    \
-            else if ((op & INST_ARG_MASK) == INST_ARG_BYTE) \
-                arg = *pc++;				    \
-            else {					    \
-                memcpy(&arg, pc, sizeof arg);		    \
-                pc += sizeof arg;			    \
-            }						    \
-        } while (0)
-
-	FETCH_INST(pc, op, arg);
-
-	switch (op & INST_OP_MASK) {
-	case INST_NOP:
-	    break;
-
-	case INST_DUP:
+	CASE(DUP):
 	    TOP(vp);
 	    PUSH(up);
 	    SEE_VALUE_COPY(up, vp);
-	    break;
+	    NEXT;
 
-	case INST_POP:
+	CASE(POP):
 	    POP0();
-	    break;
+	    NEXT;
 
-	case INST_EXCH:
+	CASE(EXCH):
 	    SEE_VALUE_COPY(&t, stack - 1);
 	    SEE_VALUE_COPY(stack - 1, stack - 2);
 	    SEE_VALUE_COPY(stack - 2, &t);
-	    break;
+	    NEXT;
 	
-	case INST_ROLL3:
+	CASE(ROLL3):
 	    SEE_VALUE_COPY(&t, stack - 1);
 	    SEE_VALUE_COPY(stack - 1, stack - 2);
 	    SEE_VALUE_COPY(stack - 2, stack - 3);
 	    SEE_VALUE_COPY(stack - 3, &t);
-	    break;
+	    NEXT;
 
-	case INST_THROW:
+	CASE(THROW):
 	    POP(up);	/* val */
 	    TRACE(SEE_TRACE_THROW);
-	    SEE_THROW(interp, up);
-	    /* NOTREACHED */
-	    break;
-
-	case INST_SETC:
+	    SEE_VALUE_COPY(&t, up);
+	    traceback = interp->traceback;
+	    throw_file = __FILE__;
+	    throw_line = __LINE__;
+	    if (try_block)
+		goto caught;
+	    goto uncaught;
+
+	CASE(SETC):
 	    POP(vp);
 	    SEE_VALUE_COPY(res, vp);
-	    break;
+	    NEXT;
 
-	case INST_GETC:
+	CASE(GETC):
 	    PUSH(vp);
 	    SEE_VALUE_COPY(vp, res);
-	    break;
+	    NEXT;
 
-	case INST_THIS:
+	CASE(THIS):
 	    PUSH(vp);
 	    SEE_SET_OBJECT(vp, ctxt->thisobj);
-	    break;
+	    NEXT;
 
-	case INST_OBJECT:
+	CASE(OBJECT):
 	    PUSH(vp);
 	    SEE_SET_OBJECT(vp, interp->Object);
-	    break;
+	    NEXT;
 
-	case INST_ARRAY:
+	CASE(ARRAY):
 	    PUSH(vp);
 	    SEE_SET_OBJECT(vp, interp->Array);
-	    break;
+	    NEXT;
 
-	case INST_REGEXP:
+	CASE(REGEXP):
 	    PUSH(vp);	/* obj */
 	    SEE_SET_OBJECT(vp, interp->RegExp);
-	    break;
+	    NEXT;
 
-	case INST_REF:
-	    POP(up);	/* str */
+	CASE(REF):
+	    POP(up);	/* str, or any with REF,1 */
 	    TOP(vp);	/* obj */
-	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_STRING);
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
-	    str = up->u.string;
 	    obj = vp->u.object;
+	    if (arg && SEE_VALUE_GET_TYPE(up) == SEE_NUMBER &&
+		SEE_is_Array(obj) && up->u.number >= 0 &&
+		up->u.number < 4294967295.0 &&
+		up->u.number == (SEE_uint32_t)up->u.number)
+	    {
+		/* Array element: refer to it by index, without a name */
+		_SEE_SET_REFERENCE(vp, obj, NULL);
+		vp->u.reference.index = (SEE_uint32_t)up->u.number;
+		NEXT;
+	    }
+	    if (SEE_VALUE_GET_TYPE(up) != SEE_STRING) {
+		struct SEE_value tmp;
+		SEE_ASSERT(interp, arg);
+		SEE_VALUE_COPY(&tmp, up);
+		SEE_ToString(interp, &tmp, up);
+	    }
+	    str = up->u.string;
 	    _SEE_SET_REFERENCE(vp, obj, str);
-	    break;
+	    NEXT;
 
-	case INST_GETVALUE:
+	CASE(GETVALUE):
 	    TOP(vp);	/* any -> val */
-	    GetValue(interp, vp);	    /* [in situ] */
-	    break;
+	    ic = INST_CACHE(arg);
+	    GetValueIC(interp, ic, vp);	    /* [in situ] */
+	    NEXT;
 
-	case INST_LOOKUP:
+	CASE(LOOKUP):
 	    TOP(vp);	/* str */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_STRING);
 	    str = SEE_intern(interp, vp->u.string);
 	    SEE_scope_lookup(interp, scope, str, vp);
-	    break;
+	    NEXT;
 
-	case INST_PUTVALUE:
+	CASE(PUTVALUE):
 	    POP(up);	/* val */
 	    POP(vp);	/* ref */
+	    ic = INST_CACHE(arg);
+	    arg = INST_IC_ARG(arg);
 	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
 		struct SEE_object *base = vp->u.reference.base;
 		struct SEE_string *prop = vp->u.reference.property;
 		if (base == NULL)
 		    base = interp->Global;
-		SEE_OBJECT_PUT(interp, base, SEE_intern(interp, prop), up,
-		    arg);
+		if (prop == NULL && !arg)
+		    SEE_Array_putindex(interp, base, vp->u.reference.index,
+			up);
+		else if (ic && !arg && prop != NULL &&
+		    base->objectclass->Put == SEE_native_put &&
+		    base->objectclass->CanPut == SEE_native_canput)
+		    _SEE_native_ic_put(interp, ic, base, prop, up);
+		else
+		    SEE_OBJECT_PUT(interp, base, RefName(interp, vp), up,
+			arg);
 	    } else
 		SEE_error_throw_string(interp, interp->ReferenceError,
 		    STR(bad_lvalue));
-	    break;
+	    NEXT;
 
-	case INST_VREF:
+	CASE(VREF):
 	    SEE_ASSERT(interp, arg >= 0);
 	    SEE_ASSERT(interp, arg < co->nvar);
 	    PUSH(vp);	/* ref */
@@ -1158,23 +2010,36 @@ code1_exec(sco, ctxt, res)
 				    == SEE_STRING);
 	    _SEE_SET_REFERENCE(vp, ctxt->variable, 
 		    co->literal[co->var[arg]].u.string);
-	    break;
+	    NEXT;
 
-	case INST_DELETE:
+	CASE(GETLOCAL):
+	    SEE_ASSERT(interp, slots != NULL);
+	    SEE_ASSERT(interp, arg >= 0);
+	    PUSH(vp);	/* val */
+	    SEE_VALUE_COPY(vp, &slots[arg]);
+	    NEXT;
+
+	CASE(PUTLOCAL):
+	    SEE_ASSERT(interp, slots != NULL);
+	    SEE_ASSERT(interp, arg >= 0);
+	    POP(vp);	/* val */
+	    SEE_VALUE_COPY(&slots[arg], vp);
+	    NEXT;
+
+	CASE(DELETE):
 	    TOP(vp);	/* any -> bool */
 	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE) {
 		struct SEE_object *base = vp->u.reference.base;
-		struct SEE_string *prop = vp->u.reference.property;
 		if (base == NULL || 
-		    SEE_OBJECT_DELETE(interp, base, SEE_intern(interp, prop)))
+		    SEE_OBJECT_DELETE(interp, base, RefName(interp, vp)))
 			SEE_SET_BOOLEAN(vp, 1);
 		else
 			SEE_SET_BOOLEAN(vp, 0);
 	    } else
 		SEE_SET_BOOLEAN(vp, 0);
-	    break;
+	    NEXT;
 
-	case INST_TYPEOF:
+	CASE(TYPEOF):
 	    TOP(vp);	/* any -> str */
 	    if (SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE &&
 		vp->u.reference.base == NULL) 
@@ -1195,99 +2060,99 @@ code1_exec(sco, ctxt, res)
 		}
 		SEE_SET_STRING(vp, s);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_TOOBJECT:
+	CASE(TOOBJECT):
 	    TOP(vp);	    /* val -> obj */
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT) {
 		struct SEE_value tmp;
 		SEE_VALUE_COPY(&tmp, vp);
 		SEE_ToObject(interp, &tmp, vp);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_TONUMBER:
+	CASE(TONUMBER):
 	    TOP(vp);	    /* val -> num */
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_NUMBER) {
 		struct SEE_value tmp;
 		SEE_VALUE_COPY(&tmp, vp);
 		SEE_ToNumber(interp, &tmp, vp);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_TOBOOLEAN:
+	CASE(TOBOOLEAN):
 	    TOP(vp);	    /* val -> bool */
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_BOOLEAN) {
 		struct SEE_value tmp;
 		SEE_VALUE_COPY(&tmp, vp);
 		SEE_ToBoolean(interp, &tmp, vp);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_TOSTRING:
+	CASE(TOSTRING):
 	    TOP(vp);	    /* val -> str */
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_STRING) {
 		struct SEE_value tmp;
 		SEE_VALUE_COPY(&tmp, vp);
 		SEE_ToString(interp, &tmp, vp);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_TOPRIMITIVE:
+	CASE(TOPRIMITIVE):
 	    TOP(vp);	    /* val -> str */
 	    if (SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT) {
 		struct SEE_object *obj = vp->u.object;
 		SEE_OBJECT_DEFAULTVALUE(interp, obj, NULL, vp);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_NEG:
+	CASE(NEG):
 	    TOP(vp);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
 	    vp->u.number = -vp->u.number;
-	    break;
+	    NEXT;
 
-	case INST_INV:
+	CASE(INV):
 	    TOP(vp);
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) != SEE_REFERENCE);
 	    int32 = SEE_ToInt32(interp, vp);
 	    SEE_SET_NUMBER(vp, ~int32);
-	    break;
+	    NEXT;
 
-	case INST_NOT:
+	CASE(NOT):
 	    TOP(vp);
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_BOOLEAN);
 	    vp->u.boolean = !vp->u.boolean;
-	    break;
+	    NEXT;
 
-	case INST_MUL:
+	CASE(MUL):
 	    POP(vp);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
 	    TOP(up);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
 	    number = up->u.number * vp->u.number;
 	    SEE_SET_NUMBER(up, number);
-	    break;
+	    NEXT;
 
-	case INST_DIV:
+	CASE(DIV):
 	    POP(vp);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
 	    TOP(up);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
 	    number = up->u.number / vp->u.number;
 	    SEE_SET_NUMBER(up, number);
-	    break;
+	    NEXT;
 
-	case INST_MOD:
+	CASE(MOD):
 	    POP(vp);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
 	    TOP(up);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
 	    number = NUMBER_fmod(up->u.number, vp->u.number);
 	    SEE_SET_NUMBER(up, number);
-	    break;
+	    NEXT;
 
-	case INST_ADD:
+	CASE(ADD):
 	    POP(vp);	/* prim */
 	    TOP(up);	/* prim -> num/str */
 	    wp = up;
@@ -1309,58 +2174,58 @@ code1_exec(sco, ctxt, res)
 		number = up->u.number + vp->u.number;
 		SEE_SET_NUMBER(wp, number);
 	    }
-	    break;
+	    NEXT;
 
-	case INST_SUB:
+	CASE(SUB):
 	    POP(vp);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_NUMBER);
 	    TOP(up);	    /* num */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_NUMBER);
 	    number = up->u.number - vp->u.number;
 	    SEE_SET_NUMBER(up, number);
-	    break;
+	    NEXT;
 
-	case INST_LSHIFT:
+	CASE(LSHIFT):
 	    POP(vp);	/* val2 */
 	    TOP(up);	/* val1 */
 	    int32 = SEE_ToInt32(interp, up) << 
 		(SEE_ToUint32(interp, vp) & 0x1f);
 	    SEE_SET_NUMBER(up, int32);
-	    break;
+	    NEXT;
 
-	case INST_RSHIFT:
+	CASE(RSHIFT):
 	    POP(vp);	/* val2 */
 	    TOP(up);	/* val1 */
 	    int32 = SEE_ToInt32(interp, up) >> 
 		    (SEE_ToUint32(interp, vp) & 0x1f);
 	    SEE_SET_NUMBER(up, int32);
-	    break;
+	    NEXT;
 
-	case INST_URSHIFT:
+	CASE(URSHIFT):
 	    POP(vp);	/* val2 */
 	    TOP(up);	/* val1 */
 	    uint32 = SEE_ToUint32(interp, up) >> 
 		    (SEE_ToUint32(interp, vp) & 0x1f);
 	    SEE_SET_NUMBER(up, uint32);
-	    break;
+	    NEXT;
 
-	case INST_LT:
+	CASE(LT):
 	    POP(vp);	/* y */
 	    TOP(up);	/* x */
 	    AbstractRelational(interp, up, vp, up);
 	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
 		SEE_SET_BOOLEAN(up, 0);
-	    break;
+	    NEXT;
 
-	case INST_GT:
+	CASE(GT):
 	    POP(vp);	/* y */
 	    TOP(up);	/* x */
 	    AbstractRelational(interp, vp, up, up);
 	    if (SEE_VALUE_GET_TYPE(up) == SEE_UNDEFINED)
 		SEE_SET_BOOLEAN(up, 0);
-	    break;
+	    NEXT;
 
-	case INST_LE:
+	CASE(LE):
 	    POP(vp);	/* y */
 	    TOP(up);	/* x */
 	    AbstractRelational(interp, vp, up, up);
@@ -1368,9 +2233,9 @@ code1_exec(sco, ctxt, res)
 		SEE_SET_BOOLEAN(up, 0);
 	    else
 		up->u.boolean = !up->u.boolean;
-	    break;
+	    NEXT;
 
-	case INST_GE:
+	CASE(GE):
 	    POP(vp);	/* y */
 	    TOP(up);	/* x */
 	    AbstractRelational(interp, up, vp, up);
@@ -1378,9 +2243,9 @@ code1_exec(sco, ctxt, res)
 		SEE_SET_BOOLEAN(up, 0);
 	    else
 		up->u.boolean = !up->u.boolean;
-	    break;
+	    NEXT;
 
-	case INST_INSTANCEOF:
+	CASE(INSTANCEOF):
 	    POP(vp);	/* val */
 	    TOP(up);	/* val */
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_OBJECT)
@@ -1388,9 +2253,9 @@ code1_exec(sco, ctxt, res)
 		    STR(instanceof_not_object));
 	    i = SEE_object_instanceof(interp, up, vp->u.object);
 	    SEE_SET_BOOLEAN(up, i);
-	    break;
+	    NEXT;
 
-	case INST_IN:
+	CASE(IN):
 	    POP(vp);	/* val */
 	    TOP(up);	/* str */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(up) == SEE_STRING);
@@ -1400,44 +2265,44 @@ code1_exec(sco, ctxt, res)
 	    i = SEE_OBJECT_HASPROPERTY(interp, /* [in situ] */
 		vp->u.object, SEE_intern(interp, up->u.string));
 	    SEE_SET_BOOLEAN(up, i);
-	    break;
+	    NEXT;
 
-	case INST_EQ:
+	CASE(EQ):
 	    POP(vp);
 	    TOP(up);
 	    i = Eq(interp, up, vp);
 	    SEE_SET_BOOLEAN(up, i);
-	    break;
+	    NEXT;
 
-	case INST_SEQ:
+	CASE(SEQ):
 	    POP(vp);
 	    TOP(up);
 	    i = Seq(up, vp);
 	    SEE_SET_BOOLEAN(up, i);
-	    break;
+	    NEXT;
 
-	case INST_BAND:
+	CASE(BAND):
 	    POP(vp);	    /* val */
 	    TOP(up);	    /* val */
 	    int32 = SEE_ToInt32(interp, up) & SEE_ToInt32(interp, vp);
 	    SEE_SET_NUMBER(up, int32);
-	    break;
+	    NEXT;
 
-	case INST_BXOR:
+	CASE(BXOR):
 	    POP(vp);	    /* val */
 	    TOP(up);	    /* val */
 	    int32 = SEE_ToInt32(interp, up) ^ SEE_ToInt32(interp, vp);
 	    SEE_SET_NUMBER(up, int32);
-	    break;
+	    NEXT;
 
-	case INST_BOR:
+	CASE(BOR):
 	    POP(vp);	    /* val */
 	    TOP(up);	    /* val */
 	    int32 = SEE_ToInt32(interp, up) | SEE_ToInt32(interp, vp);
 	    SEE_SET_NUMBER(up, int32);
-	    break;
+	    NEXT;
 
-	case INST_S_ENUM:
+	CASE(S_ENUM):
 	    POP(vp);	    /* obj */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
 	    block = &blockbottom[blocklevel];
@@ -1449,9 +2314,9 @@ code1_exec(sco, ctxt, res)
 	    block->u.enum_context.prev = enum_context;
 	    blocklevel++;
 	    enum_context = &block->u.enum_context;
-	    break;
+	    NEXT;
 
-	case INST_S_WITH:
+	CASE(S_WITH):
 	    POP(vp);	    /* obj */
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT);
 	    block = &blockbottom[blocklevel];
@@ -1461,9 +2326,9 @@ code1_exec(sco, ctxt, res)
 	    block->u.with->obj = vp->u.object;
 	    scope = block->u.with;
 	    blocklevel++;
-	    break;
+	    NEXT;
 
-        case INST_S_CATCH:
+        CASE(S_CATCH):
             /* Check that the top block really is a CATCH block */
             SEE_ASSERT(interp, blocklevel > 0);
 	    block = &blockbottom[blocklevel - 1];
@@ -1476,9 +2341,9 @@ code1_exec(sco, ctxt, res)
 	    block->u.with->next = scope;
 	    block->u.with->obj = obj;
             scope = block->u.with;     /* Push a new scope */
-            break;
+            NEXT;
 
-        case INST_ENDF:
+        CASE(ENDF):
             /*
              * End a finally handler in a way that restores
              * the circumstances the moment it was triggered.
@@ -1488,20 +2353,26 @@ code1_exec(sco, ctxt, res)
             SEE_ASSERT(interp, block->type == BLOCK_FINALLY2);
 
             /* If we had an exception we re-throw it */
-            if (SEE_CAUGHT(block->u.finally.context)) {
+            if (block->u.finally.pending) {
                 TRACE(SEE_TRACE_THROW);
-                SEE_DEFAULT_CATCH(interp, block->u.finally.context);
+                SEE_VALUE_COPY(&t, &block->u.finally.thrown);
+                traceback = block->u.finally.traceback;
+                throw_file = block->u.finally.throw_file;
+                throw_line = block->u.finally.throw_line;
+                if (try_block)
+                    goto caught;
+                goto uncaught;
             }
 
             SEE_ASSERT(interp, block->u.finally.resume != -1);
-            pc = co->inst + block->u.finally.resume;
-            break;
+            ip = co->dinst + block->u.finally.resume;
+            NEXT;
 
 	/*--------------------------------------------------
 	 * Instructions that take one argument
 	 */
 
-	case INST_NEW:
+	CASE(NEW):
 	    SEE_ASSERT(interp, stack >= stackbottom + arg + 1);
 	    stack -= arg;
 	    SEE_ASSERT(interp, arg <= co->maxargc);
@@ -1522,9 +2393,11 @@ code1_exec(sco, ctxt, res)
 	    TRACE(SEE_TRACE_CALL);
 	    SEE_OBJECT_CONSTRUCT(interp, obj, NULL, arg, argv, up);
 	    TRACE(SEE_TRACE_RETURN);
-	    break;
+	    NEXT;
 
-	case INST_CALL:
+	CASE(CALL):
+	    ic = INST_CACHE(arg);
+	    arg = INST_IC_ARG(arg);
 	    SEE_ASSERT(interp, stack >= stackbottom + arg + 1);
 	    stack -= arg;
 	    SEE_ASSERT(interp, arg <= co->maxargc);
@@ -1537,7 +2410,7 @@ code1_exec(sco, ctxt, res)
 		baseobj = vp->u.reference.base;
 		if (baseobj && IS_ACTIVATION_OBJECT(baseobj))
 		    baseobj = NULL;
-		GetValue(interp, vp);
+		GetValueIC(interp, ic, vp);
 	    }
 	    if (!baseobj)
 		baseobj = interp->Global;
@@ -1566,27 +2439,29 @@ code1_exec(sco, ctxt, res)
 	    } else 
 		SEE_OBJECT_CALL(interp, obj, baseobj, arg, argv, vp);
 	    TRACE(SEE_TRACE_RETURN);
-	    break;
+	    NEXT;
 
 	/*
 	 * Ending one or more blocks
 	 */
-	case INST_END:
+	CASE(END):
 	    new_blocklevel = arg;
     	    if (blocklevel < new_blocklevel)
-                break;
+                NEXT;
             /* 
              * END is a special instruction that only
              * advance PC when it is a no-op.
              * Because PC is advanced during instruction reads,
-             * and because END,n is always two bytes, we can
-             * reverse it easily.
+             * we reverse it to the END instruction itself.
              */
-            pc -= 2; 
+            ip = insn;
 
             /* When there are no blocks left, then return */
-            if (blocklevel == 0)
+            if (blocklevel == 0) {
+                if (armed)
+                    _SEE_TRY_FINI(interp, frame_try);
                 return;
+            }
 
             block = &blockbottom[--blocklevel];
             switch (block->type) {
@@ -1613,15 +2488,12 @@ code1_exec(sco, ctxt, res)
             case BLOCK_CATCH:
 		    /* Ending a CATCH block only happens when an
                      * exception has not been caught.
-                     * Simply finalize the unused try context.
                      */
 #ifndef NDEBUG
 		    if (SEE_eval_debug)
 			dprintf("ending CATCH\n");
 #endif
                     SEE_ASSERT(interp, block == try_block);
-                    block->u.catch.context.done = 1;
-                    _SEE_TRY_FINI(interp, block->u.catch.context);
                     try_block = block->u.catch.last_try_block;
                     break;
 
@@ -1632,21 +2504,20 @@ code1_exec(sco, ctxt, res)
 		    if (SEE_eval_debug)
 			dprintf("ending FINALLY\n");
 #endif
-                    /* 1. finalise the context */
+                    /* 1. leave the try, with no exception pending */
                     SEE_ASSERT(interp, block == try_block);
                     try_block = block->u.finally.last_try_block;
-                    block->u.finally.context.done = 1;
-                    _SEE_TRY_FINI(interp, block->u.finally.context);
+                    block->u.finally.pending = 0;
 
                     /* 2. convert to a new FINALLY2 block */
 		    block->type = BLOCK_FINALLY2;
 		    blocklevel++; /* Re-add the block */
 
                     /* Resume this END instruction later */
-                    block->u.finally.resume = pc - co->inst;
+                    block->u.finally.resume = ip - co->dinst;
 
                     /* Change the pc so that the current END is interrupted */
-                    pc = co->inst + block->u.finally.handler;
+                    ip = co->dinst + block->u.finally.handler;
 		    break;
 
             case BLOCK_FINALLY2:
@@ -1662,17 +2533,17 @@ code1_exec(sco, ctxt, res)
 #endif
             }
 
-	    break;
+	    NEXT;
 
 	/*--------------------------------------------------
 	 * Instructions that take an address argument
 	 */
 
-	case INST_B_ALWAYS:
-	    pc = co->inst + arg;
-	    break;
+	CASE(B_ALWAYS):
+	    ip = co->dinst + arg;
+	    NEXT;
 
-	case INST_B_TRUE:
+	CASE(B_TRUE):
 	    POP(vp);
 	    if (SEE_VALUE_GET_TYPE(vp) != SEE_BOOLEAN) {
 		SEE_ToBoolean(interp, vp, &v);
@@ -1680,10 +2551,10 @@ code1_exec(sco, ctxt, res)
 	    }
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_BOOLEAN);
 	    if (vp->u.boolean)
-		pc = co->inst + arg;
-	    break;
+		ip = co->dinst + arg;
+	    NEXT;
 
-	case INST_B_ENUM:
+	CASE(B_ENUM):
 	    SEE_ASSERT(interp, enum_context != NULL);
 	    while (*enum_context->props && !SEE_OBJECT_HASPROPERTY(interp, 
 			enum_context->obj, *enum_context->props))
@@ -1691,12 +2562,12 @@ code1_exec(sco, ctxt, res)
 	    if (*enum_context->props) {
 		PUSH(vp);
 		SEE_SET_STRING(vp, *enum_context->props);
-		pc = co->inst + arg;
+		ip = co->dinst + arg;
 		enum_context->props++;
 	    }
-	    break;
+	    NEXT;
 
-	case INST_S_TRYC:
+	CASE(S_TRYC):
 	    POP(vp);
 	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(vp) == SEE_STRING);
 	    block = &blockbottom[blocklevel++];
@@ -1705,93 +2576,260 @@ code1_exec(sco, ctxt, res)
 	    block->u.catch.stack = stack - stackbottom;
 	    block->u.catch.ident = vp->u.string;
 	    block->u.catch.last_try_block = try_block;
-
 	    try_block = block;
-	    try_block->u.catch.context.done = 0;
-	    _SEE_TRY_INIT(interp, try_block->u.catch.context);
-	    if (_SEE_TRY_SETJMP(interp, try_block->u.catch.context)) {
-                /* Executed when an exception has been caught by this block: */
-                /* Note: _SEE_TRY_FINI will have been called */
-                block = try_block;
-                SEE_ASSERT(interp, block->type == BLOCK_CATCH);
-                try_block = block->u.catch.last_try_block;
-                vp = SEE_CAUGHT(block->u.catch.context);
-#ifndef NDEBUG
-                if (SEE_eval_debug) {
-                    dprintf("CATCH block caught exception ");
-                    dprintv(interp, vp);
-                    dprintf("\n");
-                }
-#endif
-                /* Create a scope object to hold the exception */
-                obj = SEE_Object_new(interp);
-                SEE_OBJECT_PUT(interp, obj, block->u.catch.ident,
-                    vp, SEE_ATTR_DONTDELETE);
-                block->u.catch.obj = obj;
-                /* Restore the stack */
-                stack = stackbottom + block->u.catch.stack;
-                /* Set the PC to the catch handler */
-                pc = co->inst + block->u.catch.handler;
-                /* Resume processing instuctions in the handler. 
-                 * Hopefully there will be a S.CATCH real soon. */
-            }
-	    break;
+	    if (!armed)
+		goto arm;
+	    NEXT;
 
-	case INST_S_TRYF:
+	CASE(S_TRYF):
 	    block = &blockbottom[blocklevel++];
 	    block->type = BLOCK_FINALLY;
 	    block->u.finally.handler = arg;
 	    block->u.finally.stack = stack - stackbottom;
 	    block->u.finally.last_try_block = try_block;
 	    try_block = block;
-	    _SEE_TRY_INIT(interp, try_block->u.finally.context);
-	    try_block->u.finally.context.done = 0;
-	    if (_SEE_TRY_SETJMP(interp, try_block->u.finally.context)) {
-                /* Executed when an exception has been caught by this block. */
-                /* Note: _SEE_TRY_FINI will have been called */
-                block = try_block;
-                SEE_ASSERT(interp, block->type == BLOCK_FINALLY);
-                try_block = block->u.finally.last_try_block;
-
-                /* Restore the stack */
-                stack = stackbottom + block->u.finally.stack;
-		/* Convert the block into a FINALLY2. */
-                block->type = BLOCK_FINALLY2;
-                /* Leave context.done==0 to indicate that an exception
-                 * had been caught. No need to save the current PC */
-                pc = co->inst + block->u.finally.handler;
-                /* Continue execution in the handler, which is usually 
-                 * an END instruction to clean up earlier blocks. */
+	    if (!armed)
+		goto arm;
+	    NEXT;
+
+	/*
+	 * Exceptions. Entering a try statement costs no more than pushing
+	 * its block: the first one entered arms a single try context for
+	 * the whole frame, which stays armed until the frame returns.
+	 * Exceptions that land on it, and exceptions thrown by THROW
+	 * and ENDF, are given to the innermost try block of the frame
+	 * without any longjmp. If there is none, the exception leaves the
+	 * frame, and longjmps straight to the nearest frame or host that
+	 * can catch it; calls in between need no try contexts.
+	 */
+	arm:
+	    armed = 1;
+	    _SEE_TRY_INIT(interp, frame_try);
+	    if (_SEE_TRY_SETJMP(interp, frame_try)) {
+		/* Note: _SEE_TRY_FINI will have been called */
+		armed = 0;
+		if (!try_block)
+		    SEE_RETHROW(interp, frame_try);
+		SEE_VALUE_COPY(&t, (struct SEE_value *)&frame_try.thrown);
+		traceback = frame_try.traceback;
+		throw_file = frame_try.throw_file;
+		throw_line = frame_try.throw_line;
+		goto caught;
+	    }
+	    NEXT;
+
+	caught:
+	    /* The exception t is caught by try_block */
+	    block = try_block;
 #ifndef NDEBUG
-                block->u.finally.resume = -1; /* Store a bogus resume point */
+	    if (SEE_eval_debug) {
+		dprintf("%s block caught exception ", 
+		    block->type == BLOCK_CATCH ? "CATCH" : "FINALLY");
+		dprintv(interp, &t);
+		dprintf("\n");
+	    }
+#endif
+	    /* Unwind the blocks entered since the try statement, which
+	     * can be left from anywhere inside its body or handler */
+	    i = block - blockbottom;
+	    while (blocklevel > i + 1) {
+		block = &blockbottom[--blocklevel];
+		if (block->type == BLOCK_ENUM) {
+		    SEE_ASSERT(interp, enum_context == &block->u.enum_context);
+		    SEE_enumerate_free(interp, enum_context->props0);
+		    enum_context = enum_context->prev;
+		} else if (block->type == BLOCK_WITH)
+		    scope = block->u.with->next;
+		else
+		    SEE_ASSERT(interp, block->type == BLOCK_FINALLY2);
+	    }
+	    block = try_block;
+	    if (block->type == BLOCK_CATCH) {
+		try_block = block->u.catch.last_try_block;
+		/* Create a scope object to hold the exception */
+		obj = SEE_Object_new(interp);
+		SEE_OBJECT_PUT(interp, obj, block->u.catch.ident,
+		    &t, SEE_ATTR_DONTDELETE);
+		block->u.catch.obj = obj;
+		/* Restore the stack */
+		stack = stackbottom + block->u.catch.stack;
+		/* Set the PC to the catch handler */
+		ip = co->dinst + block->u.catch.handler;
+		/* Resume processing instuctions in the handler. 
+		 * Hopefully there will be a S.CATCH real soon. */
+	    } else {
+		SEE_ASSERT(interp, block->type == BLOCK_FINALLY);
+		try_block = block->u.finally.last_try_block;
+		/* Restore the stack */
+		stack = stackbottom + block->u.finally.stack;
+		/* Convert the block into a FINALLY2 that rethrows t
+		 * at its ENDF. No need to save the current PC */
+		block->type = BLOCK_FINALLY2;
+		SEE_VALUE_COPY(&block->u.finally.thrown, &t);
+		block->u.finally.traceback = traceback;
+		block->u.finally.throw_file = throw_file;
+		block->u.finally.throw_line = throw_line;
+		block->u.finally.pending = 1;
+		ip = co->dinst + block->u.finally.handler;
+		/* Continue execution in the handler, which is usually 
+		 * an END instruction to clean up earlier blocks. */
+#ifndef NDEBUG
+		block->u.finally.resume = -1; /* Store a bogus resume point */
 #endif
 	    }
-	    break;
+	    if (!armed)
+		goto arm;
+	    NEXT;
+
+	uncaught:
+	    /* The exception t leaves this frame */
+	    if (armed)
+		_SEE_TRY_FINI(interp, frame_try);
+	    interp->traceback = traceback;
+	    SEE__THROW(interp, &t, throw_file, throw_line);
+	    /* NOTREACHED */
 
-	case INST_FUNC:
+	CASE(FUNC):
 	    SEE_ASSERT(interp, arg >= 0);
 	    SEE_ASSERT(interp, arg < co->nfunc);
 	    PUSH(vp);
 	    SEE_SET_OBJECT(vp, SEE_function_inst_create(interp,
 		co->func[arg], scope));
-	    break;
+	    NEXT;
 
-	case INST_LITERAL:
+	CASE(LITERAL):
 	    SEE_ASSERT(interp, arg >= 0);
 	    SEE_ASSERT(interp, arg < co->nliteral);
 	    PUSH(vp);
 	    SEE_VALUE_COPY(vp, co->literal + arg);
-	    break;
+	    NEXT;
 
-	case INST_LOC:
+	CASE(LOC):
 	    SEE_ASSERT(interp, arg >= 0);
 	    SEE_ASSERT(interp, arg < co->nlocation);
 	    location = co->location + arg;
 	    TRACE(SEE_TRACE_STATEMENT);
-	    break;
+	    NEXT;
 
-	default:
+	/*--------------------------------------------------
+	 * Superinstructions. On entry, ip points at the second
+	 * instruction of the sequence they replace.
+	 */
+
+	CASE(VREF_GETVALUE):
+	    SEE_ASSERT(interp, arg >= 0);
+	    SEE_ASSERT(interp, arg < co->nvar);
+	    PUSH(vp);	/* ref -> val */
+	    _SEE_SET_REFERENCE(vp, ctxt->variable, 
+		    co->literal[co->var[arg]].u.string);
+	    arg = ip++->arg;
+	    ic = INST_CACHE(arg);
+	    GetValueIC(interp, ic, vp);
+	    NEXT;
+
+	CASE(DUP_GETVALUE):
+	    TOP(vp);
+	    PUSH(up);	/* ref -> val */
+	    SEE_VALUE_COPY(up, vp);
+	    arg = ip++->arg;
+	    ic = INST_CACHE(arg);
+	    GetValueIC(interp, ic, up);
+	    NEXT;
+
+	CASE(LITERAL_LOOKUP):
+	    SEE_ASSERT(interp, arg >= 0);
+	    SEE_ASSERT(interp, arg < co->nliteral);
+	    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(co->literal + arg) ==
+				SEE_STRING);
+	    ip++;
+	    PUSH(vp);	/* ref */
+	    str = SEE_intern(interp, co->literal[arg].u.string);
+	    SEE_scope_lookup(interp, scope, str, vp);
+	    NEXT;
+
+	CASE(LITERAL_ADD):
+	    SEE_ASSERT(interp, arg >= 0);
+	    SEE_ASSERT(interp, arg < co->nliteral);
+	    TOP(up);
+	    vp = co->literal + arg;
+	    if (SEE_VALUE_GET_TYPE(up) != SEE_NUMBER ||
+		SEE_VALUE_GET_TYPE(vp) != SEE_NUMBER)
+		GOTO_OP(LITERAL);
+	    ip++;
+	    number = up->u.number + vp->u.number;
+	    SEE_SET_NUMBER(up, number);
+	    NEXT;
+
+	CASE(TONUMBER2):
+	    /* Converts the left operand first, as the sequence does */
+	    ip += 3;
+	    for (vp = stack - 2; vp < stack; vp++)
+		if (SEE_VALUE_GET_TYPE(vp) != SEE_NUMBER) {
+		    SEE_VALUE_COPY(&t, vp);
+		    SEE_ToNumber(interp, &t, vp);
+		}
+	    NEXT;
+
+	CASE(TOPRIMITIVE2):
+	    ip += 3;
+	    for (vp = stack - 2; vp < stack; vp++)
+		if (SEE_VALUE_GET_TYPE(vp) == SEE_OBJECT)
+		    SEE_OBJECT_DEFAULTVALUE(interp, vp->u.object, NULL, vp);
+	    NEXT;
+
+	/*
+	 * A comparison followed by B_TRUE. Only numbers are compared
+	 * here; C's relational operators are false for NaN, as 11.8.5
+	 * requires.
+	 */
+	CASE(LT_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(LT);
+	    i = stack[-2].u.number < stack[-1].u.number;
+	    goto compare_branch;
+
+	CASE(GT_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(GT);
+	    i = stack[-2].u.number > stack[-1].u.number;
+	    goto compare_branch;
+
+	CASE(LE_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(LE);
+	    i = stack[-2].u.number <= stack[-1].u.number;
+	    goto compare_branch;
+
+	CASE(GE_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(GE);
+	    i = stack[-2].u.number >= stack[-1].u.number;
+	    goto compare_branch;
+
+	CASE(EQ_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(EQ);
+	    i = stack[-2].u.number == stack[-1].u.number;
+	    goto compare_branch;
+
+	CASE(SEQ_B_TRUE):
+	    if (!NUMBERS2())
+		GOTO_OP(SEQ);
+	    i = stack[-2].u.number == stack[-1].u.number;
+	    /* FALLTHROUGH */
+
+	compare_branch:
+	    POP0();
+	    POP0();
+	    if (i)
+		ip = co->dinst + ip->arg;
+	    else
+		ip++;
+	    NEXT;
+
+	DEFAULT:
 	    SEE_ASSERT(interp, !"bad instruction");
+	    NEXT;
 	}
     }
 }
@@ -1884,11 +2922,19 @@ disasm(co, pc)
 	case INST_OBJECT:	dprintf("OBJECT"); break;
 	case INST_ARRAY:	dprintf("ARRAY"); break;
 	case INST_REGEXP:	dprintf("REGEXP"); break;
-	case INST_REF:		dprintf("REF"); break;
-	case INST_GETVALUE:	dprintf("GETVALUE"); break;
+	case INST_REF:		dprintf(arg ? "REF,1" : "REF"); break;
+	case INST_GETVALUE:	dprintf("GETVALUE");
+				if (INST_IC(arg))
+				    dprintf("       ; ic%d", INST_IC(arg));
+				break;
 	case INST_LOOKUP:	dprintf("LOOKUP"); break;
-	case INST_PUTVALUE:	if (len == 1) {
-				    dprintf("PUTVALUE"); 
+	case INST_PUTVALUE:	if (INST_IC(arg)) {
+				    dprintf("PUTVALUE       ; ic%d",
+					INST_IC(arg));
+				    break;
+				}
+				if (!arg) {
+				    dprintf("PUTVALUE");
 				    break;
 				}
 				dprintf("PUTVALUE,%-4d  ;", arg);
@@ -1910,6 +2956,8 @@ disasm(co, pc)
 				else
 				    dprintf("<invalid!>");
 				break;
+	case INST_GETLOCAL:	dprintf("GETLOCAL,%d", arg); break;
+	case INST_PUTLOCAL:	dprintf("PUTLOCAL,%d", arg); break;
 	case INST_DELETE:	dprintf("DELETE"); break;
 	case INST_TYPEOF:	dprintf("TYPEOF"); break;
 	case INST_TOOBJECT:	dprintf("TOOBJECT"); break;
@@ -1945,7 +2993,10 @@ disasm(co, pc)
 	case INST_ENDF: 	dprintf("ENDF"); break;
 
 	case INST_NEW:		dprintf("NEW,%d", arg); break;
-	case INST_CALL:		dprintf("CALL,%d", arg); break;
+	case INST_CALL:		dprintf("CALL,%d", INST_IC_ARG(arg));
+				if (INST_IC(arg))
+				    dprintf("       ; ic%d", INST_IC(arg));
+				break;
 	case INST_END:		dprintf("END,%d", arg); break;
 
 	case INST_B_ALWAYS:	dprintf("B_ALWAYS,0x%x", arg); break;
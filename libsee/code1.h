@@ -16,6 +16,14 @@
  *	1 0	- a signed 32 bit value (native endian) (ARG_WORD)
  *	1 1	- reserved
  *
+ * When the code is closed, the byte stream is decoded into an array
+ * of fixed-size instructions that the executer runs. Their integers
+ * are already unpacked, and their branch addresses are array indices
+ * rather than byte offsets. Common instruction sequences are replaced
+ * by superinstructions in the array. A superinstruction overwrites
+ * only the first instruction of its sequence, so a branch into the
+ * middle of a sequence still finds the original instructions.
+ *
  */
 
 /* Instruction byte argument descriptor */
@@ -24,6 +32,17 @@
 #define INST_ARG_BYTE		0x40
 #define INST_ARG_WORD		0x80
 
+/*
+ * The GETVALUE, PUTVALUE and CALL instructions carry the number of an
+ * inline cache in the upper bits of their integer, counting from 1.
+ * Zero means the site has no cache. The lower bits hold the usual
+ * argument: the attributes for PUTVALUE, or the argc for CALL.
+ */
+#define INST_IC_SHIFT		16
+#define INST_IC_MAX		0x7fff
+#define INST_IC(arg)		((arg) >> INST_IC_SHIFT)
+#define INST_IC_ARG(arg)	((arg) & ((1 << INST_IC_SHIFT) - 1))
+
 /* Instruction byte codes */
 #define INST_OP_MASK	       0x3f
 #define INST_NOP		0x00
@@ -43,7 +62,7 @@
 #define INST_LOOKUP		0x0e
 #define INST_PUTVALUE		0x0f
 #define INST_VREF  		0x10
-                             /* 0x11 was INST_VAR */
+#define INST_GETLOCAL		0x11 /* 0x11 was INST_VAR */
 #define INST_DELETE		0x12
 #define INST_TYPEOF		0x13
 
@@ -99,14 +118,42 @@
 #define INST_S_CATCH		0x3c
 #define INST_ENDF   		0x3d
 
-                             /* 0x3e unused */
+#define INST_PUTLOCAL		0x3e
                              /* 0x3f unused */
                              /* ---- don't exceed 0x3f! */
 
+/* Superinstructions, found only in the decoded instruction array */
+#define INST_VREF_GETVALUE	0x40 /* VREF,n; GETVALUE */
+#define INST_DUP_GETVALUE	0x41 /* DUP; GETVALUE */
+#define INST_LITERAL_LOOKUP	0x42 /* LITERAL,n; LOOKUP */
+#define INST_LITERAL_ADD	0x43 /* LITERAL,n; ADD */
+#define INST_TONUMBER2		0x44 /* EXCH; TONUMBER; EXCH; TONUMBER */
+#define INST_TOPRIMITIVE2	0x45 /* EXCH; TOPRIMITIVE; EXCH; TOPRIMITIVE */
+#define INST_LT_B_TRUE		0x46 /* LT; B_TRUE,a */
+#define INST_GT_B_TRUE		0x47 /* GT; B_TRUE,a */
+#define INST_LE_B_TRUE		0x48 /* LE; B_TRUE,a */
+#define INST_GE_B_TRUE		0x49 /* GE; B_TRUE,a */
+#define INST_EQ_B_TRUE		0x4a /* EQ; B_TRUE,a */
+#define INST_SEQ_B_TRUE		0x4b /* SEQ; B_TRUE,a */
+#define INST_NDECODED		0x4c
+
 struct SEE_code;
 struct SEE_value;
 struct SEE_throw_location;
 struct SEE_interpreter;
+struct SEE_ic;
+
+/* A decoded instruction */
+struct code1_inst {
+#if HAVE_COMPUTED_GOTO
+    const void		*label;		/* handler, set by the first exec */
+#endif
+    SEE_int32_t		 arg;
+    unsigned char	 op;		/* without the INST_ARG bits */
+#ifndef NDEBUG
+    SEE_int32_t		 offset;	/* position in the byte stream */
+#endif
+};
 
 struct code1 {
     struct SEE_code	 code;
@@ -118,6 +165,10 @@ struct code1 {
     unsigned int	 ninst, nliteral, nlocation, nfunc, nvar;
     struct SEE_growable	 ginst, gliteral, glocation, gfunc, gvar;
     int	maxstack, maxblock, maxargc;
+    struct SEE_ic	*ic;		/* inline caches, allocated by close */
+    unsigned int	 nic;
+    struct code1_inst	*dinst;		/* decoded and threaded by close */
+    unsigned int	 ndinst;
 };
 
 #endif /* _SEE_h_code1_ */
@@ -83,7 +83,10 @@ SEE_PrintValue(interp, v, f)
 	case SEE_REFERENCE:
 	    fprintf(f, "<ref base=<object %p> prop=", 
 	    	(void *)v->u.reference.base);
-	    SEE_string_fputs(v->u.reference.property, f);
+	    if (v->u.reference.property)
+		SEE_string_fputs(v->u.reference.property, f);
+	    else
+		fprintf(f, "[%lu]", (unsigned long)v->u.reference.index);
 	    fprintf(f, ">");
 	    break;
 	case SEE_COMPLETION:
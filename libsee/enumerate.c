@@ -39,10 +39,12 @@
 #include <see/interpreter.h>
 #include <see/string.h>
 #include <see/object.h>
+#include <see/native.h>
 #include <see/mem.h>
 
 #include "enumerate.h"
 #include "array.h"
+#include "clone.h"
 
 /*
  * Enumeration of an object's properties
@@ -66,18 +68,65 @@
  * duplicates each time, and certainly simpler and safer than having
  * back references from the [[Delete]] methods that update the dynamic 
  * enumerators.
+ *
+ * When no prototype contributes an enumerable name, the list is just
+ * the object's own enumerable names, which are already unique, and
+ * is given in the order the object's enumerator yields them (for
+ * native objects, the order the properties were added) without
+ * sorting. Sorted order (EXT:1) is still honoured.
+ *
+ * The names of an object whose prototype chain consists only of
+ * native objects depend only on the shapes and mutation counts of
+ * those objects. Lists made for such chains are kept in a small
+ * per-interpreter cache, so that a loop that repeatedly enumerates
+ * objects of the same layout (e.g. for-in over a configuration
+ * object on every request) finds its list without rebuilding it.
+ * Cached lists are shared, so SEE_enumerate_free() leaves them be.
  */
 
+#define ENUM_CACHE_SIZE		64	/* entries; a power of 2 */
+#define ENUM_CACHE_DEPTH	4	/* longest prototype chain cached */
+
 struct propname_list {
 	struct SEE_string *name;
 	struct propname_list *next;
 	int dontenum, depth;
 };
 
+/* The layout of one native object in a prototype chain */
+struct enum_layout {
+	struct SEE_shape *shape;
+	unsigned int mutations;
+};
+
+struct enum_cache_entry {
+	unsigned int depth;		/* objects in the chain, 0 if unused */
+	int sorted;			/* true if made in EXT:1 order */
+	struct enum_layout layout[ENUM_CACHE_DEPTH];
+	struct SEE_string **names;
+};
+
+struct enum_cache {
+	struct enum_cache_entry entry[ENUM_CACHE_SIZE];
+};
+
+/*
+ * Lists returned by SEE_enumerate() are preceded by a header slot
+ * that marks the lists held in the cache.
+ */
+static struct SEE_string cached_mark;
+#define CACHED	(&cached_mark)
+
 static int make_list(struct SEE_interpreter *interp, struct SEE_object *o, 
         int depth, struct propname_list **head);
 static int slist_cmp_nice(const void *a, const void *b);
 static int slist_cmp_fast(const void *a, const void *b);
+static unsigned int chain_layout(struct SEE_interpreter *,
+	struct SEE_object *, struct enum_layout *);
+static struct enum_cache_entry *cache_entry(struct SEE_interpreter *,
+	struct enum_layout *);
+static struct SEE_string **make_names(struct SEE_interpreter *,
+	struct SEE_object *, int);
 
 /*
  * Add the property names of the local object to the property name list.
@@ -144,69 +193,177 @@ slist_cmp_fast(a, b)
 	struct propname_list **sa = (struct propname_list **)a;
 	struct propname_list **sb = (struct propname_list **)b;
 	if ((*sa)->name != (*sb)->name)
-		return (char *)(*sa)->name - (char *)(*sb)->name;
+		return (char *)(*sa)->name < (char *)(*sb)->name ? -1 : 1;
 	return (*sa)->depth - (*sb)->depth;
 }
 
 /*
- * Return nul-terminated array of string pointers to
- * all enumerable properties of an object and of its
- * prototypes.
+ * Records the layouts of the native objects in o's prototype chain.
+ * Returns the length of the chain, or 0 if it has an object that is
+ * not native or is longer than ENUM_CACHE_DEPTH.
  */
-struct SEE_string **
-SEE_enumerate(interp, o)
+static unsigned int
+chain_layout(interp, o, layout)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct enum_layout *layout;
+{
+	struct SEE_native *n;
+	unsigned int depth;
+
+	for (depth = 0; o; o = o->Prototype, depth++) {
+		if (depth == ENUM_CACHE_DEPTH ||
+		    o->objectclass->enumerator != SEE_native_enumerator)
+			return 0;
+		n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+		layout[depth].shape = n->shape;
+		layout[depth].mutations = n->mutations;
+	}
+	return depth;
+}
+
+/* Returns the cache entry where a chain's names would be kept */
+static struct enum_cache_entry *
+cache_entry(interp, layout)
+	struct SEE_interpreter *interp;
+	struct enum_layout *layout;
+{
+	struct enum_cache *cache = (struct enum_cache *)interp->enum_cache;
+	unsigned int h, i;
+
+	if (!cache) {
+		cache = SEE_NEW(interp, struct enum_cache);
+		for (i = 0; i < ENUM_CACHE_SIZE; i++)
+			cache->entry[i].depth = 0;
+		interp->enum_cache = cache;
+	}
+	h = (unsigned)((const char *)layout[0].shape - (const char *)0);
+	h = (h >> 4) ^ (h >> 12) ^ layout[0].mutations;
+	return &cache->entry[h & (ENUM_CACHE_SIZE - 1)];
+}
+
+/*
+ * Returns a new, nul-terminated array of the enumerable property names
+ * of an object and its prototypes, after a header slot.
+ */
+static struct SEE_string **
+make_names(interp, o, sorted)
 	struct SEE_interpreter *interp;
 	struct SEE_object *o;
+	int sorted;
 {
-	struct propname_list *head = NULL, **slist, **sp;
-	int count, i;
+	struct propname_list *head = NULL, **slist, **sp, *l;
+	int count, i, own;
 	struct SEE_string *current, **res;
 
 	count = make_list(interp, o, 0, &head);
 
 	/*
-	 * Copy the linked list of property names into 
-	 * an array, and sort it. (Comparison function
-	 * is constant time).
+	 * The list is built backwards, so the own names are at its
+	 * end. If no prototype has an enumerable name, the own names
+	 * are the answer, and need neither sorting nor de-duplication.
 	 */
+	own = 1;
+	for (l = head; l && l->depth > 0; l = l->next)
+	    if (!l->dontenum) {
+		own = 0;
+		break;
+	    }
+
 	slist = SEE_ALLOCA(interp, struct propname_list *, count);
-	for (sp = slist; head; head = head->next)
-		*sp++ = head;
-	qsort(slist, count, sizeof slist[0], 
-	    SEE_COMPAT_JS(interp, >=, JS11)		/* EXT:1 */
-		? slist_cmp_nice
-		: slist_cmp_fast);
+	if (own && !sorted) {
+	    sp = slist + count;
+	    for (l = head; l; l = l->next)
+		if (l->depth == 0 && !l->dontenum)
+		    *--sp = l;
+	    count = (slist + count) - sp;
+	    slist = sp;
+	} else {
+	    /*
+	     * Copy the linked list of property names into 
+	     * an array, and sort it. (Comparison function
+	     * is constant time).
+	     */
+	    for (sp = slist; head; head = head->next)
+		    *sp++ = head;
+	    qsort(slist, count, sizeof slist[0], 
+		sorted ? slist_cmp_nice : slist_cmp_fast);
 
-	/*
-	 * Remove duplicate names from the array; also
-	 * remove the unique names from the array when their shallowest
-	 * entry has the DONT-ENUM flag set.
-	 */
-	current = NULL;
-	sp = slist;
-	for (i = 0; i < count; i++) {
-	    if (slist[i]->name != current) {
-		current = slist[i]->name;
-		if (!slist[i]->dontenum)
-		    *sp++ = slist[i];
+	    /*
+	     * Remove duplicate names from the array; also
+	     * remove the unique names from the array when their shallowest
+	     * entry has the DONT-ENUM flag set.
+	     */
+	    current = NULL;
+	    sp = slist;
+	    for (i = 0; i < count; i++) {
+		if (slist[i]->name != current) {
+		    current = slist[i]->name;
+		    if (!slist[i]->dontenum)
+			*sp++ = slist[i];
+		}
 	    }
+	    count = sp - slist;
 	}
-	count = sp - slist;
 
-	res = SEE_NEW_ARRAY(interp, struct SEE_string *, count + 1);
+	res = SEE_NEW_ARRAY(interp, struct SEE_string *, count + 2);
+	res[0] = NULL;
 	for (i = 0; i < count; i++)
-		res[i] = slist[i]->name;
-	res[count] = NULL;
-
+		res[i + 1] = slist[i]->name;
+	res[count + 1] = NULL;
 	return res;
 }
 
+/*
+ * Return nul-terminated array of string pointers to
+ * all enumerable properties of an object and of its
+ * prototypes.
+ */
+struct SEE_string **
+SEE_enumerate(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct enum_layout layout[ENUM_CACHE_DEPTH];
+	struct enum_cache_entry *e;
+	struct SEE_string **res;
+	unsigned int depth, i;
+	int sorted;
+
+	sorted = SEE_COMPAT_JS(interp, >=, JS11);	/* EXT:1 */
+
+	depth = chain_layout(interp, o, layout);
+	if (!depth)
+		return make_names(interp, o, sorted) + 1;
+
+	e = cache_entry(interp, layout);
+	if (e->depth == depth && e->sorted == sorted) {
+		for (i = 0; i < depth; i++)
+		    if (e->layout[i].shape != layout[i].shape ||
+			e->layout[i].mutations != layout[i].mutations)
+			    break;
+		if (i == depth)
+		    return e->names + 1;
+	}
+
+	res = make_names(interp, o, sorted);
+	res[0] = CACHED;
+	e->depth = depth;
+	e->sorted = sorted;
+	for (i = 0; i < depth; i++)
+		e->layout[i] = layout[i];
+	e->names = res;
+	return res + 1;
+}
+
 /* Fast release of memory allocated by SEE_enumerate. May be a no-op */
 void
 SEE_enumerate_free(interp, props)
 	struct SEE_interpreter *interp;
 	struct SEE_string **props;
 {
-	void *data = props;
-	SEE_free(interp, &data);
+	void *data = props - 1;
+
+	if (props[-1] != CACHED)
+		SEE_free(interp, &data);
 }
@@ -97,6 +97,8 @@ SEE_function_make(interp, name, params, body)
 	        f->params[i] = _SEE_INTERN_ASSERT(interp, v->name);
 	} else
 	    f->params = NULL;
+	f->nlocals = 0;		/* see parse.c:function_make() */
+	f->locals = NULL;
 	f->name = _SEE_INTERN_ASSERT(interp, name);
 
 	f->next = NULL;
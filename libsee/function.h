@@ -19,6 +19,8 @@ struct var {
 struct function {
 	int nparams;
 	struct SEE_string **params;
+	int nlocals;			/* vars held in activation slots */
+	struct SEE_string **locals;
 	void *body;			/* FunctionBody_node */
 	struct SEE_string *name;	/* optional function name */
 	struct SEE_object *common;	/* common to joined functions */
@@ -36,6 +38,8 @@ void SEE_function_put_args(struct SEE_context *i, struct function *func,
 extern struct SEE_objectclass SEE_activation_class;
 #define IS_ACTIVATION_OBJECT(o) ((o)->objectclass == &SEE_activation_class)
 struct SEE_object *SEE_activation_new(struct SEE_interpreter * i);
+struct SEE_value *SEE_activation_slots(struct SEE_interpreter *i,
+	struct SEE_object *o);
 
 /* obj_Function.c */
 struct SEE_object *SEE_function_inst_create(struct SEE_interpreter *i,
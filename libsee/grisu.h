@@ -0,0 +1,8 @@
+/* Copyright (c) 2009, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_grisu_
+#define _SEE_h_grisu_
+
+int _SEE_grisu3(double v, char *buf, int *decpt);
+
+#endif /* _SEE_h_grisu_ */
@@ -4,15 +4,21 @@
 #define _SEE_h_init_
 
 struct SEE_interpreter;
+struct SEE_object;
+struct SEE_native;
 
 /*
  * Initialisers and allocators used by the interpreter initialisation
- * code (SEE_interpreter_init) are declared here in one place.
+ * code (SEE_interpreter_init) are declared here in one place, along
+ * with the functions that copy objects on write for interpreters made
+ * by SEE_interpreter_clone.
  */
 
 /* obj_Array.c */
 void SEE_Array_alloc(struct SEE_interpreter *);
 void SEE_Array_init(struct SEE_interpreter *);
+struct SEE_native *SEE_Array_copy(struct SEE_interpreter *,
+	struct SEE_native *);
 
 /* obj_Boolean.c */
 void SEE_Boolean_alloc(struct SEE_interpreter *);
@@ -21,6 +27,8 @@ void SEE_Boolean_init(struct SEE_interpreter *);
 /* obj_Date.c */
 void SEE_Date_alloc(struct SEE_interpreter *);
 void SEE_Date_init(struct SEE_interpreter *);
+struct SEE_native *SEE_Date_copy(struct SEE_interpreter *,
+	struct SEE_native *);
 
 /* obj_Error.c */
 void SEE_Error_alloc(struct SEE_interpreter *);
@@ -29,6 +37,8 @@ void SEE_Error_init(struct SEE_interpreter *);
 /* obj_Function.c */  
 void SEE_Function_alloc(struct SEE_interpreter *);
 void SEE_Function_init(struct SEE_interpreter *);
+struct SEE_native *SEE_Function_copy(struct SEE_interpreter *,
+	struct SEE_native *);
 
 /* obj_Global.c */
 void SEE_Global_alloc(struct SEE_interpreter *);
@@ -49,6 +59,8 @@ void SEE_Object_init(struct SEE_interpreter *);
 /* obj_RegExp.c */
 void SEE_RegExp_alloc(struct SEE_interpreter *);
 void SEE_RegExp_init(struct SEE_interpreter *);
+struct SEE_native *SEE_RegExp_copy(struct SEE_interpreter *,
+	struct SEE_native *);
 
 /* obj_String.c */
 void SEE_String_alloc(struct SEE_interpreter *);
@@ -57,6 +69,7 @@ void SEE_String_init(struct SEE_interpreter *);
 /* module.c */
 void _SEE_module_alloc(struct SEE_interpreter *);
 void _SEE_module_init(struct SEE_interpreter *);
+void _SEE_module_clone(struct SEE_interpreter *, struct SEE_interpreter *);
 void _SEE_module_fini(struct SEE_interpreter *);
 
 #endif /* _SEE_h_init_ */
@@ -41,6 +41,13 @@
 # include <string.h>
 #endif
 
+#if HAVE_SYS_MMAN_H && HAVE_SYS_STAT_H && HAVE_MMAP && HAVE_FSTAT
+# include <sys/types.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+# define USE_MMAP 1
+#endif
+
 #include <see/mem.h>
 #include <see/string.h>
 #include <see/type.h>
@@ -55,20 +62,33 @@
  * 7-bit ascii is assumed, unless a byte-order mark is seen at the 
  * beginning of the file, or overridden with the right argument.
  *
+ * The bytes are read a block at a time. Large regular files are
+ * mapped into memory instead, where the system allows it. The ASCII
+ * and UTF-8 decoders expand runs of 7-bit bytes in bulk.
+ *
  * NB If an end-of-file is detected while decoding some bytes,
  * EOF is returned instead of returning a SEE_INPUT_BADCHAR.
  */
 
-#define LOOKAHEAD_MAX	4
+#define BUFSZ		16384		/* bytes read at a time */
+#define MMAP_MIN	65536		/* smallest file worth mapping */
 
 struct input_file {
 	struct SEE_input	inp;
 	FILE *		file;
-	unsigned char	lookahead_buf[LOOKAHEAD_MAX];
-	unsigned char	*lookahead_pos;
-	int		lookahead_len;
+	unsigned char	*pos, *end;	/* bytes not yet decoded */
+	unsigned char	*buf;		/* read buffer, if not mapped */
+	void		*map;		/* mapped file, or NULL */
+	SEE_size_t	maplen;
 };
 
+/* The high bit of every byte in a word */
+#define ASCII_MASK	(~0UL / 0xff * 0x80)
+
+/* Returns the next byte, or EOF (-1) */
+#define GETBYTE(inpf)	((inpf)->pos < (inpf)->end ? *(inpf)->pos++	\
+				: getbyte(inpf))
+
 static int getbyte(struct input_file *);
 static SEE_unicode_t ucs32be_next(struct SEE_input *);
 static SEE_unicode_t ucs32le_next(struct SEE_input *);
@@ -76,15 +96,17 @@ static SEE_unicode_t utf16be_next(struct SEE_input *);
 static SEE_unicode_t utf16le_next(struct SEE_input *);
 static SEE_unicode_t utf8_next(struct SEE_input *);
 static SEE_unicode_t ascii_next(struct SEE_input *);
+static unsigned int ascii_fill(struct SEE_input *, SEE_unicode_t *,
+	unsigned int);
 static void input_file_close(struct SEE_input *);
 
 static struct SEE_inputclass 
    ucs32be_class = { ucs32be_next, input_file_close },
    ucs32le_class = { ucs32le_next, input_file_close },
-   utf8_class =    { utf8_next,    input_file_close },
+   utf8_class =    { utf8_next,    input_file_close, ascii_fill },
    utf16be_class = { utf16be_next, input_file_close },
    utf16le_class = { utf16le_next, input_file_close },
-   ascii_class =   { ascii_next,   input_file_close };
+   ascii_class =   { ascii_next,   input_file_close, ascii_fill };
 
 static struct bomtab {
 	int	len;
@@ -101,19 +123,21 @@ static struct bomtab {
 	{ 0,    { 0 },				&ascii_class,   NULL }
 };
 
-/* Return next byte, or EOF (-1) */
+/* Refills an empty read buffer. Returns the next byte, or EOF (-1) */
 static int
 getbyte(inpf)
 	struct input_file *inpf;
 {
-	int ch;
-
-	if (inpf->lookahead_len) {
-		ch = *inpf->lookahead_pos++;
-		inpf->lookahead_len--;
-	} else
-		ch = fgetc(inpf->file);
-	return ch;
+	SEE_size_t n;
+
+	if (!inpf->buf)
+		return EOF;			/* mapped files are all there */
+	n = fread(inpf->buf, 1, BUFSZ, inpf->file);
+	if (n == 0)
+		return EOF;
+	inpf->pos = inpf->buf;
+	inpf->end = inpf->buf + n;
+	return *inpf->pos++;
 }
 
 /* UCS-32 big endian */
@@ -129,12 +153,12 @@ ucs32be_next(inp)
 	inpf->inp.lookahead = 0;
 	inpf->inp.eof = 0;
 	for (i = 0; i < 4; i++) {
-	    ch = getbyte(inpf);
+	    ch = GETBYTE(inpf);
 	    if (ch == EOF) {
 		inpf->inp.eof = 1;
 		break;
 	    } else
-		inpf->inp.lookahead |= (ch & 0xff) >> ((3-i) * 8);
+		inpf->inp.lookahead |= (SEE_unicode_t)(ch & 0xff) << ((3-i) * 8);
 	}
 	if (inpf->inp.lookahead > _UNICODE_MAX)
 		inpf->inp.lookahead = SEE_INPUT_BADCHAR;
@@ -154,12 +178,12 @@ ucs32le_next(inp)
 	inpf->inp.lookahead = 0;
 	inpf->inp.eof = 0;
 	for (i = 0; i < 4; i++) {
-	    ch = getbyte(inpf);
+	    ch = GETBYTE(inpf);
 	    if (ch == EOF) {
 		inpf->inp.eof = 1;
 		break;
 	    } else 
-		inpf->inp.lookahead |= (ch & 0xff) >> (i * 8);
+		inpf->inp.lookahead |= (SEE_unicode_t)(ch & 0xff) << (i * 8);
 	}
 	if (inpf->inp.lookahead > _UNICODE_MAX)
 		inpf->inp.lookahead = SEE_INPUT_BADCHAR;
@@ -179,23 +203,23 @@ utf16be_next(inp)
 	/* RFC2781 */
 	next = inpf->inp.lookahead;
 	inpf->inp.eof = 1;
-	ch = getbyte(inpf);
+	ch = GETBYTE(inpf);
 	if (ch != EOF) {
-	    u1 = ch & 0xff;
-	    ch = getbyte(inpf);
+	    u1 = (ch & 0xff) << 8;
+	    ch = GETBYTE(inpf);
 	    if (ch != EOF) {
-		u1 |= (ch & 0xff) << 8;
+		u1 |= ch & 0xff;
 		inpf->inp.eof = 0;
 		inpf->inp.lookahead = u1;
 		if ((u1 & 0xfc00) == 0xd800) {
-		    ch = getbyte(inpf);
+		    ch = GETBYTE(inpf);
 		    inpf->inp.eof = 1;
 		    if (ch != EOF) {
-		        u2 = ch & 0xff;
-		        ch = getbyte(inpf);
+		        u2 = (ch & 0xff) << 8;
+		        ch = GETBYTE(inpf);
 		        if (ch != EOF) {
 			    inpf->inp.eof = 0;
-			    u2 |= (ch & 0xff) << 8;
+			    u2 |= ch & 0xff;
 			    if ((u2 & 0xfc00) == 0xdc00) {
 				inpf->inp.lookahead =
 					((u1 & 0x3ff) << 10 |
@@ -224,23 +248,23 @@ utf16le_next(inp)
 	/* RFC2781 */
 	next = inpf->inp.lookahead;
 	inpf->inp.eof = 1;
-	ch = getbyte(inpf);
+	ch = GETBYTE(inpf);
 	if (ch != EOF) {
-	    u1 = (ch & 0xff) << 8;
-	    ch = getbyte(inpf);
+	    u1 = ch & 0xff;
+	    ch = GETBYTE(inpf);
 	    if (ch != EOF) {
-		u1 |= ch & 0xff;
+		u1 |= (ch & 0xff) << 8;
 		inpf->inp.eof = 0;
 		inpf->inp.lookahead = u1;
 		if ((u1 & 0xfc00) == 0xd800) {
-		    ch = getbyte(inpf);
+		    ch = GETBYTE(inpf);
 		    inpf->inp.eof = 1;
 		    if (ch != EOF) {
-		        u2 = (ch & 0xff) << 8;
-		        ch = getbyte(inpf);
+		        u2 = ch & 0xff;
+		        ch = GETBYTE(inpf);
 		        if (ch != EOF) {
 			    inpf->inp.eof = 0;
-			    u2 |= ch & 0xff;
+			    u2 |= (ch & 0xff) << 8;
 			    if ((u2 & 0xfc00) == 0xdc00) {
 				inpf->inp.lookahead =
 					((u1 & 0x3ff) << 10 |
@@ -271,19 +295,21 @@ utf8_next(inp)
 
 	/* RFC 2279 */
 	next = inpf->inp.lookahead;
-	ch = getbyte(inpf);
+	ch = GETBYTE(inpf);
 	if (ch == EOF) {
 		inpf->inp.eof = 1;
 	} else if ((ch & 0x80) == 0) {
 		inpf->inp.lookahead = ch;
+		inpf->inp.eof = 0;
 	} else {
+		inpf->inp.eof = 0;
 		for (bytes = 1; bytes < 6; bytes++)
 		    if ((ch & mask[bytes]) == mask[bytes-1])
 			break;
 		if (bytes < 6) {
 		    c = (ch & ~mask[bytes]);
 		    for (i = 0; i < bytes; i++) {
-			ch = getbyte(inpf);
+			ch = GETBYTE(inpf);
 			if (ch == EOF) {
 			    inpf->inp.eof = 1;
 			    break;
@@ -313,7 +339,7 @@ ascii_next(inp)
 	int ch;
 
 	next = inpf->inp.lookahead;
-	ch = getbyte(inpf);
+	ch = GETBYTE(inpf);
 	if (ch == EOF) {
 		inpf->inp.eof = 1;
 	} else {
@@ -326,12 +352,55 @@ ascii_next(inp)
 	return next;
 }
 
+/*
+ * Bulk decoder for ASCII and UTF-8: the runs of 7-bit bytes that
+ * follow the lookahead in the buffer are expanded directly, a word at
+ * a time where possible. Other bytes are left to the class's next().
+ */
+static unsigned int
+ascii_fill(inp, buf, len)
+	struct SEE_input *inp;
+	SEE_unicode_t *buf;
+	unsigned int len;
+{
+	struct input_file *inpf = (struct input_file *)inp;
+	unsigned char *p;
+	unsigned long word;
+	unsigned int n, i;
+
+	n = 0;
+	while (n < len && !inpf->inp.eof) {
+		buf[n++] = inpf->inp.lookahead;
+		p = inpf->pos;
+		while (len - n >= sizeof word && 
+		       (SEE_size_t)(inpf->end - p) >= sizeof word)
+		{
+			memcpy(&word, p, sizeof word);
+			if (word & ASCII_MASK)
+				break;
+			for (i = 0; i < sizeof word; i++)
+				buf[n++] = *p++;
+		}
+		while (n < len && p < inpf->end && !(*p & 0x80))
+			buf[n++] = *p++;
+		inpf->pos = p;
+		SEE_INPUT_NEXT(inp);		/* decode the new lookahead */
+	}
+	return n;
+}
+
 static void
 input_file_close(inp)
 	struct SEE_input *inp;
 {
 	struct input_file *inpf = (struct input_file *)inp;
 
+#if USE_MMAP
+	if (inpf->map)
+		munmap(inpf->map, inpf->maplen);
+	inpf->map = NULL;
+#endif
+	inpf->pos = inpf->end = NULL;
 	fclose(inpf->file);
 }
 
@@ -350,8 +419,13 @@ SEE_input_file(interp, file, filename, label)
 	const char *label;
 {
 	struct input_file *inpf;
-	int ch, i;
 	struct bomtab *bt;
+	int i;
+#if USE_MMAP
+	struct stat st;
+	long offset;
+	void *map;
+#endif
 
 	inpf = SEE_NEW(interp, struct input_file);
 	inpf->inp.interpreter = interp;
@@ -362,10 +436,33 @@ SEE_input_file(interp, file, filename, label)
 	else
 		inpf->inp.filename = NULL;
 	inpf->inp.first_lineno = 1;
-
-	inpf->lookahead_len = 0;
-	inpf->lookahead_pos = &inpf->lookahead_buf[0];
 	inpf->inp.inputclass = &ascii_class;
+	inpf->buf = NULL;
+	inpf->map = NULL;
+	inpf->maplen = 0;
+
+#if USE_MMAP
+	/* Map the unread part of a large regular file */
+	if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) &&
+	    st.st_size >= MMAP_MIN && (SEE_size_t)st.st_size == st.st_size &&
+	    (offset = ftell(file)) >= 0 && offset < st.st_size)
+	{
+		map = mmap(NULL, (SEE_size_t)st.st_size, PROT_READ, 
+		    MAP_PRIVATE, fileno(file), 0);
+		if (map != MAP_FAILED) {
+			inpf->map = map;
+			inpf->maplen = (SEE_size_t)st.st_size;
+			inpf->pos = (unsigned char *)map + offset;
+			inpf->end = (unsigned char *)map + inpf->maplen;
+		}
+	}
+#endif
+	if (!inpf->map) {
+		inpf->buf = SEE_NEW_STRING_ARRAY(interp, unsigned char, BUFSZ);
+		inpf->pos = inpf->end = inpf->buf;
+		if (getbyte(inpf) != EOF)
+			inpf->pos--;		/* unget */
+	}
 
 	if (label && *label) {
 	    for (bt = bomtab; bt->label; bt++) 
@@ -377,24 +474,17 @@ SEE_input_file(interp, file, filename, label)
 	} else
 	    /*
 	     * Search for and match any initial byte order mark.
-	     * This is where our lookahead buffer comes in handy.
+	     * The first block of the file is already in the buffer.
 	     */
 	    for (bt = bomtab; ; bt++) {
-		for (i = 0; i < bt->len; i++) {
-		    if (inpf->lookahead_len <= i) {
-			ch = fgetc(file);
-			if (ch == EOF) 
+		for (i = 0; i < bt->len; i++)
+		    if (inpf->pos + i >= inpf->end ||
+			inpf->pos[i] != bt->match[i])
 			    break;
-			inpf->lookahead_buf[inpf->lookahead_len++] = ch;
-		    }
-		    if (inpf->lookahead_buf[i] != bt->match[i])
-			break;
-		}
 		if (i == bt->len) {
 		    inpf->inp.inputclass = bt->inputclass;
 		    /* Strip the byte order mark */
-		    inpf->lookahead_pos += i;
-		    inpf->lookahead_len -= i;
+		    inpf->pos += i;
 		    break;
 		}
 	    }
@@ -50,10 +50,13 @@
 
 static SEE_unicode_t input_string_next(struct SEE_input *);
 static void input_string_close(struct SEE_input *);
+static unsigned int input_string_fill(struct SEE_input *, SEE_unicode_t *,
+	unsigned int);
 
 static struct SEE_inputclass input_string_class = {
 	input_string_next,
-	input_string_close
+	input_string_close,
+	input_string_fill
 };
 
 struct input_string {
@@ -89,6 +92,29 @@ input_string_next(inp)
 	return next;
 }
 
+/* Copies characters out until a surrogate needs decoding by next() */
+static unsigned int
+input_string_fill(inp, buf, len)
+	struct SEE_input *inp;
+	SEE_unicode_t *buf;
+	unsigned int len;
+{
+	struct input_string *inps = (struct input_string *)inp;
+	const SEE_char_t *cur;
+	unsigned int n;
+
+	n = 0;
+	while (n < len && !inps->inp.eof) {
+		buf[n++] = inps->inp.lookahead;
+		for (cur = inps->cur; n < len && cur < inps->end &&
+		    (*cur & 0xf800) != 0xd800; cur++)
+			buf[n++] = *cur;
+		inps->cur = cur;
+		input_string_next(inp);		/* get the new lookahead */
+	}
+	return n;
+}
+
 static void
 input_string_close(inp)
 	struct SEE_input *inp;
@@ -36,6 +36,10 @@
 # include <stdio.h>
 #endif
 
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
 #include <see/mem.h>
 #include <see/type.h>
 #include <see/input.h>
@@ -56,17 +60,24 @@
 
 static SEE_unicode_t input_utf8_next(struct SEE_input *);
 static void         input_utf8_close(struct SEE_input *);
+static unsigned int input_utf8_fill(struct SEE_input *, SEE_unicode_t *,
+			unsigned int);
 
 static struct SEE_inputclass input_utf8_class = {
 	input_utf8_next,
-	input_utf8_close
+	input_utf8_close,
+	input_utf8_fill
 };
 
 struct input_utf8 {
 	struct SEE_input	inp;
 	const unsigned char *	s;
+	const unsigned char *	end;		/* the terminating nul */
 };
 
+/* The high bit of every byte in a word */
+#define ASCII_MASK	(~0UL / 0xff * 0x80)
+
 static SEE_unicode_t
 input_utf8_next(inp)
 	struct SEE_input *inp;
@@ -122,6 +133,42 @@ input_utf8_next(inp)
 	return next;
 }
 
+/*
+ * Decodes characters in bulk. Runs of ASCII are recognised a word of
+ * bytes at a time, and expanded without going through next().
+ */
+static unsigned int
+input_utf8_fill(inp, buf, len)
+	struct SEE_input *inp;
+	SEE_unicode_t *buf;
+	unsigned int len;
+{
+	struct input_utf8 *inpu = (struct input_utf8 *)inp;
+	const unsigned char *s;
+	unsigned long word;
+	unsigned int n, i;
+
+	n = 0;
+	while (n < len && !inpu->inp.eof) {
+		buf[n++] = inpu->inp.lookahead;
+		s = inpu->s;
+		while (len - n >= sizeof word && 
+		       (unsigned int)(inpu->end - s) >= sizeof word)
+		{
+			memcpy(&word, s, sizeof word);
+			if (word & ASCII_MASK)
+				break;
+			for (i = 0; i < sizeof word; i++)
+				buf[n++] = *s++;
+		}
+		while (n < len && s < inpu->end && !(*s & 0x80))
+			buf[n++] = *s++;
+		inpu->s = s;
+		input_utf8_next(inp);		/* decode the new lookahead */
+	}
+	return n;
+}
+
 static void
 input_utf8_close(inp)
 	struct SEE_input *inp;
@@ -143,6 +190,7 @@ SEE_input_utf8(interp, s)
 	inpu->inp.filename = NULL;
 	inpu->inp.first_lineno = 1;
 	inpu->s = (const unsigned char *)s;
+	inpu->end = inpu->s + strlen(s);
 	SEE_INPUT_NEXT((struct SEE_input *)inpu);	/* prime */
 	return (struct SEE_input *)inpu;
 }
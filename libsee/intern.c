@@ -48,6 +48,7 @@
 
 #include "stringdefs.h"
 #include "dprint.h"
+#include "clone.h"
 
 /*
  * Internalised strings.
@@ -63,27 +64,56 @@
  * is the application-wide "global" intern table, which applications must set
  * up early and not change after the creation of any interpreter. The
  * third level is the interpreter-local intern cache.
+ * An interpreter's local table may sit on frozen tables that it shares
+ * with the interpreters it was copied from or to (see clone.c). The
+ * frozen tables are searched before the local table, and never change.
  * 
  * This strategy allow the sharing of application static strings,
  * while avoiding the need for mutual exclusion techniques between
  * interpreters (since the library and application static strings are
  * read-only).
+ *
+ * The tables are chained hash tables keyed on SEE_string_hash(), which
+ * covers the whole string and is remembered in each interned string.
+ * A table doubles its buckets when it holds more strings than buckets.
  */
 
-#define HASHTABSZ	257
-#define HASHLENMAX	8		/* prefix of string hashed on */
+#define GLOBAL_NBUCKET	512		/* initial size of the global table */
+#define LOCAL_NBUCKET	256		/* initial size of interp tables */
+#define LAYER_NBUCKET	32		/* initial size of tables on frozen ones */
+#define UINT_CACHE_SIZE	1024		/* small integers kept as strings */
 
 struct intern {				/* element in the intern hash table */
 	struct intern *next;
 	struct SEE_string *string;
 };
-typedef struct intern *(intern_tab_t[HASHTABSZ]);
+
+typedef struct intern_tab {
+	struct intern **bucket;
+	unsigned int nbucket;		/* always a power of 2 */
+	unsigned int count;		/* number of strings in the table */
+	struct SEE_interpreter *interp;	/* that interned the strings */
+	struct intern_tab *parent;	/* frozen table below, or NULL */
+	struct SEE_string **uints;	/* see _SEE_intern_uint */
+} intern_tab_t;
 
 /* Prototypes */
-static struct intern *  make(struct SEE_interpreter *, struct SEE_string *);
-static unsigned int     hash(const struct SEE_string *);
+static struct intern *  make(struct SEE_interpreter *, struct SEE_string *,
+			     unsigned int);
+static unsigned int     hash_ascii(const char *, unsigned int *);
 static struct intern ** find(intern_tab_t *, struct SEE_string *,
 			     unsigned int);
+static struct intern ** find_ascii(intern_tab_t *, const char *, 
+			     unsigned int);
+static struct intern ** find_unicode(intern_tab_t *, const SEE_unicode_t *,
+			     unsigned int, unsigned int);
+static void tab_init(struct SEE_interpreter *, intern_tab_t *,
+			unsigned int);
+static intern_tab_t *tab_new(struct SEE_interpreter *, intern_tab_t *,
+			unsigned int);
+static struct SEE_string *tab_insert(struct SEE_interpreter *,
+			intern_tab_t *, struct intern **, struct SEE_string *,
+			unsigned int);
 static int internalized(struct SEE_interpreter *interp,
 			const struct SEE_string *s);
 static void global_init(void);
@@ -111,37 +141,28 @@ string_only_contains_ascii(s)
 
 /**
  * Make an intern entry in the hash table containing the string s,
- *  and flag s as being interned.
+ *  and flag s as being interned, with the given hash.
  */
 static struct intern *
-make(interp, s)
+make(interp, s, hash)
 	struct SEE_interpreter *interp;		/* may be NULL */
 	struct SEE_string *s;
+	unsigned int hash;
 {
 	struct intern *i;
 
 	i = SEE_NEW(interp, struct intern);
 	i->string = s;
-	s->flags |= SEE_STRING_FLAG_INTERNED;
+	s->hash = hash;
+	s->flags |= SEE_STRING_FLAG_INTERNED | SEE_STRING_FLAG_HASHED;
 	i->next = NULL;
 	return i;
 }
 
-/** Compute the hash value of a UTF-16 string */
-static unsigned int
-hash(s)
-	const struct SEE_string *s;
-{
-	unsigned int j, h = 0;
-	for (j = 0; j < HASHLENMAX && j < s->length; j++)
-		h = (h << 1) ^ s->data[j];
-	return h % HASHTABSZ;
-}
-
 /** 
  * Compute the hash value of an ASCII string.
  * Returns the same value as if the ASCII string had been converted to a
- * UTF-16 string and passed to hash().
+ * UTF-16 string and passed to SEE_string_hash().
  * Assumes the input string is indeed ASCII (bytes in 0x00..0x7f).
  */
 static unsigned int
@@ -149,14 +170,68 @@ hash_ascii(s, lenret)
 	const char *s;
 	unsigned int *lenret;
 {
-	unsigned int j, h = 0;
+	unsigned int h = SEE_STRING_HASH_INIT;
 	const char *t;
 
-	for (j = 0, t = s; j < HASHLENMAX && *t; j++, t++)
-		h = (h << 1) ^ *t;
-	while (*t) t++;
+	for (t = s; *t; t++)
+		h = SEE_STRING_HASH_STEP(h, *t);
 	*lenret = t - s;
-	return h % HASHTABSZ;
+	return h;
+}
+
+/** Initialise an empty table */
+static void
+tab_init(interp, tab, nbucket)
+	struct SEE_interpreter *interp;		/* may be NULL */
+	intern_tab_t *tab;
+	unsigned int nbucket;
+{
+	unsigned int i;
+
+	tab->bucket = SEE_NEW_ARRAY(interp, struct intern *, nbucket);
+	for (i = 0; i < nbucket; i++)
+		tab->bucket[i] = NULL;
+	tab->nbucket = nbucket;
+	tab->count = 0;
+}
+
+/**
+ * Insert a new string at the (empty) position x returned by find(),
+ * doubling the table if it has become too full.
+ * Returns the string.
+ */
+static struct SEE_string *
+tab_insert(interp, tab, x, s, hash)
+	struct SEE_interpreter *interp;		/* may be NULL */
+	intern_tab_t *tab;
+	struct intern **x;
+	struct SEE_string *s;
+	unsigned int hash;
+{
+	struct intern **old, *i, *next;
+	unsigned int j, oldn;
+
+	*x = make(interp, s, hash);
+	if (++tab->count <= tab->nbucket)
+		return s;
+
+	old = tab->bucket;
+	oldn = tab->nbucket;
+	tab_init(interp, tab, oldn * 2);
+	tab->count = oldn + 1;
+	for (j = 0; j < oldn; j++)
+		for (i = old[j]; i; i = next) {
+			next = i->next;
+			x = &tab->bucket[i->string->hash & (tab->nbucket - 1)];
+			i->next = *x;
+			*x = i;
+		}
+#ifndef NDEBUG
+	if (SEE_debug_intern)
+	    dprintf("INTERN table %p grown to %u buckets\n", tab,
+		tab->nbucket);
+#endif
+	return s;
 }
 
 /** Find an interned string */
@@ -168,8 +243,9 @@ find(intern_tab, s, hash)
 {
 	struct intern **x;
 
-	x = &(*intern_tab)[hash];
-	while (*x && SEE_string_cmp((*x)->string, s) != 0)
+	x = &intern_tab->bucket[hash & (intern_tab->nbucket - 1)];
+	while (*x && ((*x)->string->hash != hash ||
+		      SEE_string_cmp((*x)->string, s) != 0))
 		x = &((*x)->next);
 	return x;
 }
@@ -203,30 +279,102 @@ find_ascii(intern_tab, s, hash)
 {
 	struct intern **x;
 
-	x = &(*intern_tab)[hash];
-	while (*x && !ascii_eq((*x)->string, s))
+	x = &intern_tab->bucket[hash & (intern_tab->nbucket - 1)];
+	while (*x && ((*x)->string->hash != hash ||
+		      !ascii_eq((*x)->string, s)))
 		x = &((*x)->next);
 	return x;
 }
 
+/** Find an interned string equal to the len characters at c */
+static struct intern **
+find_unicode(intern_tab, c, len, hash)
+	intern_tab_t *intern_tab;
+	const SEE_unicode_t *c;
+	unsigned int len;
+	unsigned int hash;
+{
+	struct intern **x;
+	const SEE_char_t *d;
+	unsigned int i;
+
+	for (x = &intern_tab->bucket[hash & (intern_tab->nbucket - 1)];
+	     *x; x = &((*x)->next))
+	{
+		if ((*x)->string->hash != hash || (*x)->string->length != len)
+			continue;
+		d = (*x)->string->data;
+		for (i = 0; i < len; i++)
+			if (d[i] != c[i])
+				break;
+		if (i == len)
+			break;
+	}
+	return x;
+}
+
+/** Create a local table for an interpreter, on top of a frozen one */
+static intern_tab_t *
+tab_new(interp, parent, nbucket)
+	struct SEE_interpreter *interp;
+	intern_tab_t *parent;
+	unsigned int nbucket;
+{
+	intern_tab_t *intern_tab;
+
+	intern_tab = SEE_NEW(interp, intern_tab_t);
+	tab_init(interp, intern_tab, nbucket);
+	intern_tab->interp = interp;
+	intern_tab->parent = parent;
+	intern_tab->uints = NULL;
+	return intern_tab;
+}
+
 /** Create an interpreter-local intern table */
 void
 _SEE_intern_init(interp)
 	struct SEE_interpreter *interp;
 {
-	intern_tab_t *intern_tab;
-	unsigned int i;
-
 	global_init();
 #ifndef NDEBUG
 	global_intern_tab_locked = 1;
 #endif
 
-	intern_tab = SEE_NEW(interp, intern_tab_t);
-	for (i = 0; i < HASHTABSZ; i++)
-		(*intern_tab)[i] = NULL;
+	interp->intern_tab = tab_new(interp, NULL, LOCAL_NBUCKET);
+}
+
+/* Returns the number of strings in the interpreter's local table */
+int
+_SEE_intern_count(interp)
+	struct SEE_interpreter *interp;
+{
+	return ((intern_tab_t *)interp->intern_tab)->count;
+}
 
-	interp->intern_tab = intern_tab;
+/*
+ * Freezes the interpreter's local table, so that copies of the
+ * interpreter can share it, and gives it a new local table on top.
+ */
+void
+_SEE_intern_freeze(interp)
+	struct SEE_interpreter *interp;
+{
+	interp->intern_tab = tab_new(interp,
+		(intern_tab_t *)interp->intern_tab, LAYER_NBUCKET);
+}
+
+/*
+ * Gives a copy of a frozen interpreter a local table on top of the
+ * frozen tables of the original (see _SEE_layer_freeze).
+ */
+void
+_SEE_intern_clone(interp, orig)
+	struct SEE_interpreter *interp, *orig;
+{
+	intern_tab_t *parent = ((intern_tab_t *)orig->intern_tab)->parent;
+
+	SEE_ASSERT(orig, parent != NULL);
+	interp->intern_tab = tab_new(interp, parent, LAYER_NBUCKET);
 }
 
 /* Returns true if the string is already internalized */
@@ -235,15 +383,23 @@ internalized(interp, s)
 	struct SEE_interpreter *interp;
 	const struct SEE_string *s;
 {
+	intern_tab_t *tab;
+
 	/*
 	 * A string is internalized if
 	 *  - is already internalized in this interpreter or the global hash
+	 *  - is internalized in a frozen table this interpreter shares
 	 *  - is one of the static resource strings
 	 */
-	return 
-	    ((!s->interpreter || s->interpreter == interp) &&
-	     (s->flags & SEE_STRING_FLAG_INTERNED)) ||
-	    (s >= STRn(0) && s < STRn(SEE_nstringtab));
+
+	if (s >= STRn(0) && s < STRn(SEE_nstringtab))
+	    return 1;
+	if (!(s->flags & SEE_STRING_FLAG_INTERNED))
+	    return 0;
+	for (tab = (intern_tab_t *)interp->intern_tab; tab; tab = tab->parent)
+	    if (s->interpreter == tab->interp)
+		return 1;
+	return !s->interpreter;
 }
 
 /**
@@ -260,6 +416,8 @@ SEE_intern(interp, s)
 	struct SEE_string *s;
 {
 	struct intern **x;
+	struct SEE_string *is;
+	intern_tab_t *tab;
 	unsigned int h;
 #ifndef NDEBUG
 	const char *where = NULL;
@@ -290,25 +448,34 @@ SEE_intern(interp, s)
 		(s->flags & SEE_STRING_FLAG_INTERNED));
 
 	/* Look in system-wide intern table first */
-	h = hash(s);
+	h = SEE_string_hash(s);
 	x = find(&global_intern_tab, s, h);
 	WHERE("global");
+	for (tab = ((intern_tab_t *)interp->intern_tab)->parent;
+	     !*x && tab; tab = tab->parent)
+	{
+		x = find(tab, s, h);
+		WHERE("frozen");
+	}
 	if (!*x) {
 		x = find(interp->intern_tab, s, h);
 		WHERE("local");
-		if (!*x) {
-			*x = make(interp, _SEE_string_dup_fix(interp, s));
-			WHERE("new");
-		}
+	}
+	if (*x)
+		is = (*x)->string;
+	else {
+		is = tab_insert(interp, interp->intern_tab, x,
+			_SEE_string_dup_fix(interp, s), h);
+		WHERE("new");
 	}
 #ifndef NDEBUG
 	if (SEE_debug_intern) {
 	    dprintf("INTERN ");
 	    dprints(s);
-	    dprintf(" -> %p [%s h=%d]\n", (*x)->string, where, h);
+	    dprintf(" -> %p [%s h=%08x]\n", is, where, h);
 	}
 #endif
-	return (*x)->string;
+	return is;
 
 }
 
@@ -323,6 +490,7 @@ SEE_intern_ascii(interp, s)
 	SEE_char_t *c;
 	unsigned int h, len;
 	struct intern **x;
+	intern_tab_t *tab;
 #ifndef NDEBUG
 	const char *where = NULL;
 #endif
@@ -333,29 +501,97 @@ SEE_intern_ascii(interp, s)
 	h = hash_ascii(s, &len);
 	x = find_ascii(&global_intern_tab, s, h);
 	WHERE("global");
+	for (tab = ((intern_tab_t *)interp->intern_tab)->parent;
+	     !*x && tab; tab = tab->parent)
+	{
+	    x = find_ascii(tab, s, h);
+	    WHERE("frozen");
+	}
 	if (!*x) {
 	    x = find_ascii(interp->intern_tab, s, h);
 	    WHERE("local");
-	    if (!*x) {
-		WHERE("new");
-		str = SEE_NEW(interp, struct SEE_string);
-		str->length = len;
-		str->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
-		for (c = str->data, t = s; *t;)
-			*c++ = *t++;
-		str->interpreter = interp;
-		str->stringclass = NULL;
-		str->flags = 0;
-	    	SEE_ASSERT(interp, hash(str) == h);
-		*x = make(interp, str);
-		}
-	    }
+	}
+	if (*x)
+	    str = (*x)->string;
+	else {
+	    WHERE("new");
+	    str = SEE_NEW(interp, struct SEE_string);
+	    str->length = len;
+	    str->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
+	    for (c = str->data, t = s; *t;)
+		    *c++ = *t++;
+	    str->interpreter = interp;
+	    str->stringclass = NULL;
+	    str->flags = 0;
+	    SEE_ASSERT(interp, SEE_string_hash(str) == h);
+	    tab_insert(interp, interp->intern_tab, x, str, h);
+	}
 #ifndef NDEBUG
 	if (SEE_debug_intern)
-	    dprintf("INTERN %s -> %p [%s h=%d ascii]\n", 
-		s, (*x)->string, where, h);
+	    dprintf("INTERN %s -> %p [%s h=%08x ascii]\n", 
+		s, str, where, h);
 #endif
-	return (*x)->string;
+	return str;
+}
+
+/*
+ * Returns the interned string of the len characters at c, without
+ * first building a string to look it up with. The lexer uses this
+ * for identifiers. The characters must all be below 0x10000.
+ */
+struct SEE_string *
+_SEE_intern_unicode(interp, c, len)
+	struct SEE_interpreter *interp;
+	const SEE_unicode_t *c;
+	unsigned int len;
+{
+	struct SEE_string *str;
+	unsigned int h, i;
+	struct intern **x;
+	intern_tab_t *tab;
+#ifndef NDEBUG
+	const char *where = NULL;
+#endif
+
+	h = SEE_STRING_HASH_INIT;
+	for (i = 0; i < len; i++) {
+		SEE_ASSERT(interp, c[i] < 0x10000);
+		h = SEE_STRING_HASH_STEP(h, c[i]);
+	}
+	x = find_unicode(&global_intern_tab, c, len, h);
+	WHERE("global");
+	for (tab = ((intern_tab_t *)interp->intern_tab)->parent;
+	     !*x && tab; tab = tab->parent)
+	{
+	    x = find_unicode(tab, c, len, h);
+	    WHERE("frozen");
+	}
+	if (!*x) {
+	    x = find_unicode(interp->intern_tab, c, len, h);
+	    WHERE("local");
+	}
+	if (*x)
+	    str = (*x)->string;
+	else {
+	    WHERE("new");
+	    str = SEE_NEW(interp, struct SEE_string);
+	    str->length = len;
+	    str->data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
+	    for (i = 0; i < len; i++)
+		    str->data[i] = (SEE_char_t)c[i];
+	    str->interpreter = interp;
+	    str->stringclass = NULL;
+	    str->flags = 0;
+	    tab_insert(interp, interp->intern_tab, x, str, h);
+	}
+#ifndef NDEBUG
+	if (SEE_debug_intern) {
+	    dprintf("INTERN ");
+	    dprints(str);
+	    dprintf(" -> %p [%s h=%08x unicode]\n", str, where, h);
+	}
+#endif
+	return str;
 }
 
 /*
@@ -381,6 +617,46 @@ SEE_intern_and_free(interp, sp)
 	*sp = is;
 }
 
+/*
+ * Returns the interned decimal string of n from the interpreter's
+ * cache of small integers, or NULL if n is too big to be cached.
+ * Array indices and numeric property names are mostly small. The
+ * caches of frozen tables below the local one are used too.
+ */
+struct SEE_string *
+_SEE_intern_uint(interp, n)
+	struct SEE_interpreter *interp;
+	SEE_uint32_t n;
+{
+	intern_tab_t *tab = (intern_tab_t *)interp->intern_tab;
+	intern_tab_t *t;
+	char buf[12], *p;
+	SEE_uint32_t i;
+
+	if (n >= UINT_CACHE_SIZE)
+		return NULL;
+	if (tab->uints && tab->uints[n])
+		return tab->uints[n];
+	for (t = tab->parent; t; t = t->parent)
+		if (t->uints && t->uints[n])
+			return t->uints[n];
+	if (!tab->uints) {
+		tab->uints = SEE_NEW_ARRAY(interp, struct SEE_string *,
+		    UINT_CACHE_SIZE);
+		for (i = 0; i < UINT_CACHE_SIZE; i++)
+			tab->uints[i] = NULL;
+	}
+	p = buf + sizeof buf;
+	*--p = '\0';
+	i = n;
+	do {
+		*--p = '0' + i % 10;
+		i /= 10;
+	} while (i);
+	tab->uints[n] = SEE_intern_ascii(interp, p);
+	return tab->uints[n];
+}
+
 static void
 global_init()
 {
@@ -391,11 +667,12 @@ global_init()
 		return;
 
 	/* Add all the predefined strings to the global intern table */
+	tab_init(NULL, &global_intern_tab, GLOBAL_NBUCKET);
 	for (i = 0; i < SEE_nstringtab; i++) {
-		h = hash(STRn(i));
+		h = SEE_string_hash(STRn(i));
 		x = find(&global_intern_tab, STRn(i), h);
 		if (*x == NULL) 
-			*x = make(NULL, STRn(i));
+			tab_insert(NULL, &global_intern_tab, x, STRn(i), h);
 	}
 	global_intern_tab_initialized = 1;
 }
@@ -433,8 +710,7 @@ SEE_intern_global(s)
 	str->interpreter = NULL;
 	str->stringclass = NULL;
 	str->flags = 0;
-	*x = make(NULL, str);
-	return (*x)->string;
+	return tab_insert(NULL, &global_intern_tab, x, str, h);
 }
 
 /**
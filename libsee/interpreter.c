@@ -47,6 +47,12 @@
 #include <see/error.h>
 
 #include "init.h"
+#include "clone.h"
+
+static void interpreter_init(struct SEE_interpreter *, int,
+	struct SEE_arena *);
+static void interpreter_clone(struct SEE_interpreter *,
+	struct SEE_interpreter *, struct SEE_arena *);
 
 /**
  * Initialises/reinitializes an interpreter structure
@@ -73,6 +79,31 @@ SEE_interpreter_init_compat(interp, compat_flags)
 	struct SEE_interpreter *interp;
 	int compat_flags;
 {
+	interpreter_init(interp, compat_flags, NULL);
+}
+
+/**
+ * Initialises an interpreter using the default compatibility flags,
+ * so that all its memory is allocated from the given arena.
+ * The interpreter must not be used after the arena is destroyed.
+ */
+void
+SEE_interpreter_init_arena(interp, arena)
+	struct SEE_interpreter *interp;
+	struct SEE_arena *arena;
+{
+	interpreter_init(interp, SEE_system.default_compat_flags, arena);
+}
+
+/* Initialises an interpreter, allocating from arena if not NULL */
+static void
+interpreter_init(interp, compat_flags, arena)
+	struct SEE_interpreter *interp;
+	int compat_flags;
+	struct SEE_arena *arena;
+{
+	interp->arena = arena;		/* first, before anything is allocated */
+	_SEE_layer_init(interp);	/* before any objects are made */
 	interp->try_context = NULL;
 	interp->try_location = NULL;
 
@@ -84,6 +115,11 @@ SEE_interpreter_init_compat(interp, compat_flags)
 	interp->recursion_limit = SEE_system.default_recursion_limit;
 	interp->sec_domain = NULL;
 	interp->regex_engine = SEE_system.default_regex_engine;
+	interp->regex_step_limit = SEE_system.default_regex_step_limit;
+	interp->regex_cache = NULL;
+	interp->enum_cache = NULL;
+	interp->output = NULL;
+	interp->shapes = NULL;
 
 	/* Allocate object storage first, since dependencies are complex */
 	SEE_Array_alloc(interp);
@@ -117,6 +153,95 @@ SEE_interpreter_init_compat(interp, compat_flags)
 	_SEE_module_init(interp);
 }
 
+/**
+ * Initialises an interpreter as a copy of another, initialised one
+ * that is not running. Scripts run in the copy cannot affect the
+ * original, nor other copies of it, and see the built-in objects and
+ * everything else reachable from the original, such as host functions
+ * that were added to its Global object, as the original had them.
+ *
+ * The objects are not copied. Instead, the first copy made freezes
+ * the original's objects and interned strings so that they never
+ * change again, and the original and its copies share them. An
+ * interpreter copies a frozen object only when it first changes it,
+ * and then uses its own copy. Later changes to the original, such as
+ * adding more host functions, are private to it until it is copied
+ * again. Making a copy allocates little more than its own interned
+ * strings table, whatever the number of built-in objects.
+ *
+ * The original must not be used while it is being copied, because
+ * the first copy freezes it. Once frozen, the original is only read,
+ * so several threads may copy it at once; call
+ * SEE_interpreter_freeze() first if the copies are to be made by
+ * several threads. The original's memory must not be freed while
+ * any copy is in use; if the original was allocated from an arena,
+ * the arena must not be destroyed until every copy is finished with.
+ * The host_data field of interp is kept, so that allocators that use
+ * it work during the copy. Module private data is shared.
+ */
+void
+SEE_interpreter_clone(interp, orig)
+	struct SEE_interpreter *interp, *orig;
+{
+	interpreter_clone(interp, orig, NULL);
+}
+
+/**
+ * Initialises an interpreter as a copy of another, like
+ * SEE_interpreter_clone(), except that the copy's memory is allocated
+ * from the given arena. The original's memory must outlive the copy,
+ * because the things that are shared are not copied into the arena.
+ * So must the original's own arena, if it has one.
+ */
+void
+SEE_interpreter_clone_arena(interp, orig, arena)
+	struct SEE_interpreter *interp, *orig;
+	struct SEE_arena *arena;
+{
+	interpreter_clone(interp, orig, arena);
+}
+
+/**
+ * Freezes the objects and interned strings of an interpreter, so that
+ * copies made of it by SEE_interpreter_clone() can share them. The
+ * interpreter continues to work, copying each frozen object when it
+ * first changes it. Freezing again does nothing unless the interpreter
+ * has made or changed objects since.
+ */
+void
+SEE_interpreter_freeze(interp)
+	struct SEE_interpreter *interp;
+{
+	_SEE_layer_freeze(interp);
+}
+
+/* Copies an interpreter, allocating from arena if not NULL */
+static void
+interpreter_clone(interp, orig, arena)
+	struct SEE_interpreter *interp, *orig;
+	struct SEE_arena *arena;
+{
+	void *host_data = interp->host_data;
+
+	_SEE_layer_freeze(orig);
+
+	*interp = *orig;
+	interp->host_data = host_data;
+	interp->arena = arena;
+	interp->try_context = NULL;
+	interp->try_location = NULL;
+	interp->traceback = NULL;
+	interp->random_seed = (*SEE_system.random_seed)();
+	interp->enum_cache = NULL;	/* refers to the original's shapes */
+	interp->output = NULL;		/* each copy is given its own */
+	_SEE_module_clone(interp, orig);
+
+	/* The root objects are shared, and copied when first changed */
+	_SEE_layer_clone(interp, orig);
+	_SEE_intern_clone(interp, orig);
+	_SEE_regex_cache_clone(interp, orig);
+}
+
 struct SEE_interpreter_state {
 	struct SEE_interpreter *interp;
 	volatile struct SEE_try_context * try_context;
@@ -67,26 +67,35 @@ int SEE_lex_debug = 0;
 /*
  * Lexical analyser.
  *
- * This is a lexical analyser for ECMAScript. It uses a 6-character
- * lookahead input 'filter' (to detect '\u####') and provides an
- * interface that reveals if the returned token was immediately
- * preceeded by a line terminator.
+ * This is a lexical analyser for ECMAScript. It reads its input a block
+ * of characters at a time into a buffer, and scans the buffer directly.
+ * The buffer is refilled early enough to always hold the 6 characters
+ * of lookahead needed to detect '\u####'. The interface reveals if the
+ * returned token was immediately preceeded by a line terminator.
  *
  * The lexical analyser's behaviour when deciding a slash '/' as
  * a division or the start of a regular expression is determined by 
  * a flag. The parser is exepected to set it.
  *
+ * Characters below 0x80 are classified with a lookup table; the
+ * Unicode tables are only consulted for the others. Identifiers made
+ * of ASCII characters are matched against the keywords with the
+ * perfect hash in tokens.c, and interned straight from the buffer.
+ *
  * NOTE: Although all strings generated for ECMAscript are UTF-16, 
  * this lexer requires UCS-32 input.
  */
 
+#define LEX_LOOKAHEAD	6		/* longest LOOKAHEAD() needed */
+
 /* Macros that assume local variable lex */
-#define NEXT		lex->input->lookahead
-#define SKIP		do { SEE_INPUT_NEXT(lex->input);		\
-			} while (!ATEOF && is_FormatControl(NEXT))
-#define UNGET(c)	do { lex->la[++lex->lalen]=(c); } while (0)
-#define ATEOF		(lex->input->eof)
-#define LOOKAHEAD(buf, len) SEE_input_lookahead_copy(lex->input, buf, len)
+#define NEXT		(*lex->cur)
+#define SKIP		do { if (++lex->cur + LEX_LOOKAHEAD > lex->end)	\
+				lex_fill(lex);				\
+			} while (!ATEOF && NEXT >= 0x80 && 		\
+				 is_FormatControl(NEXT))
+#define ATEOF		(lex->cur >= lex->end)
+#define LOOKAHEAD(buf, len) lex_lookahead(lex, buf, len)
 #define CONSUME(ch)							\
     do {								\
 	if (ATEOF)							\
@@ -102,11 +111,42 @@ int SEE_lex_debug = 0;
 	    lex->input->interpreter->SyntaxError,			\
 	    prefix_msg(s, lex))
 
+/* Classes of ASCII characters */
+#define LEX_WS		0x01		/* white space but not a newline */
+#define LEX_LT		0x02		/* line terminator */
+#define LEX_IS		0x04		/* identifier start */
+#define LEX_IP		0x08		/* identifier part */
+#define LEX_P1		0x10		/* punctuator never followed by more */
+#define LEX_CLASS(c, cl) ((c) < 0x80 && (lex_class[c] & (cl)))
+
+#define W	LEX_WS
+#define L	LEX_LT
+#define I	(LEX_IS | LEX_IP)
+#define D	LEX_IP
+#define P	LEX_P1
+static const unsigned char lex_class[0x80] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, W, L, W, W, L, 0, 0,	/* 00-0f */
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	/* 10-1f */
+	W, 0, 0, 0, I, 0, 0, 0, P, P, 0, 0, P, 0, 0, 0,	/* 20-2f */
+	D, D, D, D, D, D, D, D, D, D, P, P, 0, 0, 0, P,	/* 30-3f */
+	0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,	/* 40-4f */
+	I, I, I, I, I, I, I, I, I, I, I, P, 0, P, 0, I,	/* 50-5f */
+	0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,	/* 60-6f */
+	I, I, I, I, I, I, I, I, I, I, I, P, 0, P, P, 0	/* 70-7f */
+};
+#undef W
+#undef L
+#undef I
+#undef D
+#undef P
+
 /* Sign constants */
 #define NEGATIVE	(-1)
 #define POSITIVE	(1)
 
 /* Prototypes */
+static void lex_fill(struct lex *lex);
+static int lex_lookahead(struct lex *lex, SEE_unicode_t *buf, int len);
 static struct SEE_string *prefix_msg(struct SEE_string *s, struct lex *lex);
 static int is_FormatControl(SEE_unicode_t c);
 static int is_WhiteSpace(SEE_unicode_t c);
@@ -117,6 +157,7 @@ static int is_HexEscape(struct lex *lex);
 static int is_UnicodeEscape(struct lex *lex);
 static int is_IdentifierStart(struct lex *lex);
 static int is_IdentifierPart(struct lex *lex);
+static int keyword(struct lex *lex, const SEE_unicode_t *c, unsigned int len);
 static SEE_unicode_t HexEscape(struct lex *lex);
 static SEE_unicode_t UnicodeEscape(struct lex *lex);
 static int DivPunctuator(struct lex *lex);
@@ -132,6 +173,42 @@ static int CommentDiv(struct lex *lex);
 static int Token(struct lex *lex);
 static int lex0(struct lex *lex);
 
+/*
+ * Moves the unscanned characters to the front of the buffer and reads
+ * more after them, so that the LOOKAHEAD is there unless the input
+ * has ended.
+ */
+static void
+lex_fill(lex)
+	struct lex *lex;
+{
+	unsigned int n;
+
+	if (lex->cur > lex->end)		/* SKIP at end of input */
+		lex->cur = lex->end;
+	if (lex->input->eof)
+		return;
+	n = lex->end - lex->cur;
+	memmove(lex->buf, lex->cur, n * sizeof lex->buf[0]);
+	lex->cur = lex->buf;
+	lex->end = lex->buf + n + SEE_input_fill(lex->input, lex->buf + n,
+	    LEX_BUFSZ - n);
+}
+
+/* Copies up to len characters starting with NEXT, returning the count */
+static int
+lex_lookahead(lex, buf, len)
+	struct lex *lex;
+	SEE_unicode_t *buf;
+	int len;
+{
+	int i;
+
+	for (i = 0; i < len && lex->cur + i < lex->end; i++)
+		buf[i] = lex->cur[i];
+	return i;
+}
+
 /* Returns ("line " + next_lineno + ": " + s) */
 static struct SEE_string *
 prefix_msg(s, lex)
@@ -157,15 +234,18 @@ static int
 is_WhiteSpace(c)
 	SEE_unicode_t c;			/* 7.2 */
 {
-	return (c == 0x0009 || c == 0x000B || c == 0x000C || c == 0x0020 
-		|| c == 0x00A0 || UNICODE_IS_Zs(c));
+	if (c < 0x80)
+		return lex_class[c] & LEX_WS;
+	return (c == 0x00A0 || UNICODE_IS_Zs(c));
 }
 
 static int
 is_LineTerminator(c)
 	SEE_unicode_t c;			/* 7.3 */
 {
-	return (c == 0x000A || c == 0x000D || c == 0x2028 || c == 0x2029);
+	if (c < 0x80)
+		return lex_class[c] & LEX_LT;
+	return (c == 0x2028 || c == 0x2029);
 }
 
 static int
@@ -227,9 +307,10 @@ is_IdentifierStart(lex)
 
 	if (ATEOF)
 		return 0;
-	if (is_UnicodeEscape(lex))
-		return 1;
 	c = NEXT;
+	if (c < 0x80)
+		return (lex_class[c] & LEX_IS) ||
+		    (c == '\\' && is_UnicodeEscape(lex));
 	return UNICODE_IS_IS(c);
 }
 
@@ -241,9 +322,10 @@ is_IdentifierPart(lex)
 
 	if (ATEOF)
 		return 0;
-	if (is_UnicodeEscape(lex))
-		return 1;
 	c = NEXT;
+	if (c < 0x80)
+		return (lex_class[c] & LEX_IP) ||
+		    (c == '\\' && is_UnicodeEscape(lex));
 	return UNICODE_IS_IP(c);
 }
 
@@ -364,6 +446,11 @@ Punctuator(lex)
 
 	if (ATEOF)
 		return tEND;
+	if (LEX_CLASS(NEXT, LEX_P1)) {
+		j = NEXT;
+		SKIP;
+		return j;
+	}
 	oplen = LOOKAHEAD(op, 4);
 	len = SEE_tok_noperators - 1;
 	if (len > oplen)
@@ -422,11 +509,14 @@ StringLiteral(lex)
 	while (!ATEOF && NEXT != quote) {
 		if (is_LineTerminator(NEXT))
 			SYNTAX_ERROR(STR(broken_literal));
-		else if (is_UnicodeEscape(lex))
+		else if (NEXT != '\\') {
+			c = NEXT;
+			SKIP;
+		} else if (is_UnicodeEscape(lex))
 			c = UnicodeEscape(lex);
 		else if (is_HexEscape(lex))
 			c = HexEscape(lex);
-		else if (NEXT == '\\') {
+		else {
 			SKIP;
 			if (is_LineTerminator(NEXT)) {
 			    if (SEE_GET_JS_COMPAT(interp)) {
@@ -471,9 +561,6 @@ StringLiteral(lex)
 	literal:
 				c = NEXT; SKIP; break;
 			}
-		} else {
-			c = NEXT;
-			SKIP;
 		}
 		SEE_string_append_unicode(s, c);
 	}
@@ -688,6 +775,46 @@ CommentDiv(lex)
 	return DivPunctuator(lex);
 }
 
+/*
+ * Returns the token of the keyword spelled by the len characters at c,
+ * or tIDENT if they spell no keyword (see SEE_tok_keyhash in tokens.c).
+ */
+static int
+keyword(lex, c, len)
+	struct lex *lex;
+	const SEE_unicode_t *c;
+	unsigned int len;
+{
+	const struct strtoken *kw;
+	const struct SEE_string *k;
+	unsigned int i, slot;
+
+	if (len < 2 || len > SEE_TOK_KEYMAX)
+		return tIDENT;
+	slot = SEE_tok_keyhash[SEE_TOK_KEYHASH(c, len)];
+	if (!slot)
+		return tIDENT;
+	kw = &SEE_tok_keywords[slot - 1];
+	k = STRn(kw->index);
+	if (k->length != len)
+		return tIDENT;
+	for (i = 0; i < len; i++)
+		if (k->data[i] != c[i])
+			return tIDENT;
+	if (kw->token == tRESERVED &&
+/* EXT:3 */	SEE_COMPAT_JS(lex->input->interpreter, >=, JS11))
+	{
+#ifndef NDEBUG
+		dprintf("Warning: line %d: reserved token '",
+		    lex->next_lineno);
+		dprints(k);
+		dprintf("' treated as identifier\n");
+#endif
+		return tIDENT;
+	}
+	return kw->token;
+}
+
 static int
 Token(lex)
 	struct lex *lex;				/* 7.5 */
@@ -703,10 +830,34 @@ Token(lex)
 	if ((NEXT >= '0' && NEXT <= '9') || NEXT == '.')
 		return NumericLiteral(lex);
 
+	/*
+	 * Identifiers of ASCII characters that are wholly in the buffer
+	 * are looked up and interned in place. The others are built up
+	 * in a string by the general case below.
+	 */
+	if (LEX_CLASS(NEXT, LEX_IS)) {
+		SEE_unicode_t *p;
+		int token;
+
+		for (p = lex->cur + 1; p < lex->end && LEX_CLASS(*p, LEX_IP);)
+			p++;
+		if (p < lex->end ? *p < 0x80 && *p != '\\' : lex->input->eof) {
+			token = keyword(lex, lex->cur, p - lex->cur);
+			if (token == tIDENT)
+				SEE_SET_STRING(&lex->value, _SEE_intern_unicode(
+				    interp, lex->cur, p - lex->cur));
+			lex->cur = p;
+			if (lex->cur + LEX_LOOKAHEAD > lex->end)
+				lex_fill(lex);
+			return token;
+		}
+	}
+
 	if (is_IdentifierStart(lex)) {
-		int hasescape = 0, i;
+		int hasescape = 0, token;
+		unsigned int i;
 		struct SEE_string *s;
-		SEE_unicode_t c;
+		SEE_unicode_t c, k[SEE_TOK_KEYMAX];
 
 		s = SEE_string_new(interp, 0);
 		do {
@@ -727,29 +878,13 @@ Token(lex)
 		} while (is_IdentifierPart(lex));
 
 		/* match keywords */
-		if (!hasescape)
-		    for (i = 0; i < SEE_tok_nkeywords; i++) {
-			const struct SEE_string *keyword;
-			
-			keyword = STRn(SEE_tok_keywords[i].index);
-			if (keyword->length == s->length &&
-		            SEE_string_cmp(keyword, s) == 0)
-			{
-			    int token = SEE_tok_keywords[i].token;
-			    if (token == tRESERVED &&
-/* EXT:3 */			SEE_COMPAT_JS(interp, >=, JS11))
-			    {
-#ifndef NDEBUG
-				dprintf("Warning: line %d: reserved token '",
-				    lex->next_lineno);
-				dprints(s);
-				dprintf("' treated as identifier\n");
-#endif
-			        break;
-			    }
-			    return token;
-			}
-		     }
+		if (!hasescape && s->length <= SEE_TOK_KEYMAX) {
+			for (i = 0; i < s->length; i++)
+				k[i] = s->data[i];
+			token = keyword(lex, k, s->length);
+			if (token != tIDENT)
+				return token;
+		}
 
 		SEE_intern_and_free(interp, &s);
 		SEE_SET_STRING(&lex->value, s);
@@ -827,6 +962,8 @@ SEE_lex_init(lex, inp)
 	struct SEE_input *inp;
 {
 	lex->input = inp;
+	lex->cur = lex->end = lex->buf;
+	lex_fill(lex);
 	SEE_SET_UNDEFINED(&lex->value);
 	lex->next_lineno = inp->first_lineno;
 	lex->next_filename = SEE_intern(inp->interpreter, inp->filename);
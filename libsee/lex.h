@@ -11,8 +11,12 @@
 struct SEE_input;
 struct SEE_string;
 
+#define LEX_BUFSZ	1024		/* characters read at a time */
+
 struct lex {
 	struct SEE_input  *input;
+	SEE_unicode_t	  *cur, *end;		/* unscanned characters */
+	SEE_unicode_t	   buf[LEX_BUFSZ];	/* characters from input */
 	struct SEE_value   value;
 	int		   next;		/* single token lookahead */
 	int		   next_lineno;		/* line number of next */
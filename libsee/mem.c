@@ -46,7 +46,9 @@
 #include <see/system.h>
 #include <see/error.h>
 #include <see/string.h>
+#include <see/interpreter.h>
 
+#include "arena.h"
 #include "stringdefs.h"
 #include "dprint.h"
 
@@ -66,6 +68,7 @@ int SEE_mem_debug = 0;
 
 /*
  * Allocates size bytes of garbage-collected storage.
+ * Interpreters that have an arena allocate from it instead.
  */
 static void *
 _SEE_malloc(interp, size, file, line)
@@ -78,7 +81,10 @@ _SEE_malloc(interp, size, file, line)
 
 	if (size == 0)
 		return NULL;
-	data = (*SEE_system.malloc)(interp, size, file, line);
+	if (interp && interp->arena)
+		data = _SEE_arena_malloc(interp, size, 0);
+	else
+		data = (*SEE_system.malloc)(interp, size, file, line);
 	if (data == NULL) 
 		(*SEE_system.mem_exhausted)(interp);
 	return data;
@@ -110,8 +116,12 @@ _SEE_malloc_finalize(interp, size, finalizefn, closure, file, line)
 
 	if (size == 0)
 		return NULL;
-	data = (*SEE_system.malloc_finalize)(interp, size, finalizefn, closure,
-	    file, line);
+	if (interp && interp->arena)
+		data = _SEE_arena_malloc_finalize(interp, size, finalizefn,
+		    closure);
+	else
+		data = (*SEE_system.malloc_finalize)(interp, size,
+		    finalizefn, closure, file, line);
 	if (data == NULL) 
 		(*SEE_system.mem_exhausted)(interp);
 	return data;
@@ -144,7 +154,9 @@ _SEE_malloc_string(interp, size, file, line)
 
 	if (size == 0)
 		return NULL;
-	if (SEE_system.malloc_string)
+	if (interp && interp->arena)
+		data = _SEE_arena_malloc(interp, size, 1);
+	else if (SEE_system.malloc_string)
 		data = (*SEE_system.malloc_string)(interp, size, 0, 0);
 	else
 		data = (*SEE_system.malloc)(interp, size, 0, 0);
@@ -163,6 +175,7 @@ SEE_malloc_string(interp, size)
 
 /*
  * Releases memory that the caller *knows* is unreachable.
+ * Memory from an arena is only released with the arena.
  */
 static void
 _SEE_free(interp, memp, file, line)
@@ -172,7 +185,8 @@ _SEE_free(interp, memp, file, line)
 	int line;
 {
 	if (*memp) {
-		(*SEE_system.free)(interp, *memp, 0, 0);
+		if (!(interp && interp->arena))
+			(*SEE_system.free)(interp, *memp, 0, 0);
 		*memp = NULL;
 	}
 }
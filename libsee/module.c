@@ -85,6 +85,18 @@ _SEE_module_alloc(interp)
 			(*_SEE_modules[i]->alloc)(interp);
 }
 
+/* Shares the module private pointers of an interpreter being copied */
+void
+_SEE_module_clone(interp, orig)
+	struct SEE_interpreter *interp, *orig;
+{
+	unsigned int i;
+
+	interp->module_private = SEE_NEW_ARRAY(interp, void *, _SEE_nmodules);
+	for (i = 0; i < _SEE_nmodules; i++)
+		interp->module_private[i] = orig->module_private[i];
+}
+
 /* Calls each module's init() */
 void
 _SEE_module_init(interp)
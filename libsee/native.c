@@ -47,10 +47,39 @@
 
 #include "stringdefs.h"
 #include "dprint.h"
+#include "shape.h"
+#include "clone.h"
 
-static unsigned int hashfn(struct SEE_string *);
-static struct SEE_property **find(struct SEE_interpreter *,
-	struct SEE_object *, struct SEE_string *);
+struct shape_prop;
+struct shape_table;
+struct shape_tree;
+
+static unsigned int hashfn(const void *);
+static struct shape_tree *shape_tree(struct SEE_interpreter *);
+static struct shape_table *table_new(struct SEE_interpreter *,
+	struct shape_prop *, unsigned int);
+static void table_append(struct SEE_interpreter *, struct shape_table *,
+	struct SEE_string *, int);
+static void index_build(struct SEE_interpreter *, struct shape_table *,
+	unsigned int);
+static void index_set(struct shape_table *, struct SEE_string *,
+	unsigned int);
+static void index_remove(struct shape_table *, struct SEE_string *);
+static int shape_find(struct SEE_interpreter *, struct SEE_shape *,
+	struct SEE_string *);
+static struct SEE_shape *shape_add(struct SEE_interpreter *,
+	struct SEE_shape *, struct SEE_string *, int);
+static struct SEE_shape *dictionary_new(struct SEE_interpreter *,
+	struct SEE_shape *);
+static void make_dictionary(struct SEE_interpreter *, struct SEE_native *);
+static int find(struct SEE_interpreter *, struct SEE_native *,
+	struct SEE_string *);
+static int add(struct SEE_interpreter *, struct SEE_native *,
+	struct SEE_string *, int);
+static void set_attr(struct SEE_interpreter *, struct SEE_native *,
+	unsigned int, int);
+static void remove_slot(struct SEE_interpreter *, struct SEE_native *,
+	unsigned int);
 static void native_enum_reset(struct SEE_interpreter *,
 	struct SEE_enum *);
 static struct SEE_string *native_enum_next(struct SEE_interpreter *,
@@ -65,43 +94,465 @@ int SEE_native_debug = 0;
  *  - maintains a simple hash table of named properties
  *  - cannot be called as functions
  *  - cannot be called as a constructor
+ *
+ * A native object keeps only the values of its properties, in a
+ * vector of slots. The names and attributes of the properties live
+ * in a 'shape' that is shared by every object that acquired the same
+ * properties, with the same attributes, in the same order. Shapes are
+ * immutable and are found through a per-interpreter transition table
+ * keyed on (shape, name, attributes), so that a shape pointer
+ * determines where each property's value is to be found. This is
+ * what makes the inline caches of _SEE_native_ic_get() work.
+ *
+ * Objects that delete properties, change attributes, or collect
+ * more than SHAPE_MAXPROPS properties are given a private, mutable
+ * 'dictionary' shape instead. Inline caches never remember those.
+ *
+ * A chain of shapes built by successive additions share the one
+ * descriptor table, each shape using a prefix of it. Only the tree
+ * that made a table extends it; shapes made by the tree of another
+ * interpreter (see clone.c) are extended into a new table. Tables with
+ * more than INDEX_MIN entries are indexed with an open-addressed
+ * hash table of slot numbers.
  */
 
-struct SEE_property {
-        struct SEE_property *next;
-        struct SEE_string *name;
-        int attr;
-        struct SEE_value value;
+#define SHAPE_MAXPROPS	64	/* larger objects become dictionaries */
+#define INDEX_MIN	8	/* smaller tables are searched linearly */
+
+/* The name and attributes of a property */
+struct shape_prop {
+	struct SEE_string *name;
+	int attr;
+};
+
+/* A table of property descriptors, in slot order */
+struct shape_table {
+	struct shape_prop *props;
+	unsigned int count, alloc;
+	unsigned int *index;		/* slot+1 or 0 if empty */
+	unsigned int indexsize;		/* power of 2, or 0 for no index */
+	struct shape_tree *tree;	/* may extend the table in place */
 };
 
-/* Return a hash value for an interned string, in range [0..HASHLEN) */
+struct SEE_shape {
+	struct shape_table *table;	/* descriptors of slots [0,nprops) */
+	unsigned int nprops;
+	int dictionary;			/* private to one object, mutable */
+};
+
+/* An edge in the shape tree */
+struct transition {
+	struct SEE_shape *from, *to;
+	struct SEE_string *name;
+	int attr;
+};
+
+/* Per-interpreter shape state, hung off interp->shapes */
+struct shape_tree {
+	struct SEE_shape *empty;	/* the shape of new objects */
+	struct transition *tab;		/* open-addressed, from=NULL if free */
+	unsigned int ntab, size;
+};
+
+/* Return a hash value for a pointer, usually an interned string */
 static unsigned int
-hashfn(s)
-	struct SEE_string *s;
+hashfn(p)
+	const void *p;
+{
+	unsigned int h = (unsigned)((const char *)p - (const char *)0);
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
+
+#define TRANSITION_HASH(from, name, attr) \
+	(hashfn(from) ^ hashfn(name) ^ (unsigned)(attr))
+
+/* Returns the interpreter's shape tree, creating it on first use */
+static struct shape_tree *
+shape_tree(interp)
+	struct SEE_interpreter *interp;
+{
+	struct shape_tree *tree = (struct shape_tree *)interp->shapes;
+	unsigned int i;
+
+	if (!tree) {
+		tree = SEE_NEW(interp, struct shape_tree);
+		tree->empty = SEE_NEW(interp, struct SEE_shape);
+		tree->empty->table = table_new(interp, NULL, 0);
+		tree->empty->nprops = 0;
+		tree->empty->dictionary = 0;
+		tree->empty->table->tree = tree;
+		tree->ntab = 0;
+		tree->size = 64;
+		tree->tab = SEE_NEW_ARRAY(interp, struct transition,
+			tree->size);
+		for (i = 0; i < tree->size; i++)
+			tree->tab[i].from = NULL;
+		interp->shapes = tree;
+	}
+	return tree;
+}
+
+/* Returns a new descriptor table holding a copy of the given props */
+static struct shape_table *
+table_new(interp, props, count)
+	struct SEE_interpreter *interp;
+	struct shape_prop *props;
+	unsigned int count;
+{
+	struct shape_table *t;
+	unsigned int i;
+
+	t = SEE_NEW(interp, struct shape_table);
+	t->alloc = 4;
+	while (t->alloc < count)
+		t->alloc *= 2;
+	t->props = SEE_NEW_ARRAY(interp, struct shape_prop, t->alloc);
+	for (i = 0; i < count; i++)
+		t->props[i] = props[i];
+	t->count = count;
+	t->index = NULL;
+	t->indexsize = 0;
+	t->tree = (struct shape_tree *)interp->shapes;
+	return t;
+}
+
+/* Appends a descriptor to a table, keeping its index up to date */
+static void
+table_append(interp, t, ip, attr)
+	struct SEE_interpreter *interp;
+	struct shape_table *t;
+	struct SEE_string *ip;
+	int attr;
+{
+	struct shape_prop *props;
+	unsigned int i;
+
+	/*
+	 * Allocation throws when an arena reaches its limit, so the
+	 * table's fields only change after each allocation succeeds.
+	 */
+	if (t->count == t->alloc) {
+		props = SEE_NEW_ARRAY(interp, struct shape_prop, t->alloc * 2);
+		for (i = 0; i < t->count; i++)
+			props[i] = t->props[i];
+		t->props = props;
+		t->alloc *= 2;
+	}
+	t->props[t->count].name = ip;
+	t->props[t->count].attr = attr;
+	if (t->indexsize && (t->count + 1) * 2 <= t->indexsize)
+		index_set(t, ip, t->count);
+	else if (t->count + 1 > INDEX_MIN)
+		index_build(interp, t, t->count + 1);
+	t->count++;
+}
+
+/*
+ * (Re)builds the index of the first count descriptors of a table, so
+ * that it is at most half full
+ */
+static void
+index_build(interp, t, count)
+	struct SEE_interpreter *interp;
+	struct shape_table *t;
+	unsigned int count;
+{
+	unsigned int i, size, *index;
+
+	size = 16;
+	while (size < count * 2)
+		size *= 2;
+	index = SEE_NEW_ARRAY(interp, unsigned int, size);
+	for (i = 0; i < size; i++)
+		index[i] = 0;
+	t->index = index;
+	t->indexsize = size;
+	for (i = 0; i < count; i++)
+		index_set(t, t->props[i].name, i);
+
+#ifndef NDEBUG
+	if (SEE_native_debug)
+	    dprintf("native index: %p %u props, %u buckets\n", t, count,
+		t->indexsize);
+#endif
+}
+
+/* Makes a name's index entry refer to the given slot */
+static void
+index_set(t, ip, slot)
+	struct shape_table *t;
+	struct SEE_string *ip;
+	unsigned int slot;
+{
+	unsigned int i, mask = t->indexsize - 1;
+
+	for (i = hashfn(ip) & mask; t->index[i]; i = (i + 1) & mask)
+		if (t->props[t->index[i] - 1].name == ip)
+			break;
+	t->index[i] = slot + 1;
+}
+
+/*
+ * Removes a name from the index, moving back any later entries
+ * that hashed before it, so there are no tombstones. The descriptor
+ * must still be in the table.
+ */
+static void
+index_remove(t, ip)
+	struct shape_table *t;
+	struct SEE_string *ip;
+{
+	unsigned int i, j, k, mask = t->indexsize - 1;
+
+	for (i = hashfn(ip) & mask; t->props[t->index[i] - 1].name != ip;
+	     i = (i + 1) & mask)
+		;
+	for (j = (i + 1) & mask; t->index[j]; j = (j + 1) & mask) {
+		k = hashfn(t->props[t->index[j] - 1].name) & mask;
+		/* Leave entry j alone if its home k lies cyclically in (i,j] */
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		t->index[i] = t->index[j];
+		i = j;
+	}
+	t->index[i] = 0;
+}
+
+/*
+ * Returns the slot of a property in a shape, or -1 if the shape
+ * does not have it. Assumes the property name is interned.
+ * A shared table may hold descriptors beyond the end of the shape.
+ */
+static int
+shape_find(interp, shape, ip)
+	struct SEE_interpreter *interp;
+	struct SEE_shape *shape;
+	struct SEE_string *ip;
 {
-        return (unsigned)(s - (struct SEE_string *)0) % SEE_NATIVE_HASHLEN;
+	struct shape_table *t = shape->table;
+	unsigned int i, mask, slot;
+
+	ip = _SEE_INTERN_ASSERT(interp, ip);
+	if (!t->indexsize) {
+		for (i = 0; i < shape->nprops; i++)
+			if (t->props[i].name == ip)
+				return i;
+		return -1;
+	}
+	mask = t->indexsize - 1;
+	for (i = hashfn(ip) & mask; (slot = t->index[i]) != 0;
+	     i = (i + 1) & mask)
+		if (t->props[slot - 1].name == ip)
+			return slot - 1 < shape->nprops ? (int)slot - 1 : -1;
+	return -1;
+}
+
+/*
+ * Returns the shared shape that follows from adding a property to
+ * a shared shape, or NULL if the result would be too big to share.
+ */
+static struct SEE_shape *
+shape_add(interp, from, ip, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_shape *from;
+	struct SEE_string *ip;
+	int attr;
+{
+	struct shape_tree *tree = shape_tree(interp);
+	struct transition *x, *tab;
+	struct SEE_shape *to;
+	unsigned int i, j, mask;
+
+	if (from->nprops >= SHAPE_MAXPROPS)
+		return NULL;
+
+	mask = tree->size - 1;
+	for (i = TRANSITION_HASH(from, ip, attr) & mask; tree->tab[i].from;
+	     i = (i + 1) & mask)
+	{
+		x = &tree->tab[i];
+		if (x->from == from && x->name == ip && x->attr == attr)
+			return x->to;
+	}
+
+	to = SEE_NEW(interp, struct SEE_shape);
+	to->nprops = from->nprops + 1;
+	to->dictionary = 0;
+	if (from->table->count == from->nprops && from->table->tree == tree)
+		/* Extend the table in place; 'from' only sees its prefix */
+		to->table = from->table;
+	else
+		to->table = table_new(interp, from->table->props,
+			from->nprops);
+	table_append(interp, to->table, ip, attr);
+
+	if ((tree->ntab + 1) * 2 > tree->size) {
+		tab = SEE_NEW_ARRAY(interp, struct transition, tree->size * 2);
+		for (j = 0; j < tree->size * 2; j++)
+			tab[j].from = NULL;
+		mask = tree->size * 2 - 1;
+		for (j = 0; j < tree->size; j++)
+		    if (tree->tab[j].from) {
+			i = TRANSITION_HASH(tree->tab[j].from,
+				tree->tab[j].name, tree->tab[j].attr) & mask;
+			while (tab[i].from)
+			    i = (i + 1) & mask;
+			tab[i] = tree->tab[j];
+		    }
+		tree->tab = tab;
+		tree->size *= 2;
+		for (i = TRANSITION_HASH(from, ip, attr) & mask;
+		     tree->tab[i].from; i = (i + 1) & mask)
+			;
+	}
+	x = &tree->tab[i];
+	x->from = from;
+	x->name = ip;
+	x->attr = attr;
+	x->to = to;
+	tree->ntab++;
+	return to;
+}
+
+/* Returns a new dictionary shape with the properties of another shape */
+static struct SEE_shape *
+dictionary_new(interp, from)
+	struct SEE_interpreter *interp;
+	struct SEE_shape *from;
+{
+	struct SEE_shape *shape;
+
+	shape = SEE_NEW(interp, struct SEE_shape);
+	shape->nprops = from->nprops;
+	shape->dictionary = 1;
+	shape->table = table_new(interp, from->table->props, shape->nprops);
+	if (shape->nprops > INDEX_MIN)
+		index_build(interp, shape->table, shape->table->count);
+	return shape;
+}
+
+/* Gives an object its own, mutable copy of its shape */
+static void
+make_dictionary(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct SEE_shape *shape;
+
+	if (n->shape->dictionary)
+		return;
+	shape = dictionary_new(interp, n->shape);
+	n->shape = shape;
+
+#ifndef NDEBUG
+	if (SEE_native_debug)
+	    dprintf("native dictionary: %p %u props\n", n, shape->nprops);
+#endif
 }
 
 /*
  * Find an object property, if it exists.
  * Assumes property is interned.
- * Returns either a pointer to the pointer to the property,
- * or a pointer to the NULL pointer at the end of a hash list.
- * (ie never returns NULL);
+ * Returns the property's slot, or -1 if not found.
  */
-static struct SEE_property **
-find(interp, o, ip)
+static int
+find(interp, n, ip)
 	struct SEE_interpreter *interp;
-	struct SEE_object *o;
+	struct SEE_native *n;
 	struct SEE_string *ip;
 {
-	struct SEE_native *n = (struct SEE_native *)o;
-	struct SEE_property **x;
+	return shape_find(interp, n->shape, ip);
+}
+
+/*
+ * Adds a new property to an object, returning its uninitialised slot.
+ * The property must not already exist.
+ */
+static int
+add(interp, n, ip, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	struct SEE_string *ip;
+	int attr;
+{
+	struct SEE_shape *shape = NULL;
+	struct SEE_value *values;
+	unsigned int i, slot = n->shape->nprops;
+
+	/*
+	 * Grow the values first: allocation may throw when an arena
+	 * reaches its limit, and the shape must not get ahead of them.
+	 */
+	if (slot >= n->nvalues) {
+		values = SEE_NEW_ARRAY(interp, struct SEE_value,
+			n->nvalues * 2);
+		for (i = 0; i < slot; i++)
+			values[i] = n->values[i];
+		n->values = values;
+		n->nvalues *= 2;
+	}
+	if (!n->shape->dictionary)
+		shape = shape_add(interp, n->shape, ip, attr);
+	if (shape)
+		n->shape = shape;
+	else {
+		make_dictionary(interp, n);
+		table_append(interp, n->shape->table, ip, attr);
+		n->shape->nprops++;
+	}
+
+	n->mutations++;
+	return slot;
+}
+
+/* Changes the attributes of an existing property */
+static void
+set_attr(interp, n, slot, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	unsigned int slot;
+	int attr;
+{
+	if (n->shape->table->props[slot].attr == attr)
+		return;
+	make_dictionary(interp, n);
+	n->shape->table->props[slot].attr = attr;
+	n->mutations++;
+}
 
-	x = &n->properties[hashfn(_SEE_INTERN_ASSERT(interp, ip))];
-	while (*x && (*x)->name != ip)
-		x = &((*x)->next);
-	return x;
+/*
+ * Removes a property, moving the later properties down one slot so
+ * that the others stay in the order they were added.
+ */
+static void
+remove_slot(interp, n, slot)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	unsigned int slot;
+{
+	struct shape_table *t;
+	unsigned int i, last;
+
+	make_dictionary(interp, n);
+	t = n->shape->table;
+	last = n->shape->nprops - 1;
+	if (t->indexsize) {
+		index_remove(t, t->props[slot].name);
+		for (i = 0; i < t->indexsize; i++)
+			if (t->index[i] > slot + 1)
+				t->index[i]--;
+	}
+	for (i = slot; i < last; i++) {
+		t->props[i] = t->props[i + 1];
+		n->values[i] = n->values[i + 1];
+	}
+	t->count--;
+	n->shape->nprops--;
+	n->mutations++;
 }
 
 /* [[Get]] 8.6.2.1 */
@@ -112,26 +563,10 @@ SEE_native_get(interp, o, ip, res)
 	struct SEE_string *ip;
 	struct SEE_value *res;
 {
-	struct SEE_property **x;
-	struct SEE_native *n = (struct SEE_native *)o;
+	struct SEE_native *n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+	int slot;
 
-	if (n->lru && n->lru->name == ip) {
-#ifndef NDEBUG
-	    if (SEE_native_debug) {
-		dprintf("native_get: o=");
-		dprinto(interp, o);
-		dprintf(" ip=");
-		dprints(ip);
-		dprintf("(%p) LRU HIT -> ", ip);
-		dprintv(interp, &n->lru->value);
-		dprintf("\n");
-	    }
-#endif
-	    SEE_VALUE_COPY(res, &n->lru->value);
-	    return;
-	}
-
-	x = find(interp, o, ip);
+	slot = find(interp, n, ip);
 
 #ifndef NDEBUG
 	if (SEE_native_debug) {
@@ -140,19 +575,18 @@ SEE_native_get(interp, o, ip, res)
 	    dprintf(" ip=");
 	    dprints(ip);
 	    dprintf("(%p)", ip);
-	    if (*x) { 
+	    if (slot >= 0) {
 		dprintf(" -> ");
-		dprintv(interp, &(*x)->value);
+		dprintv(interp, &n->values[slot]);
 		dprintf("\n");
-	    } else 
+	    } else
 		dprintf(" -> not found\n");
 	}
 #endif
 
-	if (*x) {
-	    n->lru = *x;
-	    SEE_VALUE_COPY(res, &(*x)->value);
-	} else if (SEE_GET_JS_COMPAT(interp) &&
+	if (slot >= 0)
+	    SEE_VALUE_COPY(res, &n->values[slot]);
+	else if (SEE_GET_JS_COMPAT(interp) &&
 		 ip == STR(__proto__)) {
 	    if (o->Prototype)
 		SEE_SET_OBJECT(res, o->Prototype);
@@ -170,7 +604,7 @@ SEE_native_get(interp, o, ip, res)
 #endif
 	    if (!o->Prototype)
 		SEE_SET_UNDEFINED(res);
-	    else 
+	    else
 		SEE_OBJECT_GET(interp, o->Prototype, ip, res);
 	}
 }
@@ -184,44 +618,32 @@ SEE_native_put(interp, o, ip, val, attr)
 	struct SEE_value *val;
 	int attr;
 {
-	struct SEE_property **x;
-	struct SEE_native *n = (struct SEE_native *)o;
+	struct SEE_native *n;
+	int slot;
 
 	SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(val) != SEE_REFERENCE);
 
-	if (n->lru && n->lru->name == ip && 
-	    !(n->lru->attr & SEE_ATTR_READONLY) && !attr)
-	{
-#ifndef NDEBUG
-		if (SEE_native_debug) {
-		    dprintf("native_put: o=");
-		    dprinto(interp, o);
-		    dprintf(" ip=");
-		    dprints(ip);
-		    dprintf("(%p) LRU HIT <- ", ip);
-		    dprintv(interp, val);
-		    dprintf("\n");
-		}
-#endif
-		SEE_VALUE_COPY(&n->lru->value, val);
-		return;
-	}
-
-	if (SEE_GET_JS_COMPAT(interp) && ip == STR(__proto__)) 
+	if (SEE_GET_JS_COMPAT(interp) && ip == STR(__proto__))
 	{
 		struct SEE_object *po;
+
+		/* Other interpreters share the [[Prototype]] of a copy */
+		n = (struct SEE_native *)o;
+		if (_SEE_NATIVE_WRITE(interp, n) != n)
+			SEE_error_throw_string(interp, interp->TypeError,
+				STR(proto_shared));
 		if (SEE_VALUE_GET_TYPE(val) == SEE_NULL) {
 			o->Prototype = NULL;
 			return;
 		}
 		if (SEE_VALUE_GET_TYPE(val) != SEE_OBJECT)
 			/* XXX: better error message needed. 'bad proto'? */
-			SEE_error_throw_string(interp, interp->TypeError, 
+			SEE_error_throw_string(interp, interp->TypeError,
 				STR(internal_error));
 		/* Check for recursive prototype */
 		for (po = val->u.object; po; po = po->Prototype)
 		    if (SEE_OBJECT_JOINED(o, po))
-			SEE_error_throw_string(interp, interp->TypeError, 
+			SEE_error_throw_string(interp, interp->TypeError,
 				STR(internal_error));
 		o->Prototype = val->u.object;
 		return;
@@ -235,18 +657,13 @@ SEE_native_put(interp, o, ip, val, attr)
 	 */
 	if (!attr && !SEE_OBJECT_CANPUT(interp, o, ip))
 		return;
-	x = find(interp, o, ip);
-	if (!*x) {
-		struct SEE_property *prop;
-		prop = SEE_NEW(interp, struct SEE_property);
-		prop->next = NULL;
-		prop->name = ip;
-		prop->attr = attr;
-		*x = prop;
-	} else if (attr)
-		(*x)->attr = attr;
-	n->lru = *x;
-	SEE_VALUE_COPY(&(*x)->value, val);
+	n = _SEE_NATIVE_WRITE(interp, (struct SEE_native *)o);
+	slot = find(interp, n, ip);
+	if (slot < 0)
+		slot = add(interp, n, ip, attr);
+	else if (attr)
+		set_attr(interp, n, slot, attr);
+	SEE_VALUE_COPY(&n->values[slot], val);
 
 #ifndef NDEBUG
 	if (SEE_native_debug) {
@@ -276,25 +693,11 @@ SEE_native_canput(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
-	struct SEE_native *n = (struct SEE_native *)o;
-
-	if (n->lru && n->lru->name == ip) {
-#ifndef NDEBUG
-		if (SEE_native_debug) {
-		    dprintf("native_canput: o=");
-		    dprinto(interp, o);
-		    dprintf(" ip=");
-		    dprints(ip);
-		    dprintf("(%p) LRU HIT -> %d\n", ip,
-			(n->lru->attr & SEE_ATTR_READONLY) ? 0 : 1);
-		}
-#endif
-		return (n->lru->attr & SEE_ATTR_READONLY) ? 0 : 1;
-	}
+	struct SEE_native *n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+	int slot;
 
-	x = find(interp, o, ip);
-	if (*x) {
+	slot = find(interp, n, ip);
+	if (slot >= 0) {
 #ifndef NDEBUG
 		if (SEE_native_debug) {
 		    dprintf("native_canput: o=");
@@ -302,11 +705,12 @@ SEE_native_canput(interp, o, ip)
 		    dprintf(" ip=");
 		    dprints(ip);
 		    dprintf("(%p) -> %d\n", ip,
-			((*x)->attr & SEE_ATTR_READONLY) ? 0 : 1);
+			(n->shape->table->props[slot].attr &
+			 SEE_ATTR_READONLY) ? 0 : 1);
 		}
 #endif
-		n->lru = *x;
-		return ((*x)->attr & SEE_ATTR_READONLY) ? 0 : 1;
+		return (n->shape->table->props[slot].attr &
+			SEE_ATTR_READONLY) ? 0 : 1;
 	}
 	if (!o->Prototype)
 		return 1;
@@ -320,33 +724,20 @@ native_hasownproperty(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
-	struct SEE_native *n = (struct SEE_native *)o;
-
-	if (n->lru && n->lru->name == ip) {
-#ifndef NDEBUG
-	    if (SEE_native_debug) {
-		dprintf("hasownprop: o=");
-		dprinto(interp, o);
-		dprintf(" ip=");
-		dprints(ip);
-		dprintf(" LRU HIT -> 1\n");
-	    }
-#endif
-	    return 1;
-	}
+	int slot;
 
-	x = find(interp, o, ip);
+	slot = find(interp, _SEE_NATIVE_READ(interp, (struct SEE_native *)o),
+		ip);
 #ifndef NDEBUG
 	if (SEE_native_debug) {
 	    dprintf("hasownprop: o=");
 	    dprinto(interp, o);
 	    dprintf(" ip=");
 	    dprints(ip);
-	    dprintf(" -> %d\n", *x ? 1 : 0);
+	    dprintf(" -> %d\n", slot >= 0 ? 1 : 0);
 	}
 #endif
-	return *x ? 1 : 0;
+	return slot >= 0 ? 1 : 0;
 }
 
 /* [[HasProperty]] 8.6.2.4 */
@@ -385,10 +776,11 @@ SEE_native_getownattr(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
+	struct SEE_native *n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+	int slot;
 
-	x = find(interp, o, ip);
-	return *x ? (*x)->attr : 0;
+	slot = find(interp, n, ip);
+	return slot >= 0 ? n->shape->table->props[slot].attr : 0;
 }
 
 /* [[Delete]] 8.6.2.5 */
@@ -398,20 +790,169 @@ SEE_native_delete(interp, o, ip)
 	struct SEE_object *o;
 	struct SEE_string *ip;
 {
-	struct SEE_property **x;
-	struct SEE_native *n = (struct SEE_native *)o;
+	struct SEE_native *n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+	int slot;
 
-	x = find(interp, o, ip);
-	if (!*x)
+	slot = find(interp, n, ip);
+	if (slot < 0)
 		return 1;
-	if ((*x)->attr & SEE_ATTR_DONTDELETE)
+	if (n->shape->table->props[slot].attr & SEE_ATTR_DONTDELETE)
 		return 0;
-	if (n->lru == *x)
-	    n->lru = NULL;
-	*x = (*x)->next;
+	remove_slot(interp, _SEE_NATIVE_WRITE(interp, (struct SEE_native *)o),
+		slot);
 	return 1;
 }
 
+/*------------------------------------------------------------
+ * Inline caches
+ *
+ * An inline cache entry records, for one property name, the shapes
+ * of the objects along a prototype chain, ending at the object that
+ * held the property. Since shared shapes never change, seeing the
+ * same shapes again means the property is in the same slot of the
+ * same holder, and nothing earlier in the chain has gained it.
+ * Entries are only made for interned names, and are matched by
+ * pointer so that a hit does not need to intern the name again.
+ */
+
+/* Returns the holder of a cached property, or NULL on a cache miss */
+static struct SEE_native *
+ic_match(interp, e, o, prop)
+	struct SEE_interpreter *interp;
+	struct SEE_ic_entry *e;
+	struct SEE_object *o;
+	struct SEE_string *prop;
+{
+	struct SEE_native *n;
+	unsigned int d;
+
+	if (e->name != prop)
+		return NULL;
+	n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+	if (n->shape != e->shape[0])
+		return NULL;
+	for (d = 1; d <= e->depth; d++) {
+		o = o->Prototype;
+		if (!o || o->objectclass->Get != SEE_native_get)
+			return NULL;
+		n = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+		if (n->shape != e->shape[d])
+			return NULL;
+	}
+	return n;
+}
+
+/* Fills the next entry of an inline cache */
+static void
+ic_fill(ic, prop, shapes, depth, slot)
+	struct SEE_ic *ic;
+	struct SEE_string *prop;
+	struct SEE_shape **shapes;
+	unsigned int depth, slot;
+{
+	struct SEE_ic_entry *e = &ic->entry[ic->next];
+	unsigned int d;
+
+	for (d = 0; d <= depth; d++)
+		e->shape[d] = shapes[d];
+	e->name = prop;
+	e->depth = depth;
+	e->slot = slot;
+	ic->next = (ic->next + 1) % SEE_IC_WAYS;
+}
+
+/*
+ * Gets a property through an inline cache. The object's [[Get]]
+ * method must be SEE_native_get(). The property need not be interned.
+ */
+void
+_SEE_native_ic_get(interp, ic, o, prop, res)
+	struct SEE_interpreter *interp;
+	struct SEE_ic *ic;
+	struct SEE_object *o;
+	struct SEE_string *prop;
+	struct SEE_value *res;
+{
+	struct SEE_shape *shapes[SEE_IC_DEPTH];
+	struct SEE_native *h;
+	struct SEE_string *ip;
+	unsigned int d, k;
+	int slot, cacheable;
+
+	for (k = 0; k < SEE_IC_WAYS; k++)
+		if ((h = ic_match(interp, &ic->entry[k], o, prop)) != NULL) {
+			SEE_VALUE_COPY(res, &h->values[ic->entry[k].slot]);
+			return;
+		}
+
+	/* Miss: do what SEE_native_get() does, noting the shapes seen */
+	ip = SEE_intern(interp, prop);
+	cacheable = (ip == prop) && ip != STR(__proto__);
+	for (d = 0;; d++) {
+		h = _SEE_NATIVE_READ(interp, (struct SEE_native *)o);
+		slot = find(interp, h, ip);
+		if (d >= SEE_IC_DEPTH || h->shape->dictionary)
+			cacheable = 0;
+		else
+			shapes[d] = h->shape;
+		if (slot >= 0)
+			break;
+		if (SEE_GET_JS_COMPAT(interp) && ip == STR(__proto__)) {
+			SEE_native_get(interp, o, ip, res);
+			return;
+		}
+		o = o->Prototype;
+		if (!o) {
+			SEE_SET_UNDEFINED(res);
+			return;
+		}
+		if (o->objectclass->Get != SEE_native_get) {
+			SEE_OBJECT_GET(interp, o, ip, res);
+			return;
+		}
+	}
+	if (cacheable)
+		ic_fill(ic, prop, shapes, d, slot);
+	SEE_VALUE_COPY(res, &h->values[slot]);
+}
+
+/*
+ * Puts a property through an inline cache. The object's [[Put]]
+ * method must be SEE_native_put(). Only assignments to existing,
+ * writable properties of the object itself are cached.
+ */
+void
+_SEE_native_ic_put(interp, ic, o, prop, val)
+	struct SEE_interpreter *interp;
+	struct SEE_ic *ic;
+	struct SEE_object *o;
+	struct SEE_string *prop;
+	struct SEE_value *val;
+{
+	struct SEE_native *n = _SEE_NATIVE_WRITE(interp, (struct SEE_native *)o);
+	struct SEE_ic_entry *e;
+	struct SEE_string *ip;
+	unsigned int k;
+	int slot;
+
+	for (k = 0; k < SEE_IC_WAYS; k++) {
+		e = &ic->entry[k];
+		if (e->name == prop && e->shape[0] == n->shape && !e->depth) {
+			SEE_VALUE_COPY(&n->values[e->slot], val);
+			return;
+		}
+	}
+
+	ip = SEE_intern(interp, prop);
+	SEE_native_put(interp, o, ip, val, 0);
+	if (ip != prop || ip == STR(__proto__) || n->shape->dictionary)
+		return;
+	slot = find(interp, n, ip);
+	if (slot >= 0 &&
+	    !(n->shape->table->props[slot].attr & SEE_ATTR_READONLY))
+		ic_fill(ic, prop, &n->shape, 0, slot);
+}
+
 /* [[DefaultValue]] 8.6.2.6 */
 void
 SEE_native_defaultvalue(interp, o, hint, res)
@@ -501,9 +1042,8 @@ SEE_native_defaultvalue(interp, o, hint, res)
  */
 struct native_enum {
 	struct SEE_enum	base;
-	struct SEE_native *native;
-	int next_column;
-	struct SEE_property *next_prop;
+	struct SEE_native *native;	/* the object, not a view of it */
+	unsigned int next_slot;
 };
 
 static void
@@ -512,8 +1052,7 @@ native_enum_reset(interp, e)
 	struct SEE_enum *e;
 {
 	struct native_enum *ne = (struct native_enum *)e;
-	ne->next_column = 0;
-	ne->next_prop = NULL;
+	ne->next_slot = 0;
 }
 
 static struct SEE_string *
@@ -523,16 +1062,12 @@ native_enum_next(interp, e, dont_enump)
 	int *dont_enump;
 {
 	struct native_enum *ne = (struct native_enum *)e;
-	struct SEE_native *n = ne->native;
-	struct SEE_property *p;
+	struct SEE_shape *shape = _SEE_NATIVE_READ(interp, ne->native)->shape;
+	struct shape_prop *p;
 
-	while (ne->next_prop == NULL) {
-	    if (ne->next_column >= SEE_NATIVE_HASHLEN)
-		    return NULL;
-	    ne->next_prop = n->properties[ne->next_column++];
-	}
-	p = ne->next_prop;
-	ne->next_prop = p->next;
+	if (ne->next_slot >= shape->nprops)
+		return NULL;
+	p = &shape->table->props[ne->next_slot++];
 
 	if (dont_enump)
 		*dont_enump = (p->attr & SEE_ATTR_DONTENUM);
@@ -597,12 +1132,46 @@ SEE_native_init(n, interp, objectclass, prototype)
 	struct SEE_objectclass *objectclass;
 	struct SEE_object *prototype;
 {
-	int i;
-
 	n->object.objectclass = objectclass;
 	n->object.Prototype = prototype;
 	n->object.host_data = NULL;
-	n->lru = NULL;
-	for (i = 0; i < SEE_NATIVE_HASHLEN; i++)
-		n->properties[i] = NULL;
+	n->shape = shape_tree(interp)->empty;
+	n->values = n->inline_values;
+	n->nvalues = SEE_NATIVE_INLINE;
+	n->mutations = 0;
+	n->layer = (struct SEE_layer *)interp->layer;
+	n->layer->nobjects++;
+}
+
+/*------------------------------------------------------------
+ * Copying native objects on write (see clone.c)
+ */
+
+/*
+ * Returns a copy of the first size bytes of an object that starts
+ * with a struct SEE_native, with its own property values. A private
+ * dictionary shape is copied too, since it is changed in place.
+ * The caller copies anything else after the native part that the
+ * copy must not share.
+ */
+struct SEE_native *
+_SEE_native_copy(interp, n, size)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+	SEE_size_t size;
+{
+	struct SEE_native *copy;
+
+	copy = (struct SEE_native *)SEE_malloc(interp, size);
+	memcpy(copy, n, size);
+	if (n->values != n->inline_values) {
+		copy->values = SEE_NEW_ARRAY(interp, struct SEE_value,
+			n->nvalues);
+		memcpy(copy->values, n->values,
+			n->shape->nprops * sizeof n->values[0]);
+	} else
+		copy->values = copy->inline_values;
+	if (n->shape->dictionary)
+		copy->shape = dictionary_new(interp, n->shape);
+	return copy;
 }
@@ -32,6 +32,16 @@
 # include <config.h>
 #endif
 
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
+#if HAVE_LIMITS_H
+# include <limits.h>
+#else
+# define UINT_MAX (~(unsigned int)0)
+#endif
+
 #include <see/mem.h>
 #include <see/value.h>
 #include <see/string.h>
@@ -47,6 +57,7 @@
 #include "array.h"
 #include "parse.h"
 #include "init.h"
+#include "clone.h"
 #include "nmath.h"
 
 /*
@@ -54,12 +65,45 @@
  * 15.4 
  */
 
-/* structure of array instances */
+/*
+ * Structure of array instances.
+ *
+ * Elements 0 to ndense-1 are kept in the dense vector, where a missing
+ * element is marked as a hole. All other elements, including those
+ * with non-default attributes, are native properties named by their
+ * decimal index, as are the array's non-element properties. Because
+ * nsparse counts the element properties in the native table, the
+ * common case of a fully dense array never has to build an index name.
+ * The last element of the dense vector is never a hole.
+ */
 struct array_object {
 	struct SEE_native native;
 	SEE_uint32_t length;
+	struct SEE_value *dense;	/* elements 0..ndense-1 */
+	SEE_uint32_t ndense;		/* size of the dense part */
+	SEE_uint32_t nalloc;		/* allocated size of dense[] */
+	SEE_uint32_t nholes;		/* holes in dense[] */
+	SEE_uint32_t nsparse;		/* elements in the native table */
 };
 
+#define DENSE_MINALLOC	8	/* smallest dense vector allocated */
+#define DENSE_MAXGAP	64	/* holes always allowed by a store */
+
+/* Holes are null references, which no property can hold */
+#define HOLE_SET(vp)	_SEE_SET_REFERENCE(vp, NULL, NULL)
+#define IS_HOLE(vp)	(SEE_VALUE_GET_TYPE(vp) == SEE_REFERENCE)
+
+/* True if every element below the length is in the dense vector */
+#define IS_DENSE(ao)	((ao)->ndense == (ao)->length && (ao)->nholes == 0)
+
+/* The fields of an array as this interpreter sees them (see clone.h) */
+#define ARRAY_READ(interp, o)						\
+	((struct array_object *)_SEE_NATIVE_READ(interp,		\
+	    (struct SEE_native *)(o)))
+#define ARRAY_WRITE(interp, o)						\
+	((struct array_object *)_SEE_NATIVE_WRITE(interp,		\
+	    (struct SEE_native *)(o)))
+
 
 /* Prototypes */
 static void intstr_p(struct SEE_string *, SEE_uint32_t);
@@ -69,6 +113,18 @@ static struct array_object *toarray(struct SEE_interpreter *,
 	struct SEE_object *);
 static void check_too_long(struct SEE_interpreter *, SEE_uint32_t,
 	SEE_uint32_t);
+static void dense_reserve(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t);
+static void dense_truncate(struct array_object *, SEE_uint32_t);
+static void dense_spill(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t);
+static void dense_absorb(struct SEE_interpreter *, struct array_object *);
+static int dense_put(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t, struct SEE_value *);
+static void put_element(struct SEE_interpreter *, struct array_object *,
+	SEE_uint32_t, struct SEE_string *, struct SEE_value *, int);
+static int join_length(struct array_object *, SEE_uint32_t, unsigned int,
+	unsigned int *);
 
 static void array_init(struct array_object *, struct SEE_interpreter *, 
 	unsigned int);
@@ -95,14 +151,22 @@ static void array_proto_shift(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
 static void array_proto_slice(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
-static int SortCompare(struct SEE_interpreter *, struct SEE_value *,
-	struct SEE_value *, struct SEE_object *);
-static int qs_partition(struct SEE_interpreter *, struct SEE_object *,
-	SEE_uint32_t, SEE_uint32_t, struct SEE_object *, struct SEE_string **,
-	struct SEE_string **);
-static void qs_sort(struct SEE_interpreter *, struct SEE_object *,
-	SEE_uint32_t, SEE_uint32_t, struct SEE_object *, struct SEE_string **,
-	struct SEE_string **);
+struct sort;
+struct sort_item;
+static int SortCompare(struct sort *, struct sort_item *,
+	struct sort_item *);
+static SEE_uint32_t sort_upper(struct sort *, struct sort_item *,
+	struct sort_item *, SEE_uint32_t);
+static SEE_uint32_t sort_lower(struct sort *, struct sort_item *,
+	struct sort_item *, SEE_uint32_t);
+static void sort_insertion(struct sort *, struct sort_item *,
+	SEE_uint32_t, SEE_uint32_t);
+static SEE_uint32_t sort_run(struct sort *, struct sort_item *,
+	SEE_uint32_t);
+static SEE_uint32_t sort_minrun(SEE_uint32_t);
+static void sort_merge(struct sort *, struct sort_item *, unsigned int);
+static void sort_collapse(struct sort *, struct sort_item *);
+static void sort_items(struct sort *, struct sort_item *, SEE_uint32_t);
 static void array_proto_sort(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_object *, int, struct SEE_value **, struct SEE_value *);
 static void array_proto_splice(struct SEE_interpreter *, struct SEE_object *,
@@ -120,6 +184,10 @@ static int array_hasproperty(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *);
 static int array_delete(struct SEE_interpreter *, struct SEE_object *,
 	struct SEE_string *);
+static struct SEE_string *array_enum_next(struct SEE_interpreter *,
+	struct SEE_enum *, int *);
+static struct SEE_enum *array_enumerator(struct SEE_interpreter *,
+	struct SEE_object *);
 
 /* object class for Array constructor */
 static struct SEE_objectclass array_const_class = {
@@ -144,7 +212,7 @@ static struct SEE_objectclass array_inst_class = {
 	array_hasproperty,		/* HasProperty */
 	array_delete,			/* Delete */
 	SEE_native_defaultvalue,	/* DefaultValue */
-	SEE_native_enumerator		/* enumerator */
+	array_enumerator		/* enumerator */
 };
 
 void
@@ -211,6 +279,30 @@ SEE_Array_init(interp)
 	PUTFUNC(unshift, 1)			/* 15.4.4.13 */
 }
 
+/*
+ * Copies the fields of an array for an interpreter that is about to
+ * change it (see clone.c). Returns NULL for other objects.
+ */
+struct SEE_native *
+SEE_Array_copy(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct array_object *ao, *orig = (struct array_object *)n;
+
+	if (n->object.objectclass != &array_inst_class)
+		return NULL;
+	ao = (struct array_object *)_SEE_native_copy(interp, n, sizeof *ao);
+	if (orig->nalloc) {
+		ao->dense = SEE_NEW_ARRAY(interp, struct SEE_value,
+			orig->nalloc);
+		memcpy(ao->dense, orig->dense,
+			orig->ndense * sizeof orig->dense[0]);
+	} else
+		ao->dense = NULL;
+	return (struct SEE_native *)ao;
+}
+
 #define MAX_ARRAY_INDEX	       4294967295
 #define MAX_ARRAY_INDEX_DIV_10 429496729
 #define MAX_ARRAY_INDEX_MOD_10          5
@@ -262,9 +354,9 @@ intstr_p(s, i)
 }
 
 /*
- * If sp is null, allocates a new empty string.
- * Clears the string *sp and puts unsigned integer i into it.
- * Returns an intern'd string
+ * Returns an intern'd string holding unsigned integer i. Small integers
+ * come from the interpreter's cache. Otherwise, if sp is null, allocates
+ * a new empty string, and then clears the string *sp and puts i into it.
  */
 static struct SEE_string *
 intstr(interp, sp, i)
@@ -272,18 +364,10 @@ intstr(interp, sp, i)
 	struct SEE_string **sp;
 	SEE_uint32_t i;
 {
-	switch (i) {
-	case 0: return STR(zero_digit);
-	case 1: return STR(1);
-	case 2: return STR(2);
-	case 3: return STR(3);
-	case 4: return STR(4);
-	case 5: return STR(5);
-	case 6: return STR(6);
-	case 7: return STR(7);
-	case 8: return STR(8);
-	case 9: return STR(9);
-	}
+	struct SEE_string *s;
+
+	if ((s = _SEE_intern_uint(interp, i)) != NULL)
+		return s;
 
 	if (!*sp)
 		*sp = SEE_string_new(interp, 9);
@@ -294,7 +378,9 @@ intstr(interp, sp, i)
 }
 
 /*
- * Convert the object to a native array, or raise an error
+ * Convert the object to a native array, or raise an error.
+ * The array's fields are read or changed through ARRAY_READ() or
+ * ARRAY_WRITE() of the result.
  */
 static struct array_object *
 toarray(interp, o)
@@ -318,6 +404,170 @@ check_too_long(interp, a, b)
 	    	"array too long");
 }
 
+/* Ensures the dense vector has room for n elements */
+static void
+dense_reserve(interp, ao, n)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t n;
+{
+	struct SEE_value *dense;
+	SEE_uint32_t nalloc;
+
+	if (n <= ao->nalloc)
+	    return;
+	nalloc = ao->nalloc ? ao->nalloc : DENSE_MINALLOC;
+	while (nalloc < n)
+	    nalloc = nalloc * 2 > nalloc ? nalloc * 2 : n;
+	dense = SEE_NEW_ARRAY(interp, struct SEE_value, nalloc);
+	if (ao->ndense)
+	    memcpy(dense, ao->dense, ao->ndense * sizeof *dense);
+	ao->dense = dense;
+	ao->nalloc = nalloc;
+}
+
+/* Drops the dense elements at and above n, and any holes left at the end */
+static void
+dense_truncate(ao, n)
+	struct array_object *ao;
+	SEE_uint32_t n;
+{
+	SEE_uint32_t i;
+
+	for (i = n; i < ao->ndense; i++) {
+	    if (IS_HOLE(&ao->dense[i]))
+		ao->nholes--;
+	    SEE_SET_UNDEFINED(&ao->dense[i]);	/* release for the collector */
+	}
+	if (n < ao->ndense)
+	    ao->ndense = n;
+	while (ao->ndense && IS_HOLE(&ao->dense[ao->ndense - 1])) {
+	    ao->ndense--;
+	    ao->nholes--;
+	}
+}
+
+/* Moves the dense elements at and above 'from' into the native table */
+static void
+dense_spill(interp, ao, from)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t from;
+{
+	struct SEE_string *s = NULL;
+	SEE_uint32_t i;
+
+	for (i = from; i < ao->ndense; i++)
+	    if (!IS_HOLE(&ao->dense[i])) {
+		SEE_native_put(interp, (struct SEE_object *)ao,
+		    intstr(interp, &s, i), &ao->dense[i], 0);
+		ao->nsparse++;
+	    }
+	dense_truncate(ao, from);
+}
+
+/*
+ * Moves elements that directly follow the dense part out of the
+ * native table and onto the end of the dense vector.
+ */
+static void
+dense_absorb(interp, ao)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+{
+	struct SEE_object *o = (struct SEE_object *)ao;
+	struct SEE_string *s = NULL, *p;
+
+	while (ao->nsparse) {
+	    p = intstr(interp, &s, ao->ndense);
+	    if (!SEE_native_hasownproperty(interp, o, p) ||
+		SEE_native_getownattr(interp, o, p) != 0)
+		    break;
+	    dense_reserve(interp, ao, ao->ndense + 1);
+	    SEE_native_get(interp, o, p, &ao->dense[ao->ndense]);
+	    SEE_native_delete(interp, o, p);
+	    ao->nsparse--;
+	    ao->ndense++;
+	}
+}
+
+/*
+ * Stores element i in the dense vector, extending it with holes if
+ * the gap is small. Returns false if the element should instead be
+ * kept in the native table.
+ */
+static int
+dense_put(interp, ao, i, val)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t i;
+	struct SEE_value *val;
+{
+	struct SEE_string *s = NULL;
+	SEE_uint32_t k;
+
+	if (i < ao->ndense) {
+	    if (IS_HOLE(&ao->dense[i]))
+		ao->nholes--;
+	    SEE_VALUE_COPY(&ao->dense[i], val);
+	    return 1;
+	}
+
+	/* Keep at least half of the dense vector filled */
+	if (i - ao->ndense > DENSE_MAXGAP && i / 2 > ao->ndense)
+	    return 0;
+	if (ao->nsparse) {
+	    if (i - ao->ndense > DENSE_MAXGAP)
+		return 0;
+	    for (k = ao->ndense; k <= i; k++)
+		if (SEE_native_hasownproperty(interp, 
+		    (struct SEE_object *)ao, intstr(interp, &s, k)))
+			return 0;
+	}
+
+	dense_reserve(interp, ao, i + 1);
+	for (k = ao->ndense; k < i; k++)
+	    HOLE_SET(&ao->dense[k]);
+	ao->nholes += i - ao->ndense;
+	SEE_VALUE_COPY(&ao->dense[i], val);
+	ao->ndense = i + 1;
+	dense_absorb(interp, ao);
+	return 1;
+}
+
+/*
+ * Stores element i of an array. The element's name p is only
+ * needed when the element is kept in the native table, and is
+ * built from i if p is NULL.
+ */
+static void
+put_element(interp, ao, i, p, val, attr)
+	struct SEE_interpreter *interp;
+	struct array_object *ao;
+	SEE_uint32_t i;
+	struct SEE_string *p;
+	struct SEE_value *val;
+	int attr;
+{
+	struct SEE_object *o = (struct SEE_object *)ao;
+	struct SEE_string *s = NULL;
+	int had;
+
+	if (attr || !dense_put(interp, ao, i, val)) {
+	    /* Non-default attributes are only kept in the native table */
+	    if (i < ao->ndense)
+		dense_spill(interp, ao, i);
+	    if (!p)
+		p = intstr(interp, &s, i);
+	    had = SEE_native_hasownproperty(interp, o, p);
+	    SEE_native_put(interp, o, p, val, attr);
+	    if (!had && SEE_native_hasownproperty(interp, o, p))
+		ao->nsparse++;
+	}
+	if (i >= ao->length)
+	    ao->length = i + 1;
+}
+
 int
 SEE_is_Array(o)
 	struct SEE_object *o;
@@ -333,12 +583,10 @@ SEE_Array_push(interp, o, v)
 	struct SEE_value *v;
 {
 	struct array_object *a;
-	struct SEE_string *s = NULL;
 
-	a = toarray(interp, o);
+	a = ARRAY_WRITE(interp, toarray(interp, o));
 	check_too_long(interp, a->length, 1);
-	SEE_native_put(interp, o, intstr(interp, &s, a->length), v, 0);
-	a->length++;
+	put_element(interp, a, a->length, NULL, v, 0);
 }
 
 SEE_uint32_t
@@ -346,10 +594,50 @@ SEE_Array_length(interp, o)
 	struct SEE_interpreter *interp;
 	struct SEE_object *o;
 {
-	struct array_object *a = toarray(interp, o);
+	struct array_object *a = ARRAY_READ(interp, toarray(interp, o));
 	return a->length;
 }
 
+/* Fast native array element read, a[index] */
+void
+SEE_Array_getindex(interp, o, index, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t index;
+	struct SEE_value *res;
+{
+	struct array_object *a = ARRAY_READ(interp, toarray(interp, o));
+	struct SEE_string *s = NULL;
+
+	if (index < a->ndense && !IS_HOLE(&a->dense[index]))
+	    SEE_VALUE_COPY(res, &a->dense[index]);
+	else
+	    SEE_native_get(interp, o, intstr(interp, &s, index), res);
+}
+
+/* Fast native array element write, a[index] = val */
+void
+SEE_Array_putindex(interp, o, index, val)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	SEE_uint32_t index;
+	struct SEE_value *val;
+{
+	put_element(interp, ARRAY_WRITE(interp, toarray(interp, o)), index,
+	    NULL, val, 0);
+}
+
+/* Returns the interned name of an array index */
+struct SEE_string *
+SEE_Array_indexname(interp, index)
+	struct SEE_interpreter *interp;
+	SEE_uint32_t index;
+{
+	struct SEE_string *s = NULL;
+
+	return intstr(interp, &s, index);
+}
+
 /* helper function to build an array instance */
 static void
 array_init(ao, interp, length)
@@ -360,6 +648,11 @@ array_init(ao, interp, length)
 	SEE_native_init(&ao->native, interp, &array_inst_class, 
 	    interp->Array_prototype);
 	ao->length = length;
+	ao->dense = NULL;
+	ao->ndense = 0;
+	ao->nalloc = 0;
+	ao->nholes = 0;
+	ao->nsparse = 0;
 }
 
 /* 15.4.4.2 */
@@ -374,7 +667,6 @@ array_construct(interp, self, thisobj, argc, argv, res)
 	struct array_object *ao;
 	int i;
 	SEE_uint32_t length;
-	struct SEE_string *s = NULL;
 
 	if (argc == 1 && SEE_VALUE_GET_TYPE(argv[0]) == SEE_NUMBER &&
 		!SEE_COMPAT_JS(interp, ==, JS12))
@@ -388,10 +680,10 @@ array_construct(interp, self, thisobj, argc, argv, res)
 	} else {
 	    ao = SEE_NEW(interp, struct array_object);
 	    array_init(ao, interp, argc);
-	    for (i = 0; i < argc; i++) {
-		SEE_native_put(interp, (struct SEE_object *)&ao->native, 
-			intstr(interp, &s, i), argv[i], 0);
-	    }
+	    dense_reserve(interp, ao, argc);
+	    for (i = 0; i < argc; i++)
+		SEE_VALUE_COPY(&ao->dense[i], argv[i]);
+	    ao->ndense = argc;
 	}
 	SEE_SET_OBJECT(res, (struct SEE_object *)ao);
 }
@@ -406,7 +698,7 @@ array_proto_toString(interp, self, thisobj, argc, argv, res)
 {
 	(void)toarray(interp, thisobj);
 	if (SEE_COMPAT_JS(interp, ==, JS12)) {
-		struct SEE_string *s = SEE_string_new(interp, 0);
+		struct SEE_strbuf sb;
 		struct SEE_string *n = NULL;
 		int lastundef = 0;
 		SEE_uint32_t length, i;
@@ -417,13 +709,14 @@ array_proto_toString(interp, self, thisobj, argc, argv, res)
 		    SEE_error_throw_string(interp, interp->TypeError, 
 		       STR(null_thisobj));
 
-		SEE_string_addch(s, '[');
+		SEE_strbuf_init(interp, &sb, 0);
+		SEE_STRBUF_ADDCH(&sb, '[');
 		SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
 		length = SEE_ToUint32(interp, &v);
 		for (i = 0; i < length; i++) {
 		    if (i) {
-		        SEE_string_addch(s, ',');
-		        SEE_string_addch(s, ' ');
+		        SEE_STRBUF_ADDCH(&sb, ',');
+		        SEE_STRBUF_ADDCH(&sb, ' ');
 		    }
 		    SEE_OBJECT_GET(interp, thisobj, intstr(interp, &n, i), &v);
 		    lastundef = 0;
@@ -432,27 +725,27 @@ array_proto_toString(interp, self, thisobj, argc, argv, res)
 		    	lastundef = 1;
 			break;
 		    case SEE_STRING:
-			SEE_string_addch(s, '"');
+			SEE_STRBUF_ADDCH(&sb, '"');
 			for (j = 0; j < v.u.string->length; j++) {
 			    if (v.u.string->data[j] == '\"' ||
 				v.u.string->data[j] == '\\')
-				    SEE_string_addch(s, '\\');
-			    SEE_string_addch(s, v.u.string->data[j]);
+				    SEE_STRBUF_ADDCH(&sb, '\\');
+			    SEE_STRBUF_ADDCH(&sb, v.u.string->data[j]);
 			}
-			SEE_string_addch(s, '"');
+			SEE_STRBUF_ADDCH(&sb, '"');
 			break;
 		    default:
 			SEE_ToString(interp, &v, &vs);
-			SEE_string_append(s, vs.u.string);
+			SEE_strbuf_append(&sb, vs.u.string);
 			break;
 		    }
 		}
 	        if (lastundef) {
-		    SEE_string_addch(s, ',');
-		    SEE_string_addch(s, ' ');
+		    SEE_STRBUF_ADDCH(&sb, ',');
+		    SEE_STRBUF_ADDCH(&sb, ' ');
 	        }
-		SEE_string_addch(s, ']');
-		SEE_SET_STRING(res, s);
+		SEE_STRBUF_ADDCH(&sb, ']');
+		SEE_SET_STRING(res, SEE_strbuf_finish(&sb));
 	} else
 		array_proto_join(interp, self, thisobj, 0, NULL, res);
 }
@@ -466,7 +759,8 @@ array_proto_toLocaleString(interp, self, thisobj, argc, argv, res)
 	struct SEE_value **argv, *res;
 {
 	struct SEE_value v, r6, r7;
-	struct SEE_string *separator, *s, *n = NULL;
+	struct SEE_string *separator, *n = NULL;
+	struct SEE_strbuf sb;
 	SEE_uint32_t length, i;
 
 	if (!thisobj)
@@ -483,11 +777,11 @@ array_proto_toLocaleString(interp, self, thisobj, argc, argv, res)
 	    return;
 	}
 
-	s = SEE_string_new(interp, 0);
+	SEE_strbuf_init(interp, &sb, 0);
 	if (length) {
 	    for (i = 0; i < length; i++) {
 		if (i)
-		    SEE_string_append(s, separator);
+		    SEE_strbuf_append(&sb, separator);
 		SEE_OBJECT_GET(interp, thisobj, intstr(interp, &n, i), &r6);
 		if (!(SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
 		      SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)) 
@@ -504,11 +798,11 @@ array_proto_toLocaleString(interp, self, thisobj, argc, argv, res)
 		    if (SEE_VALUE_GET_TYPE(&v) != SEE_STRING)
 			SEE_error_throw_string(interp, interp->TypeError,
 			    STR(toLocaleString_notstring));
-		    SEE_string_append(s, v.u.string);
+		    SEE_strbuf_append(&sb, v.u.string);
 		}
 	    }
 	}
-	SEE_SET_STRING(res, s);
+	SEE_SET_STRING(res, SEE_strbuf_finish(&sb));
 }
 
 /* 15.4.4.4 */
@@ -539,8 +833,8 @@ array_proto_concat(interp, self, thisobj, argc, argv, res)
 	    if (SEE_VALUE_GET_TYPE(E) == SEE_OBJECT && 
 	    	SEE_is_Array(E->u.object)) 
 	    {
-		struct array_object *Ea = (struct array_object *)E->u.object;
-		for (k = 0; k < Ea->length; k++) {
+		SEE_uint32_t length = ARRAY_READ(interp, E->u.object)->length;
+		for (k = 0; k < length; k++) {
 		    check_too_long(interp, n, 1);
 		    ns = intstr(interp, &nsbuf, k);
 		    if (SEE_OBJECT_HASPROPERTY(interp, E->u.object, ns)) {
@@ -562,6 +856,41 @@ array_proto_concat(interp, self, thisobj, argc, argv, res)
 	SEE_SET_OBJECT(res, A);
 }
 
+/*
+ * Returns true if the first length elements of a dense vector are all
+ * strings, undefined or null, storing in *lenp the length of their
+ * join with a separator of seplen characters.
+ */
+static int
+join_length(ao, length, seplen, lenp)
+	struct array_object *ao;
+	SEE_uint32_t length;
+	unsigned int seplen;
+	unsigned int *lenp;
+{
+	SEE_uint32_t i;
+	double total;
+
+	if (length > ao->ndense)
+	    return 0;
+	total = (double)seplen * (length - 1);
+	for (i = 0; i < length; i++)
+	    switch (SEE_VALUE_GET_TYPE(&ao->dense[i])) {
+	    case SEE_STRING:
+		total += ao->dense[i].u.string->length;
+		break;
+	    case SEE_UNDEFINED:
+	    case SEE_NULL:
+		break;
+	    default:
+		return 0;
+	    }
+	if (total > UINT_MAX)
+	    return 0;
+	*lenp = (unsigned int)total;
+	return 1;
+}
+
 /* 15.4.4.5 */
 static void
 array_proto_join(interp, self, thisobj, argc, argv, res)
@@ -571,9 +900,12 @@ array_proto_join(interp, self, thisobj, argc, argv, res)
 	struct SEE_value **argv, *res;
 {
 	struct SEE_value v, r6, r7;
-	struct SEE_string *separator, *s, *n = NULL;
+	struct SEE_string *separator, *n = NULL;
+	struct SEE_strbuf sb;
 	SEE_uint32_t length, i;
+	unsigned int space;
 	int use_comma;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -598,21 +930,38 @@ array_proto_join(interp, self, thisobj, argc, argv, res)
 		separator = v.u.string;
 	}
 
-	s = SEE_string_new(interp, 0);
-	if (length) {
-	    for (i = 0; i < length; i++) {
-		if (i)
-		    SEE_string_append(s, separator);
+	/* Elements in the dense vector are read without naming them */
+	ao = SEE_is_Array(thisobj) ? ARRAY_READ(interp, thisobj) : NULL;
+
+	/*
+	 * Joining strings in the dense vector needs no conversions, so
+	 * their total length is summed first and the result is built
+	 * in storage allocated once.
+	 */
+	if (!length || !ao || !join_length(ao, length, separator->length,
+	    &space))
+		space = 0;
+
+	SEE_strbuf_init(interp, &sb, space);
+	for (i = 0; i < length; i++) {
+	    if (i)
+		SEE_strbuf_append(&sb, separator);
+	    if (ao)
+		ao = ARRAY_READ(interp, thisobj);   /* may have been changed */
+	    if (ao && i < ao->ndense && !IS_HOLE(&ao->dense[i]))
+		SEE_VALUE_COPY(&r6, &ao->dense[i]);
+	    else
 		SEE_OBJECT_GET(interp, thisobj, intstr(interp, &n, i), &r6);
-		if (!(SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
-		      SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)) 
-		{
-		    SEE_ToString(interp, &r6, &r7);
-		    SEE_string_append(s, r7.u.string);
-		}
+	    if (SEE_VALUE_GET_TYPE(&r6) == SEE_STRING)
+		SEE_strbuf_append(&sb, r6.u.string);
+	    else if (!(SEE_VALUE_GET_TYPE(&r6) == SEE_UNDEFINED || 
+		  SEE_VALUE_GET_TYPE(&r6) == SEE_NULL)) 
+	    {
+		SEE_ToString(interp, &r6, &r7);
+		SEE_strbuf_append(&sb, r7.u.string);
 	    }
 	}
-	SEE_SET_STRING(res, s);
+	SEE_SET_STRING(res, SEE_strbuf_finish(&sb));
 }
 
 /* 15.4.4.6 */
@@ -626,11 +975,22 @@ array_proto_pop(interp, self, thisobj, argc, argv, res)
 	struct SEE_value v;
 	SEE_uint32_t i;
 	struct SEE_string *s = NULL, *si;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
 	       STR(null_thisobj));
 
+	if (SEE_is_Array(thisobj)) {
+	    ao = ARRAY_WRITE(interp, thisobj);
+	    if (ao->length && ao->ndense == ao->length) {
+		SEE_VALUE_COPY(res, &ao->dense[ao->ndense - 1]);
+		dense_truncate(ao, ao->ndense - 1);
+		ao->length--;
+		return;
+	    }
+	}
+
 	SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
 	i = SEE_ToUint32(interp, &v);
 	if (i == 0) {
@@ -658,11 +1018,25 @@ array_proto_push(interp, self, thisobj, argc, argv, res)
 	SEE_uint32_t n;
 	struct SEE_value v;
 	struct SEE_string *np = NULL;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
 	       STR(null_thisobj));
 
+	if (SEE_is_Array(thisobj)) {
+	    ao = ARRAY_WRITE(interp, thisobj);
+	    if (ao->ndense == ao->length) {
+		check_too_long(interp, ao->length, argc);
+		dense_reserve(interp, ao, ao->length + argc);
+		for (i = 0; i < argc; i++)
+		    SEE_VALUE_COPY(&ao->dense[ao->ndense++], argv[i]);
+		ao->length = ao->ndense;
+		SEE_SET_NUMBER(res, ao->length);
+		return;
+	    }
+	}
+
         SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
         n = SEE_ToUint32(interp, &v);
 	for (i = 0; i < argc; i++) {
@@ -730,11 +1104,24 @@ array_proto_shift(interp, self, thisobj, argc, argv, res)
 	struct SEE_value v;
 	struct SEE_string *s = NULL, *p;
 	SEE_uint32_t k, r2;
+	struct array_object *ao;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
 	       STR(null_thisobj));
 
+	if (SEE_is_Array(thisobj)) {
+	    ao = ARRAY_WRITE(interp, thisobj);
+	    if (ao->length && IS_DENSE(ao)) {
+		SEE_VALUE_COPY(res, &ao->dense[0]);
+		memmove(ao->dense, ao->dense + 1, 
+		    (ao->ndense - 1) * sizeof *ao->dense);
+		dense_truncate(ao, ao->ndense - 1);
+		ao->length--;
+		return;
+	    }
+	}
+
 	SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
 	r2 = SEE_ToUint32(interp, &v);
 	if (r2 == 0) {
@@ -801,6 +1188,19 @@ array_proto_slice(interp, self, thisobj, argc, argv, res)
 	    	 v.u.number < r3  ? (SEE_uint32_t)v.u.number :
 		 		    r3;
 	}
+	if (SEE_is_Array(thisobj) && SEE_is_Array(A)) {
+	    struct array_object *ao = ARRAY_READ(interp, thisobj);
+	    struct array_object *Ao = ARRAY_WRITE(interp, A);
+	    if (IS_DENSE(ao) && ao->length == r3) {
+		n = r8 > r5 ? r8 - r5 : 0;
+		dense_reserve(interp, Ao, n);
+		if (n)
+		    memcpy(Ao->dense, ao->dense + r5, n * sizeof *Ao->dense);
+		Ao->ndense = Ao->length = n;
+		SEE_SET_OBJECT(res, A);
+		return;
+	    }
+	}
 	for (k = r5, n = 0; k < r8; k++, n++) {
 	    p = intstr(interp, &s, k);
 	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, p)) {
@@ -814,31 +1214,56 @@ array_proto_slice(interp, self, thisobj, argc, argv, res)
 }
 
 /*
- * A sort comparison function similar to that in 15.4.4.11,
- * except that our quicksort has already used get/put/hasproperty
- * on the array, and we represent this with pointers x and y.
- * If the pointers are NULL, then the elements don't exist in the
- * array, and should be sorted higher than anything else. If the
- * pointers point to undefined, then they should be sorted second-highest.
+ * Array.prototype.sort works on a private copy of the elements. Each
+ * element present in the array is read once into a vector of sort
+ * items, except for undefined values, which are only counted because
+ * they always sort after everything else. Without a comparison
+ * function the string keys are computed once per element instead of
+ * once per comparison. The vector is then sorted with a stable,
+ * adaptive merge sort after the manner of Tim Peters' list sort for
+ * Python: it finds the ascending (or strictly descending) runs
+ * already in the input, extends short runs by binary insertion, and
+ * merges runs of similar length. Finally the elements are written
+ * back once, followed by the undefined values and then the holes.
+ * If the comparison function throws, the array is left unchanged.
  */
-static int
-SortCompare(interp, x, y, cmpfn)
+
+struct sort_item {
+	struct SEE_value value;
+	struct SEE_string *key;		/* ToString(value), or NULL */
+};
+
+#define SORT_MINMERGE	64	/* inputs shorter than this aren't merged */
+#define SORT_MAXRUNS	64	/* enough for 2^32 elements */
+
+struct sort {
 	struct SEE_interpreter *interp;
-	struct SEE_value *x, *y;
-	struct SEE_object *cmpfn;
+	struct SEE_object *cmpfn;	/* comparison function, or NULL */
+	struct sort_item *tmp;		/* scratch space for merging */
+	unsigned int nrun;
+	struct {
+		SEE_uint32_t base, len;
+	} run[SORT_MAXRUNS];
+};
+
+/*
+ * A sort comparison function similar to that in 15.4.4.11, except
+ * that undefined values and holes have already been set aside and
+ * never reach it. Returns a negative number, zero or a positive number
+ * if x sorts before, with or after y.
+ */
+static int
+SortCompare(st, x, y)
+	struct sort *st;
+	struct sort_item *x, *y;
 {
-	if (!x && !y)   return 0;
-	if (!x)		return 1;
-	if (!y)		return -1;
-	if (SEE_VALUE_GET_TYPE(x) == SEE_UNDEFINED && 
-	    SEE_VALUE_GET_TYPE(y) == SEE_UNDEFINED) return 0;
-	if (SEE_VALUE_GET_TYPE(x) == SEE_UNDEFINED) return 1;
-	if (SEE_VALUE_GET_TYPE(y) == SEE_UNDEFINED) return -1;
-	if (cmpfn) {
+	struct SEE_interpreter *interp = st->interp;
+
+	if (st->cmpfn) {
 		struct SEE_value vn, *arg[2];
-		arg[0] = x;
-		arg[1] = y;
-		SEE_OBJECT_CALL(interp, cmpfn, cmpfn, 2, arg, &vn);
+		arg[0] = &x->value;
+		arg[1] = &y->value;
+		SEE_OBJECT_CALL(interp, st->cmpfn, st->cmpfn, 2, arg, &vn);
 		if (SEE_VALUE_GET_TYPE(&vn) != SEE_NUMBER || 
 		    SEE_NUMBER_ISNAN(&vn)) 
 			SEE_error_throw_string(interp, interp->TypeError,
@@ -846,94 +1271,238 @@ SortCompare(interp, x, y, cmpfn)
 		if (vn.u.number < 0) return -1;
 		if (vn.u.number > 0) return 1;
 		return 0;
-	} else {
-		struct SEE_value xs, ys;
-		SEE_ToString(interp, x, &xs);
-		SEE_ToString(interp, y, &ys);
-		return SEE_string_cmp(xs.u.string, ys.u.string);
+	} else
+		return SEE_string_cmp(x->key, y->key);
+}
+
+/* Returns how many leading items of v[0..n) sort before or with x */
+static SEE_uint32_t
+sort_upper(st, x, v, n)
+	struct sort *st;
+	struct sort_item *x, *v;
+	SEE_uint32_t n;
+{
+	SEE_uint32_t lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+	    mid = lo + (hi - lo) / 2;
+	    if (SortCompare(st, x, &v[mid]) < 0)
+		hi = mid;
+	    else
+		lo = mid + 1;
 	}
+	return lo;
 }
 
-/**
- * Quicksort partition: partitions the given segment into numbers
- * smaller, then larger than the first element, using swaps.
- * Returns the index of the pivot point.
+/* Returns how many leading items of v[0..n) sort strictly before x */
+static SEE_uint32_t
+sort_lower(st, x, v, n)
+	struct sort *st;
+	struct sort_item *x, *v;
+	SEE_uint32_t n;
+{
+	SEE_uint32_t lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+	    mid = lo + (hi - lo) / 2;
+	    if (SortCompare(st, &v[mid], x) < 0)
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * Sorts v[0..n) by binary insertion, given that v[0..start) is
+ * already sorted.
  */
-static int
-qs_partition(interp, thisobj, lo, hi, cmpfn, s1, s2)
-	struct SEE_interpreter *interp;
-	struct SEE_object *thisobj;
-	SEE_uint32_t lo, hi;
-	struct SEE_object *cmpfn;
-	struct SEE_string **s1, **s2;
+static void
+sort_insertion(st, v, n, start)
+	struct sort *st;
+	struct sort_item *v;
+	SEE_uint32_t n, start;
 {
-	struct SEE_value xv, iv, jv;
-	struct SEE_value *xvp = NULL, *ivp = NULL, *jvp = NULL;
-	struct SEE_string *s1p, *s2p = NULL;
-	SEE_uint32_t i = lo - 1;
-	SEE_uint32_t j = hi + 1;
-
-	s1p = intstr(interp, s1, lo - 1);
-	if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s1p)) {
-		SEE_OBJECT_GET(interp, thisobj, s1p, &xv);
-		xvp = &xv;
+	struct sort_item pivot;
+	SEE_uint32_t i, pos;
+
+	for (i = start; i < n; i++) {
+	    pivot = v[i];
+	    pos = sort_upper(st, &pivot, v, i);
+	    memmove(&v[pos + 1], &v[pos], (i - pos) * sizeof *v);
+	    v[pos] = pivot;
+	}
+}
+
+/*
+ * Returns the length of the run at the start of v[0..n), reversing it
+ * in place if it is strictly descending. (A strict order keeps the
+ * reversal stable.)
+ */
+static SEE_uint32_t
+sort_run(st, v, n)
+	struct sort *st;
+	struct sort_item *v;
+	SEE_uint32_t n;
+{
+	struct sort_item t;
+	SEE_uint32_t i, j, len;
+
+	if (n < 2)
+	    return n;
+	if (SortCompare(st, &v[1], &v[0]) < 0) {
+	    for (len = 2; len < n; len++)
+		if (SortCompare(st, &v[len], &v[len - 1]) >= 0)
+		    break;
+	    for (i = 0, j = len - 1; i < j; i++, j--) {
+		t = v[i]; v[i] = v[j]; v[j] = t;
+	    }
 	} else
-		xvp = NULL;
-
-	for (;;) {
-	    do {
-		if (j == lo) break;
-		j--;
-		s2p = intstr(interp, s2, j - 1);
-		if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s2p)) {
-			SEE_OBJECT_GET(interp, thisobj, s2p, &jv);
-			jvp = &jv;
-		} else
-			jvp = NULL;
-	    } while (SortCompare(interp, xvp, jvp, cmpfn) < 0);
-	    do {
-		if (i == hi) break;
-		i++;
-		s1p = intstr(interp, s1, i - 1);
-		if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s1p)) {
-			SEE_OBJECT_GET(interp, thisobj, s1p, &iv);
-			ivp = &iv;
-		} else
-			ivp = NULL;
-	    } while (SortCompare(interp, ivp, xvp, cmpfn) < 0);
-	    if (i < j) {
-		/*
-		 * At this stage, s1p will always be "i" and s2p will
-		 * always be "j".
-		 */
-
-		if (ivp) SEE_OBJECT_PUT(interp, thisobj, s2p, ivp, 0);
-		else	 SEE_OBJECT_DELETE(interp, thisobj, s2p);
-		if (jvp) SEE_OBJECT_PUT(interp, thisobj, s1p, &jv, 0);
-		else     SEE_OBJECT_DELETE(interp, thisobj, s1p);
-	    } else
-		return j;
+	    for (len = 2; len < n; len++)
+		if (SortCompare(st, &v[len], &v[len - 1]) < 0)
+		    break;
+	return len;
+}
+
+/*
+ * Returns the shortest run worth merging for an input of n items:
+ * a number between SORT_MINMERGE/2 and SORT_MINMERGE such that n
+ * divided by it is, or is a little less than, a power of two.
+ */
+static SEE_uint32_t
+sort_minrun(n)
+	SEE_uint32_t n;
+{
+	SEE_uint32_t r = 0;
+
+	while (n >= SORT_MINMERGE) {
+	    r |= n & 1;
+	    n >>= 1;
 	}
+	return n + r;
 }
 
-/**
- * Sorts the array segment by partitioning, and then sorting the
- * partitions. ("Quicksort", Cormen et al "Introduction to Algorithms").
+/*
+ * Merges the adjacent runs i and i+1 on the run stack. Items of the
+ * first run that sort before the second run, and items of the second
+ * run that sort after the first, are already in place. The shorter of
+ * what remains is copied out to scratch space and merged back in.
  */
 static void
-qs_sort(interp, thisobj, lo, hi, cmpfn, s1, s2)
-	struct SEE_interpreter *interp;
-	struct SEE_object *thisobj;
-	SEE_uint32_t lo, hi;
-	struct SEE_object *cmpfn;
-	struct SEE_string **s1, **s2;
+sort_merge(st, v, i)
+	struct sort *st;
+	struct sort_item *v;
+	unsigned int i;
 {
-	SEE_uint32_t q;
+	struct sort_item *a, *b, *tmp = st->tmp;
+	SEE_uint32_t na, nb, k, ia, ib, dest;
+
+	a = v + st->run[i].base;
+	na = st->run[i].len;
+	b = v + st->run[i + 1].base;
+	nb = st->run[i + 1].len;
+
+	st->run[i].len = na + nb;
+	if (i + 2 < st->nrun)
+	    st->run[i + 1] = st->run[i + 2];
+	st->nrun--;
+
+	k = sort_upper(st, &b[0], a, na);
+	a += k;
+	na -= k;
+	if (na == 0)
+	    return;
+	nb = sort_lower(st, &a[na - 1], b, nb);
+	if (nb == 0)
+	    return;
 
-	if (lo < hi) {
-	    q = qs_partition(interp, thisobj, lo, hi, cmpfn, s1, s2);
-	    qs_sort(interp, thisobj, lo, q, cmpfn, s1, s2);
-	    qs_sort(interp, thisobj, q + 1, hi, cmpfn, s1, s2);
+	if (na <= nb) {
+	    /* Merge from the front, with a in scratch space */
+	    memcpy(tmp, a, na * sizeof *a);
+	    ia = ib = dest = 0;
+	    while (ia < na && ib < nb)
+		if (SortCompare(st, &b[ib], &tmp[ia]) < 0)
+		    a[dest++] = b[ib++];
+		else
+		    a[dest++] = tmp[ia++];
+	    memcpy(&a[dest], &tmp[ia], (na - ia) * sizeof *a);
+	} else {
+	    /* Merge from the back, with b in scratch space */
+	    memcpy(tmp, b, nb * sizeof *b);
+	    ia = na; ib = nb; dest = na + nb;
+	    while (ia > 0 && ib > 0)
+		if (SortCompare(st, &tmp[ib - 1], &a[ia - 1]) < 0)
+		    a[--dest] = a[--ia];
+		else
+		    a[--dest] = tmp[--ib];
+	    memcpy(a, tmp, ib * sizeof *a);
+	}
+}
+
+/*
+ * Merges runs on the stack until the length of each run exceeds the
+ * sum of the next two, and each exceeds the next, so that the stack
+ * stays short and merges stay balanced.
+ */
+static void
+sort_collapse(st, v)
+	struct sort *st;
+	struct sort_item *v;
+{
+	unsigned int n;
+
+	while (st->nrun > 1) {
+	    n = st->nrun - 2;
+	    if ((n > 0 && st->run[n - 1].len <= 
+	    		st->run[n].len + st->run[n + 1].len) ||
+		(n > 1 && st->run[n - 2].len <=
+			st->run[n - 1].len + st->run[n].len))
+	    {
+		if (st->run[n - 1].len < st->run[n + 1].len)
+		    n--;
+	    } else if (st->run[n].len > st->run[n + 1].len)
+		break;
+	    sort_merge(st, v, n);
+	}
+}
+
+/* Sorts v[0..n) stably */
+static void
+sort_items(st, v, n)
+	struct sort *st;
+	struct sort_item *v;
+	SEE_uint32_t n;
+{
+	SEE_uint32_t lo, len, minrun, force;
+	unsigned int i;
+
+	if (n < 2)
+	    return;
+	if (n < SORT_MINMERGE) {
+	    sort_insertion(st, v, n, sort_run(st, v, n));
+	    return;
+	}
+
+	st->tmp = SEE_NEW_ARRAY(st->interp, struct sort_item, n / 2 + 1);
+	st->nrun = 0;
+	minrun = sort_minrun(n);
+	for (lo = 0; lo < n; lo += len) {
+	    len = sort_run(st, v + lo, n - lo);
+	    if (len < minrun) {
+		force = n - lo < minrun ? n - lo : minrun;
+		sort_insertion(st, v + lo, force, len);
+		len = force;
+	    }
+	    st->run[st->nrun].base = lo;
+	    st->run[st->nrun].len = len;
+	    st->nrun++;
+	    sort_collapse(st, v);
+	}
+	while (st->nrun > 1) {
+	    i = st->nrun - 2;
+	    if (i > 0 && st->run[i - 1].len < st->run[i + 1].len)
+		i--;
+	    sort_merge(st, v, i);
 	}
 }
 
@@ -945,10 +1514,14 @@ array_proto_sort(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct SEE_string *s1 = NULL, *s2 = NULL;
-	SEE_uint32_t length;
+	struct SEE_string *s = NULL, *ps;
+	SEE_uint32_t length, i, end;
+	unsigned int n, nundef;
 	struct SEE_value v;
-	struct SEE_object *cmpfn;
+	struct sort st;
+	struct sort_item *items;
+	struct SEE_growable grow;
+	struct array_object *ao = NULL;
 
 	if (!thisobj)
 	    SEE_error_throw_string(interp, interp->TypeError, 
@@ -957,23 +1530,97 @@ array_proto_sort(interp, self, thisobj, argc, argv, res)
 	SEE_OBJECT_GET(interp, thisobj, STR(length), &v);
 	length = SEE_ToUint32(interp, &v);
 
+	st.interp = interp;
 	if (argc < 1 || SEE_VALUE_GET_TYPE(argv[0]) == SEE_UNDEFINED)
-		cmpfn = NULL;
+		st.cmpfn = NULL;
 	else if (SEE_VALUE_GET_TYPE(argv[0]) == SEE_OBJECT &&
 		 SEE_OBJECT_HAS_CALL(argv[0]->u.object))
-		cmpfn = argv[0]->u.object;
+		st.cmpfn = argv[0]->u.object;
 	else
 		SEE_error_throw_string(interp, interp->TypeError,
 			STR(bad_arg));
 
-	qs_sort(interp, thisobj, 1, length, cmpfn, &s1, &s2);
+	if (length < 2) {
+	    SEE_SET_OBJECT(res, thisobj);
+	    return;
+	}
+
 	/*
+	 * Copy out the elements, setting aside undefined values. The
+	 * elements of a dense array are copied straight from its
+	 * vector; anything else is asked for each index, and end
+	 * is left just past the last element found.
+	 */
+	SEE_GROW_INIT(interp, &grow, items, n);
+	nundef = 0;
+	if (SEE_is_Array(thisobj) && IS_DENSE(ARRAY_READ(interp, thisobj)))
+	{
+	    ao = ARRAY_READ(interp, thisobj);
+	    SEE_GROW_TO(interp, &grow, length);
+	    n = 0;
+	    for (i = 0; i < length; i++)
+		if (SEE_VALUE_GET_TYPE(&ao->dense[i]) == SEE_UNDEFINED)
+		    nundef++;
+		else
+		    items[n++].value = ao->dense[i];
+	    end = length;
+	} else {
+	    end = 0;
+	    for (i = 0; i < length; i++) {
+		ps = intstr(interp, &s, i);
+		if (!SEE_OBJECT_HASPROPERTY(interp, thisobj, ps))
+		    continue;
+		SEE_OBJECT_GET(interp, thisobj, ps, &v);
+		end = i + 1;
+		if (SEE_VALUE_GET_TYPE(&v) == SEE_UNDEFINED)
+		    nundef++;
+		else {
+		    SEE_GROW_TO(interp, &grow, n + 1);
+		    items[n - 1].value = v;
+		}
+	    }
+	}
+
+	/* Without a comparison function, compare the strings once made */
+	for (i = 0; i < n; i++)
+	    if (st.cmpfn)
+		items[i].key = NULL;
+	    else {
+		SEE_ToString(interp, &items[i].value, &v);
+		items[i].key = v.u.string;
+	    }
+
+	sort_items(&st, items, n);
+
+	/*
+	 * Write the elements back in order, followed by the undefined
+	 * values and then the holes. The comparison function may have
+	 * changed the array, so the dense vector is only written
+	 * directly if it is still there. 
+	 *
 	 * NOTE: the standard does not say that the length
 	 * of the array should be updated after sorting.
 	 * i.e., even as all the non-existent entries get moved 
 	 * to the end of the array, the length property will remain
 	 * unchanged. This remains consistent with 15.4.5.2.
 	 */
+	if (ao)
+	    ao = ARRAY_WRITE(interp, thisobj);
+	if (ao && IS_DENSE(ao) && ao->length == length) {
+	    for (i = 0; i < n; i++)
+		ao->dense[i] = items[i].value;
+	    for (; i < length; i++)
+		SEE_SET_UNDEFINED(&ao->dense[i]);
+	} else {
+	    for (i = 0; i < n; i++)
+		SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &s, i),
+		    &items[i].value, 0);
+	    SEE_SET_UNDEFINED(&v);
+	    for (; i < n + nundef; i++)
+		SEE_OBJECT_PUT(interp, thisobj, intstr(interp, &s, i), &v, 0);
+	    for (; i < end; i++)
+		SEE_OBJECT_DELETE(interp, thisobj, intstr(interp, &s, i));
+	}
 	SEE_SET_OBJECT(res, thisobj);
 }
 
@@ -1007,6 +1654,32 @@ array_proto_splice(interp, self, thisobj, argc, argv, res)
 /*6*/	if (argc < 2) SEE_SET_NUMBER(&v, 0);
 	else SEE_ToInteger(interp, argv[1], &v);
 	r6 = MIN(v.u.number < 0 ? 0 : (SEE_uint32_t)v.u.number, r3 - r5);
+	if (SEE_is_Array(thisobj) && SEE_is_Array(A)) {
+	    struct array_object *ao = ARRAY_READ(interp, thisobj);
+	    struct array_object *Ao = ARRAY_WRITE(interp, A);
+	    if (IS_DENSE(ao) && ao->length == r3) {
+		ao = ARRAY_WRITE(interp, thisobj);
+		r17 = argc < 2 ? 0 : argc - 2;
+		check_too_long(interp, r3 - r6, r17);
+		dense_reserve(interp, Ao, r6);
+		if (r6)
+		    memcpy(Ao->dense, ao->dense + r5, r6 * sizeof *Ao->dense);
+		Ao->ndense = Ao->length = r6;
+		dense_reserve(interp, ao, r3 - r6 + r17);
+		if (r3 - r5 - r6)
+		    memmove(ao->dense + r5 + r17, ao->dense + r5 + r6,
+			(r3 - r5 - r6) * sizeof *ao->dense);
+		for (k = 0; k < r17; k++)
+		    SEE_VALUE_COPY(&ao->dense[r5 + k], argv[k + 2]);
+		if (r17 < r6)
+		    dense_truncate(ao, r3 - r6 + r17);
+		else
+		    ao->ndense = r3 - r6 + r17;
+		ao->length = ao->ndense;
+		SEE_SET_OBJECT(res, A);
+		return;
+	    }
+	}
 /*7*/	for (k = 0; k < r6; k++) {
 /*9*/	    s9 = intstr(interp, &s, r5 + k);
 /*10*/	    if (SEE_OBJECT_HASPROPERTY(interp, thisobj, s9)) {
@@ -1120,8 +1793,10 @@ array_setlength(interp, ao, val)
 	int flags;
 
 	newlen = SEE_ToUint32(interp, val);
-	if (ao->length > newlen) {
-	    e = SEE_OBJECT_ENUMERATOR(interp, 
+	if (newlen < ao->ndense)
+	    dense_truncate(ao, newlen);
+	if (ao->length > newlen && ao->nsparse) {
+	    e = SEE_native_enumerator(interp, 
 	    	(struct SEE_object *)&ao->native);
 	    while ((s = SEE_ENUM_NEXT(interp, e, &flags))) 
 		if (SEE_to_array_index(s, &i) && i >= newlen) {
@@ -1131,8 +1806,9 @@ array_setlength(interp, ao, val)
 		    names = name;
 		}
 	    for (name = names; name; name = name->next)
-	        SEE_native_delete(interp, (struct SEE_object *)&ao->native,
-		    name->s);
+	        if (SEE_native_delete(interp, 
+		    (struct SEE_object *)&ao->native, name->s))
+			ao->nsparse--;
 	}
 	ao->length = newlen;
 }
@@ -1144,10 +1820,14 @@ array_get(interp, o, p, res)
 	struct SEE_string *p; 
 	struct SEE_value *res;
 {
-	struct array_object *ao = (struct array_object *)o;
+	struct array_object *ao = ARRAY_READ(interp, o);
+	SEE_uint32_t i;
 
 	if (p == STR(length))
 	    SEE_SET_NUMBER(res, ao->length);
+	else if (ao->ndense && SEE_to_array_index(p, &i) && 
+		 i < ao->ndense && !IS_HOLE(&ao->dense[i]))
+	    SEE_VALUE_COPY(res, &ao->dense[i]);
 	else
 	    SEE_native_get(interp, o, p, res);
 }
@@ -1160,17 +1840,14 @@ array_put(interp, o, p, val, attr)
 	struct SEE_value *val;
 	int attr;
 {
-	struct array_object *ao = (struct array_object *)o;
 	SEE_uint32_t i;
 
 	if (p == STR(length))
-	    array_setlength(interp, ao, val);
-	else {
+	    array_setlength(interp, ARRAY_WRITE(interp, o), val);
+	else if (SEE_to_array_index(p, &i))
+	    put_element(interp, ARRAY_WRITE(interp, o), i, p, val, attr);
+	else
 	    SEE_native_put(interp, o, p, val, attr);
-	    if (SEE_to_array_index(p, &i))
-		if (i >= ao->length)
-		    ao->length = i + 1;
-	}
 }
 
 static int
@@ -1179,8 +1856,14 @@ array_hasproperty(interp, o, p)
 	struct SEE_object *o;
 	struct SEE_string *p;
 {
+	struct array_object *ao = ARRAY_READ(interp, o);
+	SEE_uint32_t i;
+
 	if (p == STR(length))
 	    return 1;
+	else if (ao->ndense && SEE_to_array_index(p, &i) && 
+		 i < ao->ndense && !IS_HOLE(&ao->dense[i]))
+	    return 1;
 	else
 	    return SEE_native_hasproperty(interp, o, p);
 }
@@ -1191,8 +1874,80 @@ array_delete(interp, o, p)
 	struct SEE_object *o;
 	struct SEE_string *p;
 {
+	struct array_object *ao;
+	SEE_uint32_t i;
+
 	if (p == STR(length))
 	    return 0;
-	else
+	if (!SEE_to_array_index(p, &i))
 	    return SEE_native_delete(interp, o, p);
+	ao = ARRAY_WRITE(interp, o);
+	if (i < ao->ndense) {
+	    if (!IS_HOLE(&ao->dense[i])) {
+		HOLE_SET(&ao->dense[i]);
+		ao->nholes++;
+		dense_truncate(ao, ao->ndense);
+	    }
+	    return 1;
+	}
+	if (ao->nsparse && SEE_native_hasownproperty(interp, o, p)) {
+	    if (!SEE_native_delete(interp, o, p))
+		return 0;
+	    ao->nsparse--;
+	}
+	return 1;
+}
+
+/*
+ * Array enumerators reveal the elements in the dense vector first,
+ * followed by the properties in the native table.
+ */
+struct array_enum {
+	struct SEE_enum base;
+	struct SEE_object *o;
+	SEE_uint32_t next;		/* next dense element */
+	struct SEE_string *buf;		/* scratch for intstr() */
+	struct SEE_enum *native;	/* enumerates the native table */
+};
+
+static struct SEE_enumclass array_enumclass = {
+	0,
+	array_enum_next
+};
+
+static struct SEE_string *
+array_enum_next(interp, e, dont_enump)
+	struct SEE_interpreter *interp;
+	struct SEE_enum *e;
+	int *dont_enump;
+{
+	struct array_enum *ae = (struct array_enum *)e;
+	struct array_object *ao = ARRAY_READ(interp, ae->o);
+	SEE_uint32_t i;
+
+	while (ae->next < ao->ndense) {
+	    i = ae->next++;
+	    if (!IS_HOLE(&ao->dense[i])) {
+		if (dont_enump)
+		    *dont_enump = 0;
+		return intstr(interp, &ae->buf, i);
+	    }
+	}
+	return SEE_ENUM_NEXT(interp, ae->native, dont_enump);
+}
+
+static struct SEE_enum *
+array_enumerator(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct array_enum *ae;
+
+	ae = SEE_NEW(interp, struct array_enum);
+	ae->base.enumclass = &array_enumclass;
+	ae->o = o;
+	ae->next = 0;
+	ae->buf = NULL;
+	ae->native = SEE_native_enumerator(interp, o);
+	return (struct SEE_enum *)ae;
 }
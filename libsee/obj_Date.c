@@ -48,6 +48,7 @@
 
 #include "stringdefs.h"
 #include "init.h"
+#include "clone.h"
 #include "dprint.h"
 #include "nmath.h"
 #include "platform.h"
@@ -132,6 +133,8 @@ static struct SEE_string *reprtime(struct SEE_interpreter *, SEE_number_t);
 
 static struct date_object *todate(struct SEE_interpreter *,
 	struct SEE_object *);
+static struct date_object *todate_write(struct SEE_interpreter *,
+	struct SEE_object *);
 
 static void date_call(struct SEE_interpreter *,
 	struct SEE_object *, struct SEE_object *, int,
@@ -467,6 +470,20 @@ SEE_Date_init(interp)
 
 }
 
+/*
+ * Copies the fields of a date for an interpreter that is about to
+ * change it (see clone.c). Returns NULL for other objects.
+ */
+struct SEE_native *
+SEE_Date_copy(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	if (n->object.objectclass != &date_inst_class)
+		return NULL;
+	return _SEE_native_copy(interp, n, sizeof (struct date_object));
+}
+
 /* 15.9.1.3 */
 static SEE_number_t
 DayFromYear(y)
@@ -1034,7 +1051,7 @@ reprtime(interp, t)
 		hour, min, sec10, NUMBER_floor(secms));
 }
 
-/* Return a date object or raise a type error */
+/* Return a date object's fields to read, or raise a type error */
 static struct date_object *
 todate(interp, o)
 	struct SEE_interpreter *interp;
@@ -1043,7 +1060,19 @@ todate(interp, o)
 	if (!o || o->objectclass != &date_inst_class)
 		SEE_error_throw_string(interp, interp->TypeError, 
 		   STR(not_date));
-	return (struct date_object *)o;
+	return (struct date_object *)_SEE_NATIVE_READ(interp,
+		(struct SEE_native *)o);
+}
+
+/* Return a date object's fields to change, or raise a type error */
+static struct date_object *
+todate_write(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	(void)todate(interp, o);
+	return (struct date_object *)_SEE_NATIVE_WRITE(interp,
+		(struct SEE_native *)o);
 }
 
 /* 15.9.2.1 */
@@ -1607,7 +1636,7 @@ date_proto_setTime(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 
 	if (argc < 1) 
@@ -1627,7 +1656,7 @@ date_proto_setMilliseconds(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t t = LocalTime(interp, d->t);
 
@@ -1651,7 +1680,7 @@ date_proto_setUTCMilliseconds(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t t = d->t;
 
@@ -1675,7 +1704,7 @@ date_proto_setSeconds(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t ms;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -1706,7 +1735,7 @@ date_proto_setUTCSeconds(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t ms;
 	SEE_number_t t = d->t;
@@ -1737,7 +1766,7 @@ date_proto_setMinutes(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t sec, ms;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -1774,7 +1803,7 @@ date_proto_setUTCMinutes(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t sec, ms;
 	SEE_number_t t = d->t;
@@ -1811,7 +1840,7 @@ date_proto_setHours(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t min, sec, ms;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -1853,7 +1882,7 @@ date_proto_setUTCHours(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t min, sec, ms;
 	SEE_number_t t = d->t;
@@ -1895,7 +1924,7 @@ date_proto_setDate(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t t = LocalTime(interp, d->t);
 
@@ -1920,7 +1949,7 @@ date_proto_setUTCDate(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t t = d->t;
 
@@ -1945,7 +1974,7 @@ date_proto_setMonth(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -1977,7 +2006,7 @@ date_proto_setUTCMonth(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date;
 	SEE_number_t t = d->t;
@@ -2009,7 +2038,7 @@ date_proto_setFullYear(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date, month;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -2047,7 +2076,7 @@ date_proto_setUTCFullYear(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t date, month;
 	SEE_number_t t = d->t;
@@ -2114,7 +2143,7 @@ date_proto_setYear(interp, self, thisobj, argc, argv, res)
 	int argc;
 	struct SEE_value **argv, *res;
 {
-	struct date_object *d = todate(interp, thisobj);
+	struct date_object *d = todate_write(interp, thisobj);
 	struct SEE_value v;
 	SEE_number_t year;
 	SEE_number_t t = LocalTime(interp, d->t);
@@ -62,6 +62,7 @@
 #include "stringdefs.h"
 #include "scope.h"
 #include "init.h"
+#include "clone.h"
 #include "nmath.h"
 
 
@@ -84,13 +85,20 @@ struct function_inst {
 
 struct arguments;
 
-/* structure of the 'activation' objects */
+/*
+ * structure of the 'activation' objects. Each call allocates the
+ * activation, its scope chain node and its slots as a single block.
+ */
 struct activation {
 	struct SEE_native  native;
 	struct function   *function;
+	struct SEE_object *callee;
+	struct SEE_scope   scope;	/* innermost scope of the body */
 	int argc;			/* length of actual parameters */
+	struct SEE_value  *slots;	/* locals followed by argv */
 	struct SEE_value  *argv;
-	struct SEE_object *arguments;	/* only needed for Netscape compat */
+	struct SEE_object *arguments;	/* created on first reference */
+	struct SEE_value   slot_storage[1];
 };
 
 /* structure of the 'arguments' objects */
@@ -101,6 +109,16 @@ struct arguments {
 	SEE_boolean_t	  *deleted;
 };
 
+/*
+ * The slots and arguments pointer of an activation, and the deleted
+ * flags of an arguments object, are read and changed through these
+ * (see clone.h). The other fields never change once made.
+ */
+#define VIEW_READ(interp, type, o)					\
+	((type *)_SEE_NATIVE_READ(interp, (struct SEE_native *)(o)))
+#define VIEW_WRITE(interp, type, o)					\
+	((type *)_SEE_NATIVE_WRITE(interp, (struct SEE_native *)(o)))
+
 /* Prototypes */
 static struct function_inst *tofunction(struct SEE_interpreter *, 
         struct SEE_object *);
@@ -132,12 +150,23 @@ static void function_proto_call(struct SEE_interpreter *,
 static struct SEE_object *activation_create(struct SEE_interpreter *,
 	struct SEE_object *, struct function *, int, struct SEE_value **);
 static int activation_find_index(struct activation *, struct SEE_string *);
+static int activation_is_arguments(struct SEE_interpreter *,
+	struct activation *, struct SEE_string *);
+static struct SEE_object *activation_arguments(struct SEE_interpreter *,
+	struct activation *);
 static void activation_get(struct SEE_interpreter *, struct SEE_object *, 
         struct SEE_string *, struct SEE_value *);
 static void activation_put(struct SEE_interpreter *, struct SEE_object *, 
         struct SEE_string *, struct SEE_value *, int);
+static int activation_hasproperty(struct SEE_interpreter *, 
+        struct SEE_object *, struct SEE_string *);
+static int activation_delete(struct SEE_interpreter *, 
+        struct SEE_object *, struct SEE_string *);
+static struct SEE_enum *activation_enumerator(struct SEE_interpreter *,
+        struct SEE_object *);
 
-static int argument_index(struct arguments *, struct SEE_string *);
+static int argument_index(struct SEE_interpreter *, struct arguments *,
+	struct SEE_string *);
 static void arguments_get(struct SEE_interpreter *, struct SEE_object *, 
         struct SEE_string *, struct SEE_value *);
 static void arguments_put(struct SEE_interpreter *, struct SEE_object *, 
@@ -222,10 +251,10 @@ struct SEE_objectclass SEE_activation_class = {
 	activation_get,				/* Get */
 	activation_put,				/* Put */
 	SEE_native_canput,			/* CanPut */
-	SEE_native_hasproperty,			/* HasProperty */
-	SEE_native_delete,			/* Delete */
+	activation_hasproperty,			/* HasProperty */
+	activation_delete,			/* Delete */
 	SEE_no_defaultvalue,			/* DefaultValue */
-	SEE_native_enumerator,			/* Enumerator */
+	activation_enumerator,			/* Enumerator */
 };
 
 void
@@ -296,6 +325,44 @@ SEE_Function_init(interp)
 		SEE_ATTR_DONTENUM | SEE_ATTR_DONTDELETE | SEE_ATTR_READONLY);
 }
 
+/*
+ * Copies the fields of an activation or arguments object for an
+ * interpreter that is about to change it (see clone.c). Returns NULL
+ * for other objects.
+ */
+struct SEE_native *
+SEE_Function_copy(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	struct activation *a, *orig;
+	struct arguments *args;
+	int nslots;
+
+	if (n->object.objectclass == &SEE_activation_class) {
+		orig = (struct activation *)n;
+		nslots = orig->function->nlocals +
+			MAX(orig->function->nparams, orig->argc);
+		a = (struct activation *)_SEE_native_copy(interp, n,
+		    sizeof (struct activation) +
+		    (MAX(nslots, 1) - 1) * sizeof a->slot_storage[0]);
+		a->slots = a->slot_storage;
+		a->argv = a->slots + a->function->nlocals;
+		return (struct SEE_native *)a;
+	}
+
+	if (n->object.objectclass == &arguments_class) {
+		args = (struct arguments *)_SEE_native_copy(interp, n,
+			sizeof *args);
+		args->deleted = SEE_NEW_ARRAY(interp, SEE_boolean_t,
+			args->activation->argc);
+		memcpy(args->deleted, ((struct arguments *)n)->deleted,
+			args->activation->argc * sizeof args->deleted[0]);
+		return (struct SEE_native *)args;
+	}
+
+	return NULL;
+}
 
 /* Convert an object to a function instance, or raise a TypeError */
 static struct function_inst *
@@ -488,7 +555,6 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 	struct function_inst *fi;
 	struct SEE_object *activation;
 	struct SEE_value v;
-	struct SEE_scope *innerscope;
 	SEE_try_context_t ctxt;
 	struct SEE_value old_arguments;
 	int old_arguments_saved = 0;
@@ -507,9 +573,7 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 	activation = activation_create(interp, self, fi->function, argc, argv);
 
 	/* 10.2.3 build the right scope chain now */
-	innerscope = SEE_NEW(interp, struct SEE_scope);
-	innerscope->obj = activation;
-	innerscope->next = fi->scope;
+	((struct activation *)activation)->scope.next = fi->scope;
 
 	/* 10.2 enter a new execution context */
 	context.interpreter = interp;
@@ -517,13 +581,19 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 	context.variable = activation;	/* see 10.2.3 */
 	context.varattr = SEE_ATTR_DONTDELETE;
 	context.thisobj = thisobj ? thisobj : interp->Global;
-	context.scope = innerscope;
+	context.scope = &((struct activation *)activation)->scope;
+
+	/* Without f.arguments to restore, there is nothing to clean up */
+	if (!SEE_COMPAT_JS(interp, >=, JS11)) {
+		SEE_eval_functionbody(fi->function, &context, res);
+		return;
+	}
 
 	/* 
 	 * Compatibility: set f.arguments to the arguments object too,
 	 * saving the old value (It gets restored later)
 	 */
-	if (SEE_COMPAT_JS(interp, >=, JS11)) { /* EXT:11 */
+	{ /* EXT:11 */
 	    struct SEE_object *common = 
 	    	(struct SEE_object *)fi->function->common;
 	    if (SEE_OBJECT_HASPROPERTY(interp, common, STR(arguments))) {
@@ -532,7 +602,8 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 			STR(arguments));
 		old_arguments_saved = 1;
 	    }
-	    SEE_SET_OBJECT(&v, ((struct activation *)activation)->arguments);
+	    SEE_SET_OBJECT(&v, activation_arguments(interp,
+		(struct activation *)activation));
 	    SEE_OBJECT_PUT(interp, common, STR(arguments), &v, 
 		SEE_ATTR_DONTDELETE | SEE_ATTR_READONLY | SEE_ATTR_DONTENUM);
 	}
@@ -543,7 +614,7 @@ function_inst_call(interp, self, thisobj, argc, argv, res)
 	}
 
 	/* Restore f.arguments */
-	if (SEE_COMPAT_JS(interp, >=, JS11)) { /* EXT:12 */
+	{ /* EXT:12 */
 	    struct SEE_object *common = 
 	    	(struct SEE_object *)fi->function->common;
 	    if (old_arguments_saved)
@@ -798,6 +869,17 @@ function_proto_call(interp, self, thisobj, argc, argv, res)
  * this array, but they are inaccessible through [[Get]] (because
  * they have no name).
  *
+ * The var and function declarations that the parser found in the
+ * function body are kept in the same way, in an array of slots that
+ * immediately precedes the arguments. This lets the code generator
+ * address them by slot number, while [[Get]]/[[Put]] by name still
+ * work for closures, eval and with statements.
+ *
+ * Most functions never mention 'arguments', so the arguments object
+ * is only created the first time the activation is asked about that
+ * name: by an identifier lookup in the body, by an eval, or by an
+ * enumeration of the activation.
+ *
  * 10.1.6
  */
 
@@ -810,48 +892,95 @@ activation_create(interp, callee, function, argc, argv)
 	struct SEE_value **argv;
 {
 	struct activation *activation;
-	int i;
-	struct SEE_value v, undef;
+	int i, nslots;
 
-	activation = SEE_NEW(interp, struct activation);
+	nslots = function->nlocals + MAX(function->nparams, argc);
+	activation = (struct activation *)SEE_malloc(interp,
+	    sizeof (struct activation) +
+	    (MAX(nslots, 1) - 1) * sizeof activation->slot_storage[0]);
 	SEE_native_init(&activation->native, interp, &SEE_activation_class,
 		NULL);
 	activation->function = function;
+	activation->callee = callee;
+	activation->scope.obj = (struct SEE_object *)activation;
+	activation->scope.next = NULL;
 	activation->argc = argc;
-	activation->argv = SEE_NEW_ARRAY(interp, struct SEE_value, 
-		MAX(function->nparams, argc));
+	activation->slots = activation->slot_storage;
+	activation->argv = activation->slots + function->nlocals;
+	activation->arguments = NULL;
 
+	for (i = 0; i < function->nlocals; i++)
+		SEE_SET_UNDEFINED(&activation->slots[i]);
 	for (i = 0; i < argc; i++)
 		SEE_VALUE_COPY(&activation->argv[i], argv[i]);
 	for (; i < function->nparams; i++)
 		SEE_SET_UNDEFINED(&activation->argv[i]);
 
-	/* 10.1.6 Initialize with an 'arguments' property */
-	activation->arguments = arguments_create(interp, activation, callee);
-	SEE_SET_OBJECT(&v, activation->arguments);
-	SEE_native_put(interp, (struct SEE_object *)&activation->native, 
-		STR(arguments), &v, SEE_ATTR_DONTDELETE);
+	return (struct SEE_object *)activation;
+}
 
-	/* Initialise all the formal parameters to undef */
-	SEE_SET_UNDEFINED(&undef);
-	for (i = 0; i < function->nparams; i++)
-	    SEE_native_put(interp, (struct SEE_object *)&activation->native, 
-		    function->params[i], &undef, SEE_ATTR_DONTDELETE);
+/* 10.1.6 Initializes the 'arguments' property, if not done already */
+static struct SEE_object *
+activation_arguments(interp, activation)
+	struct SEE_interpreter *interp;
+	struct activation *activation;
+{
+	struct SEE_value v;
+	struct activation *a = VIEW_READ(interp, struct activation,
+	    activation);
+
+	if (!a->arguments) {
+		a = VIEW_WRITE(interp, struct activation, activation);
+		a->arguments = arguments_create(interp, activation,
+		    activation->callee);
+		SEE_SET_OBJECT(&v, a->arguments);
+		SEE_native_put(interp, 
+		    (struct SEE_object *)&activation->native, 
+		    STR(arguments), &v, SEE_ATTR_DONTDELETE);
+	}
+	return a->arguments;
+}
 
-	return (struct SEE_object *)activation;
+/*
+ * Returns true if the interned name p refers to a not-yet-created
+ * 'arguments' property. (A parameter called 'arguments' hides it.)
+ */
+static int
+activation_is_arguments(interp, activation, p)
+	struct SEE_interpreter *interp;
+	struct activation *activation;
+	struct SEE_string *p;
+{
+	return p == STR(arguments) &&
+	    !VIEW_READ(interp, struct activation, activation)->arguments &&
+	    activation_find_index(activation, p) < 0;
 }
 
+/* Returns the slot array of an activation object, for the code generator */
+struct SEE_value *
+SEE_activation_slots(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	return VIEW_WRITE(interp, struct activation, o)->slots;
+}
+
+/* Returns the slot index of a param or local, or -1 if not found */
 static int
 activation_find_index(activation, p)
 	struct activation *activation;
 	struct SEE_string *p;
 {
+	struct function *f = activation->function;
 	int i;
 
-	for (i = activation->function->nparams - 1; i >= 0; i--)
-	    if (p == activation->function->params[i])
-	    	break;
-	return i;
+	for (i = f->nparams - 1; i >= 0; i--)
+	    if (p == f->params[i])
+	    	return f->nlocals + i;
+	for (i = 0; i < f->nlocals; i++)
+	    if (p == f->locals[i])
+	    	return i;
+	return -1;
 }
 
 static void
@@ -866,10 +995,14 @@ activation_get(interp, o, p, res)
 	int i = activation_find_index(activation, ip);
 
 	if (i >= 0)
-		SEE_VALUE_COPY(res, &activation->argv[i]);
-	else
+		SEE_VALUE_COPY(res,
+		    &VIEW_READ(interp, struct activation, o)->slots[i]);
+	else {
+		if (activation_is_arguments(interp, activation, ip))
+			activation_arguments(interp, activation);
 		SEE_native_get(interp, 
 		    (struct SEE_object *)&activation->native, ip, res);
+	}
 }
 
 static void
@@ -885,10 +1018,62 @@ activation_put(interp, o, p, val, attr)
 	int i = activation_find_index(activation, ip);
 
 	if (i >= 0)
-		SEE_VALUE_COPY(&activation->argv[i], val);
-	else
+		SEE_VALUE_COPY(
+		    &VIEW_WRITE(interp, struct activation, o)->slots[i], val);
+	else {
+		if (activation_is_arguments(interp, activation, ip))
+			activation_arguments(interp, activation);
 		SEE_native_put(interp, 
 		    (struct SEE_object *)&activation->native, ip, val, attr);
+	}
+}
+
+static int
+activation_hasproperty(interp, o, p)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct SEE_string *p;
+{
+	struct SEE_string *ip = SEE_intern(interp, p);
+	struct activation *activation = (struct activation *)o;
+
+	if (activation_find_index(activation, ip) >= 0)
+		return 1;
+	if (activation_is_arguments(interp, activation, ip))
+		activation_arguments(interp, activation);
+	return SEE_native_hasproperty(interp, 
+	    (struct SEE_object *)&activation->native, ip);
+}
+
+/* Params and locals are DontDelete (10.1.3, 10.1.6) */
+static int
+activation_delete(interp, o, p)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	struct SEE_string *p;
+{
+	struct SEE_string *ip = SEE_intern(interp, p);
+	struct activation *activation = (struct activation *)o;
+
+	if (activation_find_index(activation, ip) >= 0)
+		return 0;
+	if (activation_is_arguments(interp, activation, ip))
+		activation_arguments(interp, activation);
+	return SEE_native_delete(interp, 
+	    (struct SEE_object *)&activation->native, ip);
+}
+
+static struct SEE_enum *
+activation_enumerator(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct activation *activation = (struct activation *)o;
+
+	if (activation_is_arguments(interp, activation, STR(arguments)))
+		activation_arguments(interp, activation);
+	return SEE_native_enumerator(interp, 
+	    (struct SEE_object *)&activation->native);
 }
 
 
@@ -902,7 +1087,8 @@ activation_put(interp, o, p, val, attr)
  * integer index. Returns -1 if not an integer less than argc;
  */
 static int
-argument_index(a, s)
+argument_index(interp, a, s)
+	struct SEE_interpreter *interp;
 	struct arguments *a;
 	struct SEE_string *s;
 {
@@ -921,7 +1107,7 @@ argument_index(a, s)
 	
 	if (value >= a->activation->argc)
 		return -1;
-	if (a->deleted[value])
+	if (VIEW_READ(interp, struct arguments, a)->deleted[value])
 		return -1;
 	return value;
 }
@@ -933,10 +1119,10 @@ arguments_delete(interp, o, p)
 	struct SEE_string *p;
 {
 	struct arguments *a = (struct arguments *)o;
-	int i = argument_index(a, p);
+	int i = argument_index(interp, a, p);
 
 	if (i != -1)
-		a->deleted[i] = 1;
+		VIEW_WRITE(interp, struct arguments, a)->deleted[i] = 1;
 	return SEE_native_delete(interp, o, p);
 }
 
@@ -948,10 +1134,11 @@ arguments_get(interp, o, p, res)
 	struct SEE_value *res;
 {
 	struct arguments *a = (struct arguments *)o;
-	int i = argument_index(a, p);
+	int i = argument_index(interp, a, p);
 
 	if (i != -1)
-		SEE_VALUE_COPY(res, &a->activation->argv[i]);
+		SEE_VALUE_COPY(res, &VIEW_READ(interp, struct activation,
+		    a->activation)->argv[i]);
 	else
 		SEE_native_get(interp, o, p, res);
 }
@@ -965,10 +1152,11 @@ arguments_put(interp, o, p, val, attr)
 	int attr;
 {
 	struct arguments *a = (struct arguments *)o;
-	int i = argument_index(a, p);
+	int i = argument_index(interp, a, p);
 
 	if (i != -1)
-		SEE_VALUE_COPY(&a->activation->argv[i], val);
+		SEE_VALUE_COPY(&VIEW_WRITE(interp, struct activation,
+		    a->activation)->argv[i], val);
 	else
 		SEE_native_put(interp, o, p, val, attr);
 }
@@ -999,7 +1187,8 @@ arguments_defaultvalue(interp, o, hint, res)
 	        SEE_string_append_int(snum, i);
 	        SEE_string_append(s, snum);
 		SEE_string_addch(s, '=');
-		SEE_ToString(interp, &a->activation->argv[i], &vs);
+		SEE_ToString(interp, &VIEW_READ(interp, struct activation,
+		    a->activation)->argv[i], &vs);
 		SEE_string_append(s, vs.u.string);
 	    }
 	    SEE_string_addch(s, ']');
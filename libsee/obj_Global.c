@@ -113,7 +113,7 @@ static void init_eval_context(struct SEE_context *context,
         struct SEE_object *variable, struct SEE_scope *scope);
 
 static int is_StrWhiteSpace(int);
-static void AddEscape(struct SEE_interpreter *, struct SEE_string *, 
+static void AddEscape(struct SEE_interpreter *, struct SEE_strbuf *, 
         unsigned int);
 static struct SEE_string *Encode(struct SEE_interpreter *, 
         struct SEE_string *, const unsigned char *);
@@ -540,14 +540,15 @@ global_isFinite(interp, self, thisobj, argc, argv, res)
 static void
 AddEscape(interp, R, i)
 	struct SEE_interpreter *interp;
-	struct SEE_string *R;
+	struct SEE_strbuf *R;
 	unsigned int i;		/* promoted unsigned char */
 {
 	char *hexstr = SEE_hexstr_uppercase;
 
-	SEE_string_addch(R, '%');
-	SEE_string_addch(R, hexstr[(i >> 4) & 0xf]);
-	SEE_string_addch(R, hexstr[i & 0xf]);
+	SEE_strbuf_reserve(R, 3);
+	R->data[R->length++] = '%';
+	R->data[R->length++] = hexstr[(i >> 4) & 0xf];
+	R->data[R->length++] = hexstr[i & 0xf];
 }
 
 /* 15.1.3 */
@@ -557,11 +558,11 @@ Encode(interp, s, unesc)
 	struct SEE_string *s;
 	const unsigned char *unesc;
 {
-	struct SEE_string *R;
+	struct SEE_strbuf R;
 	int k;
 	SEE_unicode_t C;
 
-	R = SEE_string_new(interp, 0);
+	SEE_strbuf_init(interp, &R, s->length);
 	k = 0;
 	while (k < s->length) {
 	    /*
@@ -583,24 +584,24 @@ Encode(interp, s, unesc)
 
 	    if (C < 0x80) {
 		    if (unesc[(C & 0x7f) >> 3] & (1 << (C & 0x7)))
-			SEE_string_addch(R, C);
+			SEE_STRBUF_ADDCH(&R, C);
 		    else
-			AddEscape(interp, R, (unsigned char)(C & 0x7f));
+			AddEscape(interp, &R, (unsigned char)(C & 0x7f));
 	    } else if (C < 0x800) {
-		AddEscape(interp, R, (unsigned char)(0xc0 | (C >>  6 & 0x1f)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >>  0 & 0x2f)));
+		AddEscape(interp, &R, (unsigned char)(0xc0 | (C >>  6 & 0x1f)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >>  0 & 0x3f)));
 	    } else if (C < 0x10000) {
-		AddEscape(interp, R, (unsigned char)(0xe0 | (C >> 12 & 0x0f)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >>  6 & 0x2f)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >>  0 & 0x2f)));
+		AddEscape(interp, &R, (unsigned char)(0xe0 | (C >> 12 & 0x0f)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >>  6 & 0x3f)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >>  0 & 0x3f)));
 	    } else /* if (C < 0x200000) */ {
-		AddEscape(interp, R, (unsigned char)(0xf0 | (C >> 18 & 0x07)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >> 12 & 0x2f)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >>  6 & 0x2f)));
-		AddEscape(interp, R, (unsigned char)(0x80 | (C >>  0 & 0x2f)));
+		AddEscape(interp, &R, (unsigned char)(0xf0 | (C >> 18 & 0x07)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >> 12 & 0x3f)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >>  6 & 0x3f)));
+		AddEscape(interp, &R, (unsigned char)(0x80 | (C >>  0 & 0x3f)));
 	    }
 	}
-	return R;
+	return SEE_strbuf_finish(&R);
 }
 
 static unsigned char hexbitmap[] = 
@@ -631,13 +632,13 @@ Decode(interp, s, resv)
 	struct SEE_string *s;
 	const unsigned char *resv;
 {
-	struct SEE_string *R;
+	struct SEE_strbuf R;
 	int k, i, j, start;
 	SEE_unicode_t C;
 	SEE_char_t D;
 	static unsigned char mask[] = { 0xc0, 0xe0, 0xf0, 0xf8, 0xfc, 0xfe };
 
-	R = SEE_string_new(interp, 0);
+	SEE_strbuf_init(interp, &R, s->length);
 	k = 0;
 	while (k < s->length) {
 	    /*
@@ -691,22 +692,17 @@ Decode(interp, s, resv)
 	    /* Encode into UTF-16 unless it is in the reserved set */
 	    if (C < 0x10000) {
 		if (C < 0x80 && (resv[(C & 0x7f) >> 3] & (1 << (C & 0x7)))) 
-		    while (start < k) {
-			SEE_string_addch(R, s->data[start]);
-			start++;
-		    }
+		    SEE_strbuf_append_utf16(&R, s->data + start, k - start);
 		else
-		    SEE_string_addch(R, (SEE_char_t)C);
+		    SEE_STRBUF_ADDCH(&R, (SEE_char_t)C);
 	    } else if (C < 0x110000) {
-		C -= 0x10000;
-		SEE_string_addch(R, (SEE_char_t)(0xd800 | (C >> 10 & 0x3ff)));
-		SEE_string_addch(R, (SEE_char_t)(0xdc00 | (C & 0x3ff)));
+		SEE_strbuf_append_unicode(&R, C);
 	    } else {
 		SEE_error_throw_string(interp, interp->URIError, 
 			STR(bad_unicode));
 	    }
 	}
-	return R;
+	return SEE_strbuf_finish(&R);
 }
 
 /* Global.decodeURI (15.1.3.1) */
@@ -814,7 +810,8 @@ global_escape(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_value v;
 	SEE_char_t c;
-	struct SEE_string *s, *r;
+	struct SEE_string *s;
+	struct SEE_strbuf r;
 	int i;
 	static unsigned char ok[] =
 	{ 0x00,0x00,0x00,0x00,0x00,0xec,0xff,0x03,    /* [A-Za-z0-9@*_+\-./] */
@@ -829,25 +826,26 @@ global_escape(interp, self, thisobj, argc, argv, res)
 	SEE_ToString(interp, argv[0], &v);
 
 	s = v.u.string;
-	r = SEE_string_new(interp, 0);
+	SEE_strbuf_init(interp, &r, s->length);
 	for (i = 0; i < s->length; i++) {
 	    c = s->data[i];
+	    SEE_strbuf_reserve(&r, 6);
 	    if (c < 0x80 && (ok[c >> 3] & (1 << (c & 7))))
-		SEE_string_addch(r, c);
+		r.data[r.length++] = c;
 	    else if (c < 0x100) {
-		SEE_string_addch(r, '%');
-		SEE_string_addch(r, hexstr[(c >> 4) & 0xf]);
-		SEE_string_addch(r, hexstr[c & 0xf]);
+		r.data[r.length++] = '%';
+		r.data[r.length++] = hexstr[(c >> 4) & 0xf];
+		r.data[r.length++] = hexstr[c & 0xf];
 	    } else {
-		SEE_string_addch(r, '%');
-		SEE_string_addch(r, 'u');
-		SEE_string_addch(r, hexstr[(c >> 12) & 0xf]);
-		SEE_string_addch(r, hexstr[(c >> 8) & 0xf]);
-		SEE_string_addch(r, hexstr[(c >> 4) & 0xf]);
-		SEE_string_addch(r, hexstr[c & 0xf]);
+		r.data[r.length++] = '%';
+		r.data[r.length++] = 'u';
+		r.data[r.length++] = hexstr[(c >> 12) & 0xf];
+		r.data[r.length++] = hexstr[(c >> 8) & 0xf];
+		r.data[r.length++] = hexstr[(c >> 4) & 0xf];
+		r.data[r.length++] = hexstr[c & 0xf];
 	    }
 	}
-	SEE_SET_STRING(res, r);
+	SEE_SET_STRING(res, SEE_strbuf_finish(&r));
 }
 
 /* Global.unescape - (B.2.2) */
@@ -860,7 +858,8 @@ global_unescape(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_value v;
 	SEE_char_t c;
-	struct SEE_string *s, *r;
+	struct SEE_string *s;
+	struct SEE_strbuf r;
 	int i;
 
 	if (argc < 1) {
@@ -870,7 +869,7 @@ global_unescape(interp, self, thisobj, argc, argv, res)
 
 	SEE_ToString(interp, argv[0], &v);
 	s = v.u.string;
-	r = SEE_string_new(interp, 0);
+	SEE_strbuf_init(interp, &r, s->length);
 	i = 0;
 	while (i < s->length) {
 	    c = s->data[i++];
@@ -898,9 +897,9 @@ global_unescape(interp, self, thisobj, argc, argv, res)
 	    } else {
 		/* leave character alone */
 	    }
-	    SEE_string_addch(r, c);
+	    SEE_STRBUF_ADDCH(&r, c);
 	}
-	SEE_SET_STRING(res, r);
+	SEE_SET_STRING(res, SEE_strbuf_finish(&r));
 }
 
 #ifndef NDEBUG
@@ -916,7 +915,10 @@ global_write(interp, self, thisobj, argc, argv, res)
 
 	if (argc) {
 		SEE_ToString(interp, argv[0], &v);
-		SEE_string_fputs(v.u.string, stdout);
+		if (interp->output)
+			SEE_output_string(interp, interp->output, v.u.string);
+		else
+			SEE_string_fputs(v.u.string, stdout);
 	}
 	SEE_SET_UNDEFINED(res);
 }
@@ -999,3 +1001,27 @@ SEE_eval(interp, inp, thisobj, variable, scope, res)
 
 	interp->traceback = old_traceback;
 }
+
+/*
+ * Evaluates a program from SEE_program_compile() or SEE_program_load()
+ * in the Global context, like SEE_Global_eval().
+ */
+void
+SEE_program_eval(interp, program, res)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+	struct SEE_value *res;
+{
+	struct SEE_context context;
+	struct SEE_traceback *old_traceback;
+
+	old_traceback = interp->traceback;
+	interp->traceback = NULL;
+
+	init_eval_context(&context, interp, interp->Global, interp->Global,
+		interp->Global_scope);
+
+	_SEE_eval_program(&context, interp->Global, program->function, res);
+
+	interp->traceback = old_traceback;
+}
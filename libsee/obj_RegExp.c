@@ -49,6 +49,7 @@
 #include "regex.h"
 #include "stringdefs.h"
 #include "init.h"
+#include "clone.h"
 #include "nmath.h"
 #include "compare.h"
 
@@ -199,6 +200,23 @@ SEE_RegExp_init(interp)
 	PUTFUNC(toString, 0)			/* 15.10.6.4 */
 }
 
+/*
+ * Copies a regular expression for an interpreter that is about to
+ * change its properties (see clone.c). Returns NULL for other objects.
+ * The fields after the native part never change once constructed,
+ * so toregexp() reads them from the object itself, and the compiled
+ * regex, which matching does not change, is shared.
+ */
+struct SEE_native *
+SEE_RegExp_copy(interp, n)
+	struct SEE_interpreter *interp;
+	struct SEE_native *n;
+{
+	if (!SEE_is_RegExp((struct SEE_object *)n))
+		return NULL;
+	return _SEE_native_copy(interp, n, sizeof (struct regexp_object));
+}
+
 static struct regexp_object *
 toregexp(interp, o)
 	struct SEE_interpreter *interp;
@@ -388,18 +406,14 @@ regexp_proto_exec(interp, self, thisobj, argc, argv, res)
 	ncaptures = SEE_regex_count_captures(ro->regex);
 	SEE_ASSERT(interp, ncaptures > 0);
 	captures = SEE_STRING_ALLOCA(interp, struct capture, ncaptures);
-	while (!SEE_regex_match(interp, ro->regex, S, i, captures)) {
-		i++;
-		if (i > S->length) {
-		    SEE_SET_NUMBER(&v, 0);
-		    SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
-		    SEE_SET_NULL(res);
-		    for (i = 0; i < ncaptures; i++)
-			captures[i].end = -1;
-		    regexp_set_static(interp, S, ro->regex, captures, 
-		    	ro->source);
-		    return;
-		}
+	if (!SEE_regex_search(interp, ro->regex, S, i, captures)) {
+		SEE_SET_NUMBER(&v, 0);
+		SEE_OBJECT_PUT(interp, thisobj, STR(lastIndex), &v, 0); 
+		SEE_SET_NULL(res);
+		for (i = 0; i < ncaptures; i++)
+		    captures[i].end = -1;
+		regexp_set_static(interp, S, ro->regex, captures, ro->source);
+		return;
 	}
 	regexp_set_static(interp, S, ro->regex, captures, ro->source);
 
@@ -472,6 +486,32 @@ SEE_RegExp_match(interp, obj, text, start, captures)
 	return success;
 }
 
+/*
+ * Finds the leftmost match of a RegExp object in the text at or after
+ * index start, ignoring its global flag and lastIndex.
+ */
+int
+SEE_RegExp_search(interp, obj, text, start, captures)
+	struct SEE_interpreter *interp;
+	struct SEE_object *obj;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *captures;
+{
+	struct regexp_object *ro;
+	int success;
+	unsigned int ncaptures, i;
+
+	ro = toregexp(interp, obj);
+	ncaptures = SEE_regex_count_captures(ro->regex);
+	success = SEE_regex_search(interp, ro->regex, text, start, captures);
+	if (!success)
+	    for (i = 0; i < ncaptures; i++)
+		captures[i].end = -1;
+	regexp_set_static(interp, text, ro->regex, captures, ro->source);
+	return success;
+}
+
 /* 15.10.6.3 RegExp.prototype.test() */
 static void
 regexp_proto_test(interp, self, thisobj, argc, argv, res)
@@ -441,10 +441,10 @@ string_proto_concat(interp, self, thisobj, argc, argv, res)
 	int i;
 	struct SEE_value v;
 
-	s = SEE_string_dup(interp, object_to_string(interp, thisobj));
+	s = object_to_string(interp, thisobj);
 	for (i = 0; i < argc; i++) {
 		SEE_ToString(interp, argv[i], &v);
-		SEE_string_append(s, v.u.string);
+		s = SEE_string_concat(interp, s, v.u.string);
 	}
 	SEE_SET_STRING(res, s);
 }
@@ -681,13 +681,14 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 	struct SEE_interpreter *interp;
 	unsigned int *previndexp;
 	struct SEE_object *a;
-	struct SEE_string *out, *source;
+	struct SEE_strbuf *out;
+	struct SEE_string *source;
 	struct SEE_value *replacev;
 	int ncaps;
 {
 	struct SEE_value v, v2;
 	int n;
-	unsigned int index, i, j, k;
+	unsigned int index, i, j;
 	struct SEE_string *ns = NULL;
 	struct SEE_string *ms = NULL;
 	struct SEE_string *replace;
@@ -702,8 +703,9 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 	ms = v.u.string;
 
 	/* Copy the intermediate characters we missed */
-	for (i = *previndexp; i < index; i++)
-	    SEE_string_addch(out, source->data[i]);
+	if (index > *previndexp)
+	    SEE_strbuf_append_utf16(out, source->data + *previndexp,
+		index - *previndexp);
 	*previndexp = index + ms->length;
 
 	if (SEE_VALUE_GET_TYPE(replacev) == SEE_OBJECT) {
@@ -724,7 +726,7 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 	    SEE_OBJECT_CALL(interp, replacev->u.object, replacev->u.object,
 		ncaps + 2, av, &v);
 	    SEE_ToString(interp, &v, &v2);
-	    SEE_string_append(out, v2.u.string);
+	    SEE_strbuf_append(out, v2.u.string);
 	    return;
 	}
 
@@ -739,21 +741,22 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 
 		switch (replace->data[i]) {
 		case '$':
-		    SEE_string_addch(out, '$');
+		    SEE_STRBUF_ADDCH(out, '$');
 		    i++;
 		    continue;
 		case '`':
-		    for (k = 0; k < index; k++)
-		        SEE_string_addch(out, source->data[k]);
+		    SEE_strbuf_append_utf16(out, source->data, index);
 		    i++;
 		    continue;
 		case '\'':
-		    for (k = *previndexp; k < source->length; k++)
-		        SEE_string_addch(out, source->data[k]);
+		    if (*previndexp < source->length)
+			SEE_strbuf_append_utf16(out,
+			    source->data + *previndexp,
+			    source->length - *previndexp);
 		    i++;
 		    continue;
 		case '&':
-		    SEE_string_append(out, ms);
+		    SEE_strbuf_append(out, ms);
 		    i++;
 		    continue;
 		}
@@ -764,7 +767,7 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 			n = n * 10 + replace->data[j++] - '0';
 		if (j == i) {
 		    /* Didn't see any digits */
-		    SEE_string_addch(out, '$');
+		    SEE_STRBUF_ADDCH(out, '$');
 		    continue;
 		}
 		/* Build up an index into the capture array  */
@@ -776,11 +779,11 @@ replace_helper(interp, previndexp, out, a, source, replacev, ncaps)
 		SEE_OBJECT_GET(interp, a, SEE_intern(interp, ns), &v);
 		if (SEE_VALUE_GET_TYPE(&v) != SEE_UNDEFINED) {
 		    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&v) == SEE_STRING);
-		    SEE_string_append(out, v.u.string);
+		    SEE_strbuf_append(out, v.u.string);
 		}
 		i = j;
 	    } else {
-	        SEE_string_addch(out, replace->data[i]);
+	        SEE_STRBUF_ADDCH(out, replace->data[i]);
 	        i++;
 	    }
 }
@@ -795,11 +798,13 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 {
 	struct SEE_object *regexp, *reexec;
 	struct SEE_value v, *vp, *vpv[1], v2, *replacev, replv;
-	struct SEE_string *s, *out = NULL;
+	struct SEE_string *s;
+	struct SEE_strbuf out;
 	SEE_boolean_t global;
 	int ncaps;
 	unsigned int previndex = 0;
 	
+	out.interpreter = NULL;		/* no match yet */
 	regexp = regexp_arg(interp, argc < 1 ? NULL : argv[0]);
 	ncaps = SEE_RegExp_count_captures(interp, regexp);
 
@@ -835,8 +840,8 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 		if (SEE_VALUE_GET_TYPE(&v2) != SEE_NULL) {
 		    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&v2) == SEE_OBJECT
 			&& SEE_is_Array(v2.u.object));
-		    out = SEE_string_new(interp, 0);
-		    replace_helper(interp, &previndex, out, v2.u.object,
+		    SEE_strbuf_init(interp, &out, s->length);
+		    replace_helper(interp, &previndex, &out, v2.u.object,
 			s, replacev, ncaps);
 		}
 	} else {
@@ -862,9 +867,9 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 		    SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(&v) == SEE_STRING);
 
 		    if (v.u.string->length != 0) {
-		        if (out == NULL) 
-			    out = SEE_string_new(interp, 0);
-		        replace_helper(interp, &previndex, out, vres.u.object,
+		        if (out.interpreter == NULL) 
+			    SEE_strbuf_init(interp, &out, s->length);
+		        replace_helper(interp, &previndex, &out, vres.u.object,
 			    s, replacev, ncaps);
 		    } else {
 			/* Increment the index by one if it matched empty */
@@ -877,14 +882,14 @@ string_proto_replace(interp, self, thisobj, argc, argv, res)
 		}
 	}
 
-	if (out)
+	if (out.interpreter) {
 	    /* Copy rest of source text */
-	    while (previndex < s->length)
-		SEE_string_addch(out, s->data[previndex++]);
-	else
-	    out = s;
-
-	SEE_SET_STRING(res, out);
+	    if (previndex < s->length)
+		SEE_strbuf_append_utf16(&out, s->data + previndex,
+		    s->length - previndex);
+	    SEE_SET_STRING(res, SEE_strbuf_finish(&out));
+	} else
+	    SEE_SET_STRING(res, s);
 }
 
 /* 15.5.4.12 String.prototype.search() */
@@ -899,7 +904,6 @@ string_proto_search(interp, self, thisobj, argc, argv, res)
 	struct SEE_object *regexp;
 	int ncaps;
 	struct capture *captures;
-	int index;
 
 	s = object_to_string(interp, thisobj);
 	regexp = regexp_arg(interp, argc < 1 ? NULL : argv[0]);
@@ -912,12 +916,10 @@ string_proto_search(interp, self, thisobj, argc, argv, res)
 	 * it is a perfect candidate for calling the regex 
 	 * engine (nearly) directly.
 	 */
-	for (index = 0; index < s->length; index++)
-	    if (SEE_RegExp_match(interp, regexp, s, index, captures)) {
-		SEE_SET_NUMBER(res, captures[0].start);
-		return;
-	    }
-	SEE_SET_NUMBER(res, -1);
+	if (SEE_RegExp_search(interp, regexp, s, 0, captures))
+	    SEE_SET_NUMBER(res, captures[0].start);
+	else
+	    SEE_SET_NUMBER(res, -1);
 }
 
 /* 15.5.4.13 String.prototype.slice() */
@@ -1051,7 +1053,13 @@ string_proto_split(interp, self, thisobj, argc, argv, res)
 /*9*/	if (s == 0) goto step31;
 step10:	q = p;
 step11:	if (q == s) goto step28;
-/*12*/	z = SplitMatch(interp, R, S, q, captures);
+/*12*/	if (SEE_VALUE_GET_TYPE(R) == SEE_OBJECT) {
+	    /* Let the regex engine skip the q where R cannot match */
+	    z = SEE_RegExp_search(interp, R->u.object, S, q, captures);
+	    if (!z || captures[0].start >= s) goto step28;
+	    q = captures[0].start;
+	} else
+	    z = SplitMatch(interp, R, S, q, captures);
 /*13*/	if (!z) goto step26;
 /*14*/	e = captures[0].end;
 /*15*/	if (e == p) goto step26;
@@ -69,7 +69,9 @@ transit_sec_domain(interp, obj)
 
 /*
  * Calls the object method, after checking that any recursion
- * limit has not been reached.
+ * limit has not been reached. If the call throws, the try context
+ * that catches the exception restores the limit and security domain,
+ * so none is set up here.
  */
 void
 SEE_object_call(interp, obj, thisobj, argc, argv, res)
@@ -80,7 +82,6 @@ SEE_object_call(interp, obj, thisobj, argc, argv, res)
 	struct SEE_value **argv;
 	struct SEE_value *res;
 {
-	SEE_try_context_t c;
 	int saved_recursion_limit = interp->recursion_limit;
 	void *saved_sec_domain = interp->sec_domain;
 
@@ -90,12 +91,9 @@ SEE_object_call(interp, obj, thisobj, argc, argv, res)
 	else if (interp->recursion_limit > 0) 
 	    interp->recursion_limit--;
 	transit_sec_domain(interp, obj);
-	SEE_TRY(interp, c) {
-	    _SEE_OBJECT_CALL(interp, obj, thisobj, argc, argv, res);
-	}
+	_SEE_OBJECT_CALL(interp, obj, thisobj, argc, argv, res);
 	interp->sec_domain = saved_sec_domain;
 	interp->recursion_limit = saved_recursion_limit;
-	SEE_DEFAULT_CATCH(interp, c);
 }
 
 /*
@@ -111,7 +109,6 @@ SEE_object_construct(interp, obj, thisobj, argc, argv, res)
 	struct SEE_value **argv;
 	struct SEE_value *res;
 {
-	SEE_try_context_t c;
 	int saved_recursion_limit = interp->recursion_limit;
 	void *saved_sec_domain = interp->sec_domain;
 
@@ -122,12 +119,9 @@ SEE_object_construct(interp, obj, thisobj, argc, argv, res)
 	} else if (interp->recursion_limit > 0) 
 	    interp->recursion_limit--;
 	transit_sec_domain(interp, obj);
-	SEE_TRY(interp, c) {
-	    _SEE_OBJECT_CONSTRUCT(interp, obj, NULL, argc, argv, res);
-	}
+	_SEE_OBJECT_CONSTRUCT(interp, obj, NULL, argc, argv, res);
 	interp->sec_domain = saved_sec_domain;
 	interp->recursion_limit = saved_recursion_limit;
-	SEE_DEFAULT_CATCH(interp, c);
 }
 
 /*
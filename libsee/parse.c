@@ -249,6 +249,10 @@ static struct node *SourceElements_parse(struct parser *parser);
 static void eval_functionbody(void *, struct SEE_context *, struct SEE_value *);
 
 static void *make_body(struct SEE_interpreter *, struct node *, int);
+static void FunctionBody_set_slots(struct SEE_interpreter *, 
+	struct node *, struct var *);
+static struct function *function_make(struct SEE_interpreter *,
+	struct SEE_string *, struct var *, struct node *);
 
 #define NO_CONST    1
 
@@ -653,6 +657,94 @@ make_body(interp, node, no_const)
 #endif
 }
 
+/*
+ * Assigns activation slots to the formal parameters and to the
+ * top-level var and function declarations of a function body.
+ * The code generator uses the slot numbers to access locals
+ * directly, and the activation object uses the same table to
+ * map names onto slots for everyone else (closures, eval, with).
+ * A var with the same name as a parameter shares its slot; 
+ * 'arguments' is left to the activation's property table.
+ */
+static void
+FunctionBody_set_slots(interp, node, formal)
+	struct SEE_interpreter *interp;
+	struct node *node;
+	struct var *formal;
+{
+	struct FunctionBody_node *fb = CAST_NODE(node, FunctionBody);
+	struct SourceElements_node *se = CAST_NODE(fb->u.a, SourceElements);
+	struct SourceElement *e;
+	struct SEE_string **names, *name;
+	struct var *v;
+	int i, n, nnames;
+
+	n = 0;
+	for (v = formal; v; v = v->next)
+	    n++;
+	fb->nparams = n;
+	fb->params = n ? SEE_NEW_ARRAY(interp, struct SEE_string *, n) : NULL;
+	for (i = 0, v = formal; v; v = v->next, i++)
+	    fb->params[i] = v->name;
+
+	n = 0;
+	for (e = se->functions; e; e = e->next)
+	    n++;
+	for (v = se->vars; v; v = v->next)
+	    n++;
+	names = n ? SEE_NEW_ARRAY(interp, struct SEE_string *, n) : NULL;
+
+	nnames = 0;
+	e = se->functions;
+	v = se->vars;
+	while (e || v) {
+	    if (e) {
+		name = CAST_NODE(e->node, Function)->function->name;
+		e = e->next;
+	    } else {
+		name = v->name;
+		v = v->next;
+	    }
+	    if (name == STR(arguments))
+		continue;
+	    for (i = 0; i < fb->nparams; i++)
+		if (fb->params[i] == name)
+		    break;
+	    if (i < fb->nparams)
+		continue;
+	    for (i = 0; i < nnames; i++)
+		if (names[i] == name)
+		    break;
+	    if (i < nnames)
+		continue;
+	    names[nnames++] = name;
+	}
+	fb->nlocals = nnames;
+	fb->locals = names;
+}
+
+/*
+ * Compiles a function body and wraps it up into a function
+ * structure that knows about the body's activation slots.
+ */
+static struct function *
+function_make(interp, name, formal, body)
+	struct SEE_interpreter *interp;
+	struct SEE_string *name;
+	struct var *formal;
+	struct node *body;
+{
+	struct FunctionBody_node *fb = CAST_NODE(body, FunctionBody);
+	struct function *f;
+
+	FunctionBody_set_slots(interp, body, formal);
+	f = SEE_function_make(interp, name, formal, 
+		make_body(interp, body, 0));
+	f->nlocals = fb->nlocals;
+	f->locals = fb->locals;
+	return f;
+}
+
 
 /*------------------------------------------------------------
  * LL(2) lookahead implementation
@@ -2823,8 +2915,7 @@ FunctionDeclaration_parse(parser)
 	parser->funcdepth--;
 	EXPECT('}');
 
-	n->function = SEE_function_make(parser->interpreter, 
-		name, formal, make_body(parser->interpreter, body, 0));
+	n->function = function_make(parser->interpreter, name, formal, body);
 
 	return (struct node *)n;
 }
@@ -2862,8 +2953,7 @@ FunctionExpression_parse(parser)
 	parser->funcdepth--;
 	EXPECT('}');
 
-	n->function = SEE_function_make(parser->interpreter,
-		name, formal, make_body(parser->interpreter, body, 0));
+	n->function = function_make(parser->interpreter, name, formal, body);
 
 	/* Restore parser state */
 	parser->noin = noin_save;
@@ -2912,6 +3002,8 @@ FunctionBody_make(interp, source_elements, is_program)
 	    NODECLASS_FunctionBody);
 	n->u.a = source_elements;
 	n->is_program = is_program;
+	n->nparams = n->nlocals = 0;
+	n->params = n->locals = NULL;
 	return (struct node *)n;
 }
 
@@ -2924,6 +3016,8 @@ FunctionBody_parse(parser)
 	n = NEW_NODE(struct FunctionBody_node, NODECLASS_FunctionBody);
 	n->u.a = PARSE(SourceElements);
 	n->is_program = 0;
+	n->nparams = n->nlocals = 0;
+	n->params = n->locals = NULL;
 	return (struct node *)n;
 }
 
@@ -3120,7 +3214,7 @@ SEE_parse_function(interp, name, paraminp, bodyinp)
 	struct node *body;
 
 	if (paraminp) {
-		SEE_lex_init(&lex, SEE_input_lookahead(paraminp, 6));
+		SEE_lex_init(&lex, paraminp);
 		parser_init(parser, interp, &lex);
 		formal = PARSE(FormalParameterList);	/* handles "" too */
 		EXPECT_NOSKIP(tEND);			/* uses parser var */
@@ -3128,7 +3222,7 @@ SEE_parse_function(interp, name, paraminp, bodyinp)
 		formal = NULL;
 
 	if (bodyinp) 
-		SEE_lex_init(&lex, SEE_input_lookahead(bodyinp, 6));
+		SEE_lex_init(&lex, bodyinp);
 	else {
 		/* Set the lexer to EOF quickly */
 		lex.input = NULL;
@@ -3140,15 +3234,14 @@ SEE_parse_function(interp, name, paraminp, bodyinp)
 	parser->funcdepth--;
 	EXPECT_NOSKIP(tEND);
 
-	return SEE_function_make(interp, name, formal, 
-		make_body(interp, body, 0));
+	return function_make(interp, name, formal, body);
 }
 
 /*
  * Parses a Program. 
- * Does not close the input, but may consume up to 6 characters.
- * lookahead. This is not usually a problem, because the input is
- * always read to EOF on normal completion.
+ * Does not close the input, but may read up to a block of characters
+ * (LEX_BUFSZ) past the end of the program on error. This is not usually
+ * a problem, because the input is always read to EOF on normal completion.
  */
 struct function *
 SEE_parse_program(interp, inp)
@@ -3159,7 +3252,7 @@ SEE_parse_program(interp, inp)
 	struct parser localparse, *parser = &localparse;
 	struct function *f;
 
-	SEE_lex_init(&lex, SEE_input_lookahead(inp, 6));
+	SEE_lex_init(&lex, inp);
 	parser_init(parser, interp, &lex);
 	f = PARSE(Program);
 
@@ -3312,7 +3405,20 @@ _SEE_eval_input(context, thisobj, inp, res)
 	struct SEE_input *inp;
 	struct SEE_value *res;  /* optional */
 {
+	_SEE_eval_program(context, thisobj, 
+		SEE_parse_program(context->interpreter, inp), res);
+}
+
+/*
+ * Evaluates a parsed program, as eval() would.
+ */
+void
+_SEE_eval_program(context, thisobj, f, res)
+	struct SEE_context *context;
+	struct SEE_object *thisobj;
 	struct function *f;
+	struct SEE_value *res;  /* optional */
+{
 	struct SEE_context evalcontext;
 	struct SEE_interpreter *interp = context->interpreter;
         struct SEE_value ignore;
@@ -3342,8 +3448,6 @@ _SEE_eval_input(context, thisobj, inp, res)
 		evalcontext.scope->next = context->scope;
 		evalcontext.scope->obj = thisobj;
 	}
-	
-	f = SEE_parse_program(interp, inp);
 
 	/* Set formal params to undefined, if any exist -- redundant? */
 	SEE_function_put_args(context, f, 0, NULL);
@@ -10,6 +10,11 @@ struct SEE_context;
 struct SEE_input;
 struct function;
 
+/* A compiled program (see program.c) */
+struct SEE_program {
+	struct function *function;
+};
+
 struct function *SEE_parse_function(struct SEE_interpreter *i,
 	struct SEE_string *name, struct SEE_input *param_input, 
 	struct SEE_input *body_input);
@@ -31,4 +36,8 @@ void _SEE_eval_input(struct SEE_context *context,
         struct SEE_object *thisobj, struct SEE_input *inp,
         struct SEE_value *res);
 
+void _SEE_eval_program(struct SEE_context *context, 
+        struct SEE_object *thisobj, struct function *f,
+        struct SEE_value *res);
+
 #endif /* _SEE_h_parse_ */
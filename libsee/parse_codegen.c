@@ -34,6 +34,7 @@ struct code_varscope {
 	struct SEE_string *ident;
 	unsigned int id;
 	int in_scope;
+	int slot;		/* activation slot, or -1 for VREF */
 };
 
 struct code_context {
@@ -123,6 +124,9 @@ static unsigned int cg_var_id(struct code_context *, struct SEE_string *);
 static int cg_var_is_in_scope(struct code_context *, struct SEE_string *);
 static void cg_var_set_scope(struct code_context *, struct SEE_string *, int);
 static int cg_var_set_all_scope(struct code_context *, int);
+static void cg_var_set_slot(struct code_context *, struct SEE_string *, int);
+static int cg_var_slot(struct code_context *, struct SEE_string *);
+static int cg_lhs_slot(struct code_context *, struct node *);
 
 # define CODEGENFN(node) _SEE_nodeclass_codegen[(node)->nodeclass]
 # define CODEGEN(node)	do {				\
@@ -141,6 +145,8 @@ static int cg_var_set_all_scope(struct code_context *, int);
 # define CG_CALL(n)		_CG_OP1(CALL, n)
 # define CG_END(n)		_CG_OP1(END, n)
 # define CG_VREF(n)		_CG_OP1(VREF, n)
+# define CG_GETLOCAL(n)		_CG_OP1(GETLOCAL, n)	/*   - | val */
+# define CG_PUTLOCAL(n)		_CG_OP1(PUTLOCAL, n)	/* val | -   */
 
 /* Generic operators */
 # define _CG_OP0(name) \
@@ -158,6 +164,7 @@ static int cg_var_set_all_scope(struct code_context *, int);
 # define CG_ARRAY()		_CG_OP0(ARRAY)
 # define CG_REGEXP()		_CG_OP0(REGEXP)
 # define CG_REF()		_CG_OP0(REF)
+# define CG_EREF()		_CG_OP0(EREF)
 # define CG_GETVALUE()		_CG_OP0(GETVALUE)
 # define CG_LOOKUP()		_CG_OP0(LOOKUP)
 # define CG_PUTVALUE()		_CG_OP0(PUTVALUE)
@@ -474,6 +481,7 @@ cg_var_id(cc, ident)
 		    dprintf(") = %u\n", cc->varscope[i].id);
 		}
 #endif
+		SEE_ASSERT(cc->code->interpreter, cc->varscope[i].slot < 0);
 		return cc->varscope[i].id;
 	    }
 	SEE_ASSERT(cc->code->interpreter, !"bad cg var identifier");
@@ -541,6 +549,7 @@ cg_var_set_scope(cc, ident, in_scope)
 	    cc->varscope[i].id = 
 		(*cc->code->code_class->gen_var)(cc->code, ident);
 	    cc->varscope[i].in_scope = 1;
+	    cc->varscope[i].slot = -1;
 #ifndef NDEBUG
 	    if (SEE_parse_debug) {
 		dprintf("cg_var_set_scope(");
@@ -567,6 +576,65 @@ cg_var_set_all_scope(cc, in_scope)
 	return old_scope;
 }
 
+/*
+ * Binds an identifier to an activation slot. Slot variables are
+ * accessed with GETLOCAL/PUTLOCAL and never need a VREF.
+ */
+static void
+cg_var_set_slot(cc, ident, slot)
+	struct code_context *cc;
+	struct SEE_string *ident;
+	int slot;
+{
+	unsigned int i;
+
+	for (i = 0; i < cc->nvarscope; i++)
+	    if (cc->varscope[i].ident == ident)
+		break;
+	if (i == cc->nvarscope)
+	    SEE_GROW_TO(cc->code->interpreter, &cc->gvarscope,
+			cc->nvarscope + 1);
+	cc->varscope[i].ident = ident;
+	cc->varscope[i].id = ~0;
+	cc->varscope[i].in_scope = 1;
+	cc->varscope[i].slot = slot;
+#ifndef NDEBUG
+	if (SEE_parse_debug) {
+	    dprintf("cg_var_set_slot(");
+	    dprints(ident);
+	    dprintf(", %d)\n", slot);
+	}
+#endif
+}
+
+/* Returns the slot of an identifier in the immediate scope, or -1 */
+static int
+cg_var_slot(cc, ident)
+	struct code_context *cc;
+	struct SEE_string *ident;
+{
+	unsigned int i;
+
+	if (cc->in_var_scope)
+	    for (i = 0; i < cc->nvarscope; i++)
+		if (cc->varscope[i].ident == ident)
+		    return cc->varscope[i].in_scope 
+		    	? cc->varscope[i].slot : -1;
+	return -1;
+}
+
+/* Returns the slot of an lvalue expression if it is a slot identifier */
+static int
+cg_lhs_slot(cc, node)
+	struct code_context *cc;
+	struct node *node;
+{
+	if (node->nodeclass != NODECLASS_PrimaryExpression_ident)
+	    return -1;
+	return cg_var_slot(cc, 
+	    CAST_NODE(node, PrimaryExpression_ident)->string);
+}
+
 /* Returns a body suitable for use by eval_functionbody() */
 void *
 _SEE_codegen_make_body(interp, node, no_const)
@@ -658,6 +726,16 @@ PrimaryExpression_ident_codegen(na, cc)
 {
 	struct PrimaryExpression_ident_node *n = 
 		CAST_NODE(na, PrimaryExpression_ident);
+	int slot = cg_var_slot(cc, n->string);
+
+	/* Slot variables always exist, so their value can stand in
+	 * for the reference. Lvalue contexts use cg_lhs_slot() */
+	if (slot >= 0) {
+	    CG_GETLOCAL(slot);			/* val */
+	    n->node.is = CG_TYPE_VALUE;
+	    n->node.maxstack = 1;
+	    return;
+	}
 
 	if (cg_var_is_in_scope(cc, n->string)) 
 	    CG_VREF(cg_var_id(cc, n->string));	/* ref */
@@ -832,9 +910,12 @@ MemberExpression_bracket_codegen(na, cc)
 	    CG_TOOBJECT();	    /* val2 obj1 */
 	    CG_EXCH();		    /* obj1 val2 */
 	}
+	/* The element reference leaves converting the name to
+	 * a string until it is known that the name isn't an index */
 	if (!CG_IS_STRING(n->name))
-	    CG_TOSTRING();	    /* obj1 str2 */
-	CG_REF();		    /* ref */
+	    CG_EREF();		    /* ref */
+	else
+	    CG_REF();		    /* ref */
 
 	n->node.is = CG_TYPE_REFERENCE;
 	n->node.maxstack = MAX(n->mexp->maxstack, 1 + n->name->maxstack);
@@ -865,6 +946,19 @@ PostfixExpression_inc_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	int slot = cg_lhs_slot(cc, n->a);
+
+	if (slot >= 0) {
+	    CG_GETLOCAL(slot);	/* val */
+	    CG_TONUMBER();	/* num */
+	    CG_DUP();		/* num num */
+	    CG_NUMBER(1);	/* num num 1 */
+	    CG_ADD();		/* num num+1 */
+	    CG_PUTLOCAL(slot);	/* num */
+	    n->node.is = CG_TYPE_NUMBER;
+	    n->node.maxstack = 3;
+	    return;
+	}
 
 	CODEGEN(n->a);		/* ref */
 	CG_DUP();		/* ref ref */
@@ -926,6 +1020,19 @@ PostfixExpression_dec_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	int slot = cg_lhs_slot(cc, n->a);
+
+	if (slot >= 0) {
+	    CG_GETLOCAL(slot);	/* val */
+	    CG_TONUMBER();	/* num */
+	    CG_DUP();		/* num num */
+	    CG_NUMBER(1);	/* num num 1 */
+	    CG_SUB();		/* num num-1 */
+	    CG_PUTLOCAL(slot);	/* num */
+	    n->node.is = CG_TYPE_NUMBER;
+	    n->node.maxstack = 3;
+	    return;
+	}
 
 	CODEGEN(n->a);		/* aref */
 	CG_DUP();		/* aref aref */
@@ -951,6 +1058,13 @@ UnaryExpression_delete_codegen(na, cc)
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
 
+	if (cg_lhs_slot(cc, n->a) >= 0) {
+	    CG_FALSE();	/* bool */	/* vars are DontDelete */
+	    n->node.is = CG_TYPE_BOOLEAN;
+	    n->node.maxstack = 1;
+	    return;
+	}
+
 	CODEGEN(n->a);	/* ref */
 	CG_DELETE();	/* bool */
 
@@ -999,6 +1113,19 @@ UnaryExpression_preinc_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	int slot = cg_lhs_slot(cc, n->a);
+
+	if (slot >= 0) {
+	    CG_GETLOCAL(slot);	/* aval */
+	    CG_TONUMBER();	/* anum */
+	    CG_NUMBER(1);	/* anum 1 */
+	    CG_ADD();		/* anum+1 */
+	    CG_DUP();		/* anum+1 anum+1 */
+	    CG_PUTLOCAL(slot);	/* anum+1 */
+	    n->node.is = CG_TYPE_NUMBER;
+	    n->node.maxstack = 2;
+	    return;
+	}
 
 	/* Note: Makes no sense to check n->a is already a value */
 	CODEGEN(n->a);	/* aref */
@@ -1022,6 +1149,19 @@ UnaryExpression_predec_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct Unary_node *n = CAST_NODE(na, Unary);
+	int slot = cg_lhs_slot(cc, n->a);
+
+	if (slot >= 0) {
+	    CG_GETLOCAL(slot);	/* aval */
+	    CG_TONUMBER();	/* anum */
+	    CG_NUMBER(1);	/* anum 1 */
+	    CG_SUB();		/* anum-1 */
+	    CG_DUP();		/* anum-1 anum-1 */
+	    CG_PUTLOCAL(slot);	/* anum-1 */
+	    n->node.is = CG_TYPE_NUMBER;
+	    n->node.maxstack = 2;
+	    return;
+	}
 
 	/* Note: Makes no sense to check n->a is already a value */
 	CODEGEN(n->a);	/* aref */
@@ -1583,9 +1723,15 @@ AssignmentExpression_common_codegen_pre(n, cc)	/* - | ref num num */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
-	CODEGEN(n->lhs);	/* ref */
-	CG_DUP();		/* ref ref */
-	CG_GETVALUE();		/* ref val */
+	int slot = cg_lhs_slot(cc, n->lhs);
+
+	if (slot >= 0)
+	    CG_GETLOCAL(slot);	/* val */
+	else {
+	    CODEGEN(n->lhs);	/* ref */
+	    CG_DUP();		/* ref ref */
+	    CG_GETVALUE();	/* ref val */
+	}
 	CG_TONUMBER();		/* ref num */
 	CODEGEN(n->expr);	/* ref num ref */
 	if (!CG_IS_VALUE(n->expr))
@@ -1599,9 +1745,15 @@ AssignmentExpression_common_codegen_shiftpre(n, cc)	/* - | ref val val */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
-	CODEGEN(n->lhs);	/* ref */
-	CG_DUP();		/* ref ref */
-	CG_GETVALUE();		/* ref val */
+	int slot = cg_lhs_slot(cc, n->lhs);
+
+	if (slot >= 0)
+	    CG_GETLOCAL(slot);	/* val */
+	else {
+	    CODEGEN(n->lhs);	/* ref */
+	    CG_DUP();		/* ref ref */
+	    CG_GETVALUE();	/* ref val */
+	}
 	CODEGEN(n->expr);	/* ref num ref */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref num val */
@@ -1612,6 +1764,16 @@ AssignmentExpression_common_codegen_post(n, cc) /* ref val | val */
 	struct AssignmentExpression_node *n;
 	struct code_context *cc;
 {
+	int slot = cg_lhs_slot(cc, n->lhs);
+
+	/* Slot variables have no ref on the stack */
+	if (slot >= 0) {
+	    CG_DUP();		/* val val */
+	    CG_PUTLOCAL(slot);	/* val */
+	    n->node.maxstack = 2 + n->expr->maxstack;
+	    return;
+	}
+
 	CG_DUP();		/* ref val val */
 	CG_ROLL3();   		/* val ref val */
 	CG_PUTVALUE();		/* val */
@@ -1660,7 +1822,8 @@ AssignmentExpression_simple_codegen(na, cc)
 	struct AssignmentExpression_node *n = 
 		CAST_NODE(na, AssignmentExpression);
 
-	CODEGEN(n->lhs);	/* ref */
+	if (cg_lhs_slot(cc, n->lhs) < 0)
+	    CODEGEN(n->lhs);	/* ref */
 	CODEGEN(n->expr);	/* ref ref */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref val */
@@ -1721,10 +1884,15 @@ AssignmentExpression_addeq_codegen(na, cc)
 {
 	struct AssignmentExpression_node *n = 
 		CAST_NODE(na, AssignmentExpression);
+	int slot = cg_lhs_slot(cc, n->lhs);
 
-	CODEGEN(n->lhs);	/* ref1 */
-	CG_DUP();		/* ref1 ref1 */
-	CG_GETVALUE();		/* ref1 val1 */
+	if (slot >= 0)
+	    CG_GETLOCAL(slot);	/* val1 */
+	else {
+	    CODEGEN(n->lhs);	/* ref1 */
+	    CG_DUP();		/* ref1 ref1 */
+	    CG_GETVALUE();	/* ref1 val1 */
+	}
 	CODEGEN(n->expr);	/* ref1 val1 ref2 */
 	if (!CG_IS_VALUE(n->expr))
 	    CG_GETVALUE();	/* ref1 val1 val2 */
@@ -1926,7 +2094,14 @@ VariableDeclaration_codegen(na, cc)
 {
 	struct VariableDeclaration_node *n = 
 		CAST_NODE(na, VariableDeclaration);
-	if (n->init) {
+	int slot = cg_var_slot(cc, n->var->name);
+
+	if (n->init && slot >= 0) {
+		CODEGEN(n->init);			    /* ref */
+		if (!CG_IS_VALUE(n->init))
+		    CG_GETVALUE();			    /* val */
+		CG_PUTLOCAL(slot);			    /* - */
+	} else if (n->init) {
 		if (cg_var_is_in_scope(cc, n->var->name)) 
 		    CG_VREF(cg_var_id(cc, n->var->name));    /* ref */
 		else {
@@ -2166,6 +2341,7 @@ IterationStatement_forin_codegen(na, cc)
 		CAST_NODE(na, IterationStatement_forin);
 	SEE_code_patchable_t P1;
 	SEE_code_addr_t L1, L2, L3;
+	int slot;
 
 	CG_LOC(&na->location);
 	CODEGEN(n->list);		/* ref */
@@ -2182,9 +2358,14 @@ IterationStatement_forin_codegen(na, cc)
 	CG_B_ALWAYS_f(P1);
 
     L1 = CG_HERE();
-	CODEGEN(n->lhs);		/* str ref */
-	CG_EXCH();			/* ref str */
-	CG_PUTVALUE();			/* - */
+	slot = cg_lhs_slot(cc, n->lhs);
+	if (slot >= 0)
+	    CG_PUTLOCAL(slot);		/* - */
+	else {
+	    CODEGEN(n->lhs);		/* str ref */
+	    CG_EXCH();			/* ref str */
+	    CG_PUTVALUE();		/* - */
+	}
 
 	CODEGEN(n->body);
 
@@ -2217,6 +2398,7 @@ IterationStatement_forvarin_codegen(na, cc)
 		= CAST_NODE(n->lhs, VariableDeclaration);
 	SEE_code_patchable_t P1;
 	SEE_code_addr_t L1, L2, L3;
+	int slot;
 
 	CG_LOC(&na->location);
 	CODEGEN(n->lhs);		/* - */
@@ -2234,14 +2416,19 @@ IterationStatement_forvarin_codegen(na, cc)
 	CG_B_ALWAYS_f(P1);
 
     L1 = CG_HERE();
-	if (cg_var_is_in_scope(cc, lhs->var->name)) 
-	    CG_VREF(cg_var_id(cc, lhs->var->name));    /* ref */
+	slot = cg_var_slot(cc, lhs->var->name);
+	if (slot >= 0)
+	    CG_PUTLOCAL(slot);		/* - */
 	else {
-	    CG_STRING(lhs->var->name);		    /* str */
-	    CG_LOOKUP();			    /* ref */
+	    if (cg_var_is_in_scope(cc, lhs->var->name)) 
+		CG_VREF(cg_var_id(cc, lhs->var->name));    /* ref */
+	    else {
+		CG_STRING(lhs->var->name);		    /* str */
+		CG_LOOKUP();			    	    /* ref */
+	    }
+	    CG_EXCH();			/* ref str */
+	    CG_PUTVALUE();		/* - */
 	}
-	CG_EXCH();			/* ref str */
-	CG_PUTVALUE();			/* - */
 
 	CODEGEN(n->body);
 
@@ -2639,6 +2826,13 @@ FunctionBody_codegen(na, cc)
 	struct code_context *cc;
 {
 	struct FunctionBody_node *n = CAST_NODE(na, FunctionBody);
+	int i;
+
+	/* Bind the activation slots (see parse.c:FunctionBody_set_slots) */
+	for (i = 0; i < n->nlocals; i++)
+	    cg_var_set_slot(cc, n->locals[i], i);
+	for (i = 0; i < n->nparams; i++)
+	    cg_var_set_slot(cc, n->params[i], n->nlocals + i);
 
 	/* Note that SourceElements_codegen includes the fproc action */
 	CODEGEN(n->u.a);	/* - */
@@ -2664,6 +2858,7 @@ SourceElements_codegen(na, cc)
 	struct SourceElement *e;
 	struct var *v;
 	struct Function_node *fn;
+	int slot;
 
 	/* SourceElements fproc:
 	 * - create function closures of the current scope
@@ -2673,9 +2868,15 @@ SourceElements_codegen(na, cc)
 	for (e = n->functions; e; e = e->next) {
 	    fn = CAST_NODE(e->node, Function);
 	    cg_var_set_scope(cc, fn->function->name, 1);
-	    CG_VREF(cg_var_id(cc, fn->function->name)); /* ref */
-	    CG_FUNC(fn->function);		        /* ref obj */
-	    CG_PUTVALUE();			        /* - */
+	    slot = cg_var_slot(cc, fn->function->name);
+	    if (slot >= 0) {
+		CG_FUNC(fn->function);		        /* obj */
+		CG_PUTLOCAL(slot);		        /* - */
+	    } else {
+		CG_VREF(cg_var_id(cc, fn->function->name)); /* ref */
+		CG_FUNC(fn->function);		        /* ref obj */
+		CG_PUTVALUE();			        /* - */
+	    }
 	    maxstack = MAX(maxstack, 2);
 	}
 
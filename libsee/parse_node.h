@@ -287,6 +287,10 @@ struct Function_node {
 struct FunctionBody_node {
 	struct Unary_node u;
 	int is_program;
+	/* Identifiers resolved to activation slots. The locals
+	 * occupy slots 0..nlocals-1, the params follow them. */
+	int nparams, nlocals;
+	struct SEE_string **params, **locals;
 };
 
 struct SourceElements_node {
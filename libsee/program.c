@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2009
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Compiled programs, and their serialised form.
+ *
+ * A saved program starts with a header that identifies the format
+ * and the library that wrote it, followed by the function as
+ * serialised by the code generator. A program is only loaded by a
+ * library with the same version and feature set, on the same kind
+ * of host, and only if the payload hashes to the value in the
+ * header. Otherwise SEE_program_load() returns NULL and the caller
+ * is expected to compile the source again.
+ *
+ *	offset	size	content
+ *	0	4	"SEEp"
+ *	4	4	format version
+ *	8	4	hash of SEE_version() and the host's value layout
+ *	12	4	payload length
+ *	16	4	payload hash
+ *	20	-	payload
+ *
+ * Header integers are little-endian.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#if STDC_HEADERS
+# include <stdio.h>
+#endif
+
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include <see/mem.h>
+#include <see/type.h>
+#include <see/string.h>
+#include <see/value.h>
+#include <see/error.h>
+#include <see/interpreter.h>
+#include <see/eval.h>
+#include <see/version.h>
+
+#include "stringdefs.h"
+#include "parse.h"
+#include "code.h"
+
+#define PROGRAM_MAGIC		"SEEp"
+#define PROGRAM_FORMAT		1
+#define PROGRAM_HEADER_SIZE	20
+
+/* Compatibility flags that change how source text is read and parsed */
+#define PROGRAM_COMPAT_MASK	(SEE_COMPAT_UTF_UNSAFE | SEE_COMPAT_SGMLCOM | \
+				 SEE_COMPAT_JS_MASK)
+
+static SEE_uint32_t hash_bytes(SEE_uint32_t, const void *, SEE_size_t);
+static SEE_uint32_t host_hash(struct SEE_interpreter *);
+static void put_u32(unsigned char *, SEE_uint32_t);
+static SEE_uint32_t get_u32(const unsigned char *);
+
+/* FNV-1a, continuing from h */
+static SEE_uint32_t
+hash_bytes(h, p, len)
+	SEE_uint32_t h;
+	const void *p;
+	SEE_size_t len;
+{
+	const unsigned char *b = (const unsigned char *)p;
+
+	while (len--)
+		h = SEE_STRING_HASH_STEP(h, *b++);
+	return h;
+}
+
+/*
+ * Identifies the library build, the host's byte order and sizes, and
+ * the interpreter's compatibility flags that affect parsing
+ */
+static SEE_uint32_t
+host_hash(interp)
+	struct SEE_interpreter *interp;
+{
+	const char *version = SEE_version();
+	SEE_number_t one = 1.0;
+	SEE_int32_t order = 0x01020304;
+	unsigned char sizes[3];
+	SEE_uint32_t h, compat;
+
+	sizes[0] = sizeof (SEE_number_t);
+	sizes[1] = sizeof (SEE_int32_t);
+	sizes[2] = sizeof (SEE_char_t);
+	h = hash_bytes(SEE_STRING_HASH_INIT, version, strlen(version));
+	h = hash_bytes(h, sizes, sizeof sizes);
+	h = hash_bytes(h, &one, sizeof one);
+	h = hash_bytes(h, &order, sizeof order);
+	compat = interp->compatibility & PROGRAM_COMPAT_MASK;
+	h = hash_bytes(h, &compat, sizeof compat);
+	return h;
+}
+
+static void
+put_u32(p, n)
+	unsigned char *p;
+	SEE_uint32_t n;
+{
+	p[0] = n & 0xff;
+	p[1] = (n >> 8) & 0xff;
+	p[2] = (n >> 16) & 0xff;
+	p[3] = (n >> 24) & 0xff;
+}
+
+static SEE_uint32_t
+get_u32(p)
+	const unsigned char *p;
+{
+	return (SEE_uint32_t)p[0] | ((SEE_uint32_t)p[1] << 8) |
+	       ((SEE_uint32_t)p[2] << 16) | ((SEE_uint32_t)p[3] << 24);
+}
+
+/*
+ * Parses and compiles the program text from input, without running
+ * it. Does not close the input. Throws a SyntaxError like SEE_eval().
+ */
+struct SEE_program *
+SEE_program_compile(interp, inp)
+	struct SEE_interpreter *interp;
+	struct SEE_input *inp;
+{
+	struct SEE_program *program;
+
+	program = SEE_NEW(interp, struct SEE_program);
+	program->function = SEE_parse_program(interp, inp);
+	return program;
+}
+
+/*
+ * Serialises a compiled program. The returned buffer is allocated
+ * with SEE_malloc_string() and its size is stored in *lenp.
+ * Throws an Error if the program cannot be saved.
+ */
+void *
+SEE_program_save(interp, program, lenp)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+	SEE_size_t *lenp;
+{
+#if WITH_PARSER_CODEGEN
+	unsigned char *payload, *buf;
+	unsigned int len;
+
+	_SEE_code1_save(interp, program->function, &payload, &len);
+	buf = SEE_NEW_STRING_ARRAY(interp, unsigned char, 
+		PROGRAM_HEADER_SIZE + len);
+	memcpy(buf, PROGRAM_MAGIC, 4);
+	put_u32(buf + 4, PROGRAM_FORMAT);
+	put_u32(buf + 8, host_hash(interp));
+	put_u32(buf + 12, len);
+	put_u32(buf + 16, hash_bytes(SEE_STRING_HASH_INIT, payload, len));
+	memcpy(buf + PROGRAM_HEADER_SIZE, payload, len);
+	SEE_free(interp, (void **)&payload);
+	*lenp = PROGRAM_HEADER_SIZE + len;
+	return buf;
+#else
+	SEE_error_throw_string(interp, interp->Error,
+		STR(program_not_saveable));
+	return NULL;
+#endif
+}
+
+/*
+ * Rebuilds a program saved by SEE_program_save(). Returns NULL if the
+ * data is damaged, or was saved by a different library or host, or by
+ * an interpreter whose compatibility flags parse source differently.
+ */
+struct SEE_program *
+SEE_program_load(interp, data, len)
+	struct SEE_interpreter *interp;
+	const void *data;
+	SEE_size_t len;
+{
+#if WITH_PARSER_CODEGEN
+	const unsigned char *buf = (const unsigned char *)data;
+	struct SEE_program *program;
+	struct function *f;
+	SEE_uint32_t plen;
+
+	if (len < PROGRAM_HEADER_SIZE ||
+	    memcmp(buf, PROGRAM_MAGIC, 4) != 0 ||
+	    get_u32(buf + 4) != PROGRAM_FORMAT ||
+	    get_u32(buf + 8) != host_hash(interp))
+		return NULL;
+	plen = get_u32(buf + 12);
+	if (plen != len - PROGRAM_HEADER_SIZE ||
+	    get_u32(buf + 16) != hash_bytes(SEE_STRING_HASH_INIT, 
+		buf + PROGRAM_HEADER_SIZE, plen))
+		return NULL;
+	f = _SEE_code1_load(interp, buf + PROGRAM_HEADER_SIZE, plen);
+	if (!f)
+		return NULL;
+	program = SEE_NEW(interp, struct SEE_program);
+	program->function = f;
+	return program;
+#else
+	return NULL;
+#endif
+}
+
+/*
+ * Writes a compiled program to a stdio file.
+ * Returns 0 on success, or -1 if the file could not be written.
+ */
+int
+SEE_program_save_file(interp, program, f)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+	FILE *f;
+{
+	void *buf;
+	SEE_size_t len;
+	int ok;
+
+	buf = SEE_program_save(interp, program, &len);
+	ok = fwrite(buf, 1, len, f) == len;
+	SEE_free(interp, &buf);
+	return ok ? 0 : -1;
+}
+
+/*
+ * Reads a program written by SEE_program_save_file(), from the
+ * current position to the end of the file. Returns NULL if the file 
+ * could not be read or does not hold a program this library can load.
+ */
+struct SEE_program *
+SEE_program_load_file(interp, f)
+	struct SEE_interpreter *interp;
+	FILE *f;
+{
+	struct SEE_program *program;
+	unsigned char *buf;
+	unsigned int len;
+	struct SEE_growable grow;
+	size_t n;
+
+	SEE_GROW_INIT(interp, &grow, buf, len);
+	grow.is_string = 1;
+	do {
+		n = len;
+		SEE_grow_to(interp, &grow, n + BUFSIZ);
+		len = n + fread(buf + n, 1, BUFSIZ, f);
+	} while (len == n + BUFSIZ);
+	if (ferror(f)) {
+		SEE_free(interp, (void **)&buf);
+		return NULL;
+	}
+	program = SEE_program_load(interp, buf, len);
+	SEE_free(interp, (void **)&buf);
+	return program;
+}
@@ -5,12 +5,148 @@
 #include <string.h>
 #include <see/system.h>
 #include <see/error.h>
+#include <see/mem.h>
+#include <see/string.h>
+#include <see/interpreter.h>
 #include "regex.h"
+#include "clone.h"
 
 #if WITH_PCRE
 extern const struct SEE_regex_engine _SEE_pcre_regex_engine;
 #endif
 
+/*
+ * Each interpreter keeps the regexes it compiled most recently, so that
+ * a pattern is not parsed again each time a regex literal is evaluated
+ * or a string is used as a pattern. Matching does not change a compiled
+ * regex, so one can be shared by many RegExp objects. The cache holds
+ * SEE_system.regex_cache_size entries, discarding the least recently
+ * used when full.
+ */
+
+#define REGEX_CACHE_HASHSZ	64
+
+struct regex_cache_entry {
+	struct regex_cache_entry *hnext;	/* hash chain */
+	struct regex_cache_entry *prev, *next;	/* most recent first */
+	unsigned int hash;
+	const struct SEE_regex_engine *engine;
+	struct SEE_string *pattern;
+	int flags;
+	struct regex *regex;
+};
+
+struct regex_cache {
+	struct regex_cache_entry *tab[REGEX_CACHE_HASHSZ];
+	struct regex_cache_entry *first, *last;
+	unsigned int count;
+	unsigned long hits, misses;
+};
+
+static struct regex_cache *regex_cache(struct SEE_interpreter *);
+static unsigned int regex_cache_hash(struct SEE_string *, int);
+static void regex_cache_remove(struct regex_cache *, 
+	struct regex_cache_entry *);
+static void regex_cache_push(struct regex_cache *, 
+	struct regex_cache_entry *);
+static void regex_cache_insert(struct SEE_interpreter *, 
+	struct regex_cache *, const struct SEE_regex_engine *, 
+	struct SEE_string *, int, unsigned int, struct regex *);
+
+/* Returns the interpreter's regex cache, creating it if needed */
+static struct regex_cache *
+regex_cache(interp)
+	struct SEE_interpreter *interp;
+{
+	struct regex_cache *cache;
+
+	if (!interp->regex_cache) {
+	    cache = SEE_NEW(interp, struct regex_cache);
+	    memset(cache, 0, sizeof *cache);
+	    interp->regex_cache = cache;
+	}
+	return (struct regex_cache *)interp->regex_cache;
+}
+
+static unsigned int
+regex_cache_hash(pattern, flags)
+	struct SEE_string *pattern;
+	int flags;
+{
+	unsigned int i, h = flags;
+
+	for (i = 0; i < pattern->length; i++)
+	    h = h * 31 + pattern->data[i];
+	return h;
+}
+
+/* Takes an entry off the recently used list */
+static void
+regex_cache_remove(cache, e)
+	struct regex_cache *cache;
+	struct regex_cache_entry *e;
+{
+	if (e->prev)
+	    e->prev->next = e->next;
+	else
+	    cache->first = e->next;
+	if (e->next)
+	    e->next->prev = e->prev;
+	else
+	    cache->last = e->prev;
+}
+
+/* Puts an entry at the front of the recently used list */
+static void
+regex_cache_push(cache, e)
+	struct regex_cache *cache;
+	struct regex_cache_entry *e;
+{
+	e->prev = NULL;
+	e->next = cache->first;
+	if (cache->first)
+	    cache->first->prev = e;
+	else
+	    cache->last = e;
+	cache->first = e;
+}
+
+/* Adds a compiled regex as the most recently used entry */
+static void
+regex_cache_insert(interp, cache, engine, pattern, flags, hash, regex)
+	struct SEE_interpreter *interp;
+	struct regex_cache *cache;
+	const struct SEE_regex_engine *engine;
+	struct SEE_string *pattern;
+	int flags;
+	unsigned int hash;
+	struct regex *regex;
+{
+	struct regex_cache_entry *e = NULL, **ep;
+
+	/* Discard the least recently used entries, reusing one */
+	while (cache->count && cache->count >= SEE_system.regex_cache_size) {
+	    e = cache->last;
+	    regex_cache_remove(cache, e);
+	    for (ep = &cache->tab[e->hash % REGEX_CACHE_HASHSZ]; *ep != e;
+		 ep = &(*ep)->hnext)
+		;
+	    *ep = e->hnext;
+	    cache->count--;
+	}
+	if (!e)
+	    e = SEE_NEW(interp, struct regex_cache_entry);
+	cache->count++;
+	e->hash = hash;
+	e->engine = engine;
+	e->pattern = pattern;
+	e->flags = flags;
+	e->regex = regex;
+	e->hnext = cache->tab[hash % REGEX_CACHE_HASHSZ];
+	cache->tab[hash % REGEX_CACHE_HASHSZ] = e;
+	regex_cache_push(cache, e);
+}
+
 /* Parses a source pattern and returns a regex structure for later use */
 struct regex *
 SEE_regex_parse(interp, pattern, flags)
@@ -18,8 +154,73 @@ SEE_regex_parse(interp, pattern, flags)
 	struct SEE_string *pattern;
 	int flags;
 {
-	SEE_ASSERT(interp, interp->regex_engine != NULL);
-	return (*interp->regex_engine->parse)(interp, pattern, flags);
+	const struct SEE_regex_engine *engine = interp->regex_engine;
+	struct regex_cache *cache;
+	struct regex_cache_entry *e;
+	struct regex *regex;
+	unsigned int hash;
+
+	SEE_ASSERT(interp, engine != NULL);
+	if (SEE_system.regex_cache_size == 0)
+	    return (*engine->parse)(interp, pattern, flags);
+
+	cache = regex_cache(interp);
+	hash = regex_cache_hash(pattern, flags);
+	for (e = cache->tab[hash % REGEX_CACHE_HASHSZ]; e; e = e->hnext)
+	    if (e->hash == hash && e->engine == engine && 
+	        e->flags == flags && SEE_string_cmp(e->pattern, pattern) == 0)
+	    {
+		cache->hits++;
+		if (e != cache->first) {
+		    regex_cache_remove(cache, e);
+		    regex_cache_push(cache, e);
+		}
+		return e->regex;
+	    }
+
+	cache->misses++;
+	regex = (*engine->parse)(interp, pattern, flags);
+	regex_cache_insert(interp, cache, engine, 
+	    SEE_string_dup(interp, pattern), flags, hash, regex);
+	return regex;
+}
+
+/*
+ * Reports how many times SEE_regex_parse() found the pattern in the
+ * interpreter's cache, and how many times it had to compile it.
+ */
+void
+SEE_regex_cache_stats(interp, hitsp, missesp)
+	struct SEE_interpreter *interp;
+	unsigned long *hitsp, *missesp;
+{
+	struct regex_cache *cache = regex_cache(interp);
+
+	if (hitsp)
+	    *hitsp = cache->hits;
+	if (missesp)
+	    *missesp = cache->misses;
+}
+
+/*
+ * Gives a copied interpreter the original's cached regexes, so that it
+ * need not compile them again. The counters start again from zero.
+ */
+void
+_SEE_regex_cache_clone(interp, orig)
+	struct SEE_interpreter *interp, *orig;
+{
+	struct regex_cache *ocache = (struct regex_cache *)orig->regex_cache;
+	struct regex_cache *cache;
+	struct regex_cache_entry *e;
+
+	interp->regex_cache = NULL;
+	if (!ocache || SEE_system.regex_cache_size == 0)
+	    return;
+	cache = regex_cache(interp);
+	for (e = ocache->last; e; e = e->prev)
+	    regex_cache_insert(interp, cache, e->engine, e->pattern,
+	    	e->flags, e->hash, e->regex);
 }
 
 /* Returns the number of capture parentheses in the compiled regex */
@@ -53,6 +254,27 @@ SEE_regex_match(interp, regex, text, start, captures)
 	return (*regex->engine->match)(interp, regex, text, start, captures);
 }
 
+/*
+ * Finds the leftmost match of the regex in the text that begins at or
+ * after index start. Returns true if one was found.
+ */
+int
+SEE_regex_search(interp, regex, text, start, captures)
+	struct SEE_interpreter *interp;
+	struct regex *regex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *captures;
+{
+	if (regex->engine->search)
+	    return (*regex->engine->search)(interp, regex, text, start, 
+	    	captures);
+	for (; start <= text->length; start++)
+	    if ((*regex->engine->match)(interp, regex, text, start, captures))
+		return 1;
+	return 0;
+}
+
 /* 
  * NOTE: Keep regex_name_list[] and regex_engine_list[] in sync!
  */
@@ -60,6 +282,7 @@ SEE_regex_match(interp, regex, text, start, captures)
 /* List of known regex engine names */
 static const char *regex_name_list[] = {
 	"ecma",
+	"nfa",
 #if WITH_PCRE
 	"pcre",
 #endif
@@ -69,6 +292,7 @@ static const char *regex_name_list[] = {
 /* List of known regex engines */
 static const struct SEE_regex_engine *regex_engine_list[] = {
 	&_SEE_ecma_regex_engine,
+	&_SEE_nfa_regex_engine,
 #if WITH_PCRE
 	&_SEE_pcre_regex_engine,
 #endif
@@ -30,9 +30,14 @@ struct SEE_regex_engine {
     int (*match)(struct SEE_interpreter *interp, 
 	    struct regex *regex, struct SEE_string *text, 
 	    unsigned int start, struct capture *captures);
+    /* Optional: finds the leftmost match at or after start */
+    int (*search)(struct SEE_interpreter *interp, 
+	    struct regex *regex, struct SEE_string *text, 
+	    unsigned int start, struct capture *captures);
 };
 
 extern const struct SEE_regex_engine _SEE_ecma_regex_engine;
+extern const struct SEE_regex_engine _SEE_nfa_regex_engine;
 
 /* Normal interface to regex operations */
 struct regex *SEE_regex_parse(struct SEE_interpreter *interp,
@@ -42,6 +47,9 @@ int SEE_regex_get_flags(struct regex *regex);
 int SEE_regex_match(struct SEE_interpreter *interp,
 	struct regex *regex, struct SEE_string *text,
 	unsigned int start, struct capture *captures);
+int SEE_regex_search(struct SEE_interpreter *interp,
+	struct regex *regex, struct SEE_string *text,
+	unsigned int start, struct capture *captures);
 
 void SEE_regex_init(void);
 
@@ -50,6 +58,9 @@ int SEE_is_RegExp(struct SEE_object *regexp);
 int SEE_RegExp_match(struct SEE_interpreter *interp, 
 	struct SEE_object *regexp, struct SEE_string *text, 
 	unsigned int start, struct capture *captures);
+int SEE_RegExp_search(struct SEE_interpreter *interp, 
+	struct SEE_object *regexp, struct SEE_string *text, 
+	unsigned int start, struct capture *captures);
 int SEE_RegExp_count_captures(struct SEE_interpreter *interp,
 	struct SEE_object *regexp);
 
@@ -49,6 +49,7 @@
 #include <see/system.h>
 
 #include "regex.h"
+#include "regex_ecma.h"
 #include "unicode.h"
 #include "stringdefs.h"
 #include "dprint.h"
@@ -75,61 +76,42 @@
 int SEE_regex_debug = 0;
 #endif
 
-#define	OP_FAIL		 0		/* match failed */
-#define	OP_SUCCEED	 1		/* match succeeded */
-#define	OP_CHAR		 2		/* match a char class instance */
-#define	OP_ZERO		 3		/* reset counter */
-#define	OP_REACH	 4		/* test counter over */
-#define	OP_NREACH	 5		/* test counter under */
-#define	OP_START	 6		/* enter a group */
-#define	OP_END		 7		/* exit a group */
-#define	OP_UNDEF	 8		/* reset a group */
-#define	OP_MARK		 9		/* record a position */
-#define	OP_FDIST	10		/* position test */
-#define	OP_RDIST	11		/* position and counter test */
-#define	OP_MNEXT	12		/* max-loop */
-#define	OP_RNEXT	13		/* reach-loop */
-#define	OP_GOTO		14		/* branch */
-#define	OP_GS		15		/* greedy success */
-#define	OP_NS		16		/* non-greedy success */
-#define	OP_GF		17		/* greedy fail */
-#define	OP_NF		18		/* non-greedy fail */
-#define	OP_AS		19		/* assert success */
-#define	OP_AF		20		/* assert fail */
-#define	OP_BOL		21		/* test beginning of line */
-#define	OP_EOL		22		/* test end of line */
-#define	OP_BRK		23		/* test word-break */
-#define	OP_NBRK		24		/* test non-word-break */
-#define	OP_BACKREF	25		/* backreference match */
-
-struct charclassrange {
-	struct charclassrange *next;
-	SEE_unicode_t lo, hi;		/* simple range of chars, eg [a-z] */
+#define OPTIMIZE_MAXCODE 4096		/* don't analyse longer p-code */
+#define LITERAL_MAX	64		/* longest literal kept */
+
+struct recontext {
+	struct SEE_interpreter *interpreter;
+	struct SEE_input       *input;
+	struct ecma_regex      *regex;
 };
 
-struct charclass {
-	struct charclassrange *ranges;	/* linked list of character ranges */
+/* An entry on the backtrack stack of a match (see pcode_run) */
+struct backtrack {
+	unsigned char op;		/* OP_GF/OP_NF, or an assertion op */
+	unsigned int addr;		/* p-code address to resume at */
+	unsigned int pos;		/* text index to resume at */
+	unsigned int undo;		/* undo log length to roll back to */
+	int frame;			/* enclosing assertion entry, or -1 */
 };
 
-struct ecma_regex {
-	struct regex		regex;
-	int			ncaptures, ncounters, nmarks, maxref;
-	int			statesz;
-	unsigned char	       *code;
-	unsigned int		codelen;
-	struct SEE_growable	codegrow;
-	struct charclass      **cc;
-	unsigned int		cclen;
-	struct SEE_growable	ccgrow;
-	int			flags;
+/* The old value of a state slot, recorded before it was changed */
+struct undo {
+	int *slot;
+	int value;
 };
 
-#define REGEX_CAST(aregex)   ((struct ecma_regex *)(aregex))
+#define MATCHER_LOCAL	32		/* entries preallocated per stack */
 
-struct recontext {
-	struct SEE_interpreter *interpreter;
-	struct SEE_input       *input;
-	struct ecma_regex      *regex;
+/* Backtracking state of a match in progress */
+struct matcher {
+	struct SEE_interpreter *interp;
+	struct backtrack *bt;		/* backtrack stack */
+	unsigned int nbt, btalloc;
+	int frame;			/* innermost assertion entry, or -1 */
+	struct undo *undo;		/* undo log */
+	unsigned int nundo, undoalloc;
+	struct backtrack btlocal[MATCHER_LOCAL];
+	struct undo undolocal[MATCHER_LOCAL];
 };
 
 #define NEW1(t)			SEE_NEW(recontext->interpreter, t)
@@ -162,11 +144,6 @@ struct recontext {
     do { CODE_PATCH(pos, ((i) >> 8) & 0xff); 			\
 	 CODE_PATCH((pos)+1, (i) & 0xff); } while (0)
 #define CODE_PATCHA(addr, i)	CODE_PATCHI(addr, RELADDR(addr, i))
-#define CODE_SZA	2
-#define CODE_SZI	2
-
-#define CODE_MAKEI(code, addr)  ((code[addr] << 8) | code[(addr)+1])
-#define CODE_MAKEA(code, addr)  ((CODE_MAKEI(code, addr) + (addr)) & 0xffff)
 
 #define CC_NEW()                cc_new(recontext)
 #define CC_ADDRANGE(cc, l, h)   cc_add_range(recontext, cc, l, (h)+1)
@@ -190,7 +167,6 @@ static int cc_issingle(struct charclass *);
 static SEE_uint32_t cc_count(struct charclass *);
 static int cc_cmp(struct charclass *, struct charclass *);
 static int cc_intern(struct recontext *, struct charclass *);
-static int cc_contains(struct charclass *, SEE_unicode_t);
 static struct ecma_regex *regex_new(struct recontext *);
 static void code_add(struct recontext *, int);
 static void code_insert(struct recontext *, int, int);
@@ -216,8 +192,23 @@ static void dprint_regex(struct ecma_regex *);
 #endif
 
 static SEE_unicode_t Canonicalize(struct ecma_regex *, SEE_unicode_t);
+static void *matcher_grow(struct SEE_interpreter *, void *, unsigned int *,
+	SEE_size_t, void *);
+static void matcher_undo(struct matcher *, unsigned int);
+static void matcher_push(struct matcher *, unsigned char, unsigned int,
+	unsigned int);
 static SEE_boolean_t pcode_run(struct SEE_interpreter *, struct ecma_regex *, 
-        unsigned int, struct SEE_string *, char *);
+        unsigned int, struct SEE_string *, char *, struct matcher *);
+static int pcode_succ(struct ecma_regex *, unsigned int, unsigned int *);
+static int walk_first(struct SEE_interpreter *, struct ecma_regex *, int,
+	unsigned char *);
+static int pcode_dominates(struct SEE_interpreter *, struct ecma_regex *,
+	unsigned int);
+static int pcode_literal_char(struct ecma_regex *, unsigned int);
+static unsigned int pcode_literal_run(struct ecma_regex *, unsigned int,
+	SEE_char_t *, unsigned int);
+static void set_literal(struct SEE_interpreter *, struct ecma_regex *,
+	SEE_char_t *, unsigned int, int);
 static void optimize_regex(struct SEE_interpreter *, struct ecma_regex *);
 
 /*------------------------------------------------------------
@@ -383,8 +374,8 @@ cc_intern(recontext, c)
 }
 
 /* Return true if charclass c contains character ch */
-static int
-cc_contains(c, ch)
+int
+_SEE_ecma_cc_contains(c, ch)
 	struct charclass *c;
 	SEE_unicode_t ch;
 {
@@ -1394,23 +1385,97 @@ Canonicalize(regex, ch)
 		return ch;
 }
 
+/*
+ * Grows one of a matcher's stacks to twice its size. The first
+ * allocation of each stack is local to ecma_regex_match(), and is
+ * not freed here.
+ */
+static void *
+matcher_grow(interp, data, alloc, elsize, local)
+	struct SEE_interpreter *interp;
+	void *data;
+	unsigned int *alloc;
+	SEE_size_t elsize;
+	void *local;
+{
+	void *newdata;
+
+	newdata = SEE_malloc_string(interp, 2 * *alloc * elsize);
+	memcpy(newdata, data, *alloc * elsize);
+	if (data != local)
+		SEE_free(interp, (void **)&data);
+	*alloc *= 2;
+	return newdata;
+}
+
+/* Rolls back the state changes made since the undo log had length n */
+static void
+matcher_undo(m, n)
+	struct matcher *m;
+	unsigned int n;
+{
+	while (m->nundo > n) {
+		m->nundo--;
+		*m->undo[m->nundo].slot = m->undo[m->nundo].value;
+	}
+}
+
+/* Pushes an entry onto the backtrack stack */
+static void
+matcher_push(m, op, addr, index)
+	struct matcher *m;
+	unsigned char op;
+	unsigned int addr, index;
+{
+	struct backtrack *b;
+
+	if (m->nbt == m->btalloc)
+		m->bt = (struct backtrack *)matcher_grow(m->interp, m->bt,
+		    &m->btalloc, sizeof *m->bt, m->btlocal);
+	b = &m->bt[m->nbt++];
+	b->op = op;
+	b->addr = addr;
+	b->pos = index;
+	b->undo = m->nundo;
+	b->frame = m->frame;
+	if (op != OP_GF && op != OP_NF)
+		m->frame = m->nbt - 1;
+}
+
+/*
+ * Runs the p-code from addr against the text, using and updating the
+ * captures, counters and marks in state. Returns true on success.
+ *
+ * The branch instructions (GF, NF, AS, AF, GS, NS) push entries onto
+ * an explicit backtrack stack instead of recursing:
+ *   - GF and NF push a choice point that, on failure, resumes at the
+ *     untried alternative.
+ *   - AS, AF, GS and NS push an assertion frame and then run the
+ *     assertion's body. Reaching SUCCEED while inside a frame
+ *     completes the body; running out of choice points above a frame
+ *     means the body failed.
+ * Changes to the state are recorded in an undo log only while there
+ * is something to backtrack to, and are rolled back when an entry
+ * is popped. The text index (capture[0].end) is saved in each entry
+ * instead.
+ */
 static SEE_boolean_t
-pcode_run(interp, regex, addr, text, state)
+pcode_run(interp, regex, addr, text, state, m)
 	struct SEE_interpreter *interp;
 	struct ecma_regex *regex;
 	unsigned int addr;
 	struct SEE_string *text;
 	char *state;
+	struct matcher *m;
 {
-	SEE_boolean_t result;
 	int i=0, i2=0, i3=0;
 	unsigned int a=0;
 	unsigned char op;
 	SEE_unicode_t ch;
 	struct capture *capture;
 	int *counter, *mark, statesz;
-	unsigned int newaddr;
-	char *newstate;
+	struct backtrack *b;
+	int steps = interp->regex_step_limit;
 
 	if (SEE_system.periodic)
 	    (*SEE_system.periodic)(interp);
@@ -1426,12 +1491,35 @@ pcode_run(interp, regex, addr, text, state)
 
 	SEE_ASSERT(interp, statesz == regex->statesz);
 
-	newstate = SEE_STRING_ALLOCA(interp, char, statesz);
-
 #define index (capture[0].end)
 
+/* Changes a state slot, remembering its old value if we may backtrack */
+#define SET(field, v) do {						\
+	    int *_s = (int *)&(field), _v = (v);				\
+	    if (*_s != _v) {						\
+		if (m->nbt) {						\
+		    if (m->nundo == m->undoalloc)			\
+			m->undo = (struct undo *)matcher_grow(interp,	\
+			    m->undo, &m->undoalloc, sizeof *m->undo,	\
+			    m->undolocal);				\
+		    m->undo[m->nundo].slot = _s;			\
+		    m->undo[m->nundo].value = *_s;			\
+		    m->nundo++;						\
+		}							\
+		*_s = _v;						\
+	    }								\
+	} while (0)
+
+/* Abandons the current path, and backtracks */
+#define FAIL			goto fail
+
 	for (;;) {
 
+	    /* Catch runaway matches */
+	    if (steps >= 0 && steps-- == 0)
+		SEE_error_throw_string(interp, interp->Error,
+		    STR(regex_step_limit_reached));
+
 	    /* Catch bad branches */
 	    if (addr >= regex->codelen)
 	       SEE_error_throw_string(interp, interp->Error, 
@@ -1545,8 +1633,21 @@ pcode_run(interp, regex, addr, text, state)
 
 	    switch (op) {
 
-	    case OP_FAIL:	return 0;
-	    case OP_SUCCEED:	return 1;
+	    case OP_FAIL:	FAIL;
+
+	    /* finish the innermost assertion body, or the whole match */
+	    case OP_SUCCEED:	if (m->frame < 0)
+				    return 1;
+				b = &m->bt[m->frame];
+				m->nbt = m->frame;
+				m->frame = b->frame;
+				if (b->op != OP_AS)
+				    matcher_undo(m, b->undo);
+				index = b->pos;
+				if (b->op == OP_AF)
+				    FAIL;
+				addr = b->addr;
+				break;
 
 	    /* succeed if current character matches charclass. index++ */
 	    case OP_CHAR:	if (index < text->length) {
@@ -1559,105 +1660,99 @@ pcode_run(interp, regex, addr, text, state)
 					      (text->data[index++] & 0x3ff)) +
 					     0x10000;
 				    ch = Canonicalize(regex, ch);
-				    if (!cc_contains(regex->cc[i], ch))
-					return 0;
+				    if (!_SEE_ecma_cc_contains(regex->cc[i],
+					    ch))
+					FAIL;
 				} else
-					return 0;
+					FAIL;
 				break;
 
 	    /* reset an iteration counter */
-	    case OP_ZERO:	counter[i] = 0;
+	    case OP_ZERO:	SET(counter[i], 0);
 				break;
 
 	    /* fail if we havent reached a particular count */
 	    case OP_REACH:	if (counter[i] < i2)
-					return 0;
+					FAIL;
 				break;
 
 	    /* fail if we reached a particular count */
 	    case OP_NREACH:	if (counter[i] >= i2)
-					return 0;
+					FAIL;
 				break;
 
 	    /* start a capture group at current index */
-	    case OP_START:	capture[i].start = index; 
-				capture[i].end = -1; 
+	    case OP_START:	SET(capture[i].start, index); 
+				SET(capture[i].end, -1); 
 				break;
 
 	    /* finish a capture group at current index */
-	    case OP_END:	capture[i].end = index; 
+	    case OP_END:	SET(capture[i].end, index); 
 				break;
 
 	    /* reset the given captures - usually done at a loop start */
 	    case OP_UNDEF:	while (i < i2) {
-				   capture[i].start = -1;
-				   capture[i].end = -1;
+				   SET(capture[i].start, -1);
+				   SET(capture[i].end, -1);
 				   i++;
 				}
 				break;
 
 	    /* Set a mark to the current index */
-	    case OP_MARK:	mark[i] = index;
+	    case OP_MARK:	SET(mark[i], index);
 				break;
 
 	    /* fail if we haven't advanced past the mark */
 	    case OP_FDIST:	if (mark[i] == index)
-					return 0;
+					FAIL;
 				break;
 
 	    /* fail if haven't advanced past mark AND counter has reached 
 	     * a limit */
 	    case OP_RDIST:	if (mark[i] == index && counter[i2] >= i3)
-					return 0;
+					FAIL;
 				break;
 
 	    /* increment counter if it is less than n. always branch */
 	    case OP_MNEXT:	if (counter[i] < i2)
-					counter[i]++;
+					SET(counter[i], counter[i] + 1);
 				addr = a;
 				break;
 
 	    /* increment counter. if it is less than n, then branch */
-	    case OP_RNEXT:	counter[i]++;
+	    case OP_RNEXT:	SET(counter[i], counter[i] + 1);
 				if (counter[i] < i2)
 					addr = a;
 				break;
 
 	    case OP_GOTO:	addr = a; break;
 
-	    /* operations that push state and branch for backtracking */
-	    case OP_GS:	/* greedy success */
-	    case OP_NS:	/* non-greedy success */
+	    /* try the next instruction, and on failure, resume at a */
 	    case OP_GF: /* greedy fail */
-	    case OP_NF: /* greedy fail */
+				if (SEE_system.periodic)
+				    (*SEE_system.periodic)(interp);
+				matcher_push(m, op, a, index);
+				break;
+
+	    /* try a, and on failure, resume at the next instruction */
+	    case OP_NF: /* non-greedy fail */
+				if (SEE_system.periodic)
+				    (*SEE_system.periodic)(interp);
+				matcher_push(m, op, addr, index);
+				addr = a;
+				break;
+
+	    /* run the body that follows, then continue at a */
+	    case OP_GS:	/* greedy success */
 	    case OP_AS: /* assert success */
 	    case OP_AF: /* assert fail */
-				newaddr = (op == OP_NS || op == OP_NF) 
-					? a : addr;
-				memcpy(newstate, state, statesz);
-				result = pcode_run(interp, regex, newaddr, 
-					text, newstate);
-				if (result) {
-				    if (op == OP_GF || op == OP_NF) {
-					memcpy(state, newstate, statesz);
-					return 1;
-				    }
-				    else if (op == OP_AF)
-					return 0;
-				    else if (op == OP_AS) {
-					int index_save = index;
-					memcpy(state, newstate, statesz);
-					index = index_save;
-					addr = a;
-				    } else if (op == OP_GS)
-					addr = a;
-				} else {
-				    if (op == OP_GS || op == OP_NS || 
-					op == OP_AS)
-					return 0;
-				    else if (op == OP_GF || op == OP_AF)
-					addr = a;
-				}
+				matcher_push(m, op, a, index);
+				break;
+
+	    /* run the body at a, then continue at the next instruction */
+	    case OP_NS:	/* non-greedy success */
+				matcher_push(m, op, addr, index);
+				addr = a;
 				break;
 
 	    /* succeed if we are at the beginning of a line */
@@ -1665,28 +1760,28 @@ pcode_run(interp, regex, addr, text, state)
 	    case OP_BOL:	if (index == 0)			       /* ^ */
 				    ; /* succeed */
 				else if ((regex->flags & FLAG_MULTILINE) == 0)
-				    return 0;
+				    FAIL;
 				else if (text->data[index-1] == 0x000a	/*LF*/
 				      || text->data[index-1] == 0x000d	/*CR*/
 				      || text->data[index-1] == 0x2028	/*LS*/
 				      || text->data[index-1] == 0x2029)	/*PS*/
 				    ; /* succeed */
 				else
-				    return 0;
+				    FAIL;
 				break;
 
 	    /* succeed if we are at the end of a line */
 	    case OP_EOL:	if (index == text->length)	       /* $ */
 				    ; /* succeed */
 				else if ((regex->flags & FLAG_MULTILINE) == 0)
-				    return 0;
+				    FAIL;
 				else if (text->data[index] == 0x000a	/*LF*/
 				      || text->data[index] == 0x000d	/*CR*/
 				      || text->data[index] == 0x2028	/*LS*/
 				      || text->data[index] == 0x2029)	/*PS*/
 				    ; /* succeed */
 				else
-				    return 0;
+				    FAIL;
 				break;
 
 #define IsWordChar(e)	((e) >= 0 && (e) < text->length && (		  \
@@ -1702,9 +1797,9 @@ pcode_run(interp, regex, addr, text, state)
 				a = IsWordChar(index - 1);
 				b = IsWordChar(index);
 				if (op == OP_BRK) {
-				    if (a == b) return 0;
+				    if (a == b) FAIL;
 				} else {
-				    if (a != b) return 0;
+				    if (a != b) FAIL;
 				}
 				break;
 		}
@@ -1715,12 +1810,12 @@ pcode_run(interp, regex, addr, text, state)
 				  br = capture[i].start;
 				  len = capture[i].end - br;
 				  if (len + index > text->length) 
-					return 0;
+					FAIL;
 				  for (x = 0; x < len; x++) 
 				    if (Canonicalize(regex, text->data[br+x]) 
 					!= Canonicalize(regex, 
 					      text->data[index+x]))
-				    return 0;
+				    FAIL;
 				  index += len;
 	    			}
 				break;
@@ -1730,9 +1825,31 @@ pcode_run(interp, regex, addr, text, state)
 			        SEE_error_throw_string(interp, interp->Error, 
 			          STR(internal_error));
 	    }
+	    continue;
+
+	    /*
+	     * Pop the backtrack stack until a choice point or a failed
+	     * negative assertion lets matching continue.
+	     */
+	fail:
+	    for (;;) {
+		if (m->nbt == 0)
+		    return 0;
+		b = &m->bt[--m->nbt];
+		matcher_undo(m, b->undo);
+		index = b->pos;
+		if (b->op == OP_GF || b->op == OP_NF)
+		    break;
+		m->frame = b->frame;
+		if (b->op == OP_AF)
+		    break;
+	    }
+	    addr = b->addr;
 	}
 }
 #undef index
+#undef SET
+#undef FAIL
 
 /*
  * Executes the regex on the text beginning at index.
@@ -1750,6 +1867,7 @@ ecma_regex_match(interp, aregex, text, index, capture_ret)
 	int i, success;
 	char *state = SEE_STRING_ALLOCA(interp, char, regex->statesz);
 	struct capture *capture = (struct capture *)state;
+	struct matcher m;
 
 #ifndef NDEBUG
 	memset(state, 0xd0, regex->statesz);		/* catch bugs */
@@ -1761,7 +1879,20 @@ ecma_regex_match(interp, aregex, text, index, capture_ret)
 		capture[i].start = -1;
 		capture[i].end = -1;
 	}
-	success = pcode_run(interp, regex, 0, text, state);
+
+	m.interp = interp;
+	m.bt = m.btlocal;
+	m.nbt = 0;
+	m.btalloc = MATCHER_LOCAL;
+	m.frame = -1;
+	m.undo = m.undolocal;
+	m.nundo = 0;
+	m.undoalloc = MATCHER_LOCAL;
+	success = pcode_run(interp, regex, 0, text, state, &m);
+	if (m.bt != m.btlocal)
+		SEE_free(interp, (void **)&m.bt);
+	if (m.undo != m.undolocal)
+		SEE_free(interp, (void **)&m.undo);
 #ifndef NDEBUG
         if (SEE_regex_debug) 
 		dprintf(". %s\n", success ? "success" : "failure");
@@ -1772,21 +1903,399 @@ ecma_regex_match(interp, aregex, text, index, capture_ret)
 	return success;
 }
 
+/* Returns the position of the literal in text at or after i, or -1 */
+int
+_SEE_ecma_literal_find(regex, text, i)
+	struct ecma_regex *regex;
+	struct SEE_string *text;
+	unsigned int i;
+{
+	SEE_char_t first = regex->literal[0];
+	unsigned int j, len = regex->literallen;
+
+	for (; i + len <= text->length; i++) {
+	    if (text->data[i] != first)
+		continue;
+	    for (j = 1; j < len; j++)
+		if (text->data[i + j] != regex->literal[j])
+		    break;
+	    if (j == len)
+		return i;
+	}
+	return -1;
+}
+
+#define IS_LINE_TERMINATOR(c)	((c) == 0x000a || (c) == 0x000d ||	\
+				 (c) == 0x2028 || (c) == 0x2029)
+
+/*
+ * Finds the leftmost match at or after index start. Uses the facts
+ * found by optimize_regex() to skip positions where ecma_regex_match()
+ * must fail.
+ */
+static int
+ecma_regex_search(interp, aregex, text, start, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *aregex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *capture_ret;
+{
+	struct ecma_regex *regex = REGEX_CAST(aregex);
+	unsigned int i, prev, len = text->length;
+	int next = -1;			/* position of the literal */
+
+	for (i = start; i <= len; i++) {
+
+	    /* Skip ahead until a position passes every test */
+	    do {
+		prev = i;
+		if (regex->anchor == ANCHOR_START && i > 0)
+		    return 0;
+		if (regex->anchor == ANCHOR_LINE)
+		    while (i > 0 && i <= len && 
+		    	   !IS_LINE_TERMINATOR(text->data[i - 1]))
+			i++;
+		if (regex->literal && regex->literalpos == 0) {
+		    if ((next = _SEE_ecma_literal_find(regex, text, i)) < 0)
+			return 0;
+		    i = next;
+		} else if (regex->literal && (next < 0 || next < i)) {
+		    /* A match starting at i contains the literal after i */
+		    if ((next = _SEE_ecma_literal_find(regex, text, i)) < 0)
+			return 0;
+		}
+		if (regex->first) {
+		    while (i < len && !FIRST_CONTAINS(regex, text->data[i]))
+			i++;
+		    if (i == len)
+			return 0;
+		}
+		if (i > len)
+		    return 0;
+	    } while (i != prev);
+
+	    if (ecma_regex_match(interp, aregex, text, i, capture_ret))
+		return 1;
+	}
+	return 0;
+}
+
 /*------------------------------------------------------------
  * optimizer
+ *
+ * The optimizer looks over the p-code for facts that let
+ * ecma_regex_search() skip start positions where no match can begin:
+ *   - anchoring: every path reaches ^ before consuming any text;
+ *   - a first-character set: the characters that can be consumed
+ *     first, when no path can succeed without consuming one;
+ *   - a literal: a run of single characters that every match
+ *     contains, either at its start (a prefix) or somewhere.
+ * Assertion bodies are not looked into.
+ */
+
+/* Returns the length of the instruction op and its arguments */
+unsigned int
+_SEE_ecma_insnlen(op)
+	unsigned char op;
+{
+	switch (op) {
+	case OP_CHAR:	case OP_ZERO:	case OP_START:	case OP_END:
+	case OP_MARK:	case OP_FDIST:	case OP_BACKREF:
+	case OP_GOTO:	case OP_GS:	case OP_NS:	case OP_GF:
+	case OP_NF:	case OP_AS:	case OP_AF:
+		return 1 + CODE_SZI;
+	case OP_REACH:	case OP_NREACH:	case OP_UNDEF:
+		return 1 + 2 * CODE_SZI;
+	case OP_RDIST:
+		return 1 + 3 * CODE_SZI;
+	case OP_MNEXT:	case OP_RNEXT:
+		return 1 + 2 * CODE_SZI + CODE_SZA;
+	default:
+		return 1;
+	}
+}
+
+/*
+ * Stores in succ[] the addresses of the instructions that can run
+ * after the one at addr in the same (sub-)match, and returns how many.
  */
+static int
+pcode_succ(regex, addr, succ)
+	struct ecma_regex *regex;
+	unsigned int addr;
+	unsigned int *succ;
+{
+	unsigned char op = regex->code[addr];
+	unsigned int next = addr + _SEE_ecma_insnlen(op);
+
+	switch (op) {
+	case OP_FAIL:	case OP_SUCCEED:
+		return 0;
+	case OP_GOTO:	case OP_GS:	case OP_AS:	case OP_AF:
+		succ[0] = CODE_MAKEA(regex->code, addr + 1);
+		return 1;
+	case OP_MNEXT:
+		succ[0] = CODE_MAKEA(regex->code, addr + 1 + 2 * CODE_SZI);
+		return 1;
+	case OP_RNEXT:
+		succ[0] = next;
+		succ[1] = CODE_MAKEA(regex->code, addr + 1 + 2 * CODE_SZI);
+		return 2;
+	case OP_GF:	case OP_NF:
+		succ[0] = next;
+		succ[1] = CODE_MAKEA(regex->code, addr + 1);
+		return 2;
+	default:	/* including OP_NS, whose body is at its address arg */
+		succ[0] = next;
+		return 1;
+	}
+}
+
+/* Results of walk_first() */
+#define WALK_CHAR	1		/* a character is consumed */
+#define WALK_BOL	2		/* a ^ was reached */
+#define WALK_OTHER	4		/* success or a backreference */
+
+/*
+ * Walks every path from the start of the p-code up to the first
+ * instruction that consumes text, and returns the WALK_* flags of the
+ * instructions where the paths end. The character classes met are
+ * marked in seen[]. If stop_bol is true, paths also end at ^.
+ */
+static int
+walk_first(interp, regex, stop_bol, seen)
+	struct SEE_interpreter *interp;
+	struct ecma_regex *regex;
+	int stop_bol;
+	unsigned char *seen;
+{
+	unsigned char *visited;
+	unsigned int *stack, nstack = 0, addr, succ[2];
+	int flags = 0, i, n;
+
+	visited = SEE_NEW_STRING_ARRAY(interp, unsigned char, regex->codelen);
+	memset(visited, 0, regex->codelen);
+	stack = SEE_NEW_STRING_ARRAY(interp, unsigned int, regex->codelen);
+	visited[0] = 1;
+	stack[nstack++] = 0;
+	while (nstack) {
+	    addr = stack[--nstack];
+	    switch (regex->code[addr]) {
+	    case OP_CHAR:
+		flags |= WALK_CHAR;
+		seen[CODE_MAKEI(regex->code, addr + 1)] = 1;
+		continue;
+	    case OP_SUCCEED:
+	    case OP_BACKREF:
+		flags |= WALK_OTHER;
+		continue;
+	    case OP_BOL:
+		if (stop_bol) {
+		    flags |= WALK_BOL;
+		    continue;
+		}
+		break;
+	    }
+	    n = pcode_succ(regex, addr, succ);
+	    for (i = 0; i < n; i++)
+		if (!visited[succ[i]]) {
+		    visited[succ[i]] = 1;
+		    stack[nstack++] = succ[i];
+		}
+	}
+	SEE_free(interp, (void **)&visited);
+	SEE_free(interp, (void **)&stack);
+	return flags;
+}
+
+/*
+ * Returns true if every path from the start of the p-code to its
+ * final SUCCEED passes through the instruction at avoid.
+ */
+static int
+pcode_dominates(interp, regex, avoid)
+	struct SEE_interpreter *interp;
+	struct ecma_regex *regex;
+	unsigned int avoid;
+{
+	unsigned char *visited;
+	unsigned int *stack, nstack = 0, addr, succ[2];
+	unsigned int final = regex->codelen - 1;
+	int i, n, reached = 0;
+
+	visited = SEE_NEW_STRING_ARRAY(interp, unsigned char, regex->codelen);
+	memset(visited, 0, regex->codelen);
+	stack = SEE_NEW_STRING_ARRAY(interp, unsigned int, regex->codelen);
+	visited[avoid] = 1;
+	if (avoid != 0) {
+	    visited[0] = 1;
+	    stack[nstack++] = 0;
+	}
+	while (nstack && !reached) {
+	    addr = stack[--nstack];
+	    if (addr == final)
+		reached = 1;
+	    n = pcode_succ(regex, addr, succ);
+	    for (i = 0; i < n; i++)
+		if (!visited[succ[i]]) {
+		    visited[succ[i]] = 1;
+		    stack[nstack++] = succ[i];
+		}
+	}
+	SEE_free(interp, (void **)&visited);
+	SEE_free(interp, (void **)&stack);
+	return !reached;
+}
+
+/*
+ * Returns the character that the instruction at addr must consume, or
+ * -1 if it is not a CHAR instruction with a single, plain BMP character.
+ */
+static int
+pcode_literal_char(regex, addr)
+	struct ecma_regex *regex;
+	unsigned int addr;
+{
+	struct charclass *c;
+
+	if (regex->code[addr] != OP_CHAR || (regex->flags & FLAG_IGNORECASE))
+		return -1;
+	c = regex->cc[CODE_MAKEI(regex->code, addr + 1)];
+	if (!cc_issingle(c) || c->ranges->lo > 0xffff ||
+	    (c->ranges->lo & 0xf800) == 0xd800)
+		return -1;
+	return c->ranges->lo;
+}
+
+/*
+ * Collects the literal run of characters that starts at addr, where
+ * each character's instruction leads only to the next one's.
+ * Returns the length of the run, storing up to max characters in buf.
+ */
+static unsigned int
+pcode_literal_run(regex, addr, buf, max)
+	struct ecma_regex *regex;
+	unsigned int addr;
+	SEE_char_t *buf;
+	unsigned int max;
+{
+	unsigned int len = 0;
+	int ch;
+
+	while (len < max && addr < regex->codelen) {
+	    switch (regex->code[addr]) {
+	    case OP_CHAR:
+		if ((ch = pcode_literal_char(regex, addr)) < 0)
+		    return len;
+		buf[len++] = ch;
+		break;
+	    case OP_START:	case OP_END:	case OP_MARK:
+	    case OP_ZERO:	case OP_UNDEF:
+		break;
+	    default:
+		return len;
+	    }
+	    addr += _SEE_ecma_insnlen(regex->code[addr]);
+	}
+	return len;
+}
+
+/* Stores a copy of a literal run in the regex */
+static void
+set_literal(interp, regex, buf, len, pos)
+	struct SEE_interpreter *interp;
+	struct ecma_regex *regex;
+	SEE_char_t *buf;
+	unsigned int len;
+	int pos;
+{
+	regex->literal = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, len);
+	memcpy(regex->literal, buf, len * sizeof buf[0]);
+	regex->literallen = len;
+	regex->literalpos = pos;
+}
 
 static void
 optimize_regex(interp, regex)
 	struct SEE_interpreter *interp;
 	struct ecma_regex *regex;
 {
-	/*
-	 * (nothing here yet)
-	 *
-	 * possible optimisations include branch short-cuts,
-	 * and compiling the p-code to native machine instructions.
-	 */
+	unsigned char *seen;
+	unsigned int addr, i, len, best, ch;
+	int flags, skip;
+	SEE_char_t *buf;
+
+	regex->anchor = ANCHOR_NONE;
+	regex->first = NULL;
+	regex->firsthigh = 1;
+	regex->literal = NULL;
+	regex->literallen = 0;
+	regex->literalpos = -1;
+
+	if (regex->codelen > OPTIMIZE_MAXCODE)
+		return;
+
+	seen = SEE_NEW_STRING_ARRAY(interp, unsigned char, regex->cclen + 1);
+
+	/* Anchoring */
+	memset(seen, 0, regex->cclen + 1);
+	if (walk_first(interp, regex, 1, seen) == WALK_BOL)
+		regex->anchor = (regex->flags & FLAG_MULTILINE) 
+			? ANCHOR_LINE : ANCHOR_START;
+
+	/* First-character set */
+	memset(seen, 0, regex->cclen + 1);
+	flags = walk_first(interp, regex, 0, seen);
+	if (flags == WALK_CHAR) {
+	    regex->first = SEE_NEW_STRING_ARRAY(interp, unsigned char, 
+	    	256 / 8);
+	    memset(regex->first, 0, 256 / 8);
+	    regex->firsthigh = (regex->flags & FLAG_IGNORECASE) != 0;
+	    for (i = 0; i < regex->cclen; i++) {
+		struct charclassrange *r;
+
+		if (!seen[i])
+		    continue;
+		for (ch = 0; ch < 256; ch++)
+		    if (_SEE_ecma_cc_contains(regex->cc[i],
+			    Canonicalize(regex, ch)))
+			regex->first[ch >> 3] |= 1 << (ch & 7);
+		for (r = regex->cc[i]->ranges; r; r = r->next)
+		    if (r->hi > 256)
+			regex->firsthigh = 1;
+	    }
+	}
+	SEE_free(interp, (void **)&seen);
+
+	/* A literal prefix, or failing that, the longest required literal */
+	buf = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, LITERAL_MAX);
+	len = pcode_literal_run(regex, 0, buf, LITERAL_MAX);
+	if (len)
+	    set_literal(interp, regex, buf, len, 0);
+	else {
+	    best = 0;
+	    skip = 0;
+	    for (addr = 0; addr < regex->codelen; 
+	    	 addr += _SEE_ecma_insnlen(regex->code[addr]))
+	    {
+		/* Only consider the start of each run */
+		if (pcode_literal_char(regex, addr) < 0) {
+		    if (pcode_literal_run(regex, addr, buf, 1) == 0)
+			skip = 0;
+		    continue;
+		}
+		if (skip)
+		    continue;
+		skip = 1;
+		len = pcode_literal_run(regex, addr, buf, LITERAL_MAX);
+		if (len > best && pcode_dominates(interp, regex, addr)) {
+		    best = len;
+		    set_literal(interp, regex, buf, len, -1);
+		}
+	    }
+	}
+	SEE_free(interp, (void **)&buf);
 }
 
 const struct SEE_regex_engine _SEE_ecma_regex_engine = {
@@ -1794,5 +2303,6 @@ const struct SEE_regex_engine _SEE_ecma_regex_engine = {
 	ecma_regex_parse,
 	ecma_regex_count_captures,
 	ecma_regex_get_flags,
-	ecma_regex_match
+	ecma_regex_match,
+	ecma_regex_search
 };
@@ -0,0 +1,95 @@
+/* Copyright (c) 2009, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_regex_ecma_
+#define _SEE_h_regex_ecma_
+
+/*
+ * The p-code of the ecma regex engine. It is shared with the
+ * automaton engine (regex_nfa.c), which runs the same p-code.
+ */
+
+#include <see/type.h>
+#include <see/string.h>
+#include <see/mem.h>
+#include "regex.h"
+
+#define	OP_FAIL		 0		/* match failed */
+#define	OP_SUCCEED	 1		/* match succeeded */
+#define	OP_CHAR		 2		/* match a char class instance */
+#define	OP_ZERO		 3		/* reset counter */
+#define	OP_REACH	 4		/* test counter over */
+#define	OP_NREACH	 5		/* test counter under */
+#define	OP_START	 6		/* enter a group */
+#define	OP_END		 7		/* exit a group */
+#define	OP_UNDEF	 8		/* reset a group */
+#define	OP_MARK		 9		/* record a position */
+#define	OP_FDIST	10		/* position test */
+#define	OP_RDIST	11		/* position and counter test */
+#define	OP_MNEXT	12		/* max-loop */
+#define	OP_RNEXT	13		/* reach-loop */
+#define	OP_GOTO		14		/* branch */
+#define	OP_GS		15		/* greedy success */
+#define	OP_NS		16		/* non-greedy success */
+#define	OP_GF		17		/* greedy fail */
+#define	OP_NF		18		/* non-greedy fail */
+#define	OP_AS		19		/* assert success */
+#define	OP_AF		20		/* assert fail */
+#define	OP_BOL		21		/* test beginning of line */
+#define	OP_EOL		22		/* test end of line */
+#define	OP_BRK		23		/* test word-break */
+#define	OP_NBRK		24		/* test non-word-break */
+#define	OP_BACKREF	25		/* backreference match */
+
+struct charclassrange {
+	struct charclassrange *next;
+	SEE_unicode_t lo, hi;		/* simple range of chars, eg [a-z] */
+};
+
+struct charclass {
+	struct charclassrange *ranges;	/* linked list of character ranges */
+};
+
+struct ecma_regex {
+	struct regex		regex;
+	int			ncaptures, ncounters, nmarks, maxref;
+	int			statesz;
+	unsigned char	       *code;
+	unsigned int		codelen;
+	struct SEE_growable	codegrow;
+	struct charclass      **cc;
+	unsigned int		cclen;
+	struct SEE_growable	ccgrow;
+	int			flags;
+
+	/* Found by optimize_regex() to help ecma_regex_search() */
+	int			anchor;		/* ANCHOR_* */
+	unsigned char	       *first;		/* bitmap of possible first
+						   Latin-1 chars, or NULL */
+	int			firsthigh;	/* other first chars possible */
+	SEE_char_t	       *literal;	/* text every match contains */
+	unsigned int		literallen;
+	int			literalpos;	/* 0 if at start, else -1 */
+};
+
+#define ANCHOR_NONE	0		/* a match may start anywhere */
+#define ANCHOR_START	1		/* only at the start of the text */
+#define ANCHOR_LINE	2		/* only at the start of a line */
+
+#define REGEX_CAST(aregex)   ((struct ecma_regex *)(aregex))
+
+#define FIRST_CONTAINS(regex, c)	((c) < 256				\
+		? ((regex)->first[(c) >> 3] & (1 << ((c) & 7)))		\
+		: (regex)->firsthigh)
+
+#define CODE_SZA	2
+#define CODE_SZI	2
+
+#define CODE_MAKEI(code, addr)  ((code[addr] << 8) | code[(addr)+1])
+#define CODE_MAKEA(code, addr)  ((CODE_MAKEI(code, addr) + (addr)) & 0xffff)
+
+unsigned int _SEE_ecma_insnlen(unsigned char op);
+int _SEE_ecma_cc_contains(struct charclass *c, SEE_unicode_t ch);
+int _SEE_ecma_literal_find(struct ecma_regex *regex, struct SEE_string *text,
+	unsigned int i);
+
+#endif /* _SEE_h_regex_ecma_ */
@@ -0,0 +1,1185 @@
+/*
+ * Copyright (c) 2009
+ *      David Leonard.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of David Leonard nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#if STDC_HEADERS
+# include <stdio.h>
+# include <stdlib.h>
+#endif
+
+#if HAVE_STRING_H
+# include <string.h>
+#endif
+
+#include <see/interpreter.h>
+#include <see/mem.h>
+#include <see/type.h>
+#include <see/error.h>
+#include <see/string.h>
+#include <see/system.h>
+
+#include "regex.h"
+#include "regex_ecma.h"
+#include "unicode.h"
+#include "stringdefs.h"
+#include "dprint.h"
+
+/*
+ * Automaton regular expression engine.
+ *
+ * This engine runs the p-code made by the ecma engine's parser, but
+ * without backtracking, so that a match takes time linear in the
+ * length of the text whatever the pattern. All the ways of matching
+ * are followed together, one text position at a time, as 'threads'
+ * kept in the order in which the backtracker would have tried them
+ * (a Pike VM). The first thread to succeed gives the same match and
+ * captures that the backtracker would have found.
+ *
+ * A thread's state is its p-code address, its counters, and for each
+ * mark whether the mark is at the current position. That is all the
+ * p-code can test, so two threads in the same state at the same
+ * position will go on to do the same things, and the later one can
+ * be dropped. Counters are bounded by the quantifiers, so there are
+ * only finitely many states.
+ *
+ * Because the states form a finite automaton, searches first run a
+ * DFA over the text to find out cheaply whether there is a match at
+ * all. Its states are sets of thread states and are built lazily, as
+ * the text needs them, into a cache of bounded size. Where no thread
+ * is alive, both skip ahead using the facts that the ecma optimizer
+ * found about where matches can start.
+ *
+ * Backreferences and lookaheads can't be matched this way. For those
+ * patterns, parsing returns the ecma engine's regex, and matching is
+ * done by backtracking.
+ */
+
+#ifndef NDEBUG
+extern int SEE_regex_debug;
+#endif
+
+#define NFA_MAXCOUNT	4096		/* most counter combinations */
+#define NFA_MAXBOUNDS	256		/* most char class boundaries */
+#define DFA_HASHSZ	64		/* buckets in a DFA's state table */
+#define DFA_MAXSTATES	256		/* DFA states kept before a flush */
+#define DFA_MAXFLUSH	8		/* flushes in a scan before giving up */
+
+struct dfa;
+
+struct nfa_regex {
+	struct regex		regex;
+	struct ecma_regex      *ecma;		/* the p-code */
+	unsigned int		keysz;		/* bytes in a thread state */
+	unsigned int		markoff;	/* where the mark bits are */
+	unsigned char	       *startkey;	/* state of a new thread */
+	SEE_unicode_t	       *bounds;		/* where char classes change */
+	unsigned int		nbounds;
+	unsigned int		nclasses;	/* DFA inputs besides end, or 0 */
+	unsigned short		latin1[256];	/* DFA input of Latin-1 chars */
+	struct dfa	       *dfa;		/* cached DFA for searches */
+};
+
+#define NFA_CAST(aregex)	((struct nfa_regex *)(aregex))
+
+/*
+ * A thread state is kept in keysz bytes: the p-code address and each
+ * counter as 16 bit numbers, then one bit for each mark that is at the
+ * current position. Spare bytes at the end are zero.
+ */
+#define KEY_ADDR(k)		(((k)[0] << 8) | (k)[1])
+#define KEY_SETADDR(k, a)	((k)[0] = ((a) >> 8) & 0xff, 		\
+				 (k)[1] = (a) & 0xff)
+#define KEY_COUNTER(k, i)	(((k)[2 + 2 * (i)] << 8) | (k)[3 + 2 * (i)])
+#define KEY_SETCOUNTER(k, i, v)	((k)[2 + 2 * (i)] = ((v) >> 8) & 0xff,	\
+				 (k)[3 + 2 * (i)] = (v) & 0xff)
+#define KEY_MARK(re, k, i)	((k)[(re)->markoff + ((i) >> 3)] & 	\
+				 (1 << ((i) & 7)))
+#define KEY_SETMARK(re, k, i)	((k)[(re)->markoff + ((i) >> 3)] |= 	\
+				 (1 << ((i) & 7)))
+
+/* What the p-code can test about the chars either side of a position */
+struct nfa_input {
+	int		prev, next;	/* IN_* flags */
+	SEE_unicode_t	ch;		/* next char, canonicalized */
+	unsigned int	len;		/* UTF-16 units in next char */
+};
+
+#define IN_WORD		0x1		/* a word char (for \b) */
+#define IN_LT		0x2		/* a line terminator */
+#define IN_EDGE		0x4		/* no char: start or end of text */
+
+#define IN_FLAGS(c)	((((c) >= 'a' && (c) <= 'z') ||		\
+			  ((c) >= 'A' && (c) <= 'Z') ||		\
+			  ((c) >= '0' && (c) <= '9') ||		\
+			  (c) == '_') ? IN_WORD :			\
+			 ((c) == 0x000a || (c) == 0x000d ||		\
+			  (c) == 0x2028 || (c) == 0x2029) ? IN_LT : 0)
+
+/* Threads in priority order, and all states seen at one position */
+struct nfa_list {
+	unsigned char	       *keys;		/* n thread states */
+	struct capture	       *caps;		/* n capture arrays */
+	unsigned int		n, alloc;
+	unsigned char	       *seen;		/* nseen states */
+	unsigned int		nseen, seenalloc;
+	unsigned int	       *hash;		/* (gen, seen index) pairs */
+	unsigned int		hashsz, gen;
+};
+
+/* The working storage of a match */
+struct nfa {
+	struct SEE_interpreter *interp;
+	struct nfa_regex       *re;
+	unsigned int		ncaps;		/* captures in a thread */
+	unsigned int		esz;		/* bytes of captures and state */
+	unsigned char	       *cur;		/* thread followed by nfa_add */
+	unsigned char	       *tmp;		/* scratch thread */
+	unsigned char	       *stack;		/* threads waiting in nfa_add */
+	unsigned int		nstack, stackalloc;
+	struct nfa_list		list[2];
+};
+
+/* A DFA state: the threads alive at a position, before new ones start */
+struct dstate {
+	struct dstate	       *hnext;		/* hash chain */
+	unsigned int		hash;
+	int			prev;		/* IN_* flags of previous char */
+	unsigned char	       *keys;		/* sorted thread states */
+	unsigned int		nkeys;
+	struct dstate	      **next;		/* by input; NULL if not known */
+};
+
+struct dfa {
+	struct dstate	       *tab[DFA_HASHSZ];
+	unsigned int		nstates;
+	unsigned int		flushes;
+};
+
+/* Transitions on the end of the text lead to one of these */
+static struct dstate dstate_match, dstate_fail;
+
+static struct regex *nfa_regex_parse(struct SEE_interpreter *, 
+	struct SEE_string *, int);
+static int nfa_regex_count_captures(struct regex *);
+static int nfa_regex_get_flags(struct regex *);
+static int nfa_regex_match(struct SEE_interpreter *, struct regex *,
+	struct SEE_string *, unsigned int, struct capture *);
+static int nfa_regex_search(struct SEE_interpreter *, struct regex *,
+	struct SEE_string *, unsigned int, struct capture *);
+
+static int bound_cmp(const void *, const void *);
+static void nfa_bounds(struct SEE_interpreter *, struct nfa_regex *);
+static unsigned int nfa_interval(struct nfa_regex *, SEE_unicode_t);
+static void nfa_input(struct nfa_regex *, struct SEE_string *, 
+	unsigned int, struct nfa_input *);
+static unsigned int nfa_skip(struct nfa_regex *, struct SEE_string *,
+	unsigned int);
+static unsigned int key_hash(const unsigned char *, unsigned int);
+static void *nfa_grow(struct SEE_interpreter *, void *, unsigned int *,
+	unsigned int, SEE_size_t);
+static void nfa_init(struct nfa *, struct SEE_interpreter *,
+	struct nfa_regex *);
+static void nfa_fini(struct nfa *);
+static void list_clear(struct SEE_interpreter *, struct nfa_list *);
+static int list_seen(struct nfa *, struct nfa_list *, const unsigned char *);
+static void list_append(struct nfa *, struct nfa_list *, 
+	const unsigned char *, const struct capture *);
+static void nfa_push(struct nfa *, unsigned int);
+static void nfa_add(struct nfa *, struct nfa_list *, const unsigned char *,
+	const struct capture *, unsigned int, struct nfa_input *);
+static int nfa_run(struct nfa *, struct SEE_string *, unsigned int, int,
+	struct capture *);
+static void dfa_flush(struct SEE_interpreter *, struct dfa *);
+static struct dstate *dfa_state(struct nfa *, struct dfa *,
+	unsigned char *, unsigned int, int);
+static void keys_sort(unsigned char *, unsigned int, unsigned int,
+	unsigned char *);
+static struct dstate *dfa_next(struct nfa *, struct dfa *, 
+	struct dstate *, unsigned int);
+static int dfa_scan(struct nfa *, struct dfa *, struct SEE_string *,
+	unsigned int, unsigned int *);
+
+/*
+ * Parses the pattern with the ecma engine's parser. If the p-code can
+ * be run as an automaton, returns it wrapped for this engine; otherwise
+ * returns the ecma regex itself.
+ */
+static struct regex *
+nfa_regex_parse(interp, source, flags)
+	struct SEE_interpreter *interp;
+	struct SEE_string *source;
+	int flags;
+{
+	struct regex *aregex;
+	struct ecma_regex *ecma;
+	struct nfa_regex *re;
+	unsigned int addr, *bound, i = 0, n = 0, count;
+	unsigned char op;
+
+	aregex = (*_SEE_ecma_regex_engine.parse)(interp, source, flags);
+	ecma = REGEX_CAST(aregex);
+
+	/* Find the largest value each counter is compared with */
+	bound = SEE_NEW_STRING_ARRAY(interp, unsigned int, 
+		ecma->ncounters + 1);
+	for (i = 0; i < ecma->ncounters; i++)
+	    bound[i] = 0;
+	for (addr = 0; addr < ecma->codelen; 
+	     addr += _SEE_ecma_insnlen(op)) 
+	{
+	    op = ecma->code[addr];
+	    switch (op) {
+	    case OP_BACKREF:	case OP_GS:	case OP_NS:
+	    case OP_AS:		case OP_AF:
+#ifndef NDEBUG
+		if (SEE_regex_debug)
+		    dprintf("nfa: op %d needs the backtracker\n", op);
+#endif
+		goto backtrack;
+	    case OP_REACH:	case OP_NREACH:
+	    case OP_MNEXT:	case OP_RNEXT:
+		i = CODE_MAKEI(ecma->code, addr + 1);
+		n = CODE_MAKEI(ecma->code, addr + 1 + CODE_SZI);
+		break;
+	    case OP_RDIST:
+		i = CODE_MAKEI(ecma->code, addr + 1 + CODE_SZI);
+		n = CODE_MAKEI(ecma->code, addr + 1 + 2 * CODE_SZI);
+		break;
+	    default:
+		continue;
+	    }
+	    if (n > bound[i])
+		bound[i] = n;
+	}
+	for (count = 1, i = 0; i < ecma->ncounters; i++) {
+	    count *= bound[i] + 1;
+	    if (count > NFA_MAXCOUNT) {
+#ifndef NDEBUG
+		if (SEE_regex_debug)
+		    dprintf("nfa: counters too large\n");
+#endif
+		goto backtrack;
+	    }
+	}
+	SEE_free(interp, (void **)&bound);
+
+	re = SEE_NEW(interp, struct nfa_regex);
+	re->regex.engine = &_SEE_nfa_regex_engine;
+	re->regex.interp = interp;
+	re->ecma = ecma;
+	re->markoff = 2 + 2 * ecma->ncounters;
+	re->keysz = re->markoff + (ecma->nmarks + 7) / 8;
+	re->keysz = (re->keysz + sizeof (int) - 1) & ~(sizeof (int) - 1);
+	re->startkey = SEE_NEW_STRING_ARRAY(interp, unsigned char, re->keysz);
+	memset(re->startkey, 0, re->keysz);
+	nfa_bounds(interp, re);
+	if (re->nclasses) {
+	    re->dfa = SEE_NEW(interp, struct dfa);
+	    memset(re->dfa, 0, sizeof *re->dfa);
+	} else
+	    re->dfa = NULL;
+	return &re->regex;
+
+    backtrack:
+	SEE_free(interp, (void **)&bound);
+	return aregex;
+}
+
+static int
+bound_cmp(a, b)
+	const void *a, *b;
+{
+	SEE_unicode_t x = *(const SEE_unicode_t *)a;
+	SEE_unicode_t y = *(const SEE_unicode_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Divides the chars into intervals, so that every char class contains
+ * either all or none of each interval. The DFA's inputs are these
+ * intervals, further divided by the IN_WORD and IN_LT flags.
+ */
+static void
+nfa_bounds(interp, re)
+	struct SEE_interpreter *interp;
+	struct nfa_regex *re;
+{
+	struct ecma_regex *ecma = re->ecma;
+	struct charclassrange *r;
+	unsigned int i, j, n;
+	SEE_unicode_t ch;
+	SEE_char_t c;
+
+	n = 1;
+	for (i = 0; i < ecma->cclen; i++)
+	    for (r = ecma->cc[i]->ranges; r; r = r->next)
+		n += 2;
+	re->bounds = SEE_NEW_STRING_ARRAY(interp, SEE_unicode_t, n);
+	n = 0;
+	re->bounds[n++] = 0;
+	for (i = 0; i < ecma->cclen; i++)
+	    for (r = ecma->cc[i]->ranges; r; r = r->next) {
+		re->bounds[n++] = r->lo;
+		re->bounds[n++] = r->hi;
+	    }
+	qsort(re->bounds, n, sizeof re->bounds[0], bound_cmp);
+	for (i = j = 1; i < n; i++)
+	    if (re->bounds[i] != re->bounds[j - 1])
+		re->bounds[j++] = re->bounds[i];
+	re->nbounds = j;
+
+	if (re->nbounds > NFA_MAXBOUNDS) {
+	    re->nclasses = 0;
+	    return;
+	}
+	re->nclasses = 4 * re->nbounds;
+	for (c = 0; c < 256; c++) {
+	    ch = c;
+	    if (ecma->flags & FLAG_IGNORECASE)
+		ch = UNICODE_TOUPPER(ch);
+	    re->latin1[c] = 4 * nfa_interval(re, ch) + IN_FLAGS(c);
+	}
+}
+
+/* Returns the index of the interval that contains ch */
+static unsigned int
+nfa_interval(re, ch)
+	struct nfa_regex *re;
+	SEE_unicode_t ch;
+{
+	unsigned int lo = 0, hi = re->nbounds, mid;
+
+	while (hi - lo > 1) {
+	    mid = (lo + hi) / 2;
+	    if (re->bounds[mid] <= ch)
+		lo = mid;
+	    else
+		hi = mid;
+	}
+	return lo;
+}
+
+/* Describes the position index in text */
+static void
+nfa_input(re, text, index, in)
+	struct nfa_regex *re;
+	struct SEE_string *text;
+	unsigned int index;
+	struct nfa_input *in;
+{
+	SEE_unicode_t ch;
+
+	in->prev = index == 0 ? IN_EDGE : IN_FLAGS(text->data[index - 1]);
+	if (index >= text->length) {
+	    in->next = IN_EDGE;
+	    in->ch = 0;
+	    in->len = 0;
+	    return;
+	}
+	ch = text->data[index];
+	in->next = IN_FLAGS(ch);
+	in->len = 1;
+	/* N.B. strings are UTF-16 encoded! */
+	if ((ch & 0xfc00) == 0xd800 && index + 1 < text->length &&
+	    (text->data[index + 1] & 0xfc00) == 0xdc00)
+	{
+	    ch = (((ch & 0x3ff) << 10) | (text->data[index + 1] & 0x3ff)) 
+	    	+ 0x10000;
+	    in->len = 2;
+	}
+	if (re->ecma->flags & FLAG_IGNORECASE)
+	    ch = UNICODE_TOUPPER(ch);
+	in->ch = ch;
+}
+
+/*
+ * Returns the first position at or after i where a match could start,
+ * judging by what the ecma optimizer found out about the p-code, or a
+ * position past the end of the text if there is none.
+ */
+static unsigned int
+nfa_skip(re, text, i)
+	struct nfa_regex *re;
+	struct SEE_string *text;
+	unsigned int i;
+{
+	struct ecma_regex *ecma = re->ecma;
+	unsigned int len = text->length;
+	int next;
+
+	if (ecma->anchor == ANCHOR_START && i > 0)
+	    return len + 1;
+	if (ecma->literal && ecma->literalpos == 0) {
+	    if ((next = _SEE_ecma_literal_find(ecma, text, i)) < 0)
+		return len + 1;
+	    i = next;
+	}
+	if (ecma->first) {
+	    while (i < len && !FIRST_CONTAINS(ecma, text->data[i]))
+		i++;
+	    if (i == len)
+		return len + 1;
+	}
+	return i;
+}
+
+/* Returns the FNV-1 hash of len bytes */
+static unsigned int
+key_hash(k, len)
+	const unsigned char *k;
+	unsigned int len;
+{
+	unsigned int h = 2166136261U;
+
+	while (len--)
+	    h = (h * 16777619) ^ *k++;
+	return h;
+}
+
+/* Returns a copy of the array p, grown to hold at least n elements */
+static void *
+nfa_grow(interp, p, allocp, n, size)
+	struct SEE_interpreter *interp;
+	void *p;
+	unsigned int *allocp, n;
+	SEE_size_t size;
+{
+	unsigned int alloc = *allocp ? *allocp : 16;
+	void *np;
+
+	while (alloc < n)
+	    alloc *= 2;
+	np = SEE_malloc_string(interp, alloc * size);
+	if (p) {
+	    memcpy(np, p, *allocp * size);
+	    SEE_free(interp, &p);
+	}
+	*allocp = alloc;
+	return np;
+}
+
+static void
+nfa_init(nfa, interp, re)
+	struct nfa *nfa;
+	struct SEE_interpreter *interp;
+	struct nfa_regex *re;
+{
+	memset(nfa, 0, sizeof *nfa);
+	nfa->interp = interp;
+	nfa->re = re;
+	nfa->ncaps = re->ecma->ncaptures;
+	nfa->esz = nfa->ncaps * sizeof (struct capture) + re->keysz;
+	nfa->cur = SEE_NEW_STRING_ARRAY(interp, unsigned char, nfa->esz);
+	nfa->tmp = SEE_NEW_STRING_ARRAY(interp, unsigned char, nfa->esz);
+	memset(nfa->cur, 0, nfa->esz);
+}
+
+/* Releases the storage of a match */
+static void
+nfa_fini(nfa)
+	struct nfa *nfa;
+{
+	struct SEE_interpreter *interp = nfa->interp;
+	struct nfa_list *list;
+
+	SEE_free(interp, (void **)&nfa->cur);
+	SEE_free(interp, (void **)&nfa->tmp);
+	if (nfa->stack)
+	    SEE_free(interp, (void **)&nfa->stack);
+	for (list = nfa->list; list < nfa->list + 2; list++) {
+	    if (list->keys)
+		SEE_free(interp, (void **)&list->keys);
+	    if (list->caps)
+		SEE_free(interp, (void **)&list->caps);
+	    if (list->seen)
+		SEE_free(interp, (void **)&list->seen);
+	    if (list->hash)
+		SEE_free(interp, (void **)&list->hash);
+	}
+}
+
+/* Empties a list, ready for the next position */
+static void
+list_clear(interp, list)
+	struct SEE_interpreter *interp;
+	struct nfa_list *list;
+{
+	list->n = 0;
+	list->nseen = 0;
+	if (++list->gen == 0) {
+	    memset(list->hash, 0, list->hashsz * 2 * sizeof list->hash[0]);
+	    list->gen = 1;
+	}
+}
+
+/* 
+ * Records that state k has been seen at the list's position. Returns
+ * false if it already had been.
+ */
+static int
+list_seen(nfa, list, k)
+	struct nfa *nfa;
+	struct nfa_list *list;
+	const unsigned char *k;
+{
+	struct SEE_interpreter *interp = nfa->interp;
+	unsigned int keysz = nfa->re->keysz;
+	unsigned int h, i, j, *slot;
+
+	if (2 * (list->nseen + 1) > list->hashsz) {
+	    /* Rebuild the index twice as large */
+	    if (list->hash)
+		SEE_free(interp, (void **)&list->hash);
+	    list->hashsz = list->hashsz ? 2 * list->hashsz : 64;
+	    list->hash = SEE_NEW_STRING_ARRAY(interp, unsigned int,
+	    	2 * list->hashsz);
+	    memset(list->hash, 0, list->hashsz * 2 * sizeof list->hash[0]);
+	    list->gen = 1;
+	    for (i = 0; i < list->nseen; i++) {
+		h = key_hash(list->seen + i * keysz, keysz);
+		for (j = h & (list->hashsz - 1); list->hash[2 * j];
+		     j = (j + 1) & (list->hashsz - 1))
+		    ;
+		list->hash[2 * j] = list->gen;
+		list->hash[2 * j + 1] = i;
+	    }
+	}
+
+	h = key_hash(k, keysz);
+	for (j = h & (list->hashsz - 1); ; j = (j + 1) & (list->hashsz - 1)) {
+	    slot = &list->hash[2 * j];
+	    if (slot[0] != list->gen)
+		break;
+	    if (memcmp(list->seen + slot[1] * keysz, k, keysz) == 0)
+		return 0;
+	}
+	if (list->nseen == list->seenalloc)
+	    list->seen = (unsigned char *)nfa_grow(interp, list->seen,
+	    	&list->seenalloc, list->nseen + 1, keysz);
+	memcpy(list->seen + list->nseen * keysz, k, keysz);
+	slot[0] = list->gen;
+	slot[1] = list->nseen++;
+	return 1;
+}
+
+/* Appends a thread to the end of a list */
+static void
+list_append(nfa, list, k, caps)
+	struct nfa *nfa;
+	struct nfa_list *list;
+	const unsigned char *k;
+	const struct capture *caps;
+{
+	struct SEE_interpreter *interp = nfa->interp;
+	unsigned int keysz = nfa->re->keysz, alloc;
+
+	if (list->n == list->alloc) {
+	    alloc = list->alloc;
+	    list->keys = (unsigned char *)nfa_grow(interp, list->keys, 
+	    	&list->alloc, list->n + 1, keysz);
+	    if (nfa->ncaps)
+		list->caps = (struct capture *)nfa_grow(interp, list->caps,
+		    &alloc, list->n + 1, 
+		    nfa->ncaps * sizeof (struct capture));
+	}
+	memcpy(list->keys + list->n * keysz, k, keysz);
+	memcpy(list->caps + list->n * nfa->ncaps, caps,
+	    nfa->ncaps * sizeof (struct capture));
+	list->n++;
+}
+
+/* Saves a copy of the thread being followed, to continue at addr later */
+static void
+nfa_push(nfa, addr)
+	struct nfa *nfa;
+	unsigned int addr;
+{
+	unsigned char *e;
+
+	if (nfa->nstack == nfa->stackalloc)
+	    nfa->stack = (unsigned char *)nfa_grow(nfa->interp, nfa->stack,
+	    	&nfa->stackalloc, nfa->nstack + 1, nfa->esz);
+	e = nfa->stack + nfa->nstack++ * nfa->esz;
+	memcpy(e, nfa->cur, nfa->esz);
+	e += nfa->ncaps * sizeof (struct capture);
+	KEY_SETADDR(e, addr);
+}
+
+/*
+ * Follows the thread in state key through the instructions that don't
+ * consume text at position index, and appends the threads that arrive
+ * at OP_CHAR or OP_SUCCEED to the list, in the order the backtracker
+ * would try them. A thread that reaches a state already seen at this
+ * position is dropped, since an earlier thread will do the same.
+ * If caps is NULL, captures are not kept.
+ */
+static void
+nfa_add(nfa, list, key, caps, index, in)
+	struct nfa *nfa;
+	struct nfa_list *list;
+	const unsigned char *key;
+	const struct capture *caps;
+	unsigned int index;
+	struct nfa_input *in;
+{
+	struct nfa_regex *re = nfa->re;
+	struct ecma_regex *ecma = re->ecma;
+	unsigned char *code = ecma->code;
+	unsigned int capsz = nfa->ncaps * sizeof (struct capture);
+	struct capture *c = (struct capture *)nfa->cur;
+	unsigned char *k = nfa->cur + capsz;
+	unsigned int addr, next, a = 0, i = 0, i2 = 0, i3 = 0, v;
+	int multiline = (ecma->flags & FLAG_MULTILINE) != 0;
+	unsigned char op;
+
+	if (caps)
+	    memcpy(c, caps, capsz);
+	memcpy(k, key, re->keysz);
+
+	for (;;) {
+	    if (!list_seen(nfa, list, k))
+		goto drop;
+
+	    addr = KEY_ADDR(k);
+	    op = code[addr];
+	    next = addr + _SEE_ecma_insnlen(op);
+	    switch (op) {
+	    case OP_ZERO:	case OP_START:	case OP_END:
+	    case OP_MARK:	case OP_FDIST:
+		i = CODE_MAKEI(code, addr + 1);
+		break;
+	    case OP_REACH:	case OP_NREACH:	case OP_UNDEF:
+		i = CODE_MAKEI(code, addr + 1);
+		i2 = CODE_MAKEI(code, addr + 1 + CODE_SZI);
+		break;
+	    case OP_RDIST:
+		i = CODE_MAKEI(code, addr + 1);
+		i2 = CODE_MAKEI(code, addr + 1 + CODE_SZI);
+		i3 = CODE_MAKEI(code, addr + 1 + 2 * CODE_SZI);
+		break;
+	    case OP_MNEXT:	case OP_RNEXT:
+		i = CODE_MAKEI(code, addr + 1);
+		i2 = CODE_MAKEI(code, addr + 1 + CODE_SZI);
+		a = CODE_MAKEA(code, addr + 1 + 2 * CODE_SZI);
+		break;
+	    case OP_GOTO:	case OP_GF:	case OP_NF:
+		a = CODE_MAKEA(code, addr + 1);
+		break;
+	    }
+
+	    switch (op) {
+	    case OP_CHAR:
+	    case OP_SUCCEED:	list_append(nfa, list, k, c);
+				goto drop;
+
+	    case OP_FAIL:	goto drop;
+
+	    case OP_ZERO:	KEY_SETCOUNTER(k, i, 0);
+				break;
+
+	    case OP_REACH:	if (KEY_COUNTER(k, i) < i2)
+				    goto drop;
+				break;
+
+	    case OP_NREACH:	if (KEY_COUNTER(k, i) >= i2)
+				    goto drop;
+				break;
+
+	    case OP_START:	if (caps) {
+				    c[i].start = index;
+				    c[i].end = -1;
+				}
+				break;
+
+	    case OP_END:	if (caps)
+				    c[i].end = index;
+				break;
+
+	    case OP_UNDEF:	if (caps)
+				    for (; i < i2; i++)
+					c[i].start = c[i].end = -1;
+				break;
+
+	    case OP_MARK:	KEY_SETMARK(re, k, i);
+				break;
+
+	    case OP_FDIST:	if (KEY_MARK(re, k, i))
+				    goto drop;
+				break;
+
+	    case OP_RDIST:	if (KEY_MARK(re, k, i) && 
+				    KEY_COUNTER(k, i2) >= i3)
+				    goto drop;
+				break;
+
+	    case OP_MNEXT:	v = KEY_COUNTER(k, i);
+				if (v < i2)
+				    KEY_SETCOUNTER(k, i, v + 1);
+				next = a;
+				break;
+
+	    case OP_RNEXT:	v = KEY_COUNTER(k, i) + 1;
+				KEY_SETCOUNTER(k, i, v);
+				if (v < i2)
+				    next = a;
+				break;
+
+	    case OP_GOTO:	next = a;
+				break;
+
+	    /* follow next first, and a after all it leads to */
+	    case OP_GF:		nfa_push(nfa, a);
+				break;
+
+	    case OP_NF:		nfa_push(nfa, next);
+				next = a;
+				break;
+
+	    case OP_BOL:	if (!(in->prev & IN_EDGE) &&
+				    !(multiline && (in->prev & IN_LT)))
+				    goto drop;
+				break;
+
+	    case OP_EOL:	if (!(in->next & IN_EDGE) &&
+				    !(multiline && (in->next & IN_LT)))
+				    goto drop;
+				break;
+
+	    case OP_BRK:	if (!(in->prev & IN_WORD) == 
+				    !(in->next & IN_WORD))
+				    goto drop;
+				break;
+
+	    case OP_NBRK:	if (!(in->prev & IN_WORD) != 
+				    !(in->next & IN_WORD))
+				    goto drop;
+				break;
+
+	    default:
+				SEE_error_throw_string(nfa->interp, 
+				    nfa->interp->Error, STR(internal_error));
+	    }
+	    KEY_SETADDR(k, next);
+	    continue;
+
+	drop:
+	    /* Take up the thread saved most recently */
+	    if (nfa->nstack == 0)
+		return;
+	    nfa->nstack--;
+	    memcpy(nfa->cur, nfa->stack + nfa->nstack * nfa->esz, nfa->esz);
+	}
+}
+
+/*
+ * Runs all the threads together from position start, and returns
+ * true if one succeeds, with its captures. If anchored is false, a 
+ * new thread is started at each position until a match is found,
+ * so that the leftmost match is found.
+ */
+static int
+nfa_run(nfa, text, start, anchored, capture_ret)
+	struct nfa *nfa;
+	struct SEE_string *text;
+	unsigned int start;
+	int anchored;
+	struct capture *capture_ret;
+{
+	struct nfa_regex *re = nfa->re;
+	struct ecma_regex *ecma = re->ecma;
+	struct nfa_list *clist = &nfa->list[0], *nlist = &nfa->list[1], *l;
+	struct nfa_input in, nin;
+	struct capture *caps, *c;
+	unsigned char *k, *tk;
+	unsigned int i, t, addr, ncaps = nfa->ncaps;
+	int matched = 0;
+
+	caps = (struct capture *)nfa->tmp;
+	tk = nfa->tmp + ncaps * sizeof (struct capture);
+	list_clear(nfa->interp, clist);
+	nfa_input(re, text, start, &in);
+	for (i = start; ; i += in.len, in = nin) {
+	    if (!matched && !anchored && clist->n == 0) {
+		/* No thread is alive: go to where one could start */
+		t = nfa_skip(re, text, i);
+		if (t > text->length)
+		    break;
+		if (t != i) {
+		    i = t;
+		    nfa_input(re, text, i, &in);
+		}
+	    }
+	    if (!matched && (!anchored || i == start)) {
+		caps[0].start = i;
+		caps[0].end = -1;
+		for (t = 1; t < ncaps; t++)
+		    caps[t].start = caps[t].end = -1;
+		nfa_add(nfa, clist, re->startkey, caps, i, &in);
+	    }
+	    if (clist->n == 0 && (matched || anchored))
+		break;
+
+	    if (i < text->length)
+		nfa_input(re, text, i + in.len, &nin);
+	    list_clear(nfa->interp, nlist);
+	    for (t = 0; t < clist->n; t++) {
+		k = clist->keys + t * re->keysz;
+		c = clist->caps + t * ncaps;
+		addr = KEY_ADDR(k);
+		if (ecma->code[addr] == OP_SUCCEED) {
+		    /* Threads after this one can only give worse matches */
+		    matched = 1;
+		    memcpy(capture_ret, c, ncaps * sizeof (struct capture));
+		    capture_ret[0].end = i;
+		    break;
+		}
+		if (i < text->length && _SEE_ecma_cc_contains(
+		    ecma->cc[CODE_MAKEI(ecma->code, addr + 1)], in.ch))
+		{
+		    memcpy(tk, k, re->keysz);
+		    KEY_SETADDR(tk, addr + 1 + CODE_SZI);
+		    memset(tk + re->markoff, 0, re->keysz - re->markoff);
+		    nfa_add(nfa, nlist, tk, c, i + in.len, &nin);
+		}
+	    }
+	    if (i >= text->length)
+		break;
+	    l = clist; clist = nlist; nlist = l;
+	}
+	return matched;
+}
+
+/* Discards all the states of a DFA */
+static void
+dfa_flush(interp, dfa)
+	struct SEE_interpreter *interp;
+	struct dfa *dfa;
+{
+	struct dstate *s, *snext;
+	unsigned int i;
+
+	for (i = 0; i < DFA_HASHSZ; i++) {
+	    for (s = dfa->tab[i]; s; s = snext) {
+		snext = s->hnext;
+		if (s->keys)
+		    SEE_free(interp, (void **)&s->keys);
+		SEE_free(interp, (void **)&s->next);
+		SEE_free(interp, (void **)&s);
+	    }
+	    dfa->tab[i] = NULL;
+	}
+	dfa->nstates = 0;
+	dfa->flushes++;
+}
+
+/* Returns the DFA state for the sorted thread states keys[] */
+static struct dstate *
+dfa_state(nfa, dfa, keys, nkeys, prev)
+	struct nfa *nfa;
+	struct dfa *dfa;
+	unsigned char *keys;
+	unsigned int nkeys;
+	int prev;
+{
+	struct SEE_interpreter *interp = nfa->interp;
+	unsigned int len = nkeys * nfa->re->keysz, h, i;
+	struct dstate *s;
+
+	h = key_hash(keys, len) ^ prev;
+	for (s = dfa->tab[h % DFA_HASHSZ]; s; s = s->hnext)
+	    if (s->hash == h && s->prev == prev && s->nkeys == nkeys &&
+	    	memcmp(s->keys, keys, len) == 0)
+		    return s;
+
+	if (dfa->nstates >= DFA_MAXSTATES)
+	    dfa_flush(interp, dfa);
+	s = SEE_NEW(interp, struct dstate);
+	s->hash = h;
+	s->prev = prev;
+	s->nkeys = nkeys;
+	if (nkeys) {
+	    s->keys = SEE_NEW_STRING_ARRAY(interp, unsigned char, len);
+	    memcpy(s->keys, keys, len);
+	} else
+	    s->keys = NULL;
+	s->next = SEE_NEW_ARRAY(interp, struct dstate *, 
+		nfa->re->nclasses + 1);
+	for (i = 0; i <= nfa->re->nclasses; i++)
+	    s->next[i] = NULL;
+	s->hnext = dfa->tab[h % DFA_HASHSZ];
+	dfa->tab[h % DFA_HASHSZ] = s;
+	dfa->nstates++;
+	return s;
+}
+
+/* Sorts n keys of keysz bytes into order, using tmp to hold one */
+static void
+keys_sort(keys, n, keysz, tmp)
+	unsigned char *keys;
+	unsigned int n, keysz;
+	unsigned char *tmp;
+{
+	unsigned int i, j;
+
+	for (i = 1; i < n; i++) {
+	    memcpy(tmp, keys + i * keysz, keysz);
+	    for (j = i; j > 0 && 
+	    	memcmp(keys + (j - 1) * keysz, tmp, keysz) > 0; j--)
+		memcpy(keys + j * keysz, keys + (j - 1) * keysz, keysz);
+	    memcpy(keys + j * keysz, tmp, keysz);
+	}
+}
+
+/*
+ * Works out the DFA state that follows s on the input cls, or 
+ * &dstate_match if a match ends before the input. Input nclasses
+ * is the end of the text, after which &dstate_fail follows.
+ */
+static struct dstate *
+dfa_next(nfa, dfa, s, cls)
+	struct nfa *nfa;
+	struct dfa *dfa;
+	struct dstate *s;
+	unsigned int cls;
+{
+	struct nfa_regex *re = nfa->re;
+	struct ecma_regex *ecma = re->ecma;
+	struct nfa_list *list = &nfa->list[0], *nlist = &nfa->list[1];
+	struct nfa_input in;
+	struct dstate *t;
+	unsigned int i, addr, flushes;
+	unsigned char *k, *tk;
+
+	in.prev = s->prev;
+	if (cls == re->nclasses) {
+	    in.next = IN_EDGE;
+	    in.ch = 0;
+	} else {
+	    in.next = cls & (IN_WORD | IN_LT);
+	    in.ch = re->bounds[cls / 4];
+	}
+	in.len = 0;
+
+	/* The threads alive, then a new one */
+	list_clear(nfa->interp, list);
+	for (i = 0; i < s->nkeys; i++)
+	    nfa_add(nfa, list, s->keys + i * re->keysz, NULL, 0, &in);
+	nfa_add(nfa, list, re->startkey, NULL, 0, &in);
+
+	tk = nfa->tmp;
+	list_clear(nfa->interp, nlist);
+	for (i = 0; i < list->n; i++) {
+	    k = list->keys + i * re->keysz;
+	    addr = KEY_ADDR(k);
+	    if (ecma->code[addr] == OP_SUCCEED) {
+		t = &dstate_match;
+		goto out;
+	    }
+	    if (cls != re->nclasses && _SEE_ecma_cc_contains(
+		ecma->cc[CODE_MAKEI(ecma->code, addr + 1)], in.ch))
+	    {
+		memcpy(tk, k, re->keysz);
+		KEY_SETADDR(tk, addr + 1 + CODE_SZI);
+		memset(tk + re->markoff, 0, re->keysz - re->markoff);
+		(void)list_seen(nfa, nlist, tk);
+	    }
+	}
+	if (cls == re->nclasses) {
+	    t = &dstate_fail;
+	    goto out;
+	}
+
+	keys_sort(nlist->seen, nlist->nseen, re->keysz, tk);
+	flushes = dfa->flushes;
+	t = dfa_state(nfa, dfa, nlist->seen, nlist->nseen, in.next);
+	if (dfa->flushes != flushes)
+	    return t;			/* s has gone */
+    out:
+	s->next[cls] = t;
+	return t;
+}
+
+/*
+ * Runs the DFA over the text from start to find out whether there is
+ * a match. Returns 1 if there is, 0 if there isn't, or -1 if the DFA
+ * kept running out of room. When there is a match, *fromp is set to
+ * a position before which no match can start.
+ */
+static int
+dfa_scan(nfa, dfa, text, start, fromp)
+	struct nfa *nfa;
+	struct dfa *dfa;
+	struct SEE_string *text;
+	unsigned int start, *fromp;
+{
+	struct nfa_regex *re = nfa->re;
+	struct nfa_input in;
+	struct dstate *s, *t;
+	unsigned int i, j, cls, len, from = start;
+	unsigned int flushes = dfa->flushes;
+	SEE_char_t c;
+
+	s = dfa_state(nfa, dfa, NULL, 0, 
+	    start == 0 ? IN_EDGE : IN_FLAGS(text->data[start - 1]));
+	for (i = start; ; i += len) {
+	    if (s->nkeys == 0) {
+		/* No thread is alive: go to where one could start */
+		j = nfa_skip(re, text, i);
+		if (j > text->length)
+		    return 0;
+		if (j != i) {
+		    i = j;
+		    s = dfa_state(nfa, dfa, NULL, 0, 
+		    	IN_FLAGS(text->data[i - 1]));
+		}
+		from = i;
+	    }
+	    if (i >= text->length) {
+		cls = re->nclasses;
+		len = 0;
+	    } else if ((c = text->data[i]) < 256) {
+		cls = re->latin1[c];
+		len = 1;
+	    } else {
+		nfa_input(re, text, i, &in);
+		cls = 4 * nfa_interval(re, in.ch) + in.next;
+		len = in.len;
+	    }
+	    t = s->next[cls];
+	    if (!t) {
+		t = dfa_next(nfa, dfa, s, cls);
+		if (dfa->flushes - flushes > DFA_MAXFLUSH)
+		    return -1;
+	    }
+	    if (t == &dstate_match) {
+		*fromp = from;
+		return 1;
+	    }
+	    if (t == &dstate_fail)
+		return 0;
+	    s = t;
+	}
+}
+
+/* Returns the number of capture parentheses in the compiled regex */
+static int
+nfa_regex_count_captures(aregex)
+	struct regex *aregex;
+{
+	return NFA_CAST(aregex)->ecma->ncaptures;
+}
+
+/* Returns the flags of the regex object */
+static int
+nfa_regex_get_flags(aregex)
+	struct regex *aregex;
+{
+	return NFA_CAST(aregex)->ecma->flags;
+}
+
+/*
+ * Executes the regex on the text beginning at index.
+ * Returns true if a match was successful.
+ */
+static int
+nfa_regex_match(interp, aregex, text, index, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *aregex;
+	struct SEE_string *text;
+	unsigned int index;
+	struct capture *capture_ret;
+{
+	struct nfa nfa;
+	int success;
+
+	if (SEE_system.periodic)
+	    (*SEE_system.periodic)(interp);
+	nfa_init(&nfa, interp, NFA_CAST(aregex));
+	success = nfa_run(&nfa, text, index, 1, capture_ret);
+	nfa_fini(&nfa);
+	return success;
+}
+
+/*
+ * Finds the leftmost match at or after index start. The DFA cache is
+ * only used by the interpreter that parsed the regex, because copies
+ * of that interpreter share the regex (see SEE_interpreter_clone).
+ */
+static int
+nfa_regex_search(interp, aregex, text, start, capture_ret)
+	struct SEE_interpreter *interp;
+	struct regex *aregex;
+	struct SEE_string *text;
+	unsigned int start;
+	struct capture *capture_ret;
+{
+	struct nfa_regex *re = NFA_CAST(aregex);
+	struct dfa local, *dfa;
+	struct nfa nfa;
+	unsigned int from = start;
+	int found = -1;
+
+	if (start > text->length)
+	    return 0;
+	if (re->ecma->literal && re->ecma->literalpos != 0 &&
+	    _SEE_ecma_literal_find(re->ecma, text, start) < 0)
+		return 0;		/* every match contains the literal */
+	if (SEE_system.periodic)
+	    (*SEE_system.periodic)(interp);
+	nfa_init(&nfa, interp, re);
+	if (re->dfa) {
+	    if (interp == re->regex.interp)
+		dfa = re->dfa;
+	    else {
+		memset(&local, 0, sizeof local);
+		dfa = &local;
+	    }
+	    found = dfa_scan(&nfa, dfa, text, start, &from);
+	    if (dfa == &local)
+		dfa_flush(interp, dfa);
+	}
+	if (found)
+	    found = nfa_run(&nfa, text, from, 0, capture_ret);
+	nfa_fini(&nfa);
+	return found;
+}
+
+const struct SEE_regex_engine _SEE_nfa_regex_engine = {
+	NULL,				/* no init */
+	nfa_regex_parse,
+	nfa_regex_count_captures,
+	nfa_regex_get_flags,
+	nfa_regex_match,
+	nfa_regex_search
+};
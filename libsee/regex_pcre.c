@@ -90,7 +90,8 @@ const struct SEE_regex_engine _SEE_pcre_regex_engine = {
 	regex_pcre_parse,
 	regex_pcre_count_captures,
 	regex_pcre_get_flags,
-	regex_pcre_match
+	regex_pcre_match,
+	NULL				/* no search */
 };
 
 /* Called by PCRE to allocate memory */
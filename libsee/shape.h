@@ -0,0 +1,38 @@
+/* Copyright (c) 2003, David Leonard. All rights reserved. */
+
+#ifndef _SEE_h_shape_
+#define _SEE_h_shape_
+
+struct SEE_interpreter;
+struct SEE_object;
+struct SEE_string;
+struct SEE_value;
+struct SEE_shape;
+
+/*
+ * An inline cache is attached to a property access site in compiled
+ * code. It remembers where the property was last found, in terms of
+ * the shapes of the native objects along the prototype chain.
+ * Each site holds a few entries so that it can be polymorphic.
+ */
+#define SEE_IC_WAYS	2	/* entries per site */
+#define SEE_IC_DEPTH	3	/* the object and two of its prototypes */
+
+struct SEE_ic_entry {
+	struct SEE_string *name;		/* NULL if entry unused */
+	struct SEE_shape *shape[SEE_IC_DEPTH];	/* shapes down the chain */
+	unsigned int depth;			/* prototypes to the holder */
+	unsigned int slot;			/* value slot in the holder */
+};
+
+struct SEE_ic {
+	struct SEE_ic_entry entry[SEE_IC_WAYS];
+	unsigned int next;			/* entry to replace next */
+};
+
+void _SEE_native_ic_get(struct SEE_interpreter *interp, struct SEE_ic *ic,
+	struct SEE_object *o, struct SEE_string *prop, struct SEE_value *res);
+void _SEE_native_ic_put(struct SEE_interpreter *interp, struct SEE_ic *ic,
+	struct SEE_object *o, struct SEE_string *prop, struct SEE_value *val);
+
+#endif /* _SEE_h_shape_ */
@@ -29,30 +29,41 @@
  */
 
 /*
- * A simple mark-and-sweep GC that uses an AVL-tree and the system malloc.
- * Currently contains intel/unix-specific specific parts, that could
- * be replaced for other systems.
+ * A mark-and-sweep garbage collector for systems without Boehm GC.
  *
- * sgc_malloc - Allocates memory that will be scanned for pointers.
- * sgc_malloc_atomic - Allocates memory with content that wont be scanned.
- * sgc_malloc_finalizer - Allocates scannable with finalizer function
- *                        that will be called when collected.
- * sgc_atexit - Runs all finalizers and frees all objects.
- * sgc_collect - Perform a collection now, instead of waiting until 
- *			malloc() returns NULL.
- * sgc_add_root - Add foreign memory to scan.
- * sgc_remove_root - Remove memory previously added with sgc_add_root().
+ * Small objects are kept in 16kB pages of equal-sized cells, with a
+ * page for each size class. A page's descriptor has bitmaps of the
+ * cells in use and of the cells reached, and a hash table maps page
+ * addresses to descriptors, so that a word that might be a pointer
+ * is checked in constant time. Larger objects get a run of pages to
+ * themselves. Pointers into the middle of objects keep them alive.
  *
- * TODO:
- *   stack and BSS detection for different platforms
+ * A collection marks everything reachable from the registers, the
+ * stack, the writable segments of the program and its libraries, the
+ * roots added with _SEE_sgc_add_root() and the finalizer closures,
+ * using an explicit mark stack. The small pages are then swept
+ * lazily: each is swept when its size class next needs a free cell,
+ * so that a collection's pause is only as long as its mark.
+ *
+ * Objects with finalizers that are found unreachable are kept for one
+ * more collection, so that their finalizers (run after the collection)
+ * can still see them and what they point to.
+ *
+ * The roots are found with /proc/self/maps and dl_iterate_phdr(), so
+ * the collector only collects on Linux; elsewhere it allocates but
+ * never frees. It is not thread-safe.
  */
 
-#ifdef TEST
-# include <stdio.h>
-# include <unistd.h>
+#if __linux__
+# define _GNU_SOURCE		/* for struct dl_phdr_info */
+#endif
+
+#if HAVE_CONFIG_H
+# include <config.h>
 #endif
 
-#if STDC_INCLUDES
+#if STDC_HEADERS
+# include <stdio.h>
 # include <stdlib.h>
 #endif
 
@@ -60,613 +71,989 @@
 # include <string.h>
 #endif
 
+#if HAVE_LINK_H
+# include <link.h>
+#endif
+
+#include <see/type.h>
 #include <see/try.h>
 
 #include "simple_gc.h"
+#include "dprint.h"
 
-#if TEST
-# define IS_ROOT	,1
-# define IS_NOT_ROOT	,0
-# define TPRINTF(fmt, args...)	fprintf(stderr, fmt , ## args)
+#if __linux__ && HAVE_LINK_H && HAVE_DL_ITERATE_PHDR
+# define CAN_COLLECT	1
 #else
-# define IS_ROOT		/* nothing */
-# define IS_NOT_ROOT		/* nothing */
-# define TPRINTF(fmt, args...)	/* nothing */
+# define CAN_COLLECT	0
 #endif
 
-/* Linked list of roots. A root is a memory segment that is always reachable */
+#define SGC_PAGESHIFT	14
+#define SGC_PAGE	((SEE_size_t)1 << SGC_PAGESHIFT)
+#define SGC_GRANULE	16		/* cell sizes are multiples of this */
+#define SGC_MAXCELLS	(SGC_PAGE / SGC_GRANULE)
+#define SGC_MAXSMALL	4096		/* largest object kept in a cell */
+#define SGC_NCLASS	23		/* number of cell sizes */
+#define SGC_BITS	(8 * sizeof (unsigned long))
+#define SGC_BITMAPSZ	(SGC_MAXCELLS / SGC_BITS)
+#define SGC_MAXSPARE	16		/* empty pages kept for reuse */
+
+/* Bytes allocated between collections, at least */
+#ifndef SGC_MIN_TRIGGER
+# define SGC_MIN_TRIGGER (1024 * 1024)
+#endif
+
+#define BIT_TEST(map, i)  ((map)[(i) / SGC_BITS] & (1UL << ((i) % SGC_BITS)))
+#define BIT_SET(map, i)   ((map)[(i) / SGC_BITS] |= 1UL << ((i) % SGC_BITS))
+#define BIT_CLEAR(map, i) ((map)[(i) / SGC_BITS] &= ~(1UL << ((i) % SGC_BITS)))
+
+/* Describes a page of cells, a large object, or a spare page */
+struct page {
+	char *base;			/* SGC_PAGE-aligned start */
+	void *mem;			/* what malloc() returned */
+	SEE_size_t cellsz;		/* cell size, or large object size */
+	SEE_size_t npages;		/* pages spanned */
+	unsigned int ncells;
+	int cls;			/* size class, or CLS_* */
+	unsigned int flags;
+	struct page *next;		/* on a class, large or spare list */
+	unsigned long alloc[SGC_BITMAPSZ];	/* cells in use */
+	unsigned long mark[SGC_BITMAPSZ];	/* cells reached */
+};
+#define CLS_LARGE	(-1)		/* page holds one large object */
+#define CLS_SPARE	(-2)		/* page is empty */
+
+#define PAGE_ATOMIC	1		/* cells never hold pointers */
+#define PAGE_UNSWEPT	2		/* marked but not yet swept */
+
+/* Maps a page number to its descriptor */
+struct pagemap {
+	SEE_size_t key;
+	struct page *page;
+};
+
+/* An extent of memory waiting on the mark stack to be scanned */
+struct span {
+	char *base, *end;
+};
+
+/* An object with a finalizer */
+struct final {
+	char *p;
+	void (*fn)(void *, void *);
+	void *closure;
+};
+
+/* Foreign memory that is always scanned */
 struct root {
 	char *base;
-	unsigned int extent;
+	SEE_size_t extent;
 	struct root *next;
 };
 
-/* Binary tree of allocations. Allocations are collectable memory segments */
-struct allocation {
-	struct allocation *side[2];
-	unsigned int state;	/* mark state and AVL flags */
-	unsigned int extent;	/* sizeof of struct + allocation length */
-	void (*finalizer)(void *);
-	/* char data[]; */
-};
-
-/* State flags */
-#define STATE_AVL       3		/* AVL balance property of the node */
-#define  LEFT	           0
-#define  RIGHT	           1
-#define  BALANCED          2
-#define STATE_MARKED	4		/* Marked during scan() */
-#define STATE_ATOMIC	8		/* Guaranteed not to contain pointers */
-
-#define IS_MARKED(a)	 ((a)->state & STATE_MARKED)
-#define SET_MARK(a)	 (a)->state |= STATE_MARKED
-#define CLEAR_MARK(a)	 (a)->state &= ~STATE_MARKED
-#define IS_ATOMIC(a)	 ((a)->state & STATE_ATOMIC)
-#define GET_BALANCE(a)	 ((a)->state & STATE_AVL) 
-#define SET_BALANCE(a,b) (a)->state = ((a)->state & ~STATE_AVL) | (b)
-
-/* The allocation data immediately follows the allocation */
-#define ALLOCATION_BASE(a) ((char *)(a) + sizeof (struct allocation))
-#define ALLOCATION_LENGTH(a) ((a)->extent - sizeof (struct allocation))
-#define ALLOCATION_END(a) ((char *)(a) + (a)->extent) 
-
-#define ALIGN(a)	((a) & ~(sizeof (void *) - 1))
-
-static void sweep(void);
-static void sweep_sub(struct allocation *);
+static void init(void);
+static unsigned int hash(SEE_size_t);
+static struct page *page_find(const void *);
+static int pagemap_reserve(SEE_size_t);
+static void pagemap_insert(SEE_size_t, struct page *);
+static void pagemap_remove(SEE_size_t);
+static struct page *page_new(SEE_size_t);
+static void page_free(struct page *);
+static void page_release(struct page *);
+static struct page *page_get(void);
+static void page_setup(struct page *, int);
+static unsigned int page_sweep(struct page *);
+static struct page *sweep_next(int);
+static unsigned int next_free(struct page *, unsigned int);
+static struct page *refill(int);
+static void *allocate(SEE_size_t, int);
+static void *allocate_large(SEE_size_t, int);
+static void push(char *, char *);
+static void mark_ptr(char *);
+static void mark_range(char *, char *);
+static void mark_drain(void);
+static void mark_rescan(void);
+static int is_marked(char *);
 static void run_finalizers(void);
-static void machdep_scan(void);
-#if TEST
-static void scan(char *base, unsigned int len, unsigned int isroot);
-#else
-static void scan(char *base, unsigned int len);
+#if CAN_COLLECT
+static int stack_bounds(char *);
+static void mark_stack(void);
+static int mark_data(struct dl_phdr_info *, size_t, void *);
 #endif
-static void allocation_insert(struct allocation *);
-static void allocation_free(struct allocation *);
-static void *allocate(unsigned int sz, int state, void (*finalizer)(void *));
 
-static struct {
-	struct allocation *allocation_root;	/* allocated objects */
-	struct allocation *allocation_finalizing; /* objects pending finalizer */
-	char *allocation_min;
-	char *allocation_max;
-	unsigned int allocation_total_size;
-	unsigned int allocation_total_count;
-	unsigned int collect_at;		/* collect at this size */
-	struct root *user_roots;
-} gc;
+/* Cell sizes, each a multiple of SGC_GRANULE */
+static const unsigned short class_size[SGC_NCLASS] = {
+	16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+	320, 384, 448, 512, 640, 768, 1024, 1360, 2048, 2720, 4096
+};
 
 /*
- * Inserts a new allocation into the AVL binary tree. Takes O(log(n))
- * but is not recursive, and uses constant stack space.
+ * The collector's state. It is skipped when the data segments are
+ * scanned, so that the pointers it holds do not keep objects alive.
+ * Classes below SGC_NCLASS are for scanned objects; those above are
+ * the same sizes for atomic objects.
  */
-static void
-allocation_insert(new_node)
-	struct allocation *new_node;
-{
-	struct allocation **root = &gc.allocation_root;
-	struct allocation **last_imbalance = NULL;
-	struct allocation **n;
-
-	SET_BALANCE(new_node, BALANCED);
-	new_node->side[RIGHT] = NULL;
-	new_node->side[LEFT] = NULL;
-
-	/*
-	 * Search the tree, looking for the leaf to
-	 * attach the new_node too. At the same time,
-	 * we take note of the closest imbalanced
-	 * ancestor.
-	 */
-	n = root;
-	while (*n) {
-	    if (GET_BALANCE(*n) != BALANCED)
-	    	last_imbalance = n;
-	    n = &(*n)->side[new_node < *n];
-	}
-	*n = new_node;
+static struct {
+	int initialised;
+	int collecting;			/* collection under way */
+	int finalizing;			/* finalizers being run */
+	struct page *pages[2 * SGC_NCLASS];	/* small pages */
+	struct page **sweep[2 * SGC_NCLASS];	/* link to next to sweep */
+	struct page *cur[2 * SGC_NCLASS];	/* page being filled */
+	unsigned int curidx[2 * SGC_NCLASS];	/* next cell to try */
+	struct page *large;
+	struct page *spare;
+	unsigned int nspare;
+	struct pagemap *tab;		/* open-addressed page map */
+	unsigned int tabsz, tabcount;
+	char *min, *max;		/* bounds of all pages */
+	struct span *stack;		/* mark stack */
+	unsigned int sp, stacksz;
+	int overflow;			/* mark stack could not grow */
+	struct final *final;		/* objects with finalizers */
+	unsigned int nfinal, finalsz;
+	struct final *ready;		/* finalizers waiting to run */
+	unsigned int nready, readysz;
+	struct root *roots;
+	char *stack_lo, *stack_hi;	/* mapping holding the C stack */
+	SEE_size_t heapsz;		/* bytes in pages */
+	SEE_size_t live;		/* bytes marked by last collection */
+	SEE_size_t allocated;		/* bytes allocated since then */
+	SEE_size_t trigger;		/* allocation that starts the next */
+	unsigned long collections;
+	unsigned char class_of[SGC_MAXSMALL / SGC_GRANULE + 1];
+} gc;
 
-	if (last_imbalance) {
-	    n = last_imbalance;
-	    if (GET_BALANCE(*n) == BALANCED) {
-	    	/* nothing to do, root node is balanced */
-	    } else {
-	    	unsigned int dir = new_node < *n;
-		struct allocation **n1 = &(*n)->side[dir];
-	        if (GET_BALANCE(*n) != dir) {
-		    /* counter-imbalance is corrected to balanced */
-		    SET_BALANCE(*n, BALANCED);
-		    n = n1;
-		} else {
-		    unsigned int dir1 = new_node < *n1;
-		    struct allocation **n2 = &(*n1)->side[dir1];
-		    if (dir == dir1) {
-			/* aggravated imbalance corrected by single rotation */
-		        struct allocation **n2o = &(*n1)->side[!dir1];
-		    	struct allocation *t = *n;
-			*n = *n1;
-			*n1 = *n2o;
-			*n2o = t;
-			n = n2;
-			SET_BALANCE(t, BALANCED);
-		    } else {
-			/* aggravated imbalance corrected by double rotation */
-		        struct allocation *p = (*n2)->side[dir1];
-		        struct allocation *q = (*n2)->side[dir];
-			unsigned int dir2 = new_node < *n2;
-			(*n2)->side[dir1] = *n;
-			(*n2)->side[dir] = *n1;
-			if (*n2 == new_node) {
-			    SET_BALANCE(*n, BALANCED);
-			    SET_BALANCE(*n1, BALANCED);
-			} else if (dir2 == dir1) {
-			    SET_BALANCE(*n, BALANCED);
-			    SET_BALANCE(*n1, dir);
-			} else {
-			    SET_BALANCE(*n, dir1);
-			    SET_BALANCE(*n1, BALANCED);
-			}
-			*n = *n2;
-			*n1 = p;
-			*n2 = q;
-			n = dir2 == dir1 ? n1 : n2;
-		    }
-		}
-	    }
-	} else
-	    n = root;
-
-	/* 
-	 * Correct the remainder chain of balanced nodes by
-	 * making them all imbalanced towards the new node
-	 */
-	while (*n && *n != new_node) {
-	    SET_BALANCE(*n, new_node < *n);
-	    n = &(*n)->side[new_node < *n];
-	}
+#ifndef NDEBUG
+extern int SEE_mem_debug;
+#endif
 
+/* Sets up the size class lookup table */
+static void
+init()
+{
+	unsigned int i;
+	int c = 0;
 
+	for (i = 0; i <= SGC_MAXSMALL / SGC_GRANULE; i++) {
+	    while (class_size[c] < i * SGC_GRANULE)
+		c++;
+	    gc.class_of[i] = c;
+	}
+	gc.trigger = SGC_MIN_TRIGGER;
+	gc.initialised = 1;
 }
 
-/*
- * Machine-dependent root scan.
+/*------------------------------------------------------------
+ * Page map
  */
-#if __unix__
-static void
-machdep_scan()
-{
-	/* 1. Stack */
-#if __i386__ && __GNUC__
-	/* Intel; assumes stack top never changes (ie no threads) */
-	char *bottom;
-	static char *top = NULL;
-	__asm__("mov %%ebp, %0" : "=g"(bottom));
-	if (!top) {
-		char *sp = bottom;
-		while (*(char **)sp > sp)
-			sp = *(char **)sp;
-		top = sp;
-	}
-	TPRINTF("{stack}");
-	scan(bottom, top - bottom  IS_ROOT);
-#else
-  /* TODO - stack finders for other architectures */
- # warning "Unable to add stack to root set on this architecture"
-#endif
-
-#if 0 /* Turned off because malloc's own pointers are found */
-      /* Better to have the application add static roots */
-
-	/* 2. Static variables */
-#if __unix__ || unix
-# if __linux__ || sun
-#  define __fini _fini
-# endif
-# if hppa || __hppa__
-#  define _init	__data_start
-#  define __fini _edata
-# endif
-# define data_start	_init
-# define data_end	__fini
-# define bss_start	_edata
-# define bss_end	_end
-	{
-	    extern char data_start[], data_end[], bss_start[], bss_end[];
-	    TPRINTF("{data}");
-	    scan(data_start, data_end - data_start  IS_ROOT);
-	    TPRINTF("{bss}");
-	    scan(bss_start, bss_end - bss_start  IS_ROOT);
-	}
-#else /* not unix */
- # warning "Unable to add static storage to root set on this system"
-#endif 
-#endif
 
-    /* Dynamically loaded libraries */
-    /* TODO - detected shared libraries? */
+static unsigned int
+hash(key)
+	SEE_size_t key;
+{
+	return (unsigned int)(key ^ (key >> 12));
 }
-#endif /* unix */
 
-/* Scans the stack, BSS and user roots and then sweeps the allocation tree */
-void
-sgc_collect() 
+/* Returns the descriptor of the page holding an address, or NULL */
+static struct page *
+page_find(p)
+	const void *p;
 {
-	struct root *root;
-	_SEE_JMPBUF jmpbuf;
-#if TEST
-	unsigned int osize = gc.allocation_total_size;
-	unsigned int ocount = gc.allocation_total_count;
-#endif
+	SEE_size_t key = (SEE_size_t)p >> SGC_PAGESHIFT;
+	unsigned int i, mask = gc.tabsz - 1;
 
-	TPRINTF("[collecting...");
+	if (!gc.tabsz)
+	    return NULL;
+	for (i = hash(key) & mask; gc.tab[i].page; i = (i + 1) & mask)
+	    if (gc.tab[i].key == key)
+		return gc.tab[i].page;
+	return NULL;
+}
 
-	/*
-	 * Phase 1: Scan and mark
-	 */
+/* Grows the page map so that n more pages fit; returns 0 on failure */
+static int
+pagemap_reserve(n)
+	SEE_size_t n;
+{
+	struct pagemap *otab = gc.tab;
+	unsigned int i, otabsz = gc.tabsz, nsz;
+
+	if (2 * (gc.tabcount + n) <= gc.tabsz)
+	    return 1;
+	for (nsz = gc.tabsz ? gc.tabsz : 256; nsz < 2 * (gc.tabcount + n); )
+	    nsz *= 2;
+	gc.tab = (struct pagemap *)calloc(nsz, sizeof *gc.tab);
+	if (!gc.tab) {
+	    gc.tab = otab;
+	    return 0;
+	}
+	gc.tabsz = nsz;
+	gc.tabcount = 0;
+	for (i = 0; i < otabsz; i++)
+	    if (otab[i].page)
+		pagemap_insert(otab[i].key, otab[i].page);
+	free(otab);
+	return 1;
+}
 
-	/* Scan the unspilt registers */
-	memset(&jmpbuf, 0, sizeof jmpbuf);
-	_SEE_SETJMP(jmpbuf);
-        TPRINTF("{registers}");
-        scan((char *)&jmpbuf, sizeof jmpbuf  IS_ROOT);
+static void
+pagemap_insert(key, pg)
+	SEE_size_t key;
+	struct page *pg;
+{
+	unsigned int i, mask = gc.tabsz - 1;
 
-	/* Scan the stack, data and BSS */
-	machdep_scan();
+	for (i = hash(key) & mask; gc.tab[i].page; i = (i + 1) & mask)
+	    ;
+	gc.tab[i].key = key;
+	gc.tab[i].page = pg;
+	gc.tabcount++;
+}
 
-	/* Scan the user-supplied roots */
-        TPRINTF("{users}");
-	for (root = gc.user_roots; root; root = root->next)
-		scan(root->base, root->extent  IS_ROOT);
+/* Removes a page number, shifting back the entries probed past it */
+static void
+pagemap_remove(key)
+	SEE_size_t key;
+{
+	unsigned int i, j, k, mask = gc.tabsz - 1;
 
-	/*
-	 * Phase 2: Sweep and release
-	 */
+	for (i = hash(key) & mask; gc.tab[i].key != key; i = (i + 1) & mask)
+	    ;
+	for (j = i;;) {
+	    j = (j + 1) & mask;
+	    if (!gc.tab[j].page)
+		break;
+	    k = hash(gc.tab[j].key) & mask;
+	    if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+		gc.tab[i] = gc.tab[j];
+		i = j;
+	    }
+	}
+	gc.tab[i].page = NULL;
+	gc.tabcount--;
+}
 
-	/* Rebuild the allocation tree with marked nodes only */
-        TPRINTF("{sweep}");
-	sweep();
+/*------------------------------------------------------------
+ * Pages
+ */
 
-	/* Deal with objects left on the finalizing list */
-        TPRINTF("{final}");
-	run_finalizers();
+/* Allocates a run of pages from the system, or returns NULL */
+static struct page *
+page_new(npages)
+	SEE_size_t npages;
+{
+	struct page *pg;
+	void *mem;
+	SEE_size_t i, len = npages << SGC_PAGESHIFT;
 
-	TPRINTF(" freed %d objects %d bytes]\n", 
-		ocount - gc.allocation_total_count,
-		osize - gc.allocation_total_size);
+	if (!pagemap_reserve(npages))
+	    return NULL;
+	pg = (struct page *)malloc(sizeof *pg);
+	if (!pg)
+	    return NULL;
+#if HAVE_POSIX_MEMALIGN
+	if (posix_memalign(&mem, SGC_PAGE, len) != 0)
+	    mem = NULL;
+	pg->base = (char *)mem;
+#else
+	mem = malloc(len + SGC_PAGE - 1);
+	pg->base = (char *)(((SEE_size_t)mem + SGC_PAGE - 1) & ~(SGC_PAGE - 1));
+#endif
+	if (!mem) {
+	    free(pg);
+	    return NULL;
+	}
+	pg->mem = mem;
+	pg->npages = npages;
+	pg->flags = 0;
+	memset(pg->alloc, 0, sizeof pg->alloc);
+	memset(pg->mark, 0, sizeof pg->mark);
+	for (i = 0; i < npages; i++)
+	    pagemap_insert(((SEE_size_t)pg->base >> SGC_PAGESHIFT) + i, pg);
+	if (!gc.min || pg->base < gc.min)
+	    gc.min = pg->base;
+	if (pg->base + len > gc.max)
+	    gc.max = pg->base + len;
+	gc.heapsz += len;
+	return pg;
 }
 
-/*
- * Scans the allocation tree, removing nodes that aren't marked, and
- * removing the mark from those that are. Runs in O(n.log(n)).
- * Calling this without a scan frees everything allocated.
- */
+/* Returns pages to the system */
 static void
-sweep()
+page_free(pg)
+	struct page *pg;
 {
-	struct allocation *old_root = gc.allocation_root;
-	
-	gc.allocation_root = NULL;
-	if (old_root)
-	    sweep_sub(old_root);
+	SEE_size_t i;
+
+	for (i = 0; i < pg->npages; i++)
+	    pagemap_remove(((SEE_size_t)pg->base >> SGC_PAGESHIFT) + i);
+	gc.heapsz -= pg->npages << SGC_PAGESHIFT;
+	free(pg->mem);
+	free(pg);
 }
 
-/* Note that this function recurses to a depth of approx 1.5 * log(n). */
+/* Keeps an empty small page for reuse, or frees it */
 static void
-sweep_sub(a)
-	struct allocation *a;
+page_release(pg)
+	struct page *pg;
 {
-	struct allocation *side[2];
+	if (gc.nspare >= SGC_MAXSPARE) {
+	    page_free(pg);
+	    return;
+	}
+	pg->cls = CLS_SPARE;
+	pg->next = gc.spare;
+	gc.spare = pg;
+	gc.nspare++;
+}
 
-	side[0] = a->side[0];
-	side[1] = a->side[1];
+/* Returns an empty page */
+static struct page *
+page_get()
+{
+	struct page *pg;
 
-	if (!IS_MARKED(a)) {
-	    gc.allocation_total_size -= ALLOCATION_LENGTH(a);
-	    gc.allocation_total_count--;
-	    if (a->finalizer) {
-	    	/* Add to the list of finalizers to run later */
-	        a->side[0] = gc.allocation_finalizing;
-	        gc.allocation_finalizing = a;
-	    } else
-	        allocation_free(a);
-	} else {
-	    CLEAR_MARK(a);
-	    allocation_insert(a);
+	if ((pg = gc.spare) != NULL) {
+	    gc.spare = pg->next;
+	    gc.nspare--;
+	    return pg;
 	}
-	if (side[0])
-	    sweep_sub(side[0]);
-	if (side[1])
-	    sweep_sub(side[1]);
+	return page_new(1);
 }
 
-/* Finalize the allocations on the gc.allocation_finalizing list then free them */
+/* Turns an empty page into cells of a size class */
 static void
-run_finalizers()
+page_setup(pg, c)
+	struct page *pg;
+	int c;
 {
-	struct allocation *a, *anext;
-
-	a = gc.allocation_finalizing;
-	gc.allocation_finalizing = NULL;
+	pg->cls = c;
+	pg->cellsz = class_size[c % SGC_NCLASS];
+	pg->ncells = SGC_PAGE / pg->cellsz;
+	pg->flags = c >= SGC_NCLASS ? PAGE_ATOMIC : 0;
+	memset(pg->alloc, 0, sizeof pg->alloc);
+	memset(pg->mark, 0, sizeof pg->mark);
+	pg->next = gc.pages[c];
+	gc.pages[c] = pg;
+}
 
-	while (a) {
-	    anext = a->side[0];
-	    (*a->finalizer)((void *)ALLOCATION_BASE(a));
-	    allocation_free(a);
-	    a = anext;
+/* Frees a page's unmarked cells and returns how many cells are in use */
+static unsigned int
+page_sweep(pg)
+	struct page *pg;
+{
+	unsigned int k, n = 0;
+	unsigned long w;
+
+	for (k = 0; k < SGC_BITMAPSZ; k++) {
+	    w = pg->alloc[k] = pg->mark[k];
+	    pg->mark[k] = 0;
+	    for (; w; w &= w - 1)
+		n++;
 	}
+	pg->flags &= ~PAGE_UNSWEPT;
+	return n;
 }
 
-/* Scans a segment of memory and recursively marks/scans reached allocations */
-static void
-#if TEST
-scan(base, len, isroot)
-	char *base;
-	unsigned int len, isroot;
-#else
-scan(base, len)
-	char *base;
-	unsigned int len;
-#endif
+/*
+ * Sweeps the pages of a size class left by the last collection,
+ * until one with free cells is found. Pages found empty are released.
+ */
+static struct page *
+sweep_next(c)
+	int c;
 {
-	char **p;
+	struct page **link, *pg;
+	unsigned int n;
 
-	for (p = (char **)ALIGN((unsigned int)base); 
-	     (char *)p + sizeof *p < base + len; 
-	     p++)
-	{
-	    /* Don't scan GC-private storage */
-	    if (p >= (char **)&gc && p < (char **)(&gc + 1))
-	    	continue;
-	    if (*p >= gc.allocation_min && *p < gc.allocation_max)
-	    {
-	    	/* Looks like a pointer into an allocation; search O(log(n)) */
-	    	struct allocation *a = gc.allocation_root;
-	        while (a) 
-			if (*p < (char *)a)
-				a = a->side[RIGHT];
-			else if (*p >= ALLOCATION_END(a))
-				a = a->side[LEFT];
-			else {
-			    /* Found the allocation pointed to */
-			    if (!IS_MARKED(a) && *p >= ALLOCATION_BASE(a)) {
-#if TEST
-				if (isroot) 
-				    TPRINTF("%p reached by %p in [%p/%u]\n", 
-				        ALLOCATION_BASE(a), p, base, len);
-#endif
-				SET_MARK(a);
-				if (!IS_ATOMIC(a))
-				    scan(ALLOCATION_BASE(a), 
-				         ALLOCATION_LENGTH(a) IS_NOT_ROOT);
-			    }
-			    break;
-			}
-	     }
+	while ((link = gc.sweep[c]) != NULL && (pg = *link) != NULL) {
+	    if (!(pg->flags & PAGE_UNSWEPT)) {
+		gc.sweep[c] = &pg->next;
+		continue;
+	    }
+	    n = page_sweep(pg);
+	    if (n == 0) {
+		*link = pg->next;
+		page_release(pg);
+		continue;
+	    }
+	    gc.sweep[c] = &pg->next;
+	    if (n < pg->ncells)
+		return pg;
 	}
+	gc.sweep[c] = NULL;
+	return NULL;
 }
 
-/* Creates a new allocation */
-static void *
-allocate(len, init_state, finalizer)
-	unsigned int len;
-	int init_state;
-	void (*finalizer)(void *);
+/* Returns the index of the first free cell at or after i */
+static unsigned int
+next_free(pg, i)
+	struct page *pg;
+	unsigned int i;
 {
-	struct allocation *newa;
+	unsigned long w;
+
+	while (i < pg->ncells) {
+	    w = ~pg->alloc[i / SGC_BITS] >> (i % SGC_BITS);
+	    if (w) {
+		while (!(w & 1)) {
+		    w >>= 1;
+		    i++;
+		}
+		return i;
+	    }
+	    i += SGC_BITS - i % SGC_BITS;
+	}
+	return pg->ncells;
+}
 
-	/* Don't allocate empty objects */
-	if (len == 0) {
-	    /* NB: finalizer is NOT run */
-	    return NULL;
+/*------------------------------------------------------------
+ * Allocation
+ */
+
+/* Finds or makes a page with free cells for a size class */
+static struct page *
+refill(c)
+	int c;
+{
+	struct page *pg;
+
+	if ((pg = sweep_next(c)) != NULL)
+	    return pg;
+	if (gc.allocated >= gc.trigger) {
+	    _SEE_sgc_collect();
+	    if ((pg = sweep_next(c)) != NULL)
+		return pg;
+	}
+	if ((pg = page_get()) == NULL) {
+	    /* Out of system memory; try to find some */
+	    _SEE_sgc_collect();
+	    if ((pg = sweep_next(c)) != NULL)
+		return pg;
+	    if ((pg = page_get()) == NULL)
+		return NULL;
 	}
+	page_setup(pg, c);
+	return pg;
+}
 
-	/* Collect when we have allocated twice as much as last time */
-	if (gc.allocation_total_size >= gc.collect_at) {
-	    sgc_collect();
-	    gc.collect_at = gc.collect_at * 3 / 2;
-	    if (gc.collect_at == 0) gc.collect_at = 1024;
+static void *
+allocate(size, atomic)
+	SEE_size_t size;
+	int atomic;
+{
+	struct page *pg;
+	unsigned int i;
+	int c;
+	char *p;
+
+	if (!gc.initialised)
+	    init();
+	if (size > SGC_MAXSMALL)
+	    return allocate_large(size, atomic);
+
+	c = gc.class_of[(size + SGC_GRANULE - 1) / SGC_GRANULE];
+	if (atomic)
+	    c += SGC_NCLASS;
+	for (;;) {
+	    pg = gc.cur[c];
+	    if (pg && (i = next_free(pg, gc.curidx[c])) < pg->ncells)
+		break;
+	    if ((pg = refill(c)) == NULL)
+		return NULL;
+	    gc.cur[c] = pg;
+	    gc.curidx[c] = 0;
 	}
+	BIT_SET(pg->alloc, i);
+	gc.curidx[c] = i + 1;
+	gc.allocated += pg->cellsz;
+	p = pg->base + i * pg->cellsz;
+	if (!atomic)
+	    memset(p, 0, pg->cellsz);
+	return p;
+}
 
-	/* Call system malloc; if exhausted, collect and retry */
-	newa = (struct allocation *)malloc(sizeof *newa + len);
-	if (!newa) {
-	    sgc_collect();
-	    newa = (struct allocation *)malloc(sizeof *newa + len);
-	    if (!newa)
-	        return NULL;
+/* Allocates an object too big for a cell in pages of its own */
+static void *
+allocate_large(size, atomic)
+	SEE_size_t size;
+	int atomic;
+{
+	struct page *pg;
+	SEE_size_t npages = (size + SGC_PAGE - 1) >> SGC_PAGESHIFT;
+
+	if (gc.allocated >= gc.trigger)
+	    _SEE_sgc_collect();
+	if ((pg = page_new(npages)) == NULL) {
+	    _SEE_sgc_collect();
+	    if ((pg = page_new(npages)) == NULL)
+		return NULL;
 	}
+	pg->cls = CLS_LARGE;
+	pg->cellsz = size;
+	pg->ncells = 1;
+	pg->flags = atomic ? PAGE_ATOMIC : 0;
+	BIT_SET(pg->alloc, 0);
+	pg->next = gc.large;
+	gc.large = pg;
+	gc.allocated += npages << SGC_PAGESHIFT;
+	if (!atomic)
+	    memset(pg->base, 0, size);
+	return pg->base;
+}
+
+/*------------------------------------------------------------
+ * Marking
+ */
 
-	/* Fill in the allocation header and insert into allocation tree */
-	newa->extent = sizeof *newa + len;
-	newa->state = init_state;
-	newa->finalizer = finalizer;
-	allocation_insert(newa); /* O(log(n)) */
+/* Pushes an object's extent onto the mark stack */
+static void
+push(base, end)
+	char *base, *end;
+{
+	struct span *nstack;
+	unsigned int nsz;
+
+	if (gc.sp == gc.stacksz) {
+	    nsz = gc.stacksz ? 2 * gc.stacksz : 1024;
+	    nstack = (struct span *)realloc(gc.stack, nsz * sizeof *nstack);
+	    if (!nstack) {
+		/* Dropped; mark_drain() will find it again */
+		gc.overflow = 1;
+		return;
+	    }
+	    gc.stack = nstack;
+	    gc.stacksz = nsz;
+	}
+	gc.stack[gc.sp].base = base;
+	gc.stack[gc.sp].end = end;
+	gc.sp++;
+}
 
-	/* Accounting */
-	gc.allocation_total_size += ALLOCATION_LENGTH(newa);
-	gc.allocation_total_count++;
-	if (!gc.allocation_min || ALLOCATION_BASE(newa) < gc.allocation_min)
-		gc.allocation_min = ALLOCATION_BASE(newa);
-	if (ALLOCATION_END(newa) >= gc.allocation_max)
-		gc.allocation_max = ALLOCATION_END(newa);
+/* Marks the object that a word points into, if any */
+static void
+mark_ptr(q)
+	char *q;
+{
+	struct page *pg;
+	SEE_size_t off;
+	unsigned int i;
+	char *obj;
 
-	return ALLOCATION_BASE(newa);
+	if (q < gc.min || q >= gc.max || (pg = page_find(q)) == NULL)
+	    return;
+	off = q - pg->base;
+	if (pg->cls >= 0) {
+	    i = off / pg->cellsz;
+	    if (i >= pg->ncells)
+		return;
+	} else if (pg->cls == CLS_LARGE && off < pg->cellsz)
+	    i = 0;
+	else
+	    return;
+	if (!BIT_TEST(pg->alloc, i) || BIT_TEST(pg->mark, i))
+	    return;
+	BIT_SET(pg->mark, i);
+	gc.live += pg->cellsz;
+	if (!(pg->flags & PAGE_ATOMIC)) {
+	    obj = pg->base + i * pg->cellsz;
+	    push(obj, obj + pg->cellsz);
+	}
 }
 
-/* Called when an allocation is deemed unreachable after sweeping */
+/* Marks from every aligned word in an extent of memory */
 static void
-allocation_free(a)
-	struct allocation *a;
+mark_range(base, end)
+	char *base, *end;
 {
-	free(a);
+	char **p;
+
+	for (p = (char **)(((SEE_size_t)base + sizeof *p - 1) &
+		~(sizeof *p - 1));
+	     (char *)(p + 1) <= end;
+	     p++)
+	    if (*p >= gc.min && *p < gc.max)
+		mark_ptr(*p);
 }
 
-/* Adds a memory segment to the list of roots scanned during collect */
-void
-sgc_add_root(base, extent)
-	void *base;
-	unsigned int extent;
+/* Scans the objects on the mark stack until everything reached is marked */
+static void
+mark_drain()
 {
-	struct root *root;
-	
-	if (!extent)
-	    return;
-	root = (struct root *)malloc(sizeof (struct root));
-	if (root) {
-	    root->base = (char *)base;
-	    root->extent = extent;
-	    root->next = gc.user_roots;
-	    gc.user_roots = root;
+	struct span s;
+
+	for (;;) {
+	    while (gc.sp) {
+		s = gc.stack[--gc.sp];
+		mark_range(s.base, s.end);
+	    }
+	    if (!gc.overflow)
+		break;
+	    gc.overflow = 0;
+	    mark_rescan();
 	}
 }
 
-/* Removes a previously added memory segment */
-void
-sgc_remove_root(base)
-	void *base;
+/* Rescans every marked object, after the mark stack lost some */
+static void
+mark_rescan()
 {
-	struct root **r;
+	struct page *pg;
+	unsigned int i;
+	int c;
+
+	for (c = 0; c < SGC_NCLASS; c++)
+	    for (pg = gc.pages[c]; pg; pg = pg->next)
+		for (i = 0; i < pg->ncells; i++)
+		    if (BIT_TEST(pg->mark, i))
+			mark_range(pg->base + i * pg->cellsz,
+			    pg->base + (i + 1) * pg->cellsz);
+	for (pg = gc.large; pg; pg = pg->next)
+	    if (!(pg->flags & PAGE_ATOMIC) && BIT_TEST(pg->mark, 0))
+		mark_range(pg->base, pg->base + pg->cellsz);
+}
 
-	for (r = &gc.user_roots; *r; r = &(*r)->next)
-	    if ((*r)->base == (char *)base) {
-	    	struct root *root = *r;
-		*r = root->next;
-		free(root);
-		return;
+/* Tests if the object at p was reached */
+static int
+is_marked(p)
+	char *p;
+{
+	struct page *pg = page_find(p);
+
+	if (pg->cls == CLS_LARGE)
+	    return BIT_TEST(pg->mark, 0) != 0;
+	return BIT_TEST(pg->mark, (p - pg->base) / pg->cellsz) != 0;
+}
+
+#if CAN_COLLECT
+/* Finds the mapping that holds a stack address; returns 0 if none */
+static int
+stack_bounds(sp)
+	char *sp;
+{
+	FILE *f;
+	char line[256];
+	unsigned long lo, hi;
+	int bol = 1;
+
+	if (sp >= gc.stack_lo && sp < gc.stack_hi)
+	    return 1;
+	if ((f = fopen("/proc/self/maps", "r")) == NULL)
+	    return 0;
+	while (fgets(line, sizeof line, f)) {
+	    if (bol && sscanf(line, "%lx-%lx", &lo, &hi) == 2 &&
+		(unsigned long)sp >= lo && (unsigned long)sp < hi)
+	    {
+		gc.stack_lo = (char *)lo;
+		gc.stack_hi = (char *)hi;
+		fclose(f);
+		return 1;
 	    }
+	    bol = strchr(line, '\n') != NULL;
+	}
+	fclose(f);
+	return 0;
 }
 
-/* Allocates collectable memory */
-void *
-sgc_malloc(len)
-	unsigned int len;
+/* Marks from the stack above this function's frame; stacks grow down */
+static void
+mark_stack()
 {
-	return allocate(len, 0, NULL);
+	char *sp;
+
+	sp = (char *)&sp;
+	mark_range(sp, gc.stack_hi);
 }
 
-/* Allocates collectable memory caller guarantees never to contain pointers */
-void *
-sgc_malloc_atomic(len)
-	unsigned int len;
+/* Marks from the writable segments of a loaded object */
+static int
+mark_data(info, size, data)
+	struct dl_phdr_info *info;
+	size_t size;
+	void *data;
 {
-	return allocate(len, STATE_ATOMIC, NULL);
+	char *start, *end;
+	int i;
+
+	for (i = 0; i < info->dlpi_phnum; i++) {
+	    if (info->dlpi_phdr[i].p_type != PT_LOAD ||
+		!(info->dlpi_phdr[i].p_flags & PF_W))
+		    continue;
+	    start = (char *)info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+	    end = start + info->dlpi_phdr[i].p_memsz;
+	    if (start <= (char *)&gc && (char *)(&gc + 1) <= end) {
+		mark_range(start, (char *)&gc);
+		mark_range((char *)(&gc + 1), end);
+	    } else
+		mark_range(start, end);
+	}
+	return 0;
 }
+#endif /* CAN_COLLECT */
 
-/* Allocates collectable memory attaching a finalizer callback function */
-void *
-sgc_malloc_finalizer(len, finalizer)
-	unsigned int len;
-	void (*finalizer)(void *);
+/*------------------------------------------------------------
+ * Collection
+ */
+
+/* Tests if collections are possible on this system */
+int
+_SEE_sgc_can_collect()
 {
-	return allocate(len, 0, finalizer);
+#if CAN_COLLECT
+	char *sp;
+
+	sp = (char *)&sp;
+	return stack_bounds(sp);
+#else
+	return 0;
+#endif
 }
 
-/* Marks all objects as unreachable and runs finalizers */
+/* Marks from the roots and frees what was not reached */
 void
-sgc_atexit()
+_SEE_sgc_collect()
 {
-	sweep();
-	run_finalizers();
-	sweep();
+#if CAN_COLLECT
+	_SEE_JMPBUF regs;
+	struct page **link, *pg;
+	struct root *root;
+	unsigned int i;
+	int c;
+
+	if (gc.collecting || !gc.initialised)
+	    return;
+	if (!stack_bounds((char *)&regs))
+	    return;
+	gc.collecting = 1;
+
+	/* Bring the cells-in-use bitmaps up to date */
+	for (c = 0; c < 2 * SGC_NCLASS; c++) {
+	    while (sweep_next(c))
+		;
+	    gc.cur[c] = NULL;
+	}
+
+	/* Mark from the registers, stack, static data and other roots */
+	gc.live = 0;
+#if __GNUC__
+	__builtin_unwind_init();
+#endif
+	memset(&regs, 0, sizeof regs);
+	_SEE_SETJMP(regs);
+	mark_range((char *)&regs, (char *)(&regs + 1));
+	mark_stack();
+	dl_iterate_phdr(mark_data, NULL);
+	for (root = gc.roots; root; root = root->next)
+	    mark_range(root->base, root->base + root->extent);
+	for (i = 0; i < gc.nfinal; i++)
+	    mark_ptr((char *)gc.final[i].closure);
+	for (i = 0; i < gc.nready; i++)
+	    mark_ptr((char *)gc.ready[i].closure);
+	mark_drain();
+
+	/* Queue the finalizers of unreached objects */
+	for (i = 0; i < gc.nfinal; ) {
+	    if (is_marked(gc.final[i].p)) {
+		i++;
+		continue;
+	    }
+	    if (gc.nready == gc.readysz) {
+		struct final *nready;
+		unsigned int nsz = gc.readysz ? 2 * gc.readysz : 64;
+
+		nready = (struct final *)realloc(gc.ready,
+		    nsz * sizeof *nready);
+		if (!nready) {
+		    /* Try again next time */
+		    mark_ptr(gc.final[i].p);
+		    i++;
+		    continue;
+		}
+		gc.ready = nready;
+		gc.readysz = nsz;
+	    }
+	    gc.ready[gc.nready++] = gc.final[i];
+	    gc.final[i] = gc.final[--gc.nfinal];
+	}
+
+	/* Keep what the finalizers will see */
+	for (i = 0; i < gc.nready; i++)
+	    mark_ptr(gc.ready[i].p);
+	mark_drain();
+
+	/* Free the unreached large objects now and small ones lazily */
+	for (link = &gc.large; (pg = *link) != NULL; )
+	    if (BIT_TEST(pg->mark, 0)) {
+		BIT_CLEAR(pg->mark, 0);
+		link = &pg->next;
+	    } else {
+		*link = pg->next;
+		page_free(pg);
+	    }
+	for (c = 0; c < 2 * SGC_NCLASS; c++) {
+	    for (pg = gc.pages[c]; pg; pg = pg->next)
+		pg->flags |= PAGE_UNSWEPT;
+	    gc.sweep[c] = &gc.pages[c];
+	}
+
+	gc.collections++;
+	gc.allocated = 0;
+	gc.trigger = gc.live > SGC_MIN_TRIGGER ? gc.live : SGC_MIN_TRIGGER;
+	gc.collecting = 0;
+
+#ifndef NDEBUG
+	if (SEE_mem_debug)
+	    dprintf("sgc: collection %lu: %lu bytes live in %lu\n",
+		gc.collections, (unsigned long)gc.live,
+		(unsigned long)gc.heapsz);
+#endif
+
 	run_finalizers();
+#endif /* CAN_COLLECT */
+}
+
+/* Runs the finalizers of objects found unreachable */
+static void
+run_finalizers()
+{
+	struct final f;
+
+	if (gc.finalizing)
+	    return;
+	gc.finalizing = 1;
+	while (gc.nready) {
+	    f = gc.ready[--gc.nready];
+	    (*f.fn)(f.p, f.closure);
+	}
+	gc.finalizing = 0;
 }
 
 /*------------------------------------------------------------
- * Test stubs
+ * Public interface
  */
-#ifdef TEST
 
-static void myfinalizer(void *);
-static void info(void);
-
-static void
-info()
+/* Allocates collectable memory */
+void *
+_SEE_sgc_malloc(len)
+	SEE_size_t len;
 {
-	printf("[in use: %u bytes in %u objects]\n\n",
-		gc.allocation_total_size, gc.allocation_total_count);
+	return allocate(len, 0);
 }
 
-static void 
-myfinalizer(p)
-	void *p;
+/* Allocates collectable memory the caller guarantees never holds pointers */
+void *
+_SEE_sgc_malloc_atomic(len)
+	SEE_size_t len;
 {
-	printf("Finalizer called for %p!\n", p);
+	return allocate(len, 1);
 }
 
-static double
-now()
+/* Allocates collectable memory with a function to call once unreachable */
+void *
+_SEE_sgc_malloc_finalizer(len, finalizer, closure)
+	SEE_size_t len;
+	void (*finalizer)(void *, void *);
+	void *closure;
 {
-	struct timeval t;
+	struct final *nfinal;
+	unsigned int nsz;
+	void *p;
 
-	gettimeofday(&t, NULL);
-	return (double)t.tv_sec + (double)t.tv_usec * 1e-6;
+	if (gc.nfinal == gc.finalsz) {
+	    nsz = gc.finalsz ? 2 * gc.finalsz : 64;
+	    nfinal = (struct final *)realloc(gc.final, nsz * sizeof *nfinal);
+	    if (!nfinal)
+		return NULL;
+	    gc.final = nfinal;
+	    gc.finalsz = nsz;
+	}
+	p = allocate(len, 0);
+	if (p) {
+	    gc.final[gc.nfinal].p = (char *)p;
+	    gc.final[gc.nfinal].fn = finalizer;
+	    gc.final[gc.nfinal].closure = closure;
+	    gc.nfinal++;
+	}
+	return p;
 }
 
-int
-main()
-{
-	void *p, *p2;
-	unsigned long i;
-	double start;
-
-	setbuf(stdout, NULL);
-	atexit(info);
-	atexit(sgc_atexit);
-
-	printf("calling: p = allocate(100)\n");
-	p = sgc_malloc(100);
-	printf("  -> p = %p\n", p);
-	info();
-
-	printf("calling collect\n");
-	sgc_collect();
-	info();
-
-	printf("setting p = NULL\n");
-	p = NULL;
-	sgc_collect();
-	info();
-
-#define COUNT 1024*256
-#define SIZE  1024*2
-	printf("allocating %u objects of size %u:\n", COUNT, SIZE);
-	p2 = NULL;
-	for (i = 0; i < COUNT; i++) {
-/*	    printf("\r\t%7u", i); */
-	    p = sgc_malloc(SIZE);
-	    if (!p) {
-	    	printf("Out of memory at count=%lu\n", i);
+/* Frees an object now; its finalizer is not called */
+void
+_SEE_sgc_free(p)
+	void *p;
+{
+	struct page *pg, **link;
+	SEE_size_t off;
+	unsigned int i;
+
+	if ((char *)p < gc.min || (char *)p >= gc.max ||
+	    (pg = page_find(p)) == NULL)
+		return;
+	for (i = 0; i < gc.nfinal; i++)
+	    if (gc.final[i].p == (char *)p) {
+		gc.final[i] = gc.final[--gc.nfinal];
 		break;
-	    } else {
-	    	memset(p, 0, SIZE);
-		*(void **)p = p2;
-		p2 = p;
 	    }
+	off = (char *)p - pg->base;
+	if (pg->cls == CLS_LARGE) {
+	    if (off)
+		return;
+	    for (link = &gc.large; *link != pg; link = &(*link)->next)
+		;
+	    *link = pg->next;
+	    page_free(pg);
+	} else if (pg->cls >= 0 && off % pg->cellsz == 0) {
+	    i = off / pg->cellsz;
+	    BIT_CLEAR(pg->alloc, i);
+	    BIT_CLEAR(pg->mark, i);
 	}
-/*	printf(" done\n"); */
-	info();
-
-	printf("calling collect\n");
-	start = now();
-	sgc_collect();
-	printf(" collect took %f seconds\n", now() - start);
-	info();
-
-	p = p2 = NULL;
-
-	printf("calling collect\n");
-	start = now();
-	sgc_collect();
-	printf(" collect took %f seconds\n", now() - start);
-	info();
+}
 
-	printf("calling malloc_finalizer(300, myfinalizer)\n");
-	p2 = sgc_malloc_finalizer(300, myfinalizer);
-	info();
+/* Adds foreign memory to be scanned for pointers */
+void
+_SEE_sgc_add_root(base, extent)
+	void *base;
+	SEE_size_t extent;
+{
+	struct root *root;
+	
+	if (!extent)
+	    return;
+	root = (struct root *)malloc(sizeof (struct root));
+	if (root) {
+	    root->base = (char *)base;
+	    root->extent = extent;
+	    root->next = gc.roots;
+	    gc.roots = root;
+	}
+}
 
-	printf("p=%p p2=%p\n", p, p2);
+/* Removes memory previously added with _SEE_sgc_add_root() */
+void
+_SEE_sgc_remove_root(base)
+	void *base;
+{
+	struct root **r, *root;
 
-	exit(0);
+	for (r = &gc.roots; *r; r = &(*r)->next)
+	    if ((*r)->base == (char *)base) {
+		root = *r;
+		*r = root->next;
+		free(root);
+		return;
+	    }
 }
 
-#endif /* TEST */
+/* Reports the heap size, the bytes in use and the number of collections */
+void
+_SEE_sgc_stats(heapsz, inuse, collections)
+	SEE_size_t *heapsz, *inuse;
+	unsigned long *collections;
+{
+	if (heapsz)
+	    *heapsz = gc.heapsz;
+	if (inuse)
+	    *inuse = gc.live + gc.allocated;
+	if (collections)
+	    *collections = gc.collections;
+}
@@ -1,12 +1,18 @@
 #ifndef _h_simple_gc_
 #define _h_simple_gc_
 
-void  sgc_collect(void);
-void *sgc_malloc(unsigned int sz);
-void *sgc_malloc_atomic(unsigned int sz);
-void *sgc_malloc_finalizer(unsigned int sz, void (*finalizer)(void *));
-void  sgc_atexit(void);
-void  sgc_add_root(void *base, unsigned int sz);
-void  sgc_remove_root(void *base);
+#include <see/type.h>
+
+int   _SEE_sgc_can_collect(void);
+void  _SEE_sgc_collect(void);
+void *_SEE_sgc_malloc(SEE_size_t sz);
+void *_SEE_sgc_malloc_atomic(SEE_size_t sz);
+void *_SEE_sgc_malloc_finalizer(SEE_size_t sz,
+	void (*finalizer)(void *, void *), void *closure);
+void  _SEE_sgc_free(void *p);
+void  _SEE_sgc_add_root(void *base, SEE_size_t sz);
+void  _SEE_sgc_remove_root(void *base);
+void  _SEE_sgc_stats(SEE_size_t *heapsz, SEE_size_t *inuse,
+	unsigned long *collections);
 
 #endif /* _h_simple_gc_ */
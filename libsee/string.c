@@ -41,6 +41,12 @@
 # include <string.h>
 #endif
 
+#if HAVE_LIMITS_H
+# include <limits.h>
+#else
+# define UINT_MAX (~(unsigned int)0)
+#endif
+
 #include <see/mem.h>
 #include <see/type.h>
 #include <see/string.h>
@@ -206,6 +212,30 @@ SEE_string_cmp(a, b)
 	return (*ap < *bp) ? -1 : 1;
 }
 
+/*
+ * Returns a hash of the whole content of a string (32-bit FNV-1a over
+ * the UTF-16 code units). Interned strings never change, so their
+ * hash is remembered in the string and computed only once.
+ */
+unsigned int
+SEE_string_hash(s)
+	struct SEE_string *s;
+{
+	const SEE_char_t *p;
+	unsigned int len, h;
+
+	if (s->flags & SEE_STRING_FLAG_HASHED)
+		return s->hash;
+	h = SEE_STRING_HASH_INIT;
+	for (p = s->data, len = s->length; len; len--)
+		h = SEE_STRING_HASH_STEP(h, *p++);
+	if (s->flags & SEE_STRING_FLAG_INTERNED) {
+		s->hash = h;
+		s->flags |= SEE_STRING_FLAG_HASHED;
+	}
+	return h;
+}
+
 /*
  * Compares a SEE string with an ASCII string.
  * Returns -1,0,+1 just like SEE_string_cmp().
@@ -324,55 +354,119 @@ string_append_int(s, i)
 	s->data[s->length++] = (i % 10) + '0';
 }
 
+/* The bits of each character in a word that are clear in ASCII */
+#define UTF16_ASCII_MASK	(~0UL / 0xffff * 0xff80)
+
+/*
+ * Encodes UTF-16 text as UTF-8 into a buffer. Characters are taken
+ * from *srcp up to srcend and written from *dstp up to dstend, and both
+ * pointers are advanced past what was converted. Conversion stops when
+ * the source is used up or when the next character will not fit, so
+ * that a caller can empty the buffer and continue. Runs of ASCII are
+ * copied a word of characters at a time.
+ * Returns -1, leaving *srcp at the offending character, if the source
+ * has a high surrogate without a low surrogate after it; otherwise
+ * returns 0.
+ * Ref: RFC2279, RFC2781
+ */
+int
+SEE_utf16_to_utf8(srcp, srcend, dstp, dstend)
+	const SEE_char_t **srcp, *srcend;
+	char **dstp, *dstend;
+{
+	const SEE_char_t *src = *srcp;
+	unsigned char *dst = (unsigned char *)*dstp;
+	unsigned char *end = (unsigned char *)dstend;
+	unsigned long word;
+	SEE_char_t ch, ch2;
+	unsigned int i;
+	int ret = 0;
+
+#define WORDCHARS	(sizeof word / sizeof *src)
+
+	while (src < srcend) {
+		while ((SEE_size_t)(srcend - src) >= WORDCHARS &&
+		       (SEE_size_t)(end - dst) >= WORDCHARS)
+		{
+			memcpy(&word, src, sizeof word);
+			if (word & UTF16_ASCII_MASK)
+				break;
+			for (i = 0; i < WORDCHARS; i++)
+				dst[i] = (unsigned char)src[i];
+			src += WORDCHARS;
+			dst += WORDCHARS;
+		}
+		if (src == srcend)
+			break;
+
+		ch = *src;
+		if ((ch & 0xff80) == 0) {
+		    if (dst == end)
+			break;
+		    *dst++ = ch & 0x7f;
+		} else if ((ch & 0xf800) == 0) {
+		    if (end - dst < 2)
+			break;
+		    *dst++ = 0xc0 | ((ch >> 6) & 0x1f);
+		    *dst++ = 0x80 | (ch & 0x3f);
+		} else if ((ch & 0xfc00) != 0xd800) {
+		    if (end - dst < 3)
+			break;
+		    *dst++ = 0xe0 | ((ch >> 12) & 0x0f);
+		    *dst++ = 0x80 | ((ch >> 6) & 0x3f);
+		    *dst++ = 0x80 | (ch & 0x3f);
+		} else {
+		    if (src + 1 == srcend || 
+			((ch2 = src[1]) & 0xfc00) != 0xdc00)
+		    {
+			ret = -1;
+			break;
+		    }
+		    if (end - dst < 4)
+			break;
+		    ch = (ch & 0x03ff) + 0x0040;
+		    *dst++ = 0xf0 | ((ch >> 8) & 0x07);
+		    *dst++ = 0x80 | ((ch >> 2) & 0x3f);
+		    *dst++ = 0x80 | ((ch & 0x3) << 4) | ((ch2 & 0x03c0) >> 6);
+		    *dst++ = 0x80 | (ch2 & 0x3f);
+		    src++;
+		}
+		src++;
+	}
+#undef WORDCHARS
+
+	*srcp = src;
+	*dstp = (char *)dst;
+	return ret;
+}
+
 /* 
  * Converts a UTF-16 string to UTF-8 and write to a stdio file.
  * Returns 0 on success, like fputs().
  * Returns EOF on write error, like fputs().
  * Throws exception on conversion error, unlike fputs().
- * Ref: RFC2279, RFC2781
  */
 int
 SEE_string_fputs(s, f)
 	const struct SEE_string *s;
 	FILE *f;
 {
-	unsigned int i;
-	SEE_char_t ch, ch2;
 	struct SEE_interpreter *interp = s->interpreter;
+	const SEE_char_t *src = s->data, *end = s->data + s->length;
+	char buf[1024], *out;
+	int bad;
 
-#define OUTPUT(c) do { if (fputc(c, f) == EOF) goto error; } while (0)
-
-	for (i = 0; i < s->length; i++) {
-		ch = s->data[i];
-		if ((ch & 0xff80) == 0) 
-		    OUTPUT(ch & 0x7f);
-		else if ((ch & 0xf800) == 0) {
-		    OUTPUT(0xc0 | ((ch >> 6) & 0x1f));
-		    OUTPUT(0x80 | (ch & 0x3f));
-		} else if ((ch & 0xfc00) != 0xd800) {
-		    OUTPUT(0xe0 | ((ch >> 12) & 0x0f));
-		    OUTPUT(0x80 | ((ch >> 6) & 0x3f));
-		    OUTPUT(0x80 | (ch & 0x3f));
-		} else {
-		    if (i == s->length - 1)
-			SEE_error_throw_string(interp, interp->Error, 
-				STR(bad_utf16_string));
-		    ch2 = s->data[++i];
-		    if ((ch2 & 0xfc00) != 0xdc00)
+	while (src < end) {
+		out = buf;
+		bad = SEE_utf16_to_utf8(&src, end, &out, buf + sizeof buf);
+		if (out > buf && 
+		    fwrite(buf, 1, out - buf, f) != (SEE_size_t)(out - buf))
+			return EOF;
+		if (bad)
 			SEE_error_throw_string(interp, interp->Error, 
 				STR(bad_utf16_string));
-		    ch = (ch & 0x03ff) + 0x0040;
-		    OUTPUT(0xf0 | ((ch >> 8) & 0x07));
-		    OUTPUT(0x80 | ((ch >> 2) & 0x3f));
-		    OUTPUT(0x80 | ((ch & 0x3) << 4) |
-				 ((ch2 & 0x03c0) >> 6));
-		    OUTPUT(0x80 | (ch2 & 0x3f));
-		}
 	}
 	return 0;
-    error:
-	return EOF;
-#undef OUTPUT
 }
 
 /*------------------------------------------------------------
@@ -381,6 +475,7 @@ SEE_string_fputs(s, f)
 struct simple_string {
 	struct SEE_string string;
 	struct SEE_growable grow;
+	unsigned int front;		/* free characters before data */
 };
 
 /* 
@@ -394,15 +489,21 @@ simple_growby(s, extra)
 {
 	struct simple_string *ss = (struct simple_string *)s;
 	unsigned int len_save;
+	SEE_char_t *data_save;
 
 	/*
 	 * The grow_to API increments the length, but the growby contract
 	 * is simply to ensure that the length can be incremented up
 	 * to that point. So we save the length before calling grow_to().
+	 * If the storage moves, the space in front of the old data is
+	 * left behind.
 	 */
 	len_save = ss->string.length;
+	data_save = ss->string.data;
 	SEE_grow_to(s->interpreter, &ss->grow, ss->string.length + extra);
 	ss->string.length = len_save;
+	if (ss->string.data != data_save)
+	    ss->front = 0;
 }
 
 static struct SEE_stringclass simple_stringclass = {
@@ -425,6 +526,7 @@ SEE_string_new(interp, space)
 	ss->string.flags = 0;
 	SEE_GROW_INIT(interp, &ss->grow, ss->string.data, ss->string.length);
 	ss->grow.is_string = 1;
+	ss->front = 0;
 	ss->string.stringclass = &simple_stringclass;
 	if (space)
 	    simple_growby((struct SEE_string *)ss, space);
@@ -470,60 +572,60 @@ SEE_string_literal(interp, s)
 	struct SEE_interpreter *interp;
 	const struct SEE_string *s;
 {
-	struct SEE_string *lit;
+	struct SEE_strbuf lit;
 	unsigned int i;
 	SEE_char_t c;
 
 	if (s == NULL)
 		return NULL;
 
-	lit = SEE_string_new(interp, 0);
-	SEE_string_addch(lit, '\"');
+	SEE_strbuf_init(interp, &lit, s->length + 2);
+	SEE_STRBUF_ADDCH(&lit, '\"');
 	for (i = 0; i < s->length; i++) {
 	    c = s->data[i];
 	    switch (c) {
-	    case 0x0008:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 'b');
+	    case 0x0008:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 'b');
 				break;
-	    case 0x0009:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 't');
+	    case 0x0009:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 't');
 				break;
-	    case 0x000a:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 'n');
+	    case 0x000a:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 'n');
 				break;
-	    case 0x000b:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 'v');
+	    case 0x000b:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 'v');
 				break;
-	    case 0x000c:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 'f');
+	    case 0x000c:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 'f');
 				break;
-	    case 0x000d:	SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, 'r');
+	    case 0x000d:	SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, 'r');
 				break;
 	    case '\\':
-	    case '\"':		SEE_string_addch(lit, '\\');
-				SEE_string_addch(lit, c);
+	    case '\"':		SEE_STRBUF_ADDCH(&lit, '\\');
+				SEE_STRBUF_ADDCH(&lit, c);
 				break;
 	    default:
 		if (c >= 0x20 && c < 0x7f)
-		   SEE_string_addch(lit, c);
+		   SEE_STRBUF_ADDCH(&lit, c);
 		else if (c < 0x100) {
-		   SEE_string_addch(lit, '\\');
-		   SEE_string_addch(lit, 'x');
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[(c >> 4) & 0xf]);
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[ c       & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, '\\');
+		   SEE_STRBUF_ADDCH(&lit, 'x');
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[(c >> 4) & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[ c       & 0xf]);
 		} else {
-		   SEE_string_addch(lit, '\\');
-		   SEE_string_addch(lit, 'u');
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[(c >>12) & 0xf]);
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[(c >> 8) & 0xf]);
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[(c >> 4) & 0xf]);
-		   SEE_string_addch(lit, SEE_hexstr_lowercase[ c       & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, '\\');
+		   SEE_STRBUF_ADDCH(&lit, 'u');
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[(c >>12) & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[(c >> 8) & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[(c >> 4) & 0xf]);
+		   SEE_STRBUF_ADDCH(&lit, SEE_hexstr_lowercase[ c       & 0xf]);
 		}
 	    }
 	}
-	SEE_string_addch(lit, '\"');
-	return lit;
+	SEE_STRBUF_ADDCH(&lit, '\"');
+	return SEE_strbuf_finish(&lit);
 }
 
 /*
@@ -591,52 +693,19 @@ SEE_string_toutf8(interp, buf, buflen, s)
 	SEE_size_t buflen;
 	const struct SEE_string *s;
 {
-	unsigned int i;
-	SEE_char_t ch, ch2;
-
-#define OUTPUT(c) do { 				\
-	if (buflen <= 1) goto toolong; 		\
-	*buf++ = (c); 				\
-	buflen--; 				\
-    } while (0)
-
-	for (i = 0; i < s->length; i++) {
-		ch = s->data[i];
-		if ((ch & 0xff80) == 0) 
-		    OUTPUT(ch & 0x7f);
-		else if ((ch & 0xf800) == 0) {
-		    OUTPUT(0xc0 | ((ch >> 6) & 0x1f));
-		    OUTPUT(0x80 | (ch & 0x3f));
-		} else if ((ch & 0xfc00) != 0xd800) {
-		    OUTPUT(0xe0 | ((ch >> 12) & 0x0f));
-		    OUTPUT(0x80 | ((ch >> 6) & 0x3f));
-		    OUTPUT(0x80 | (ch & 0x3f));
-		} else {
-		    if (i == s->length - 1)
-			SEE_error_throw_string(interp, interp->Error, 
-				STR(bad_utf16_string));
-		    ch2 = s->data[++i];
-		    if ((ch2 & 0xfc00) != 0xdc00)
-			SEE_error_throw_string(interp, interp->Error, 
-				STR(bad_utf16_string));
-		    ch = (ch & 0x03ff) + 0x0040;
-		    OUTPUT(0xf0 | ((ch >> 8) & 0x07));
-		    OUTPUT(0x80 | ((ch >> 2) & 0x3f));
-		    OUTPUT(0x80 | ((ch & 0x3) << 4) |
-				 ((ch2 & 0x03c0) >> 6));
-		    OUTPUT(0x80 | (ch2 & 0x3f));
-		}
-	}
+	const SEE_char_t *src = s->data, *end = s->data + s->length;
 
-	if (buflen < 1) goto toolong;
+	if (buflen < 1)
+		SEE_error_throw_string(interp, interp->RangeError, 
+			STR(string_limit_reached));
+	if (SEE_utf16_to_utf8(&src, end, &buf, buf + buflen - 1))
+		SEE_error_throw_string(interp, interp->Error, 
+			STR(bad_utf16_string));
+	if (src < end)
+		SEE_error_throw_string(interp, interp->RangeError, 
+			STR(string_limit_reached));
 	*buf = '\0';
-	return;
-
-    toolong:
-	SEE_error_throw_string(interp, interp->RangeError, 
-		STR(string_limit_reached));
 }
-#undef OUTPUT
 
 /*
  * Extends a string, marking the original string as ungrowable.
@@ -664,10 +733,47 @@ simple_concat(interp, a, b)
 	return (struct SEE_string *)cp;
 }
 
+/*
+ * Prepends a to b, using the free space in front of b's data, and
+ * marks b as ungrowable. The result takes over b's storage.
+ */
+static struct SEE_string *
+simple_prepend(interp, a, b)
+	struct SEE_interpreter *interp;
+	const struct SEE_string *a;
+	struct simple_string *b;
+{
+	struct simple_string *cp;
+
+	cp = SEE_NEW(interp, struct simple_string);
+	memcpy(cp, b, sizeof (struct simple_string));
+	cp->grow.data_ptr = (void **)&cp->string.data;
+	cp->grow.length_ptr = &cp->string.length;
+
+	b->grow.data_ptr = NULL;
+	b->grow.length_ptr = NULL;
+	b->front = 0;
+	MAKE_UNGROWABLE(&b->string);
+
+	cp->string.data -= a->length;
+	cp->string.length += a->length;
+	cp->grow.allocated += a->length * sizeof (SEE_char_t);
+	cp->front -= a->length;
+	memcpy(cp->string.data, a->data, a->length * sizeof (SEE_char_t));
+	return (struct SEE_string *)cp;
+}
+
 /*
  * Concatenates two strings together and return the resulting string.
  * May return one of the original strings, or a new string altogether.
  * May modify a. String b will not be modified, but it may be returned.
+ *
+ * A growable a is extended in place (see simple_concat). When b is
+ * the longer, growable string, a is instead copied into free space
+ * kept in front of b's data; if there is none, the new string is made
+ * with as much space in front as it has characters. Either way, a
+ * string built up by repeatedly appending or prepending short strings
+ * is copied only O(log n) times.
  */
 struct SEE_string *
 SEE_string_concat(interp, a, b)
@@ -675,21 +781,335 @@ SEE_string_concat(interp, a, b)
 	struct SEE_string *a, *b;
 {
 	struct SEE_string *s;
+	struct simple_string *ss;
+	unsigned int front;
 
 	if (a->length == 0)
 		return b;
 	if (b->length == 0)
 		return a;
 
-	if (a->stringclass == &simple_stringclass) 
+	front = 0;
+	if (b->stringclass == &simple_stringclass && b->length > a->length) {
+		if (((struct simple_string *)b)->front >= a->length)
+			return simple_prepend(interp, a,
+			    (struct simple_string *)b);
+		front = a->length + b->length;
+	} else if (a->stringclass == &simple_stringclass) 
 		return simple_concat(interp, (struct simple_string *)a, b);
 
-	s = SEE_string_new(interp, a->length + b->length);
-	if (a->length)
-		memcpy(s->data, a->data, a->length * sizeof (SEE_char_t));
-	if (b->length)
-		memcpy(s->data + a->length, b->data, 
-		    b->length * sizeof (SEE_char_t));
+	if (front > UINT_MAX / 4)
+		front = 0;
+	s = SEE_string_new(interp, front + a->length + b->length);
+	ss = (struct simple_string *)s;
+	ss->string.data += front;
+	ss->grow.allocated -= front * sizeof (SEE_char_t);
+	ss->front = front;
+	memcpy(s->data, a->data, a->length * sizeof (SEE_char_t));
+	memcpy(s->data + a->length, b->data, b->length * sizeof (SEE_char_t));
 	s->length = a->length + b->length;
 	return s;
 }
+
+/*------------------------------------------------------------
+ * The string builder
+ */
+
+/*
+ * Initialises an empty string builder with room for space characters.
+ */
+void
+SEE_strbuf_init(interp, sb, space)
+	struct SEE_interpreter *interp;
+	struct SEE_strbuf *sb;
+	unsigned int space;
+{
+	sb->interpreter = interp;
+	sb->length = 0;
+	sb->capacity = 0;
+	sb->data = NULL;
+	if (space)
+	    SEE_strbuf_reserve(sb, space);
+}
+
+/*
+ * Ensures there is room for extra more characters, at least doubling
+ * the capacity whenever the storage has to move.
+ */
+void
+SEE_strbuf_reserve(sb, extra)
+	struct SEE_strbuf *sb;
+	unsigned int extra;
+{
+	struct SEE_interpreter *interp = sb->interpreter;
+	unsigned int need, cap;
+	SEE_char_t *data;
+
+	if (extra <= sb->capacity - sb->length)
+	    return;
+	if (extra > UINT_MAX / sizeof (SEE_char_t) - sb->length)
+	    SEE_error_throw_string(interp, interp->Error,
+		STR(string_limit_reached));
+	need = sb->length + extra;
+	if (sb->capacity == 0)
+	    cap = need;			/* trust the first hint */
+	else if (sb->capacity > UINT_MAX / sizeof (SEE_char_t) / 2)
+	    cap = UINT_MAX / sizeof (SEE_char_t);
+	else
+	    cap = sb->capacity * 2;
+	if (cap < need)
+	    cap = need;
+	if (cap < 16)
+	    cap = 16;
+	data = SEE_NEW_STRING_ARRAY(interp, SEE_char_t, cap);
+	if (sb->length)
+	    memcpy(data, sb->data, sb->length * sizeof (SEE_char_t));
+	sb->data = data;
+	sb->capacity = cap;
+}
+
+/*
+ * Appends a character to a string builder.
+ */
+void
+SEE_strbuf_addch(sb, c)
+	struct SEE_strbuf *sb;
+	int c;				/* promoted SEE_char_t */
+{
+	SEE_STRBUF_ADDCH(sb, c);
+}
+
+/*
+ * Appends the characters of a string to a string builder.
+ */
+void
+SEE_strbuf_append(sb, s)
+	struct SEE_strbuf *sb;
+	const struct SEE_string *s;
+{
+	SEE_strbuf_append_utf16(sb, s->data, s->length);
+}
+
+/*
+ * Appends an array of UTF-16 characters to a string builder.
+ */
+void
+SEE_strbuf_append_utf16(sb, data, len)
+	struct SEE_strbuf *sb;
+	const SEE_char_t *data;
+	unsigned int len;
+{
+	if (len) {
+	    SEE_strbuf_reserve(sb, len);
+	    memcpy(sb->data + sb->length, data, len * sizeof (SEE_char_t));
+	    sb->length += len;
+	}
+}
+
+/*
+ * Appends len 7-bit ASCII characters to a string builder.
+ */
+void
+SEE_strbuf_append_ascii(sb, ascii, len)
+	struct SEE_strbuf *sb;
+	const char *ascii;
+	SEE_size_t len;
+{
+	SEE_char_t *d;
+	SEE_size_t i;
+
+	if (len > UINT_MAX)
+	    SEE_error_throw_string(sb->interpreter, sb->interpreter->Error,
+		STR(string_limit_reached));
+	SEE_strbuf_reserve(sb, (unsigned int)len);
+	d = sb->data + sb->length;
+	for (i = 0; i < len; i++) {
+	    SEE_ASSERT(sb->interpreter, !(ascii[i] & 0x80));
+	    d[i] = ascii[i] & 0x7f;
+	}
+	sb->length += (unsigned int)len;
+}
+
+/*
+ * Appends len bytes of UTF-8 text to a string builder, converting it
+ * to UTF-16. Each byte that does not start or continue a well-formed
+ * sequence becomes U+FFFD.
+ */
+void
+SEE_strbuf_append_utf8(sb, utf8, len)
+	struct SEE_strbuf *sb;
+	const char *utf8;
+	SEE_size_t len;
+{
+	const unsigned char *p = (const unsigned char *)utf8;
+	const unsigned char *end = p + len;
+	SEE_unicode_t c, min;
+	int n, i;
+
+	if (len > UINT_MAX)
+	    SEE_error_throw_string(sb->interpreter, sb->interpreter->Error,
+		STR(string_limit_reached));
+	/* UTF-8 never takes fewer bytes than UTF-16 takes characters */
+	SEE_strbuf_reserve(sb, (unsigned int)len);
+	while (p < end) {
+	    c = *p;
+	    if (c < 0x80) {
+		sb->data[sb->length++] = c;
+		p++;
+		continue;
+	    }
+	    if ((c & 0xe0) == 0xc0)      { n = 1; c &= 0x1f; min = 0x80; }
+	    else if ((c & 0xf0) == 0xe0) { n = 2; c &= 0x0f; min = 0x800; }
+	    else if ((c & 0xf8) == 0xf0) { n = 3; c &= 0x07; min = 0x10000; }
+	    else { n = 0; min = 1; }
+	    if (n > end - p - 1)
+		n = 0;
+	    for (i = 1; i <= n; i++)
+		if ((p[i] & 0xc0) != 0x80)
+		    break;
+		else
+		    c = c << 6 | (p[i] & 0x3f);
+	    if (n == 0 || i <= n || c < min || c > 0x10ffff ||
+		(c & 0xfffff800) == 0xd800)
+	    {
+		sb->data[sb->length++] = 0xfffd;
+		p++;
+	    } else if (c < 0x10000) {
+		sb->data[sb->length++] = c;
+		p += n + 1;
+	    } else {
+		c -= 0x10000;
+		sb->data[sb->length++] = 0xd800 | (c >> 10 & 0x3ff);
+		sb->data[sb->length++] = 0xdc00 | (c & 0x3ff);
+		p += n + 1;
+	    }
+	}
+}
+
+/*
+ * Appends a unicode code point to a string builder, as a surrogate
+ * pair if it lies outside the basic multilingual plane.
+ */
+void
+SEE_strbuf_append_unicode(sb, c)
+	struct SEE_strbuf *sb;
+	SEE_unicode_t c;
+{
+	SEE_strbuf_reserve(sb, 2);
+	if (c < 0x10000)
+	    sb->data[sb->length++] = (SEE_char_t)c;
+	else {
+	    /* RFC2781: UTF-16 encoding */
+	    c -= 0x10000;
+	    sb->data[sb->length++] = 0xd800 | (c >> 10 & 0x3ff);
+	    sb->data[sb->length++] = 0xdc00 | (c       & 0x3ff);
+	}
+}
+
+/*
+ * Returns a new, ungrowable string holding the builder's characters.
+ * The string takes over the builder's storage, and the builder is
+ * left empty.
+ */
+struct SEE_string *
+SEE_strbuf_finish(sb)
+	struct SEE_strbuf *sb;
+{
+	struct SEE_interpreter *interp = sb->interpreter;
+	struct SEE_string *s;
+
+	if (sb->length == 0)
+	    s = STR(empty_string);
+	else {
+	    s = SEE_NEW(interp, struct SEE_string);
+	    s->length = sb->length;
+	    s->data = sb->data;
+	    s->interpreter = interp;
+	    s->flags = 0;
+	    MAKE_UNGROWABLE(s);
+	}
+	sb->data = NULL;
+	sb->length = 0;
+	sb->capacity = 0;
+	return s;
+}
+
+/*------------------------------------------------------------
+ * Output buffers
+ */
+
+/* Prepares an empty output buffer for a stdio file */
+void
+SEE_output_init(out, file)
+	struct SEE_output *out;
+	FILE *file;
+{
+	out->file = file;
+	out->length = 0;
+	out->error = 0;
+}
+
+/*
+ * Hands the buffered text to the stdio file, without fflush()ing it.
+ * Returns 0 on success, or EOF if any write so far has failed.
+ */
+int
+SEE_output_flush(out)
+	struct SEE_output *out;
+{
+	if (out->length &&
+	    fwrite(out->data, 1, out->length, out->file) != out->length)
+		out->error = 1;
+	out->length = 0;
+	return out->error ? EOF : 0;
+}
+
+/*
+ * Appends bytes. A run that does not fit and would fill much of the
+ * buffer is written straight to the file instead of being copied.
+ */
+void
+SEE_output_bytes(out, data, len)
+	struct SEE_output *out;
+	const char *data;
+	SEE_size_t len;
+{
+	if (len > SEE_OUTPUT_BUFSZ - out->length) {
+		SEE_output_flush(out);
+		if (len >= SEE_OUTPUT_BUFSZ / 2) {
+			if (fwrite(data, 1, len, out->file) != len)
+				out->error = 1;
+			return;
+		}
+	}
+	memcpy(out->data + out->length, data, len);
+	out->length += len;
+}
+
+/*
+ * Appends a string in UTF-8, encoding it directly into the buffer.
+ * Throws an Error if the string is not well-formed UTF-16.
+ */
+void
+SEE_output_string(interp, out, s)
+	struct SEE_interpreter *interp;
+	struct SEE_output *out;
+	const struct SEE_string *s;
+{
+	const SEE_char_t *src = s->data, *end = s->data + s->length;
+	char *dst;
+	int bad;
+
+	for (;;) {
+		dst = out->data + out->length;
+		bad = SEE_utf16_to_utf8(&src, end, &dst,
+			out->data + SEE_OUTPUT_BUFSZ);
+		out->length = dst - out->data;
+		if (bad)
+			SEE_error_throw_string(interp, interp->Error,
+				STR(bad_utf16_string));
+		if (src == end)
+			break;
+		SEE_output_flush(out);
+	}
+}
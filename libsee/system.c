@@ -61,6 +61,7 @@
 #include "platform.h"
 #include "code.h"
 #include "regex.h"
+#include "simple_gc.h"
 
 /* Prototypes */
 static unsigned int simple_random_seed(void);
@@ -74,7 +75,6 @@ static void *simple_gc_malloc_finalize(struct SEE_interpreter *, SEE_size_t,
 		const char *, int);
 static void simple_gc_free(struct SEE_interpreter *, void *,
 	const char *, int);
-static void simple_gc_finalizer(void *, void *);
 static void simple_gc_gcollect(struct SEE_interpreter *);
 #else
 static void *simple_malloc(struct SEE_interpreter *, SEE_size_t,
@@ -86,6 +86,17 @@ static void simple_free(struct SEE_interpreter *, void *,
 	const char *, int);
 static void simple_finalize_all(void);
 #endif
+static void simple_gc_finalizer(void *, void *);
+static void *simple_sgc_malloc(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *simple_sgc_malloc_string(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *simple_sgc_malloc_finalize(struct SEE_interpreter *, SEE_size_t,
+        void (*)(struct SEE_interpreter *, void *, void *), void *,
+		const char *, int);
+static void simple_sgc_free(struct SEE_interpreter *, void *,
+	const char *, int);
+static void simple_sgc_gcollect(struct SEE_interpreter *);
 static void simple_mem_exhausted(struct SEE_interpreter *) SEE_dead;
 
 /*
@@ -95,6 +106,7 @@ static void simple_mem_exhausted(struct SEE_interpreter *) SEE_dead;
 struct SEE_system SEE_system = {
 	NULL,				/* default_locale */
 	-1,				/* default_recursion_limit */
+	-1,				/* default_regex_step_limit */
 	NULL,				/* default_trace */
 
 	SEE_COMPAT_262_3B, 		/* default_compat_flags */
@@ -111,6 +123,13 @@ struct SEE_system SEE_system = {
 	simple_gc_free,			/* free */
 	simple_mem_exhausted,		/* mem_exhausted */
 	simple_gc_gcollect,		/* gcollect */
+#elif WITH_SIMPLE_GC
+	simple_sgc_malloc,		/* malloc */
+	simple_sgc_malloc_finalize,	/* malloc_finalize */
+	simple_sgc_malloc_string,	/* malloc_string */
+	simple_sgc_free,		/* free */
+	simple_mem_exhausted,		/* mem_exhausted */
+	simple_sgc_gcollect,		/* gcollect */
 #else
 	simple_malloc,			/* malloc */
 	simple_malloc_finalize,		/* malloc_finalize */
@@ -126,7 +145,8 @@ struct SEE_system SEE_system = {
 	NULL,            		/* code_alloc */
 #endif
 	NULL,				/* object_construct */
-	&_SEE_ecma_regex_engine		/* default_regex_engine */
+	&_SEE_ecma_regex_engine,	/* default_regex_engine */
+	64				/* regex_cache_size */
 };
 
 /*
@@ -155,6 +175,27 @@ simple_mem_exhausted(interp)
 	SEE_ABORT(interp, "memory exhausted");
 }
 
+/*
+ * A private structure to hold finalization info. This is appended onto
+ * objects that are allocated with finalization requirements by either
+ * garbage collector.
+ */
+struct finalize_info {
+	struct SEE_interpreter *interp;
+        void (*finalizefn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+};
+
+static void
+simple_gc_finalizer(p, cd)
+	void *p;
+	void *cd;
+{
+	struct finalize_info *info = 
+	    (struct finalize_info *)((char *)p + (SEE_size_t)cd);
+	
+	(*info->finalizefn)(info->interp, (void *)p, info->closure);
+}
 
 #if WITH_BOEHM_GC
 
@@ -179,27 +220,6 @@ simple_gc_malloc(interp, size, file, line)
 	return GC_MALLOC(size);
 }
 
-/*
- * A private structure to hold finalization info. This is appended onto
- * objects that are allocated with finalization requirements.
- */
-struct finalize_info {
-	struct SEE_interpreter *interp;
-        void (*finalizefn)(struct SEE_interpreter *, void *, void *);
-	void *closure;
-};
-
-static void
-simple_gc_finalizer(p, cd)
-	void *p;
-	void *cd;
-{
-	struct finalize_info *info = 
-	    (struct finalize_info *)((char *)p + (SEE_size_t)cd);
-	
-	(*info->finalizefn)(info->interp, (void *)p, info->closure);
-}
-
 static void *
 simple_gc_malloc_finalize(interp, size, finalizefn, closure, file, line)
 	struct SEE_interpreter *interp;
@@ -377,6 +397,110 @@ simple_free(interp, ptr, file, line)
 
 #endif /* !WITH_BOEHM_GC */
 
+/*
+ * Memory allocator using SEE's own collector (simple_gc.c)
+ */
+static void *
+simple_sgc_malloc(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	return _SEE_sgc_malloc(size);
+}
+
+static void *
+simple_sgc_malloc_finalize(interp, size, finalizefn, closure, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+        void (*finalizefn)(struct SEE_interpreter *, void *, void *);
+	void *closure;
+	const char *file;
+	int line;
+{
+	SEE_size_t padsz;
+	void *data;
+	struct finalize_info *info;
+
+	/* Round up to align the finalize_info */
+	padsz = size;
+	padsz += sizeof (struct finalize_info) - 1;
+	padsz -= padsz % sizeof (struct finalize_info);
+
+	data = _SEE_sgc_malloc_finalizer(padsz + sizeof (struct finalize_info),
+	    simple_gc_finalizer, (void *)padsz);
+	if (!data)
+	    return NULL;
+
+	info = (struct finalize_info *)((char *)data + padsz);
+	info->interp = interp;
+	info->finalizefn = finalizefn;
+	info->closure = closure;
+	return data;
+}
+
+/*
+ * Non-pointer memory allocator using SEE's own collector
+ */
+static void *
+simple_sgc_malloc_string(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	return _SEE_sgc_malloc_atomic(size);
+}
+
+static void
+simple_sgc_free(interp, ptr, file, line)
+	struct SEE_interpreter *interp;
+	void *ptr;
+	const char *file;
+	int line;
+{
+	_SEE_sgc_free(ptr);
+}
+
+static void
+simple_sgc_gcollect(interp)
+	struct SEE_interpreter *interp;
+{
+	_SEE_sgc_collect();
+}
+
+/*
+ * Makes SEE's own collector the memory allocator. This must be called
+ * before any interpreter is initialised. Returns zero, leaving the
+ * allocator unchanged, if the collector cannot find its roots on this
+ * system.
+ */
+int
+SEE_simple_gc_install()
+{
+	if (!_SEE_sgc_can_collect())
+	    return 0;
+	SEE_system.malloc = simple_sgc_malloc;
+	SEE_system.malloc_finalize = simple_sgc_malloc_finalize;
+	SEE_system.malloc_string = simple_sgc_malloc_string;
+	SEE_system.free = simple_sgc_free;
+	SEE_system.gcollect = simple_sgc_gcollect;
+	return 1;
+}
+
+/*
+ * Reports the size of SEE's own collector's heap, the bytes in use,
+ * and the number of collections so far.
+ */
+void
+SEE_simple_gc_stats(heapsz, inuse, collections)
+	SEE_size_t *heapsz, *inuse;
+	unsigned long *collections;
+{
+	_SEE_sgc_stats(heapsz, inuse, collections);
+}
+
 
 /* Reserved for future use */
 void
@@ -0,0 +1,63 @@
+#include "bench.inc"
+
+/*
+ * Measures Array element access from scripts on an array of NELEMENTS
+ * numbers: filling it by index and by push(), reading it back, and
+ * the memory used per element. The array is kept in the global 'a'
+ * between scripts, and each script's loop runs inside a function so
+ * that its variables are locals.
+ */
+
+#define NELEMENTS	300000
+
+static void
+run(interp, desc, body)
+	struct SEE_interpreter *interp;
+	const char *desc, *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	unsigned long before;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"(function () { var n = %d, s = 0, i;\n"
+		"  %s\n"
+		"  return s; })()", NELEMENTS, body);
+	input = SEE_input_string(interp, s);
+	before = bench_allocated;
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / NELEMENTS,
+		"ns/element");
+	BENCH_REPORT("  allocated",
+		(double)(bench_allocated - before) / NELEMENTS,
+		"bytes/element");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	bench_count_allocations();
+	SEE_interpreter_init(interp);
+
+	run(interp, "a[i] = i",
+		"a = []; for (i = 0; i < n; i++) a[i] = i;");
+	run(interp, "s += a[i]",
+		"for (i = 0; i < n; i++) s += a[i];");
+	run(interp, "a[i] += 1",
+		"for (i = 0; i < n; i++) a[i] += 1;");
+	run(interp, "a.push(i)",
+		"a = []; for (i = 0; i < n; i++) a.push(i);");
+	run(interp, "a.pop()",
+		"for (i = 0; i < n; i++) s += a.pop();");
+	run(interp, "a.slice(0)",
+		"a = []; for (i = 0; i < n; i++) a[i] = n - i;\n"
+		"  for (i = 0; i < 10; i++) a.slice(0);");
+	run(interp, "a.sort(cmp)",
+		"a.sort(function (x, y) { return x - y; });");
+}
@@ -0,0 +1,89 @@
+#include "bench.inc"
+
+/*
+ * Measures the cost of calling script functions: a recursive
+ * Fibonacci function, small accessor methods, a two-argument helper
+ * and a function that uses its arguments object. Each is reported
+ * in calls per second, with the memory allocated per call.
+ */
+
+#define FIB_N		24
+#define ITERATIONS	300000
+
+static const char prelude[] =
+	"function fib(n) { return n < 2 ? n : fib(n - 1) + fib(n - 2); }\n"
+	"function P(x) { this.x = x; }\n"
+	"P.prototype.getX = function () { return this.x; };\n"
+	"P.prototype.setX = function (x) { this.x = x; };\n"
+	"function add(a, b) { return a + b; }\n"
+	"function count() { return arguments.length; }\n";
+
+static double fib_calls(int);
+static void run(struct SEE_interpreter *, const char *, double, const char *);
+
+/* Returns the number of calls that fib(n) makes */
+static double
+fib_calls(n)
+	int n;
+{
+	double a = 1, b = 1, c;	/* calls for n-2, n-1 */
+
+	if (n < 2)
+		return 1;
+	while (n-- > 1) {
+		c = 1 + a + b;
+		a = b;
+		b = c;
+	}
+	return b;
+}
+
+static void
+run(interp, desc, ncalls, body)
+	struct SEE_interpreter *interp;
+	const char *desc;
+	double ncalls;
+	const char *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	unsigned long before;
+	double start, elapsed;
+
+	s = SEE_string_sprintf(interp,
+		"%s(function () { var p = new P(1), s = 0, i;\n"
+		"  %s\n"
+		"  return s; })()", prelude, body);
+	input = SEE_input_string(interp, s);
+	before = bench_allocated;
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	elapsed = BENCH_NOW() - start;
+	BENCH_REPORT(desc, elapsed > 0 ? ncalls / elapsed : 0, "calls/s");
+	BENCH_REPORT("  allocated", (bench_allocated - before) / ncalls,
+		"bytes/call");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	char body[64];
+
+	bench_count_allocations();
+	SEE_interpreter_init(interp);
+
+	sprintf(body, "s = fib(%d);", FIB_N);
+	run(interp, "fib(24)", fib_calls(FIB_N), body);
+	sprintf(body, "for (i = 0; i < %d; i++) s += p.getX();", ITERATIONS);
+	run(interp, "p.getX()", ITERATIONS, body);
+	sprintf(body, "for (i = 0; i < %d; i++) p.setX(i);", ITERATIONS);
+	run(interp, "p.setX(i)", ITERATIONS, body);
+	sprintf(body, "for (i = 0; i < %d; i++) s = add(s, i);", ITERATIONS);
+	run(interp, "add(s, i)", ITERATIONS, body);
+	sprintf(body, "for (i = 0; i < %d; i++) s += count(i, i);",
+		ITERATIONS);
+	run(interp, "count(i, i) using arguments", ITERATIONS, body);
+}
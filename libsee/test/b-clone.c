@@ -0,0 +1,75 @@
+#include "bench.inc"
+
+/*
+ * Compares the cost of preparing an interpreter for a short request
+ * by initialising it from scratch with the cost of copying one that
+ * was initialised earlier, as ssp does. A copy shares the original's
+ * objects until it changes them, so the cost of copying and then
+ * running a request that changes a few of them is reported too. Each
+ * is reported in microseconds per interpreter, with the memory
+ * allocated for it.
+ */
+
+#define NINTERP		2000
+
+static const char prelude[] =
+	"function Point(x, y) { this.x = x; this.y = y; }\n"
+	"Point.prototype.sum = function () { return this.x + this.y; };\n"
+	"var config = { name: 'bench', sizes: [1, 2, 4, 8] };";
+
+static const char request[] =
+	"config.sizes.push(new Point(8, 8).sum()); config.name = 'req';";
+
+static void
+report(desc, start, before)
+	const char *desc;
+	double start;
+	unsigned long before;
+{
+	BENCH_REPORT(desc, 1e6 * (BENCH_NOW() - start) / NINTERP,
+		"us/interpreter");
+	BENCH_REPORT("  allocated",
+		(double)(bench_allocated - before) / NINTERP,
+		"bytes/interpreter");
+}
+
+void
+bench()
+{
+	struct SEE_interpreter template_storage, *template = &template_storage;
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_input *input, *rinput;
+	struct SEE_value res;
+	unsigned long before;
+	double start;
+	int i;
+
+	bench_count_allocations();
+
+	before = bench_allocated;
+	start = BENCH_NOW();
+	for (i = 0; i < NINTERP; i++)
+		SEE_interpreter_init(interp);
+	report("SEE_interpreter_init()", start, before);
+
+	SEE_interpreter_init(template);
+	input = SEE_input_utf8(template, prelude);
+	SEE_Global_eval(template, input, &res);
+	SEE_INPUT_CLOSE(input);
+
+	before = bench_allocated;
+	start = BENCH_NOW();
+	for (i = 0; i < NINTERP; i++)
+		SEE_interpreter_clone(interp, template);
+	report("SEE_interpreter_clone()", start, before);
+
+	before = bench_allocated;
+	start = BENCH_NOW();
+	for (i = 0; i < NINTERP; i++) {
+		SEE_interpreter_clone(interp, template);
+		rinput = SEE_input_utf8(interp, request);
+		SEE_Global_eval(interp, rinput, &res);
+		SEE_INPUT_CLOSE(rinput);
+	}
+	report("SEE_interpreter_clone() and a request", start, before);
+}
@@ -0,0 +1,61 @@
+#include "bench.inc"
+
+/*
+ * Measures building a long string out of NFRAGMENTS short fragments:
+ * by appending with + and +=, by prepending, with
+ * String.prototype.concat() and with Array.prototype.join(). Each is
+ * reported in nanoseconds per fragment, with the memory allocated
+ * per fragment.
+ */
+
+#define NFRAGMENTS	100000
+
+static void
+run(interp, desc, body)
+	struct SEE_interpreter *interp;
+	const char *desc, *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	unsigned long before;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"(function () { var n = %d, s = '', a = [], i;\n"
+		"  %s\n"
+		"  if (s.length < n) throw new Error('short');\n"
+		"  return s.length; })()", NFRAGMENTS, body);
+	input = SEE_input_string(interp, s);
+	before = bench_allocated;
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / NFRAGMENTS,
+		"ns/fragment");
+	BENCH_REPORT("  allocated",
+		(double)(bench_allocated - before) / NFRAGMENTS,
+		"bytes/fragment");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	bench_count_allocations();
+	SEE_interpreter_init(interp);
+
+	run(interp, "s = s + 'ab'",
+		"for (i = 0; i < n; i++) s = s + 'ab';");
+	run(interp, "s += i",
+		"for (i = 0; i < n; i++) s += i;");
+	run(interp, "s = 'ab' + s",
+		"for (i = 0; i < n; i++) s = 'ab' + s;");
+	run(interp, "s = '<' + s + '>'",
+		"for (i = 0; i < n; i++) s = '<' + s + '>';");
+	run(interp, "s = s.concat('ab')",
+		"for (i = 0; i < n; i++) s = s.concat('ab');");
+	run(interp, "a.push('ab'); a.join('')",
+		"for (i = 0; i < n; i++) a.push('ab'); s = a.join('');");
+}
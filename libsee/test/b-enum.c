@@ -0,0 +1,55 @@
+#include "bench.inc"
+
+/*
+ * Measures for-in enumeration from scripts: iterating over a small
+ * configuration object, over a fresh object of a common layout, and
+ * over an object that inherits enumerable properties, as a request
+ * handler might do once per request. Each loop runs ITERATIONS times
+ * inside a function, so that its variables are locals.
+ */
+
+#define ITERATIONS	200000
+
+static const char prelude[] =
+	"var config = { host: 'localhost', port: 8080, path: '/',\n"
+	"  secure: false, timeout: 30, retries: 3, user: 'nobody',\n"
+	"  level: 'info' };\n"
+	"function Defaults() {}\n"
+	"Defaults.prototype = config;\n"
+	"var derived = new Defaults(); derived.port = 80; derived.extra = 1;\n";
+
+static void
+run(interp, desc, body)
+	struct SEE_interpreter *interp;
+	const char *desc, *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"%s(function () { var n = 0;\n"
+		"  for (var i = 0; i < %d; i++) { %s }\n"
+		"  return n; })()", prelude, ITERATIONS, body);
+	input = SEE_input_string(interp, s);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / ITERATIONS,
+		"ns/iteration");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+
+	run(interp, "for-in over config", "for (var k in config) n++;");
+	run(interp, "for-in over a new {a,b,c}",
+		"var o = {a: i, b: 2, c: 3}; for (var k in o) n++;");
+	run(interp, "for-in over inherited config",
+		"for (var k in derived) n++;");
+}
@@ -0,0 +1,61 @@
+#include "bench.inc"
+
+/*
+ * Measures the bytecode executer on small loops of the kinds of
+ * statements that scripts are made of: arithmetic and comparisons
+ * on locals and globals, conditionals, property access and string
+ * concatenation. Each loop runs NITER times and is reported in
+ * nanoseconds per iteration.
+ */
+
+#define NITER		200000
+
+static void
+run(interp, desc, body)
+	struct SEE_interpreter *interp;
+	const char *desc, *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp, "var n = %d;\n%s", NITER, body);
+	input = SEE_input_string(interp, s);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / NITER,
+		"ns/iteration");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+
+	run(interp, "global loop, s += i",
+		"var s = 0; for (var i = 0; i < n; i++) s += i;");
+	run(interp, "local loop, s += i * 2 - 1",
+		"(function () { var s = 0;\n"
+		"  for (var i = 0; i < n; i++) s += i * 2 - 1; })()");
+	run(interp, "local loop, if/else on i % 3",
+		"(function () { var a = 0, b = 0;\n"
+		"  for (var i = 0; i < n; i++)\n"
+		"    if (i % 3 == 0) a++; else b--; })()");
+	run(interp, "local while loop, j = j + 1",
+		"(function () { var j = 0;\n"
+		"  while (j < n) j = j + 1; })()");
+	run(interp, "property loop, o.x = o.x + o.y",
+		"(function () { var o = { x: 0, y: 1 };\n"
+		"  for (var i = 0; i < n; i++) o.x = o.x + o.y; })()");
+	run(interp, "global calls, f(i)",
+		"function f(x) { return x + 1; }\n"
+		"var t = 0; for (var i = 0; i < n; i++) t = f(i);");
+	run(interp, "string loop, s = s + 'x' (every 64)",
+		"(function () { var s = '';\n"
+		"  for (var i = 0; i < n; i++)\n"
+		"    if ((i & 63) == 0) s = s + 'x'; })()");
+}
@@ -0,0 +1,126 @@
+#include "bench.inc"
+
+/*
+ * Measures SEE's own garbage collector on a script that keeps a
+ * long-lived tree while making many short-lived ones, after the
+ * binary-trees benchmark. The pauses are the times of the
+ * allocations that ran a collection.
+ */
+
+#define MAXPAUSES	100000
+
+static const char trees[] =
+	"function tree(d) {\n"
+	"  return d == 0 ? {} : { l: tree(d - 1), r: tree(d - 1) };\n"
+	"}\n"
+	"function check(t) { return t.l ? 1 + check(t.l) + check(t.r) : 1; }\n"
+	"var old = tree(14), n = 0;\n"
+	"for (var i = 0; i < 100; i++) n += check(tree(10));\n"
+	"n + check(old)";
+
+static double pauses[MAXPAUSES];
+static unsigned int npauses;
+
+static void *(*gc_malloc)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+static void *(*gc_malloc_string)(struct SEE_interpreter *, SEE_size_t,
+	const char *, int);
+
+static void *
+timed_malloc(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	unsigned long before, after;
+	double start = BENCH_NOW();
+	void *p;
+
+	SEE_simple_gc_stats(NULL, NULL, &before);
+	p = (*gc_malloc)(interp, size, file, line);
+	SEE_simple_gc_stats(NULL, NULL, &after);
+	if (after != before && npauses < MAXPAUSES)
+		pauses[npauses++] = BENCH_NOW() - start;
+	return p;
+}
+
+static void *
+timed_malloc_string(interp, size, file, line)
+	struct SEE_interpreter *interp;
+	SEE_size_t size;
+	const char *file;
+	int line;
+{
+	unsigned long before, after;
+	double start = BENCH_NOW();
+	void *p;
+
+	SEE_simple_gc_stats(NULL, NULL, &before);
+	p = (*gc_malloc_string)(interp, size, file, line);
+	SEE_simple_gc_stats(NULL, NULL, &after);
+	if (after != before && npauses < MAXPAUSES)
+		pauses[npauses++] = BENCH_NOW() - start;
+	return p;
+}
+
+static int
+cmp_double(a, b)
+	const void *a, *b;
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Runs the script in a fresh interpreter and returns the seconds taken */
+static double
+run()
+{
+	struct SEE_interpreter interp;
+	struct SEE_input *input;
+	struct SEE_value res;
+	double start;
+
+	SEE_interpreter_init(&interp);
+	input = SEE_input_utf8(&interp, trees);
+	start = BENCH_NOW();
+	SEE_Global_eval(&interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+	return BENCH_NOW() - start;
+}
+
+void
+bench()
+{
+	SEE_size_t heapsz;
+	unsigned long collections;
+	double t;
+
+	if (!SEE_simple_gc_install()) {
+		printf("SEE's own collector cannot run on this system\n");
+		return;
+	}
+
+	t = run();
+	SEE_simple_gc_stats(&heapsz, NULL, &collections);
+	BENCH_REPORT("binary trees, total", t * 1e3, "ms");
+	BENCH_REPORT("binary trees, collections", collections, "");
+	BENCH_REPORT("binary trees, heap size", heapsz / 1024.0, "kB");
+
+	/* Time again, noting each allocation that collected */
+	gc_malloc = SEE_system.malloc;
+	gc_malloc_string = SEE_system.malloc_string;
+	SEE_system.malloc = timed_malloc;
+	SEE_system.malloc_string = timed_malloc_string;
+	run();
+	if (!npauses)
+		return;
+	qsort(pauses, npauses, sizeof pauses[0], cmp_double);
+	BENCH_REPORT("pause, median", pauses[npauses / 2] * 1e3, "ms");
+	BENCH_REPORT("pause, 90th percentile",
+		pauses[npauses * 9 / 10] * 1e3, "ms");
+	BENCH_REPORT("pause, 99th percentile",
+		pauses[npauses * 99 / 100] * 1e3, "ms");
+	BENCH_REPORT("pause, maximum", pauses[npauses - 1] * 1e3, "ms");
+}
@@ -0,0 +1,103 @@
+#include "bench.inc"
+#include "../lex.h"
+
+/*
+ * Measures how fast source text is read, decoded and scanned. A
+ * script of NFUNC small functions, with comments, string literals
+ * and a few non-ASCII characters, is decoded in blocks and split into
+ * tokens when read from a UTF-8 C string, from a SEE string and from
+ * a file, and is then compiled once. Each is reported in nanoseconds per byte of UTF-8
+ * source; the compiled program is not run.
+ */
+
+#define NFUNC		20000
+
+static const char chunk[] =
+	"/* Returns the sum of a and b, scaled by %d */\n"
+	"function f%d(a, b) {\n"
+	"    var x = a + b * %d, s = 'caf\xc3\xa9';\n"
+	"    // plain line comment\n"
+	"    return x > 10 ? \"big\" : s + x;\n"
+	"}\n";
+
+static void
+decode(desc, input, nbytes)
+	const char *desc;
+	struct SEE_input *input;
+	SEE_size_t nbytes;
+{
+	SEE_unicode_t buf[1024];
+	double start;
+
+	start = BENCH_NOW();
+	while (SEE_input_fill(input, buf, 1024))
+		;
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / nbytes, "ns/byte");
+	SEE_INPUT_CLOSE(input);
+}
+
+static void
+scan(desc, input, nbytes)
+	const char *desc;
+	struct SEE_input *input;
+	SEE_size_t nbytes;
+{
+	struct lex lex;
+	double start;
+
+	start = BENCH_NOW();
+	SEE_lex_init(&lex, input);
+	while (lex.next != tEND)
+		SEE_lex_next(&lex);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / nbytes, "ns/byte");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_input *input;
+	struct SEE_string *s;
+	char *text, *p;
+	SEE_size_t len;
+	double start;
+	FILE *f;
+	int i;
+
+	SEE_interpreter_init(interp);
+
+	text = malloc(NFUNC * sizeof chunk + 3 * NFUNC * 10);
+	for (p = text, i = 0; i < NFUNC; i++)
+		p += sprintf(p, chunk, i, i, i);
+	len = p - text;
+
+	s = SEE_string_sprintf(interp, "%s", text);
+	decode("decode UTF-8 text", SEE_input_utf8(interp, text), len);
+	decode("decode a string", SEE_input_string(interp, s), len);
+	scan("scan UTF-8 text", SEE_input_utf8(interp, text), len);
+	scan("scan a string", SEE_input_string(interp, s), len);
+
+	f = tmpfile();
+	if (f) {
+		fwrite(text, 1, len, f);
+		rewind(f);
+		decode("decode a file", SEE_input_file(interp, f, "tmp",
+			"UTF-8"), len);
+	}
+	f = tmpfile();
+	if (f) {
+		fwrite(text, 1, len, f);
+		rewind(f);
+		scan("scan a file", SEE_input_file(interp, f, "tmp", "UTF-8"),
+			len);
+	}
+
+	input = SEE_input_utf8(interp, text);
+	start = BENCH_NOW();
+	(void)SEE_program_compile(interp, input);
+	BENCH_REPORT("compile UTF-8 text", 1e9 * (BENCH_NOW() - start) / len,
+		"ns/byte");
+	SEE_INPUT_CLOSE(input);
+	free(text);
+}
@@ -0,0 +1,45 @@
+#include "bench.inc"
+
+/*
+ * Measures the intern table with a million distinct keys that share
+ * a long common prefix, like the generated property names of data
+ * held in objects. Each key is interned from a fresh (uninterned)
+ * string, as the interpreter does when it resolves a property name;
+ * then all the keys are looked up again.
+ */
+
+#define NKEYS	    1000000
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_string **keys, *s;
+	double start;
+	long i;
+
+	SEE_interpreter_init(interp);
+	keys = SEE_NEW_ARRAY(interp, struct SEE_string *, NKEYS);
+	for (i = 0; i < NKEYS; i++)
+		keys[i] = SEE_string_sprintf(interp,
+		    "configuration_item_%07d", (int)i);
+
+	start = BENCH_NOW();
+	for (i = 0; i < NKEYS; i++)
+		SEE_intern(interp, keys[i]);
+	BENCH_REPORT("intern new key",
+		1e9 * (BENCH_NOW() - start) / NKEYS, "ns/key");
+
+	start = BENCH_NOW();
+	for (i = 0; i < NKEYS; i++)
+		keys[i] = SEE_intern(interp, keys[i]);
+	BENCH_REPORT("intern existing key",
+		1e9 * (BENCH_NOW() - start) / NKEYS, "ns/key");
+
+	/* The keys are now the interned strings themselves */
+	start = BENCH_NOW();
+	for (i = 0; i < NKEYS; i++)
+		s = SEE_intern(interp, keys[i]);
+	BENCH_REPORT("intern interned key",
+		1e9 * (BENCH_NOW() - start) / NKEYS, "ns/key");
+}
@@ -0,0 +1,87 @@
+#include "bench.inc"
+
+/*
+ * Measures building strings from many pieces: Array.prototype.join()
+ * over NELEMENTS short strings and over numbers, and escape(),
+ * encodeURIComponent() and a global String.prototype.replace() over
+ * a string of NELEMENTS characters. Each array or string is made by
+ * one script and used by another, and only the second is timed. Times
+ * are reported per element or character, with the memory allocated.
+ */
+
+#define NELEMENTS	1000000
+
+static void
+eval(interp, text)
+	struct SEE_interpreter *interp;
+	const char *text;
+{
+	struct SEE_input *input;
+	struct SEE_value res;
+
+	input = SEE_input_utf8(interp, text);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+}
+
+static void
+run(interp, desc, setup, body, n)
+	struct SEE_interpreter *interp;
+	const char *desc, *setup, *body;
+	int n;
+{
+	struct SEE_string *s;
+	struct SEE_input *input;
+	struct SEE_value res;
+	unsigned long before;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"(function () { var n = %d, i; a = []; s = '';\n"
+		"  %s\n"
+		"})()", n, setup);
+	input = SEE_input_string(interp, s);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+
+	before = bench_allocated;
+	start = BENCH_NOW();
+	eval(interp, body);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / n, "ns/element");
+	BENCH_REPORT("  allocated", (double)(bench_allocated - before) / n,
+		"bytes/element");
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	bench_count_allocations();
+	SEE_interpreter_init(interp);
+
+	run(interp, "join 250000 strings",
+		"for (i = 0; i < n; i++) a[i] = 'ab';",
+		"r = a.join(',')", NELEMENTS / 4);
+	run(interp, "join 1000000 strings",
+		"for (i = 0; i < n; i++) a[i] = 'ab';",
+		"r = a.join(',')", NELEMENTS);
+	run(interp, "join 1000000 numbers",
+		"for (i = 0; i < n; i++) a[i] = i;",
+		"r = a.join(',')", NELEMENTS);
+	run(interp, "escape",
+		"for (i = 0; i < n / 1000; i++) a[i] = 'abc d\\u00e9f ';"
+		" s = a.join(''); s = s + s + s + s; s = s + s + s;"
+		" a = [];",
+		"r = escape(s)", NELEMENTS / 1000 * 9 * 12);
+	run(interp, "encodeURIComponent",
+		"for (i = 0; i < n / 1000; i++) a[i] = 'abc d\\u00e9f ';"
+		" s = a.join(''); s = s + s + s + s; s = s + s + s;"
+		" a = [];",
+		"r = encodeURIComponent(s)", NELEMENTS / 1000 * 9 * 12);
+	run(interp, "replace(/ /g, '_')",
+		"for (i = 0; i < n / 1000; i++) a[i] = 'abc d\\u00e9f ';"
+		" s = a.join(''); s = s + s + s + s; s = s + s + s;"
+		" a = [];",
+		"r = s.replace(/ /g, '_')", NELEMENTS / 1000 * 9 * 12);
+}
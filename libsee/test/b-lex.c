@@ -0,0 +1,119 @@
+#include "bench.inc"
+#include "../lex.h"
+#include "../tokens.h"
+
+/*
+ * Measures the lexer's throughput over the scripts in shell/test,
+ * in megabytes of source per second. The scripts are read into
+ * memory first and then split into tokens NITER times each. A slash
+ * is taken to start a regular expression wherever the token before
+ * it could not end an expression, much as the parser decides.
+ */
+
+#ifndef CORPUS_DIR
+# define CORPUS_DIR	"../../shell/test"
+#endif
+
+#define NITER		20
+
+static const char *corpus[] = {
+	"common.js", "function.js", "grammar.js", "obj.Array.js",
+	"obj.Function.js", "obj.Global.js", "obj.Object.js",
+	"obj.String.js", "regex-nfa.js", "regex.js", "regress.js",
+	"throw.js", NULL
+};
+
+/* Reads a whole file into memory, returning its length or -1 */
+static long
+slurp(name, textp)
+	const char *name;
+	char **textp;
+{
+	char path[1024];
+	FILE *f;
+	long len;
+
+	sprintf(path, "%s/%s", CORPUS_DIR, name);
+	if (!(f = fopen(path, "r")))
+		return -1;
+	fseek(f, 0L, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	*textp = malloc(len + 1);
+	len = fread(*textp, 1, len, f);
+	(*textp)[len] = '\0';
+	fclose(f);
+	return len;
+}
+
+/* Returns true if a token can end an expression */
+static int
+ends_expression(token)
+	int token;
+{
+	switch (token) {
+	case tIDENT: case tNUMBER: case tSTRING: case tREGEX:
+	case tTHIS: case tTRUE: case tFALSE: case tNULL:
+	case tPLUSPLUS: case tMINUSMINUS: case ')': case ']': case '}':
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Splits a text into tokens, returning how many there were */
+static unsigned long
+scan(interp, text)
+	struct SEE_interpreter *interp;
+	const char *text;
+{
+	struct lex lex;
+	unsigned long ntokens = 0;
+	int prev;
+
+	SEE_lex_init(&lex, SEE_input_utf8(interp, text));
+	while (lex.next != tEND) {
+		prev = SEE_lex_next(&lex);
+		if (!ends_expression(prev))
+			SEE_lex_regex(&lex);
+		ntokens++;
+	}
+	return ntokens;
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	char *text[sizeof corpus / sizeof corpus[0]];
+	unsigned long nbytes, ntokens;
+	double start, elapsed;
+	long len;
+	int i, n;
+
+	SEE_interpreter_init(interp);
+
+	nbytes = 0;
+	for (n = 0; corpus[n]; n++) {
+		if ((len = slurp(corpus[n], &text[n])) < 0) {
+			perror(corpus[n]);
+			exit(1);
+		}
+		nbytes += len;
+	}
+
+	ntokens = 0;
+	start = BENCH_NOW();
+	for (i = 0; i < NITER; i++)
+		for (n = 0; corpus[n]; n++)
+			ntokens += scan(interp, text[n]);
+	elapsed = BENCH_NOW() - start;
+
+	BENCH_REPORT("scan shell/test/*.js",
+	    NITER * nbytes / elapsed / 1e6, "MB/s");
+	BENCH_REPORT("scan shell/test/*.js",
+	    1e9 * elapsed / ntokens, "ns/token");
+
+	for (n = 0; corpus[n]; n++)
+		free(text[n]);
+}
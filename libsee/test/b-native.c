@@ -0,0 +1,59 @@
+#include "bench.inc"
+
+/*
+ * Measures the memory cost of native objects: a million small
+ * objects are created with zero, two and eight properties, and the
+ * number of bytes requested from the allocator is reported per object.
+ */
+
+#define NOBJECTS    1000000
+
+static void
+native_objects(interp, nprops, desc)
+	struct SEE_interpreter *interp;
+	int nprops;
+	const char *desc;
+{
+	struct SEE_string *names[8];
+	struct SEE_object *o;
+	struct SEE_value v;
+	unsigned long before;
+	double start;
+	char name[2];
+	long i;
+	int j;
+
+	name[1] = '\0';
+	for (j = 0; j < nprops; j++) {
+		name[0] = 'a' + j;
+		names[j] = SEE_intern_ascii(interp, name);
+	}
+
+	start = BENCH_NOW();
+	before = bench_allocated;
+	for (i = 0; i < NOBJECTS; i++) {
+		o = SEE_Object_new(interp);
+		SEE_SET_NUMBER(&v, i);
+		for (j = 0; j < nprops; j++)
+			SEE_OBJECT_PUT(interp, o, names[j], &v, 0);
+	}
+	BENCH_REPORT(desc, (double)(bench_allocated - before) / NOBJECTS,
+		"bytes/object");
+	BENCH_REPORT("  creation time",
+		1e9 * (BENCH_NOW() - start) / NOBJECTS, "ns/object");
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	bench_count_allocations();
+	SEE_interpreter_init(interp);
+
+	BENCH_REPORT("sizeof (struct SEE_native)",
+		sizeof (struct SEE_native), "bytes");
+	native_objects(interp, 0, "{}");
+	native_objects(interp, 2, "{a,b}");
+	native_objects(interp, 8, "{a,b,c,d,e,f,g,h}");
+}
@@ -0,0 +1,68 @@
+#include "bench.inc"
+
+/*
+ * Measures conversions between numbers and strings: small and large
+ * integers, negative integers and fractions converted with String(),
+ * an array of records joined into JSON-like text, and strings read
+ * back with unary +. Each loop runs NITER times and is reported in
+ * nanoseconds per conversion.
+ */
+
+#define NITER		200000
+
+static void
+run(interp, desc, count, body)
+	struct SEE_interpreter *interp;
+	const char *desc;
+	int count;
+	const char *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp, "var n = %d;\n%s", NITER, body);
+	input = SEE_input_string(interp, s);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / (NITER * count),
+		"ns/conversion");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+
+	run(interp, "String(i & 255)", 1,
+		"(function () { var s;\n"
+		"  for (var i = 0; i < n; i++) s = String(i & 255); })()");
+	run(interp, "String(i * 7919)", 1,
+		"(function () { var s;\n"
+		"  for (var i = 0; i < n; i++) s = String(i * 7919); })()");
+	run(interp, "String(-i)", 1,
+		"(function () { var s;\n"
+		"  for (var i = 0; i < n; i++) s = String(-i); })()");
+	run(interp, "String(i / 7)", 1,
+		"(function () { var s;\n"
+		"  for (var i = 0; i < n; i++) s = String(i / 7); })()");
+	run(interp, "String(i * 0.25 - 1e4)", 1,
+		"(function () { var s;\n"
+		"  for (var i = 0; i < n; i++) s = String(i * 0.25 - 1e4); })()");
+	run(interp, "JSON-like records, 3 numbers each", 3,
+		"(function () { var a = [];\n"
+		"  for (var i = 0; i < n; i++)\n"
+		"    a.push('{\"id\":' + i + ',\"x\":' + i / 8 + ',\"y\":' +\n"
+		"      (i % 100 - 50) + '}');\n"
+		"  return a.join(); })()");
+	run(interp, "+'123'", 1,
+		"(function () { var s = '123', x;\n"
+		"  for (var i = 0; i < n; i++) x = +s; })()");
+	run(interp, "+'-4567.125'", 1,
+		"(function () { var s = '-4567.125', x;\n"
+		"  for (var i = 0; i < n; i++) x = +s; })()");
+}
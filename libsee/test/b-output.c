@@ -0,0 +1,101 @@
+#include "bench.inc"
+
+/*
+ * Measures UTF-8 output of strings: whole strings written with
+ * SEE_string_fputs(), and many short fragments written through an
+ * output buffer, as a page generator prints them. The text is ASCII,
+ * or mostly ASCII with accented letters and a symbol in every line.
+ * Output goes to /dev/null, so that only the encoding and the calls
+ * into stdio are timed.
+ */
+
+#define TEXTLEN		(1024 * 1024)
+#define NFRAG		1000000
+
+static struct SEE_string *
+make_text(interp, accented)
+	struct SEE_interpreter *interp;
+	int accented;
+{
+	struct SEE_string *s;
+	int i;
+
+	s = SEE_string_new(interp, TEXTLEN);
+	for (i = 0; i < TEXTLEN; i++)
+		if (accented && i % 64 == 10)
+			SEE_string_addch(s, 0xe9);
+		else if (accented && i % 64 == 40)
+			SEE_string_addch(s, 0x20ac);
+		else
+			SEE_string_addch(s, i % 64 == 63 ? '\n' : 'a' + i % 26);
+	return s;
+}
+
+static void
+fputs_text(desc, s, f)
+	const char *desc;
+	struct SEE_string *s;
+	FILE *f;
+{
+	double start;
+	int i;
+
+	start = BENCH_NOW();
+	for (i = 0; i < 20; i++)
+		SEE_string_fputs(s, f);
+	fflush(f);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / (20.0 * TEXTLEN),
+		"ns/char");
+}
+
+static void
+fragments(interp, desc, frags, nfrags, f, buffered)
+	struct SEE_interpreter *interp;
+	const char *desc;
+	struct SEE_string **frags;
+	int nfrags;
+	FILE *f;
+	int buffered;
+{
+	static struct SEE_output output;
+	double start;
+	int i;
+
+	SEE_output_init(&output, f);
+	start = BENCH_NOW();
+	for (i = 0; i < NFRAG; i++)
+		if (buffered)
+			SEE_output_string(interp, &output, frags[i % nfrags]);
+		else
+			SEE_string_fputs(frags[i % nfrags], f);
+	SEE_output_flush(&output);
+	fflush(f);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / NFRAG,
+		"ns/fragment");
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_string *frags[4];
+	FILE *f;
+
+	SEE_interpreter_init(interp);
+	f = fopen("/dev/null", "w");
+	if (!f) {
+		perror("/dev/null");
+		exit(1);
+	}
+
+	fputs_text("fputs 1MB of ASCII", make_text(interp, 0), f);
+	fputs_text("fputs 1MB, 3% accented", make_text(interp, 1), f);
+
+	frags[0] = SEE_string_sprintf(interp, "<td class=\"n\">");
+	frags[1] = SEE_string_sprintf(interp, "12345");
+	frags[2] = SEE_string_sprintf(interp, "</td>");
+	frags[3] = SEE_string_sprintf(interp, "caf\xc3\xa9 au lait\n");
+	fragments(interp, "fputs short fragments", frags, 4, f, 0);
+	fragments(interp, "buffer short fragments", frags, 4, f, 1);
+	fclose(f);
+}
@@ -0,0 +1,52 @@
+#include "bench.inc"
+
+/*
+ * Measures property access from scripts: reading and writing an
+ * object's own properties, and calling methods found on prototypes.
+ * Each script loops ITERATIONS times inside a function, so that its
+ * variables are locals and only the property accesses are timed.
+ */
+
+#define ITERATIONS	1000000
+
+static const char prelude[] =
+	"function P(x) { this.x = x; this.y = 0; this.z = 0; }\n"
+	"P.prototype.get = function () { return this.x; };\n"
+	"P.prototype.toString = function () { return 'P'; };\n";
+
+static void
+run(interp, desc, body)
+	struct SEE_interpreter *interp;
+	const char *desc, *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"%s(function () { var p = new P(1), q = new P(2), s = 0;\n"
+		"  for (var i = 0; i < %d; i++) { %s }\n"
+		"  return s; })()", prelude, ITERATIONS, body);
+	input = SEE_input_string(interp, s);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / ITERATIONS,
+		"ns/iteration");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+
+	run(interp, "empty loop", "");
+	run(interp, "s += p.x", "s += p.x;");
+	run(interp, "p.y = i", "p.y = i;");
+	run(interp, "s += p.get()", "s += p.get();");
+	run(interp, "s += (i & 1 ? p : q).get()", "s += (i & 1 ? p : q).get();");
+	run(interp, "p.hasOwnProperty('x')", "p.hasOwnProperty('x');");
+}
@@ -0,0 +1,71 @@
+#include "bench.inc"
+
+/*
+ * Measures regular expression searches over a long text that has few
+ * matches: global replace, match and split, search for a literal that
+ * is near the end, and a search that makes the backtracker retry each
+ * word. Each is run with each regex engine, and is reported in
+ * nanoseconds per character of the text.
+ */
+
+#define TEXTLEN		100000
+
+static const char *exprs[] = {
+	"text.replace(/&/g, '&amp;')",
+	"text.match(/&amp;|</g)",
+	"text.split(/,\\s*/)",
+	"text.search(/need(le|s)/)",
+	"text.search(/[0-9]+x/)",
+	"/(fox|cat)\\s+jumps/g.exec(text)",
+	"text.search(/(\\w+\\s)+\\d/)",
+	NULL
+};
+
+static void
+run(interp, engine, expr)
+	struct SEE_interpreter *interp;
+	const char *engine, *expr;
+{
+	struct SEE_input *input;
+	struct SEE_value res;
+	double start;
+	char desc[128];
+
+	sprintf(desc, "%s: %.100s", engine, expr);
+
+	interp->regex_engine = SEE_regex_engine(engine);
+	input = SEE_input_utf8(interp, expr);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / TEXTLEN,
+		"ns/char");
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	const char **e;
+
+	SEE_interpreter_init(interp);
+
+	/* A line of text with an & every 1000 or so characters */
+	s = SEE_string_sprintf(interp,
+		"var text = 'the quick brown fox jumps over the lazy dog ';\n"
+		"while (text.length < %d) text += text;\n"
+		"text = text.substring(0, %d);\n"
+		"text = text.replace(/(.{997})/g, '$1&,');\n"
+		"text += 'needle';", TEXTLEN, TEXTLEN);
+	input = SEE_input_string(interp, s);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+
+	for (e = exprs; *e; e++) {
+		run(interp, "ecma", *e);
+		run(interp, "nfa", *e);
+	}
+}
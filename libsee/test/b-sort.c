@@ -0,0 +1,78 @@
+#include "bench.inc"
+
+/*
+ * Measures Array.prototype.sort on NRECORDS elements: records ordered
+ * by a numeric field through a comparison function, numbers and
+ * strings in their default string order, and input that is already
+ * sorted or reversed. Each array is built by one script and sorted
+ * by another, and only the sort is timed.
+ */
+
+#define NRECORDS	200000
+
+static void
+eval(interp, text)
+	struct SEE_interpreter *interp;
+	const char *text;
+{
+	struct SEE_input *input;
+	struct SEE_value res;
+
+	input = SEE_input_utf8(interp, text);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+}
+
+static void
+run(interp, desc, setup, sort)
+	struct SEE_interpreter *interp;
+	const char *desc, *setup, *sort;
+{
+	struct SEE_string *s;
+	struct SEE_input *input;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp,
+		"(function () { var n = %d, i; a = [];\n"
+		"  %s\n"
+		"})()", NRECORDS, setup);
+	input = SEE_input_string(interp, s);
+	SEE_Global_eval(interp, input, &res);
+	SEE_INPUT_CLOSE(input);
+
+	start = BENCH_NOW();
+	eval(interp, sort);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / NRECORDS,
+		"ns/element");
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+	eval(interp, "function bykey(x, y) { return x.key - y.key; }\n"
+		     "function bynum(x, y) { return x - y; }");
+
+	run(interp, "records, sort(bykey)",
+		"for (i = 0; i < n; i++)"
+		" a[i] = { key: (i * 7919) % 1000, name: 'r' + i };",
+		"a.sort(bykey)");
+	run(interp, "numbers, sort(bynum)",
+		"for (i = 0; i < n; i++) a[i] = (i * 7919) % n;",
+		"a.sort(bynum)");
+	run(interp, "numbers, sort()",
+		"for (i = 0; i < n; i++) a[i] = (i * 7919) % n;",
+		"a.sort()");
+	run(interp, "strings, sort()",
+		"for (i = 0; i < n; i++) a[i] = 'k' + (i * 7919) % n;",
+		"a.sort()");
+	run(interp, "sorted numbers, sort(bynum)",
+		"for (i = 0; i < n; i++) a[i] = i;",
+		"a.sort(bynum)");
+	run(interp, "reversed numbers, sort(bynum)",
+		"for (i = 0; i < n; i++) a[i] = n - i;",
+		"a.sort(bynum)");
+}
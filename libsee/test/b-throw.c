@@ -0,0 +1,65 @@
+#include "bench.inc"
+
+/*
+ * Measures the cost of calls and of exceptions: calls that return
+ * normally through a deep chain of frames, calls of built-in
+ * functions, try statements that catch nothing, and exceptions that
+ * are thrown through DEPTH frames before being caught.
+ */
+
+#define DEPTH		50
+#define NITER		4000
+
+/* Runs body, which performs count of the operations named by unit */
+static void
+run(interp, desc, count, unit, body)
+	struct SEE_interpreter *interp;
+	const char *desc;
+	double count;
+	const char *unit;
+	const char *body;
+{
+	struct SEE_input *input;
+	struct SEE_string *s;
+	struct SEE_value res;
+	double start;
+
+	s = SEE_string_sprintf(interp, "var n = %d, depth = %d;\n%s",
+		NITER, DEPTH, body);
+	input = SEE_input_string(interp, s);
+	start = BENCH_NOW();
+	SEE_Global_eval(interp, input, &res);
+	BENCH_REPORT(desc, 1e9 * (BENCH_NOW() - start) / count, unit);
+	SEE_INPUT_CLOSE(input);
+}
+
+void
+bench()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	SEE_interpreter_init(interp);
+
+	run(interp, "call chain 50 deep, no exceptions",
+		(double)NITER * (DEPTH + 1), "ns/call",
+		"function f(k) { return k ? f(k - 1) + 1 : 0; }\n"
+		"for (var i = 0; i < n; i++) f(depth);");
+	run(interp, "built-in calls, Math.abs(i)",
+		(double)NITER * 50, "ns/call",
+		"(function () { var m = Math;\n"
+		"  for (var i = 0; i < n * 50; i++) m.abs(i); })()");
+	run(interp, "try { } catch in a loop, nothing thrown",
+		(double)NITER * 50, "ns/iteration",
+		"(function () { var s = 0;\n"
+		"  for (var i = 0; i < n * 50; i++)\n"
+		"    try { s += i; } catch (e) { s = 0; } })()");
+	run(interp, "throw through 50 frames",
+		(double)NITER, "ns/throw",
+		"function g(k) { if (!k) throw k; g(k - 1); }\n"
+		"for (var i = 0; i < n; i++) try { g(depth); } catch (e) { }");
+	run(interp, "throw through 50 frames with finally",
+		(double)NITER, "ns/throw",
+		"function h(k) { try { if (!k) throw k; h(k - 1); }\n"
+		"  finally { k++; } }\n"
+		"for (var i = 0; i < n; i++) try { h(depth); } catch (e) { }");
+}
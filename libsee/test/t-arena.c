@@ -0,0 +1,126 @@
+#include "test.inc"
+#include <see/see.h>
+
+static int finalized;
+
+/* Counts the objects finalized */
+static void
+count_finalize(interp, p, closure)
+	struct SEE_interpreter *interp;
+	void *p, *closure;
+{
+	finalized++;
+}
+
+void
+test()
+{
+	struct SEE_interpreter orig_storage, *orig = &orig_storage;
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_interpreter copy_storage, *copy = &copy_storage;
+	struct SEE_arena *arena, *inner;
+	SEE_try_context_t ctxt;
+	SEE_size_t used;
+	char buf[16];
+	int i, j;
+
+	TEST_DESCRIBE("interpreters allocated from arenas");
+
+	/* An interpreter can be initialised in an arena */
+	arena = SEE_arena_new(0);
+	TEST_NOT_NULL(arena);
+	SEE_interpreter_init_arena(interp, arena);
+	TEST_EQ_PTR(interp->arena, arena);
+	used = SEE_arena_used(arena);
+	TEST(used > 0);
+	TEST_RUN(interp, "var a = []; for (var i = 0; i < 100; i++) "
+		"a.push('x' + i); a.join('').length", "290");
+	TEST(SEE_arena_used(arena) > used);
+
+	/* Finalizers run when the arena is destroyed */
+	finalized = 0;
+	for (i = 0; i < 3; i++)
+		SEE_malloc_finalize(interp, 16, count_finalize, NULL);
+	TEST_EQ_INT(finalized, 0);
+	SEE_arena_destroy(arena);
+	TEST_EQ_INT(finalized, 3);
+
+	/* A copy of an ordinary interpreter can be made in an arena */
+	SEE_interpreter_init(orig);
+	TEST(orig->arena == NULL);
+	test_eval(orig,
+	    "var counter = 0; function next() { return ++counter; }");
+	for (i = 0; i < 3; i++) {
+		arena = SEE_arena_new(0);
+		SEE_interpreter_clone_arena(interp, orig, arena);
+		TEST_EQ_PTR(interp->arena, arena);
+		TEST_RUN(interp, "next() + next()", "3");
+		SEE_arena_destroy(arena);
+	}
+	TEST_RUN(orig, "next()", "1");
+
+	/*
+	 * An interpreter in an arena can be copied, in the ordinary way
+	 * or into another arena, while its own arena outlives the copies
+	 */
+	arena = SEE_arena_new(0);
+	SEE_interpreter_clone_arena(interp, orig, arena);
+	TEST_RUN(interp, "next()", "2");
+	SEE_interpreter_clone(copy, interp);
+	TEST(copy->arena == NULL);
+	TEST_RUN(copy, "next()", "3");
+	TEST_RUN(interp, "next()", "3");
+	inner = SEE_arena_new(0);
+	SEE_interpreter_clone_arena(copy, interp, inner);
+	TEST_EQ_PTR(copy->arena, inner);
+	TEST_RUN(copy, "next() + next()", "9");
+	SEE_arena_destroy(inner);
+	TEST_RUN(interp, "next()", "4");
+	SEE_arena_destroy(arena);
+	TEST_RUN(orig, "next()", "2");
+
+	/* Going past the limit throws an error that scripts can catch */
+	SEE_interpreter_init(orig);
+	arena = SEE_arena_new(2 * 1024 * 1024);
+	SEE_interpreter_clone_arena(interp, orig, arena);
+	TEST_RUN(interp, "var a = [], caught;\n"
+		"try { for (;;) a.push('xxxxxxxx' + a.length); }\n"
+		"catch (e) { caught = e; }\n"
+		"a = null; caught.name", "RangeError");
+	TEST_RUN(interp, "caught.message",
+		"<input>:2: Memory limit was reached");
+	TEST(SEE_arena_used(arena) > 2 * 1024 * 1024);
+	TEST_RUN(interp, "try { 'x'.replace(/x/, new Array(20000).join('y'))"
+		".length } catch (e) { e.name }", "RangeError");
+	SEE_arena_destroy(arena);
+
+	/*
+	 * Objects and intern tables stay whole when the error is caught,
+	 * wherever the limit happens to fall
+	 */
+	for (j = 0; j < 16; j++) {
+	    arena = SEE_arena_new(300 * 1024 + j * 1000);
+	    SEE_interpreter_clone_arena(interp, orig, arena);
+	    test_eval(interp, "var o = {}, n = 0;\n"
+		"function fill() {\n"
+		"  try { for (;;) o['p' + n++] = n; }\n"
+		"  catch (e) { return e.name; }\n"
+		"}");
+	    for (i = 0; i < 4; i++)
+		TEST_RUN(interp, "fill()", "RangeError");
+	    SEE_TRY(interp, ctxt) {
+		for (i = 0; ; i++) {
+		    sprintf(buf, "s%d", i);
+		    SEE_intern_ascii(interp, buf);
+		}
+	    }
+	    TEST(SEE_CAUGHT(ctxt) != NULL);
+	    TEST_EQ_PTR(SEE_intern_ascii(interp, "s0"),
+		SEE_intern_ascii(interp, "s0"));
+	    TEST_RUN(interp, "fill()", "RangeError");
+	    TEST_RUN(interp,
+		"o.p0 + ',' + o.p7 + ',' + (o['p' + (n - 9)] - n)", "1,8,-8");
+	    TEST_RUN(interp, "var p = { a: 1 }; p.b = 2; p.a + p.b", "3");
+	    SEE_arena_destroy(arena);
+	}
+}
@@ -0,0 +1,93 @@
+#include "test.inc"
+#include <see/see.h>
+
+static const char prelude[] =
+	"var counter = (function () { var n = 0;\n"
+	"  return function () { return ++n; }; })();\n"
+	"function Point(x, y) { this.x = x; this.y = y; }\n"
+	"Point.prototype.sum = function () { return this.x + this.y; };\n"
+	"var table = { a: [1, 2, 3], s: new String('str'), re: /o+/g };\n"
+	"var when = new Date(0);\n"
+	"var args = (function () { return arguments; })(1, 2);\n"
+	"Array.prototype.first = function () { return this[0]; };\n"
+	"counter();";
+
+/* Returns twice its argument */
+static void
+twice_fn(interp, self, thisobj, argc, argv, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *self, *thisobj;
+	int argc;
+	struct SEE_value **argv, *res;
+{
+	struct SEE_value v;
+
+	SEE_ToNumber(interp, argv[0], &v);
+	SEE_SET_NUMBER(res, 2 * v.u.number);
+}
+
+void
+test()
+{
+	struct SEE_interpreter orig_storage, *orig = &orig_storage;
+	struct SEE_interpreter a_storage, *a = &a_storage;
+	struct SEE_interpreter b_storage, *b = &b_storage;
+
+	TEST_DESCRIBE("copying initialised interpreters");
+	SEE_interpreter_init(orig);
+	SEE_CFUNCTION_PUTA(orig, orig->Global, "twice", twice_fn, 1, 0);
+	TEST_RUN(orig, prelude, "1");
+
+	SEE_interpreter_clone(a, orig);
+	SEE_interpreter_clone(b, orig);
+
+	/* The copies start out the same as the original */
+	TEST_RUN(a, "counter()", "2");
+	TEST_RUN(b, "counter()", "2");
+	TEST_RUN(a, "counter()", "3");
+	TEST_RUN(a, "twice(21)", "42");
+	TEST_RUN(a, "new Point(3, 4).sum()", "7");
+	TEST_RUN(a, "table.a.first() + table.a.join('')", "1123");
+	TEST_RUN(a, "table.s.length + table.s.charAt(1)", "3t");
+	TEST_RUN(a, "'foo boo'.replace(table.re, 'e')", "fe be");
+	TEST_RUN(a, "Math.max(1, 5) + parseInt('12')", "17");
+	TEST_RUN(a, "new Date(0).getTime()", "0");
+	TEST_RUN(a, "try { null.x } catch (e) { e.name }",
+		"TypeError");
+	TEST_RUN(a, "typeof Function.prototype.call", "function");
+	TEST_RUN(a, "eval('1 + 1')", "2");
+
+	/* Changes made in one copy are not seen by the others */
+	test_eval(a,
+		"Object.prototype.extra = 'a'; Array.prototype.first = null;"
+		"Point.prototype.z = 1; table.a.push(4); table.b = 2;"
+		"delete Math.PI; var g = 'a';");
+	TEST_RUN(a, "({}).extra + table.a.length + table.b + g",
+		"a42a");
+	TEST_RUN(b, "typeof ({}).extra + table.a.length + "
+		"typeof table.b + typeof g", "undefined3undefinedundefined");
+	TEST_RUN(b, "[5].first() + ',' + new Point(1, 1).z + ',' + Math.PI",
+		"5,undefined,3.141592653589793");
+	TEST_RUN(b, "counter()", "3");
+	TEST_RUN(orig, "counter() + ',' + table.a.length", "2,3");
+
+	/* Objects of the original's other kinds are copied when changed */
+	test_eval(a, "when.setTime(5); args[0] = 7; delete args[1]; "
+		"table.re.lastIndex = 2");
+	TEST_RUN(a, "when.getTime() + ',' + args[0] + ',' + args[1] + ','"
+		" + table.re.lastIndex", "5,7,undefined,2");
+	TEST_RUN(b, "when.getTime() + ',' + args[0] + ',' + args[1] + ','"
+		" + table.re.lastIndex", "0,1,2,0");
+
+	/* The original's later changes are private to it */
+	test_eval(orig, "Array.prototype.first = 'o'; var h = 1;");
+	TEST_RUN(b, "typeof [].first + typeof h", "functionundefined");
+	SEE_interpreter_clone(b, orig);
+	TEST_RUN(b, "[].first + h", "o1");
+	TEST_RUN(a, "[].first + typeof h", "nullundefined");
+
+	/* A copy can itself be copied */
+	SEE_interpreter_clone(b, a);
+	TEST_RUN(b, "counter() + ',' + ({}).extra + g", "4,aa");
+	TEST_RUN(a, "counter()", "4");
+}
@@ -0,0 +1,188 @@
+#include "test.inc"
+#include <see/see.h>
+#include "../enumerate.h"
+
+/* Joins the names SEE_enumerate() gives for an object with commas */
+static char *
+names(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	static char buf[256];
+	struct SEE_string **props, **p;
+	char *b = buf;
+	unsigned int i;
+
+	props = SEE_enumerate(interp, o);
+	for (p = props; *p; p++) {
+		if (p != props)
+			*b++ = ',';
+		for (i = 0; i < (*p)->length; i++)
+			*b++ = (char)(*p)->data[i];
+	}
+	*b = '\0';
+	SEE_enumerate_free(interp, props);
+	return buf;
+}
+
+/* Sets a property on an object to a number */
+static void
+put(interp, o, name, attr)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+	const char *name;
+	int attr;
+{
+	struct SEE_value v;
+
+	SEE_SET_NUMBER(&v, 1);
+	SEE_OBJECT_PUT(interp, o, SEE_intern_ascii(interp, name), &v, attr);
+}
+
+/* Returns a new native object with the given prototype */
+static struct SEE_object *
+make(interp, proto)
+	struct SEE_interpreter *interp;
+	struct SEE_object *proto;
+{
+	struct SEE_object *o;
+
+	o = SEE_native_new(interp);
+	o->Prototype = proto;
+	return o;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_object *o, *o2, *p, *a;
+	struct SEE_string **props1, **props2;
+	struct SEE_value v;
+	int i;
+
+	SEE_interpreter_init_compat(interp, SEE_COMPAT_262_3B);
+
+	TEST_DESCRIBE("own properties are enumerated in insertion order");
+	o = make(interp, NULL);
+	TEST_EQ_STR(names(interp, o), "");
+	put(interp, o, "zeta", 0);
+	put(interp, o, "alpha", 0);
+	put(interp, o, "10", 0);
+	put(interp, o, "hidden", SEE_ATTR_DONTENUM);
+	put(interp, o, "2", 0);
+	TEST_EQ_STR(names(interp, o), "zeta,alpha,10,2");
+
+	TEST_DESCRIBE("enumeration follows changes to the object");
+	TEST_EQ_STR(names(interp, o), "zeta,alpha,10,2");
+	put(interp, o, "beta", 0);
+	TEST_EQ_STR(names(interp, o), "zeta,alpha,10,2,beta");
+	SEE_OBJECT_DELETE(interp, o, SEE_intern_ascii(interp, "alpha"));
+	TEST_EQ_STR(names(interp, o), "zeta,10,2,beta");
+	put(interp, o, "alpha", 0);
+	TEST_EQ_STR(names(interp, o), "zeta,10,2,beta,alpha");
+	SEE_SET_NUMBER(&v, 2);
+	SEE_native_put(interp, o, SEE_intern_ascii(interp, "zeta"), &v,
+	    SEE_ATTR_DONTENUM);
+	TEST_EQ_STR(names(interp, o), "10,2,beta,alpha");
+
+	TEST_DESCRIBE("deleting a property keeps the others in order");
+	o = make(interp, NULL);
+	put(interp, o, "a", 0);
+	put(interp, o, "b", 0);
+	put(interp, o, "c", 0);
+	put(interp, o, "d", 0);
+	SEE_OBJECT_DELETE(interp, o, SEE_intern_ascii(interp, "a"));
+	TEST_EQ_STR(names(interp, o), "b,c,d");
+	SEE_OBJECT_DELETE(interp, o, SEE_intern_ascii(interp, "c"));
+	TEST_EQ_STR(names(interp, o), "b,d");
+	SEE_OBJECT_DELETE(interp, o, SEE_intern_ascii(interp, "d"));
+	TEST_EQ_STR(names(interp, o), "b");
+
+	/* Large enough for the property names to be hashed */
+	o = make(interp, NULL);
+	for (i = 0; i < 20; i++) {
+		SEE_SET_NUMBER(&v, i);
+		SEE_OBJECT_PUT(interp, o, SEE_intern(interp,
+		    SEE_string_sprintf(interp, "p%d", i)), &v, 0);
+	}
+	for (i = 0; i < 20; i += 3)
+		SEE_OBJECT_DELETE(interp, o, SEE_intern(interp,
+		    SEE_string_sprintf(interp, "p%d", i)));
+	TEST_EQ_STR(names(interp, o),
+	    "p1,p2,p4,p5,p7,p8,p10,p11,p13,p14,p16,p17,p19");
+	for (i = 0; i < 20; i++) {
+		SEE_OBJECT_GET(interp, o, SEE_intern(interp,
+		    SEE_string_sprintf(interp, "p%d", i)), &v);
+		if (i % 3 == 0)
+			TEST_EQ_INT(SEE_VALUE_GET_TYPE(&v), SEE_UNDEFINED);
+		else
+			TEST(SEE_VALUE_GET_TYPE(&v) == SEE_NUMBER &&
+			    v.u.number == i);
+	}
+
+	TEST_DESCRIBE("objects of the same layout share their names");
+	o = make(interp, NULL);
+	o2 = make(interp, NULL);
+	put(interp, o, "x", 0);
+	put(interp, o, "y", 0);
+	put(interp, o2, "x", 0);
+	put(interp, o2, "y", 0);
+	props1 = SEE_enumerate(interp, o);
+	props2 = SEE_enumerate(interp, o2);
+	TEST_EQ_PTR(props1, props2);
+	SEE_enumerate_free(interp, props1);
+	SEE_enumerate_free(interp, props2);
+	TEST_EQ_STR(names(interp, o), "x,y");
+	put(interp, o2, "z", 0);
+	TEST_EQ_STR(names(interp, o), "x,y");
+	TEST_EQ_STR(names(interp, o2), "x,y,z");
+
+	TEST_DESCRIBE("JavaScript compatibility mode sorts the names");
+	o = make(interp, NULL);
+	put(interp, o, "zeta", 0);
+	put(interp, o, "alpha", 0);
+	TEST_EQ_STR(names(interp, o), "zeta,alpha");
+	SEE_SET_JS_COMPAT(interp, SEE_COMPAT_JS15);
+	TEST_EQ_STR(names(interp, o), "alpha,zeta");
+	o = make(interp, NULL);
+	put(interp, o, "zeta", 0);
+	put(interp, o, "alpha", 0);
+	put(interp, o, "10", 0);
+	put(interp, o, "2", 0);
+	TEST_EQ_STR(names(interp, o), "2,10,alpha,zeta");
+	TEST_EQ_STR(names(interp, o), "2,10,alpha,zeta");
+	put(interp, o, "beta", 0);
+	TEST_EQ_STR(names(interp, o), "2,10,alpha,beta,zeta");
+
+	TEST_DESCRIBE("prototype properties are merged and follow changes");
+	/* (Sorted, since the merged order is otherwise arbitrary) */
+	p = make(interp, NULL);
+	o = make(interp, p);
+	put(interp, o, "b", 0);
+	TEST_EQ_STR(names(interp, o), "b");
+	put(interp, p, "c", SEE_ATTR_DONTENUM);
+	TEST_EQ_STR(names(interp, o), "b");
+	put(interp, p, "a", 0);
+	put(interp, p, "b", 0);
+	TEST_EQ_STR(names(interp, o), "a,b");
+	SEE_OBJECT_DELETE(interp, p, SEE_intern_ascii(interp, "a"));
+	TEST_EQ_STR(names(interp, o), "b");
+	put(interp, o, "c", 0);
+	TEST_EQ_STR(names(interp, o), "b,c");	/* shadows DontEnum */
+
+	/* Long chains, and chains through non-native objects */
+	for (a = o, i = 0; i < 6; i++)
+		a = make(interp, a);
+	TEST_EQ_STR(names(interp, a), "b,c");
+	put(interp, p, "d", 0);
+	TEST_EQ_STR(names(interp, a), "b,c,d");
+	SEE_OBJECT_CONSTRUCT(interp, interp->Array, interp->Array, 0, NULL,
+	    &v);
+	a = v.u.object;
+	put(interp, a, "0", 0);
+	o = make(interp, a);
+	TEST_EQ_STR(names(interp, o), "0");
+	put(interp, a, "1", 0);
+	TEST_EQ_STR(names(interp, o), "0,1");
+}
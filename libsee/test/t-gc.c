@@ -0,0 +1,99 @@
+#include "test.inc"
+#include <see/see.h>
+
+/* Reached only from this static variable */
+static struct SEE_string *kept;
+
+static int finalized;
+
+static void
+count_finalize(interp, p, closure)
+	struct SEE_interpreter *interp;
+	void *p, *closure;
+{
+	finalized++;
+}
+
+/* Makes many objects, keeping one in a thousand */
+static const char churn[] =
+	"var keep = [];\n"
+	"for (var i = 0; i < 20000; i++) {\n"
+	"  var o = { n: i, s: 'item ' + i, a: [i, i + 1, i + 2] };\n"
+	"  if (i % 1000 == 0) keep.push(o);\n"
+	"}\n"
+	"keep.length + ',' + keep[7].s + ',' + keep[19].a.join('+')";
+
+/* Hangs an array of objects with finalizers off the interpreter */
+static void
+make_finalizable(interp, n)
+	struct SEE_interpreter *interp;
+	int n;
+{
+	void **objs;
+	int i;
+
+	objs = SEE_NEW_ARRAY(interp, void *, n);
+	for (i = 0; i < n; i++)
+	    objs[i] = SEE_malloc_finalize(interp, 32, count_finalize, NULL);
+	interp->host_data = objs;
+}
+
+/*
+ * Called through a pointer so that it is not inlined, and no copy of
+ * the array is left in the caller's registers to keep it alive
+ */
+static void (*volatile make_finalizable_fn)(struct SEE_interpreter *, int) =
+	make_finalizable;
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	SEE_size_t heapsz, heapsz2, inuse;
+	unsigned long collections;
+	void *p;
+	int i;
+
+	TEST_DESCRIBE("SEE's own garbage collector");
+	if (!SEE_simple_gc_install())
+	    TEST_EXIT_IGNORE();
+	SEE_interpreter_init(interp);
+	kept = SEE_string_sprintf(interp, "static %s", "root");
+
+	/* Scripts run while their garbage is collected */
+	TEST_RUN(interp, churn, "20,item 7000,19000+19001+19002");
+	SEE_simple_gc_stats(&heapsz, &inuse, &collections);
+	TEST(collections > 0);
+	TEST(inuse <= heapsz);
+
+	/* Memory is reused rather than the heap growing */
+	for (i = 0; i < 4; i++)
+	    TEST_RUN(interp, churn, "20,item 7000,19000+19001+19002");
+	SEE_simple_gc_stats(&heapsz2, NULL, NULL);
+	TEST(heapsz2 < 2 * heapsz);
+
+	/* Static data are roots */
+	TEST_EQ_STRING(kept, SEE_string_sprintf(interp, "static root"));
+
+	/* Finalizers run only once their objects are unreachable */
+	(*make_finalizable_fn)(interp, 100);
+	SEE_gcollect(interp);
+	TEST_EQ_INT(finalized, 0);
+	interp->host_data = NULL;
+	SEE_gcollect(interp);
+	TEST(finalized >= 90);
+
+	/* Large objects are returned to the system when freed */
+	SEE_gcollect(interp);
+	SEE_simple_gc_stats(&heapsz, NULL, NULL);
+	p = SEE_malloc_string(interp, 1000000);
+	SEE_simple_gc_stats(&heapsz2, NULL, NULL);
+	TEST(heapsz2 >= heapsz + 1000000);
+	SEE_free(interp, &p);
+	SEE_simple_gc_stats(&heapsz2, NULL, NULL);
+	TEST(heapsz2 == heapsz);
+
+	/* The interpreter still works after all that */
+	TEST_RUN(interp, "function f(x) { return /b+/.exec(x)[0]; }"
+		"f('abbbc') + [3, 1, 2].sort().join('')", "bbb123");
+}
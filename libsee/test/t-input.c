@@ -0,0 +1,220 @@
+#include "test.inc"
+#include <see/see.h>
+
+/* Mixed ASCII, two, three and four byte UTF-8 and a malformed byte */
+static const char mixed[] = "var caf\xc3\xa9 = '\xe2\x82\xac\xf0\x9f\x98\x80';"
+	" // \xff plain ASCII text, long enough to be read a word at a time";
+
+/* Reads an input to its end one character at a time */
+static int
+read_next(inp, buf, len)
+	struct SEE_input *inp;
+	SEE_unicode_t *buf;
+	int len;
+{
+	int n;
+
+	for (n = 0; n < len && !inp->eof; n++)
+		buf[n] = SEE_INPUT_NEXT(inp);
+	return n;
+}
+
+/* Reads an input to its end in blocks of varying sizes */
+static int
+read_fill(inp, buf, len)
+	struct SEE_input *inp;
+	SEE_unicode_t *buf;
+	int len;
+{
+	unsigned int n, got, chunk = 1;
+
+	for (n = 0; n < (unsigned int)len; n += got) {
+		got = SEE_input_fill(inp, buf + n,
+			chunk < len - n ? chunk : len - n);
+		if (!got)
+			break;
+		chunk = chunk * 3 % 29 + 1;
+	}
+	return n;
+}
+
+/* Encodes characters as UTF-8, returning the number of bytes */
+static int
+utf8(text, n, bytes)
+	const SEE_unicode_t *text;
+	int n;
+	unsigned char *bytes;
+{
+	int i, len = 0;
+
+	for (i = 0; i < n; i++)
+		if (text[i] < 0x80)
+			bytes[len++] = text[i];
+		else if (text[i] < 0x800) {
+			bytes[len++] = 0xc0 | text[i] >> 6;
+			bytes[len++] = 0x80 | (text[i] & 0x3f);
+		} else if (text[i] < 0x10000) {
+			bytes[len++] = 0xe0 | text[i] >> 12;
+			bytes[len++] = 0x80 | (text[i] >> 6 & 0x3f);
+			bytes[len++] = 0x80 | (text[i] & 0x3f);
+		} else {
+			bytes[len++] = 0xf0 | text[i] >> 18;
+			bytes[len++] = 0x80 | (text[i] >> 12 & 0x3f);
+			bytes[len++] = 0x80 | (text[i] >> 6 & 0x3f);
+			bytes[len++] = 0x80 | (text[i] & 0x3f);
+		}
+	return len;
+}
+
+/* Compares filling and stepping through the file made of bytes */
+static void
+test_file(interp, bytes, len, encoding, expected, nexpected)
+	struct SEE_interpreter *interp;
+	const unsigned char *bytes;
+	int len;
+	const char *encoding;
+	const SEE_unicode_t *expected;
+	int nexpected;
+{
+	static SEE_unicode_t a[70000], b[70000];
+	struct SEE_input *inp;
+	FILE *f;
+	int na, nb, i;
+
+	f = tmpfile();
+	TEST_NOT_NULL(f);
+	if (!f)
+		return;
+	fwrite(bytes, 1, len, f);
+	rewind(f);
+	inp = SEE_input_file(interp, f, "tmp", encoding);
+	na = read_fill(inp, a, 70000);
+	SEE_INPUT_CLOSE(inp);
+
+	f = tmpfile();
+	fwrite(bytes, 1, len, f);
+	rewind(f);
+	inp = SEE_input_file(interp, f, "tmp", encoding);
+	nb = read_next(inp, b, 70000);
+	SEE_INPUT_CLOSE(inp);
+
+	TEST_EQ_INT(na, nexpected);
+	TEST_EQ_INT(nb, nexpected);
+	for (i = 0; i < na && i < nexpected && a[i] == expected[i]; i++)
+		;
+	TEST_EQ_INT(i, nexpected);
+	for (i = 0; i < nb && i < nexpected && b[i] == expected[i]; i++)
+		;
+	TEST_EQ_INT(i, nexpected);
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_input *inp;
+	struct SEE_string *s;
+	struct SEE_value res;
+	static SEE_unicode_t a[70000], b[70000], text[70000];
+	static unsigned char bytes[300000];
+	int na, nb, i, n, len;
+
+	SEE_interpreter_init(interp);
+
+	TEST_DESCRIBE("block reads from UTF-8 and string inputs");
+	inp = SEE_input_utf8(interp, mixed);
+	na = read_fill(inp, a, 1000);
+	inp = SEE_input_utf8(interp, mixed);
+	nb = read_next(inp, b, 1000);
+	TEST_EQ_INT(na, nb);
+	TEST_EQ_INT(na, (int)sizeof mixed - 1 - 1 - 2 - 3);
+	for (i = 0; i < na && a[i] == b[i]; i++)
+		;
+	TEST_EQ_INT(i, na);
+	TEST_EQ_INT(a[12], 0x20ac);
+	TEST_EQ_INT(a[13], 0x1f600);
+	TEST_EQ_INT(a[20], SEE_INPUT_BADCHAR);
+
+	/* A surrogate pair, a lone high surrogate and one at the end */
+	s = SEE_string_new(interp, 0);
+	SEE_string_addch(s, 'a');
+	SEE_string_addch(s, 0xd83d);
+	SEE_string_addch(s, 0xde00);
+	SEE_string_addch(s, 'b');
+	SEE_string_addch(s, 0xd800);
+	SEE_string_addch(s, 'c');
+	SEE_string_addch(s, 0xd800);
+	inp = SEE_input_string(interp, s);
+	na = read_fill(inp, a, 100);
+	inp = SEE_input_string(interp, s);
+	nb = read_next(inp, b, 100);
+	TEST_EQ_INT(na, 6);
+	TEST_EQ_INT(nb, 6);
+	for (i = 0; i < na && a[i] == b[i]; i++)
+		;
+	TEST_EQ_INT(i, na);
+	TEST_EQ_INT(a[1], 0x1f600);
+	TEST_EQ_INT(a[3], SEE_INPUT_BADCHAR);
+	TEST_EQ_INT(a[5], 0xd800);
+
+	/*
+	 * Files, both read through a buffer and mapped. Characters that
+	 * straddle the blocks in which the file is read must survive.
+	 */
+	TEST_DESCRIBE("block reads from files");
+	for (n = 0; n < 70000 - 4; ) {
+		text[n] = 'a' + n % 26;
+		n++;
+		if (n % 1000 == 999) text[n++] = 0xe9;
+		if (n % 4096 == 4095) text[n++] = 0x20ac;
+		if (n % 5000 == 4999) text[n++] = 0x1f600;
+	}
+	/* UTF-8 with a byte order mark; small files are not mapped */
+	bytes[0] = 0xef; bytes[1] = 0xbb; bytes[2] = 0xbf;
+	len = 3 + utf8(text, 900, bytes + 3);
+	test_file(interp, bytes, len, NULL, text, 900);
+	len = 3 + utf8(text, n, bytes + 3);
+	test_file(interp, bytes, len, NULL, text, n);
+	test_file(interp, bytes + 3, len - 3, "UTF-8", text, n);
+
+	/* Large UTF-16, both byte orders */
+	len = 0;
+	bytes[len++] = 0xfe; bytes[len++] = 0xff;
+	for (i = 0; i < n; i++)
+		if (text[i] < 0x10000) {
+			bytes[len++] = text[i] >> 8;
+			bytes[len++] = text[i] & 0xff;
+		} else {
+			bytes[len++] = 0xd8 | (text[i] - 0x10000) >> 18;
+			bytes[len++] = (text[i] - 0x10000) >> 10 & 0xff;
+			bytes[len++] = 0xdc | ((text[i] - 0x10000) >> 8 & 0x3);
+			bytes[len++] = text[i] & 0xff;
+		}
+	test_file(interp, bytes, len, NULL, text, n);
+	for (i = 0; i < len; i += 2) {
+		bytes[i] ^= bytes[i + 1];
+		bytes[i + 1] ^= bytes[i];
+		bytes[i] ^= bytes[i + 1];
+	}
+	test_file(interp, bytes, len, NULL, text, n);
+
+	/* Large ASCII */
+	for (i = 0; i < 70000; i++)
+		bytes[i] = 'a' + i % 26;
+	for (i = 0; i < 70000; i++)
+		text[i] = 'a' + i % 26;
+	test_file(interp, bytes, 70000, NULL, text, 70000);
+
+	/* Escapes, strings and comments across the lexer's blocks */
+	TEST_DESCRIBE("scanning across blocks");
+	s = SEE_string_new(interp, 0);
+	SEE_string_append_ascii(s, "var s = '', n = 0;\n");
+	for (i = 0; i < 400; i++)
+		SEE_string_append_ascii(s, "s += '\\u0041'; /* c */ n++;\n");
+	SEE_string_append_ascii(s, "s.length + ',' + n + ',' + s.charAt(399)");
+	inp = SEE_input_string(interp, s);
+	SEE_Global_eval(interp, inp, &res);
+	SEE_ToString(interp, &res, &res);
+	TEST_EQ_STRING(res.u.string,
+		SEE_string_sprintf(interp, "400,400,A"));
+}
@@ -0,0 +1,130 @@
+#include "test.inc"
+#include <see/see.h>
+#include "../stringdefs.h"
+#include "../lex.h"
+#include "../tokens.h"
+
+/* Returns the first token scanned from a UTF-8 text, and its value */
+static int
+scan1(interp, text, value)
+	struct SEE_interpreter *interp;
+	const char *text;
+	struct SEE_value *value;
+{
+	struct lex lex;
+
+	SEE_lex_init(&lex, SEE_input_utf8(interp, text));
+	if (value)
+		SEE_VALUE_COPY(value, &lex.value);
+	return lex.next;
+}
+
+/* Scans all of a SEE string, returning the number of tokens */
+static int
+scan_all(interp, s, last)
+	struct SEE_interpreter *interp;
+	struct SEE_string *s;
+	struct SEE_value *last;
+{
+	struct lex lex;
+	int n = 0;
+
+	SEE_lex_init(&lex, SEE_input_string(interp, s));
+	while (lex.next != tEND) {
+		SEE_VALUE_COPY(last, &lex.value);
+		SEE_lex_next(&lex);
+		n++;
+	}
+	return n;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value v;
+	struct SEE_string *s, *id;
+	const struct SEE_string *k;
+	SEE_unicode_t c[SEE_TOK_KEYMAX];
+	char text[SEE_TOK_KEYMAX + 2];
+	unsigned int i, j, slot;
+
+	SEE_interpreter_init_compat(interp, SEE_COMPAT_262_3B);
+
+	TEST_DESCRIBE("keyword hash table matches the keyword list");
+	for (i = 0; i < (unsigned int)SEE_tok_nkeywords; i++) {
+		k = STRn(SEE_tok_keywords[i].index);
+		if (k->data[0] == '.')
+			continue;		/* filler */
+		TEST(k->length >= 2 && k->length <= SEE_TOK_KEYMAX);
+		for (j = 0; j < k->length; j++) {
+			c[j] = k->data[j];
+			text[j] = (char)k->data[j];
+		}
+		text[j] = '\0';
+		slot = SEE_tok_keyhash[SEE_TOK_KEYHASH(c, k->length)];
+		TEST_EQ_INT(slot, i + 1);
+		TEST_EQ_INT(scan1(interp, text, NULL),
+		    SEE_tok_keywords[i].token);
+	}
+
+	TEST_DESCRIBE("identifiers and keywords");
+	TEST_EQ_INT(scan1(interp, "if", NULL), tIF);
+	TEST_EQ_INT(scan1(interp, "instanceof", NULL), tINSTANCEOF);
+	TEST_EQ_INT(scan1(interp, "synchronized", NULL), tRESERVED);
+	TEST_EQ_INT(scan1(interp, "iff", &v), tIDENT);
+	TEST_EQ_STRING(v.u.string, SEE_intern_ascii(interp, "iff"));
+	TEST_EQ_PTR(v.u.string, SEE_intern_ascii(interp, "iff"));
+	TEST_EQ_INT(scan1(interp, "i", &v), tIDENT);
+	TEST_EQ_INT(scan1(interp, "$_", &v), tIDENT);
+	TEST_EQ_INT(scan1(interp, "ifx9 ", &v), tIDENT);
+	TEST_EQ_PTR(v.u.string, SEE_intern_ascii(interp, "ifx9"));
+	TEST_EQ_INT(scan1(interp, "instanceofx", NULL), tIDENT);
+	TEST_EQ_INT(scan1(interp, "length", &v), tIDENT);
+	TEST_EQ_PTR(v.u.string, STR(length));
+	TEST_EQ_INT(scan1(interp, "\\u0069f", &v), tIDENT);	/* escaped */
+	TEST_EQ_PTR(v.u.string, SEE_intern_ascii(interp, "if"));
+	TEST_EQ_INT(scan1(interp, "i\\u0066", &v), tIDENT);
+#if WITH_UNICODE_TABLES
+	TEST_EQ_INT(scan1(interp, "caf\xc3\xa9", &v), tIDENT);
+	TEST_EQ_INT(v.u.string->length, 4);
+	TEST_EQ_INT(v.u.string->data[3], 0xe9);
+	TEST_EQ_INT(scan1(interp, "a\xc2\xad" "b", &v), tIDENT);
+	TEST_EQ_INT(v.u.string->length, 2);		/* format control */
+	TEST_EQ_INT(scan1(interp, "\xe2\x80\x83x", &v), tIDENT);
+#endif
+
+	TEST_DESCRIBE("white space and punctuators");
+	TEST_EQ_INT(scan1(interp, " \t\v\f\xc2\xa0x", &v), tIDENT);
+	TEST_EQ_INT(scan1(interp, "\xe2\x80\xa8;", NULL), ';');
+	TEST_EQ_INT(scan1(interp, "{", NULL), '{');
+	TEST_EQ_INT(scan1(interp, "~x", NULL), '~');
+	TEST_EQ_INT(scan1(interp, ">>>=", NULL), tURSHIFTEQ);
+	TEST_EQ_INT(scan1(interp, "!==", NULL), tSNE);
+	TEST_EQ_INT(scan1(interp, "'a\\'b'", &v), tSTRING);
+	TEST_EQ_INT(v.u.string->length, 3);
+
+	TEST_DESCRIBE("tokens that straddle the lexer's buffer");
+	for (j = LEX_BUFSZ - 12; j < LEX_BUFSZ + 4; j++) {
+		s = SEE_string_new(interp, 0);
+		for (i = 0; i < j; i++)
+			SEE_string_addch(s, ' ');
+		SEE_string_append_ascii(s, "function ");
+		SEE_string_append_ascii(s, "instanceofx");
+		TEST_EQ_INT(scan_all(interp, s, &v), 2);
+		TEST_EQ_PTR(v.u.string, SEE_intern_ascii(interp,
+		    "instanceofx"));
+	}
+	s = SEE_string_new(interp, 0);
+	for (i = 0; i < 3 * LEX_BUFSZ; i++)
+		SEE_string_addch(s, 'a' + i % 26);
+	TEST_EQ_INT(scan_all(interp, s, &v), 1);
+	id = SEE_intern(interp, s);
+	TEST_EQ_PTR(v.u.string, id);
+
+	TEST_DESCRIBE("reserved words in JavaScript compatibility mode");
+	SEE_interpreter_init_compat(interp, SEE_COMPAT_JS15);
+	TEST_EQ_INT(scan1(interp, "class", &v), tIDENT);
+	TEST_EQ_PTR(v.u.string, STR(class));
+	TEST_EQ_INT(scan1(interp, "while", NULL), tWHILE);
+}
@@ -0,0 +1,82 @@
+#include "test.inc"
+#include <see/see.h>
+
+/* Counts the properties revealed by an object's enumerator */
+static int
+count_props(interp, o)
+	struct SEE_interpreter *interp;
+	struct SEE_object *o;
+{
+	struct SEE_enum *e;
+	int dontenum, count = 0;
+
+	e = SEE_OBJECT_ENUMERATOR(interp, o);
+	while (SEE_ENUM_NEXT(interp, e, &dontenum))
+		count++;
+	return count;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_string *names[100];
+	struct SEE_object *o;
+	struct SEE_value v;
+	char buf[16];
+	int i, ok;
+
+	TEST_DESCRIBE("native object property tables");
+	SEE_interpreter_init(interp);
+
+	for (i = 0; i < 100; i++) {
+		sprintf(buf, "p%d", i);
+		names[i] = SEE_intern_ascii(interp, buf);
+	}
+
+	o = SEE_native_new(interp);
+	TEST_EQ_INT(count_props(interp, o), 0);
+	TEST_FALSE(SEE_OBJECT_HASPROPERTY(interp, o, names[0]));
+
+	/* Grow the table well past its inline slots */
+	for (i = 0; i < 100; i++) {
+		SEE_SET_NUMBER(&v, i);
+		SEE_OBJECT_PUT(interp, o, names[i], &v, 0);
+	}
+	TEST_EQ_INT(count_props(interp, o), 100);
+	ok = 1;
+	for (i = 0; i < 100; i++) {
+		SEE_OBJECT_GET(interp, o, names[i], &v);
+		if (SEE_VALUE_GET_TYPE(&v) != SEE_NUMBER || v.u.number != i)
+			ok = 0;
+	}
+	TEST(ok);
+
+	/* Deleting must not lose the other members of a probe sequence */
+	for (i = 0; i < 100; i += 2)
+		TEST_EQ_INT(SEE_OBJECT_DELETE(interp, o, names[i]), 1);
+	TEST_EQ_INT(count_props(interp, o), 50);
+	ok = 1;
+	for (i = 0; i < 100; i++) {
+		if (SEE_OBJECT_HASPROPERTY(interp, o, names[i]) != (i & 1))
+			ok = 0;
+		if (i & 1) {
+			SEE_OBJECT_GET(interp, o, names[i], &v);
+			if (v.u.number != i)
+				ok = 0;
+		}
+	}
+	TEST(ok);
+
+	/* Attributes survive moving between slots */
+	SEE_SET_NUMBER(&v, -1);
+	SEE_OBJECT_PUT(interp, o, names[0], &v, SEE_ATTR_DONTDELETE);
+	for (i = 1; i < 100; i += 2)
+		SEE_OBJECT_DELETE(interp, o, names[i]);
+	TEST_EQ_INT(count_props(interp, o), 1);
+	TEST_EQ_INT(SEE_OBJECT_DELETE(interp, o, names[0]), 0);
+	TEST_EQ_INT(SEE_native_getownattr(interp, o, names[0]),
+		SEE_ATTR_DONTDELETE);
+	SEE_OBJECT_GET(interp, o, names[0], &v);
+	TEST_EQ_FLOAT(v.u.number, -1.0);
+}
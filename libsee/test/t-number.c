@@ -0,0 +1,174 @@
+#include "test.inc"
+#include <see/see.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Converts a SEE string to an ASCII C string in a static buffer */
+static char *
+ascii(s)
+	struct SEE_string *s;
+{
+	static char buf[256];
+	unsigned int i;
+
+	for (i = 0; i < s->length && i < sizeof buf - 1; i++)
+		buf[i] = (char)s->data[i];
+	buf[i] = '\0';
+	return buf;
+}
+
+/*
+ * Formats positive x the way 9.8.1 says to, independently of SEE:
+ * the shortest digits are those of the fewest %e digits that read
+ * back as x, which the C library rounds correctly.
+ */
+static void
+reference(x, buf)
+	double x;
+	char *buf;
+{
+	char e[64], d[32], *p;
+	int prec, k, n, i;
+
+	for (prec = 0; prec < 17; prec++) {
+		sprintf(e, "%.*e", prec, x);
+		if (strtod(e, NULL) == x)
+			break;
+	}
+	k = 0;
+	for (p = e; *p != 'e'; p++)
+		if (*p != '.')
+			d[k++] = *p;
+	while (k > 1 && d[k - 1] == '0')
+		k--;
+	n = atoi(p + 1) + 1;
+
+	if (k <= n && n <= 21) {
+		for (i = 0; i < n; i++)
+			*buf++ = i < k ? d[i] : '0';
+	} else if (0 < n && n <= 21) {
+		for (i = 0; i < k; i++) {
+			if (i == n)
+				*buf++ = '.';
+			*buf++ = d[i];
+		}
+	} else if (-6 < n && n <= 0) {
+		*buf++ = '0';
+		*buf++ = '.';
+		for (i = 0; i < -n; i++)
+			*buf++ = '0';
+		for (i = 0; i < k; i++)
+			*buf++ = d[i];
+	} else {
+		*buf++ = d[0];
+		if (k > 1)
+			*buf++ = '.';
+		for (i = 1; i < k; i++)
+			*buf++ = d[i];
+		buf += sprintf(buf, "e%s%d", n > 1 ? "+" : "", n - 1);
+	}
+	*buf = '\0';
+}
+
+/* Returns a pseudo-random 32 bit number */
+static SEE_uint32_t
+random32()
+{
+	static SEE_uint32_t x = 2463534242U;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_value v, s;
+	SEE_uint32_t hi, lo;
+	unsigned char bytes[8];
+	char expected[64], text[64];
+	double x;
+	int i, j, bad;
+
+	TEST_DESCRIBE("number to string conversion");
+	SEE_interpreter_init(interp);
+
+	TEST_RUN(interp, "0", "0");
+	TEST_RUN(interp, "-0", "0");
+	TEST_RUN(interp, "7 + ',' + -7 + ',' + 1023 + ',' + 1024",
+		"7,-7,1023,1024");
+	TEST_RUN(interp, "4294967295 + ',' + -4294967296",
+		"4294967295,-4294967296");
+	TEST_RUN(interp, "9007199254740991", "9007199254740991");
+	TEST_RUN(interp, "-9007199254740993", "-9007199254740992");
+	TEST_RUN(interp, "123456789012345680000", "123456789012345680000");
+	TEST_RUN(interp, "1e21", "1e+21");
+	TEST_RUN(interp, "1e23", "1e+23");
+	TEST_RUN(interp, "-1.5", "-1.5");
+	TEST_RUN(interp, "0.1 + 0.2", "0.30000000000000004");
+	TEST_RUN(interp, "1 / 3", "0.3333333333333333");
+	TEST_RUN(interp, "0.000001", "0.000001");
+	TEST_RUN(interp, "-1e-7", "-1e-7");
+	TEST_RUN(interp, "1.25e-7", "1.25e-7");
+	TEST_RUN(interp, "5e-324", "5e-324");
+	TEST_RUN(interp, "1.7976931348623157e308", "1.7976931348623157e+308");
+	TEST_RUN(interp, "-1/0", "-Infinity");
+	TEST_RUN(interp, "0/0", "NaN");
+	TEST_RUN(interp, "var o = {}; o[5] = 'a'; o[5000] = 'b';"
+		"o['5'] + o['5000'] + (5 in o)", "abtrue");
+
+	/* Random doubles of all magnitudes */
+	bad = 0;
+	for (i = 0; i < 100000; i++) {
+		hi = random32() & 0x7fffffff;
+		lo = random32();
+		for (j = 0; j < 4; j++) {
+			bytes[j] = (unsigned char)(lo >> (8 * j));
+			bytes[j + 4] = (unsigned char)(hi >> (8 * j));
+		}
+		if (i & 1)
+			x = (double)(lo % 1000000) / (1 << (hi % 20));
+		else
+			memcpy(&x, bytes, sizeof x);
+		if (!(x > 0) || x > 1.7976931348623157e308)
+			continue;
+		reference(x, expected);
+		SEE_SET_NUMBER(&v, x);
+		SEE_ToString(interp, &v, &s);
+		if (strcmp(ascii(s.u.string), expected) != 0 && bad++ < 10)
+			TEST_EQ_STR(ascii(s.u.string), expected);
+	}
+	TEST_EQ_INT(bad, 0);
+
+	TEST_DESCRIBE("string to number conversion");
+	TEST_RUN(interp, "+'12.5'", "12.5");
+	TEST_RUN(interp, "1 / +'-0'", "-Infinity");
+	TEST_RUN(interp, "+' 12 '", "12");
+	TEST_RUN(interp, "+'0x1f'", "31");
+	TEST_RUN(interp, "+'1e3'", "1000");
+	TEST_RUN(interp, "+'.5' + +'5.' + +'-.5'", "5");
+	TEST_RUN(interp, "+'007'", "7");
+	TEST_RUN(interp, "+''", "0");
+	TEST_RUN(interp, "+'.'", "NaN");
+	TEST_RUN(interp, "+'-'", "NaN");
+	TEST_RUN(interp, "+'1.2.3'", "NaN");
+	TEST_RUN(interp, "+'123456789012345678901'", "123456789012345680000");
+	TEST_RUN(interp, "+'0.1' === 0.1", "true");
+
+	/* Random short decimals are read as the C library reads them */
+	bad = 0;
+	for (i = 0; i < 100000; i++) {
+		j = random32() % 16;
+		sprintf(text, "%s%u.%0*u", i & 1 ? "-" : "",
+		    random32() % 100000, j, random32() % 100000);
+		x = strtod(text, NULL);
+		SEE_SET_STRING(&s, SEE_string_sprintf(interp, "%s", text));
+		SEE_ToNumber(interp, &s, &v);
+		if (v.u.number != x && bad++ < 10)
+			TEST_EQ_STR(text, "");
+	}
+	TEST_EQ_INT(bad, 0);
+}
@@ -0,0 +1,105 @@
+#include "test.inc"
+#include <see/see.h>
+
+static const char source[] =
+	"function Counter(n) { this.n = n; }\n"
+	"Counter.prototype.next = function () { return this.n++; };\n"
+	"function adder(k) { return function (x) { return x + k; }; }\n"
+	"function run() {\n"
+	"  var c = new Counter(3), add2 = adder(2), r = [], o = {a:1, b:2};\n"
+	"  for (var p in o) r.push(p + o[p]);\n"
+	"  switch (c.next()) { case 3: r.push('three'); break; default: r.push('?'); }\n"
+	"  try { null.x; } catch (e) { r.push(e.name); }\n"
+	"  finally { r.push(add2(c.next())); }\n"
+	"  r.push(/b+/.exec('abbc')[0], 'caf\\u00e9'.length, 1.5e300 * 2);\n"
+	"  return r.join();\n"
+	"}\n"
+	"run()";
+
+static const char expected[] = "a1,b2,three,TypeError,6,bb,4,3e+300";
+
+/* Evaluates a program and converts its result to an ASCII C string */
+static char *
+result(interp, program)
+	struct SEE_interpreter *interp;
+	struct SEE_program *program;
+{
+	struct SEE_value res, s;
+	static char buf[256];
+	unsigned int i;
+
+	SEE_program_eval(interp, program, &res);
+	SEE_ToString(interp, &res, &s);
+	for (i = 0; i < s.u.string->length && i < sizeof buf - 1; i++)
+		buf[i] = (char)s.u.string->data[i];
+	buf[i] = '\0';
+	return buf;
+}
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_interpreter interp2_storage, *interp2 = &interp2_storage;
+	struct SEE_input *input;
+	struct SEE_program *program;
+	unsigned char *data, *copy;
+	SEE_size_t len, i;
+
+	TEST_DESCRIBE("saving and loading compiled programs");
+	SEE_interpreter_init(interp);
+
+	input = SEE_input_utf8(interp, source);
+	program = SEE_program_compile(interp, input);
+	SEE_INPUT_CLOSE(input);
+	TEST_NOT_NULL(program);
+	TEST_EQ_STR(result(interp, program), expected);
+
+	data = SEE_program_save(interp, program, &len);
+	TEST_NOT_NULL(data);
+	TEST(len > 20);
+
+	/* A fresh interpreter gets the same answer from the saved form */
+	SEE_interpreter_init(interp2);
+	program = SEE_program_load(interp2, data, len);
+	TEST_NOT_NULL(program);
+	if (program)
+		TEST_EQ_STR(result(interp2, program), expected);
+
+	/* Damaged data is refused rather than run */
+	copy = SEE_NEW_STRING_ARRAY(interp2, unsigned char, len);
+	memcpy(copy, data, len);
+	copy[0] = 'X';
+	TEST_NULL(SEE_program_load(interp2, copy, len));
+	memcpy(copy, data, len);
+	copy[len - 1] ^= 0x55;
+	TEST_NULL(SEE_program_load(interp2, copy, len));
+	for (i = 0; i < len; i += 7)
+		TEST_NULL(SEE_program_load(interp2, data, i));
+	TEST_NULL(SEE_program_load(interp2, data, 0));
+
+	TEST_DESCRIBE("programs saved under other compatibility flags");
+	/* 'goto' is an identifier in JS1.1 but reserved in ECMA mode */
+	SEE_interpreter_init_compat(interp, SEE_COMPAT_JS11);
+	input = SEE_input_utf8(interp, "var goto = 3; goto");
+	program = SEE_program_compile(interp, input);
+	SEE_INPUT_CLOSE(input);
+	data = SEE_program_save(interp, program, &len);
+	TEST_NOT_NULL(data);
+
+	SEE_interpreter_init_compat(interp2, SEE_COMPAT_JS11);
+	program = SEE_program_load(interp2, data, len);
+	TEST_NOT_NULL(program);
+	if (program)
+		TEST_EQ_STR(result(interp2, program), "3");
+
+	SEE_interpreter_init_compat(interp2, SEE_COMPAT_262_3B);
+	TEST_NULL(SEE_program_load(interp2, data, len));
+	SEE_interpreter_init_compat(interp2, SEE_COMPAT_JS15);
+	TEST_NULL(SEE_program_load(interp2, data, len));
+
+	/* Flags that only matter at run time do not invalidate it */
+	SEE_interpreter_init_compat(interp2,
+	    SEE_COMPAT_JS11 | SEE_COMPAT_262_3B | SEE_COMPAT_ERRATA);
+	TEST_NOT_NULL(SEE_program_load(interp2, data, len));
+}
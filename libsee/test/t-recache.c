@@ -0,0 +1,69 @@
+#include "test.inc"
+#include <see/see.h>
+
+/* Checks the cache counters have grown by the given amounts */
+#define TEST_STATS(interp, dhits, dmisses) do {				\
+	unsigned long h_, m_;						\
+	SEE_regex_cache_stats(interp, &h_, &m_);			\
+	TEST_EQ_INT((int)(h_ - hits), dhits);				\
+	TEST_EQ_INT((int)(m_ - misses), dmisses);			\
+	hits = h_; misses = m_;						\
+    } while (0)
+
+static const char escape[] =
+	"var n = 0; for (var i = 0; i < 100; i++)"
+	"  n += 'a&b'.replace(/&/g, '&amp;').length; n";
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+	struct SEE_interpreter copy_storage, *copy = &copy_storage;
+	unsigned long hits, misses;
+
+	TEST_DESCRIBE("compiled regular expression cache");
+	SEE_interpreter_init(interp);
+	SEE_regex_cache_stats(interp, &hits, &misses);
+
+	/* A literal evaluated in a loop is compiled once */
+	TEST_RUN(interp, escape, "700");
+	TEST_STATS(interp, 99, 1);
+
+	/* So is a string used as a pattern */
+	TEST_RUN(interp, "var s = 'x-y-z', r = 0;"
+		"for (var i = 0; i < 10; i++) r += s.search('y'); r", "20");
+	TEST_STATS(interp, 9, 1);
+
+	/* Flags and the engine are part of the key */
+	TEST_RUN(interp, "/a/i.test('A') + ',' + /a/.test('A') + ','"
+		" + new RegExp('a', 'i').test('A')", "true,false,true");
+	TEST_STATS(interp, 1, 2);
+	interp->regex_engine = SEE_regex_engine("nfa");
+	TEST_RUN(interp, "/a/i.test('A')", "true");
+	TEST_STATS(interp, 0, 1);
+	interp->regex_engine = SEE_regex_engine("ecma");
+
+	/* The least recently used entries make way for new ones */
+	SEE_system.regex_cache_size = 2;
+	TEST_RUN(interp, "var t = '';"
+		"for (var i = 0; i < 3; i++) t += '' + /p/.test('p') +"
+		"  /q/.test('p') + /r/.test('r') + ','; t",
+		"truefalsetrue,truefalsetrue,truefalsetrue,");
+	TEST_STATS(interp, 0, 9);
+	TEST_RUN(interp, "/r/.test('r')", "true");
+	TEST_STATS(interp, 1, 0);
+	SEE_system.regex_cache_size = 64;
+
+	/* A copied interpreter starts with the original's regexes */
+	SEE_interpreter_clone(copy, interp);
+	hits = misses = 0;
+	TEST_RUN(copy, "/r/.test('r') + ',' + /s/.test('r')", "true,false");
+	TEST_STATS(copy, 1, 1);
+
+	/* A size of zero turns the cache off */
+	SEE_system.regex_cache_size = 0;
+	SEE_regex_cache_stats(interp, &hits, &misses);
+	TEST_RUN(interp, escape, "700");
+	TEST_STATS(interp, 0, 0);
+	SEE_system.regex_cache_size = 64;
+}
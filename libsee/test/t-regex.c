@@ -0,0 +1,32 @@
+#include "test.inc"
+#include <see/see.h>
+
+/* Exponential in the length of the a's when there is no match */
+static const char runaway[] =
+	"try { /^(a+)+$/.test('aaaaaaaaaaaaaaaaaaaaaaaaaaaaaac') }"
+	" catch (e) { e.message.indexOf('step limit') >= 0 }";
+
+void
+test()
+{
+	struct SEE_interpreter interp_storage, *interp = &interp_storage;
+
+	TEST_DESCRIBE("regular expression step limit");
+	SEE_interpreter_init(interp);
+	TEST_EQ_INT(interp->regex_step_limit, -1);
+
+	/* A runaway match is stopped with an exception scripts can catch */
+	interp->regex_step_limit = 100000;
+	TEST_RUN(interp, runaway, "true");
+
+	/* Ordinary matches are unaffected, and the limit is per match */
+	TEST_RUN(interp, "var s = 'x'; while (s.length < 2000) s += s;"
+		"/^x*$/.test(s) + ',' + s.replace(/x/g, '').length",
+		"true,0");
+
+	/* Exhausting the limit leaves the interpreter usable */
+	interp->regex_step_limit = 10;
+	TEST_RUN(interp, runaway, "true");
+	interp->regex_step_limit = -1;
+	TEST_RUN(interp, "String(/^(a+)+b/.exec('aaab'))", "aaab,aaa");
+}
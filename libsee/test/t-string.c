@@ -5,8 +5,17 @@ void
 test()
 {
 	struct SEE_interpreter interp_storage, *interp = &interp_storage;
-	struct SEE_string *s1, *s2;
-	int val;
+	struct SEE_string *s1, *s2, *keys[2];
+	struct SEE_strbuf sb;
+	SEE_char_t *data;
+	static const SEE_char_t utf16[] = { 'x', 0xd83d, 0xde00 };
+	char buf[40], *out, *expect;
+	const SEE_char_t *src;
+	struct SEE_output output;
+	static char big[3 * SEE_OUTPUT_BUFSZ];
+	SEE_size_t len;
+	FILE *f;
+	int val, i, ok, n;
 
 	TEST_DESCRIBE("string tests");
 
@@ -42,4 +51,160 @@ test()
 	TEST_EQ_INT(val, +1);
 	val = SEE_string_cmp(s1, SEE_intern_ascii(interp, "helloo"));
 	TEST_EQ_INT(val, -1);
+
+	/* Hashes cover the whole string, and agree with the intern table */
+	TEST_EQ_INT(SEE_string_hash(s1), SEE_string_hash(s2));
+	TEST_NOT_EQ_INT(SEE_string_hash(SEE_intern_ascii(interp,
+	    "configuration_a")), SEE_string_hash(SEE_intern_ascii(interp,
+	    "configuration_b")));
+	TEST_EQ_PTR(SEE_intern(interp, s2), s1);
+
+	/* Interning many keys with a long common prefix grows the table */
+	ok = 1;
+	for (i = 0; i < 5000; i++) {
+	    sprintf(buf, "configuration_item_%d", i);
+	    keys[i % 2] = SEE_intern_ascii(interp, buf);
+	    s2 = SEE_string_sprintf(interp, "configuration_item_%d", i);
+	    if (SEE_intern(interp, s2) != keys[i % 2] ||
+		SEE_intern_ascii(interp, buf) != keys[i % 2])
+		ok = 0;
+	}
+	TEST(ok);
+	TEST_EQ_PTR(SEE_intern_ascii(interp, "configuration_item_0"),
+	    SEE_intern(interp, SEE_string_sprintf(interp, "%s_%d",
+		"configuration_item", 0)));
+
+	TEST_DESCRIBE("string builder");
+	SEE_strbuf_init(interp, &sb, 0);
+	TEST_EQ_PTR(SEE_strbuf_finish(&sb), SEE_intern_ascii(interp, ""));
+
+	SEE_strbuf_init(interp, &sb, 4);
+	SEE_strbuf_append_ascii(&sb, "ab", 2);
+	SEE_STRBUF_ADDCH(&sb, '-');
+	SEE_strbuf_append(&sb, s1);
+	SEE_strbuf_append_utf16(&sb, utf16, 3);
+	SEE_strbuf_append_unicode(&sb, 0x1f600);
+	SEE_strbuf_append_utf8(&sb, "caf\xc3\xa9\xff\xe2\x82", 8);
+	data = sb.data;
+	s2 = SEE_strbuf_finish(&sb);
+	TEST_EQ_PTR(s2->data, data);			/* not copied */
+	TEST_EQ_INT(sb.length, 0);
+	TEST_EQ_INT(s2->length, 3 + 5 + 3 + 2 + 7);
+	TEST_EQ_INT(SEE_string_cmp_ascii(SEE_string_substr(interp, s2, 0, 9),
+	    "ab-hellox"), 0);
+	TEST_EQ_INT(s2->data[9], 0xd83d);
+	TEST_EQ_INT(s2->data[11], 0xd83d);
+	TEST_EQ_INT(s2->data[12], 0xde00);
+	TEST_EQ_INT(s2->data[16], 0xe9);
+	TEST_EQ_INT(s2->data[17], 0xfffd);		/* bad byte */
+	TEST_EQ_INT(s2->data[18], 0xfffd);		/* truncated */
+
+	/* A builder sized up front is never reallocated */
+	SEE_strbuf_init(interp, &sb, 3000);
+	data = sb.data;
+	for (i = 0; i < 1000; i++)
+	    SEE_strbuf_append(&sb, SEE_intern_ascii(interp, "abc"));
+	TEST_EQ_PTR(sb.data, data);
+	s2 = SEE_strbuf_finish(&sb);
+	TEST_EQ_INT(s2->length, 3000);
+	TEST_EQ_INT(s2->data[2999], 'c');
+
+	TEST_DESCRIBE("UTF-8 encoding into buffers");
+	/* ASCII runs of every length, between multibyte characters */
+	s2 = SEE_string_new(interp, 0);
+	for (i = 0; i < 20; i++) {
+	    for (n = 0; n < i; n++)
+		SEE_string_addch(s2, 'a' + n);
+	    SEE_string_addch(s2, i & 1 ? 0xe9 : 0x20ac);
+	    if (i % 5 == 0) {
+		SEE_string_addch(s2, 0xd83d);
+		SEE_string_addch(s2, 0xde00);
+		SEE_string_addch(s2, 0xdc00);		/* stray low half */
+	    }
+	}
+	len = SEE_string_utf8_size(interp, s2);
+	expect = malloc(len + 1);
+	SEE_string_toutf8(interp, expect, len + 1, s2);
+	TEST_EQ_INT(expect[0], (char)0xe2);
+	TEST_EQ_INT(expect[3], (char)0xf0);
+	TEST_EQ_INT(expect[7], (char)0xed);
+	TEST_EQ_INT(expect[10], 'a');
+	TEST_EQ_INT(expect[11], (char)0xc3);
+
+	/* Small buffers, emptied whenever the next character won't fit */
+	ok = 1;
+	for (n = 1; n <= 9; n++) {
+	    SEE_size_t done = 0;
+	    src = s2->data;
+	    while (src < s2->data + s2->length) {
+		out = buf;
+		if (SEE_utf16_to_utf8(&src, s2->data + s2->length,
+		    &out, buf + n) != 0 || (n >= 4 && out == buf))
+		{
+		    ok = 0;
+		    break;
+		}
+		if (done + (out - buf) > len ||
+		    memcmp(expect + done, buf, out - buf) != 0)
+			ok = 0;
+		done += out - buf;
+		if (n < 4 && out == buf)
+		    break;		/* a wide character will never fit */
+	    }
+	    if (n >= 4 && done != len)
+		ok = 0;
+	}
+	TEST(ok);
+
+	/* An unpaired high surrogate stops the conversion */
+	s1 = SEE_string_new(interp, 0);
+	SEE_string_append_ascii(s1, "abc");
+	SEE_string_addch(s1, 0xd800);
+	SEE_string_addch(s1, 'd');
+	src = s1->data;
+	out = buf;
+	TEST_EQ_INT(SEE_utf16_to_utf8(&src, s1->data + s1->length, &out,
+	    buf + sizeof buf), -1);
+	TEST_EQ_INT(src - s1->data, 3);
+	TEST_EQ_INT(out - buf, 3);
+	src = s1->data;
+	out = buf;
+	TEST_EQ_INT(SEE_utf16_to_utf8(&src, s1->data + 4, &out,
+	    buf + sizeof buf), -1);
+	TEST_EQ_INT(src - s1->data, 3);
+
+	TEST_DESCRIBE("output buffers");
+	f = tmpfile();
+	TEST_NOT_NULL(f);
+	if (f) {
+	    for (i = 0; i < (int)sizeof big; i++)
+		big[i] = 'A' + i % 26;
+	    SEE_output_init(&output, f);
+	    for (i = 0; i < 1000; i++)
+		SEE_output_string(interp, &output, s2);
+	    SEE_output_bytes(&output, "|", 1);
+	    SEE_output_bytes(&output, big, sizeof big);
+	    SEE_output_bytes(&output, "|", 1);
+	    TEST_EQ_INT(SEE_output_flush(&output), 0);
+	    TEST_EQ_INT(output.length, 0);
+
+	    rewind(f);
+	    ok = 1;
+	    out = malloc(len);
+	    for (i = 0; i < 1000; i++)
+		if (fread(out, 1, len, f) != len ||
+		    memcmp(out, expect, len) != 0)
+			ok = 0;
+	    TEST(ok);
+	    ok = getc(f) == '|';
+	    for (i = 0; i < (int)sizeof big; i++)
+		if (getc(f) != 'A' + i % 26)
+		    ok = 0;
+	    if (getc(f) != '|' || getc(f) != EOF)
+		ok = 0;
+	    TEST(ok);
+	    fclose(f);
+	    free(out);
+	}
+	free(expect);
 }
@@ -121,6 +121,34 @@ struct strtoken SEE_tok_keywords[] = {
 };
 int SEE_tok_nkeywords = lengthof(SEE_tok_keywords);
 
+/*
+ * Perfect hash of the keywords above, for the lexer. The entry at
+ * SEE_TOK_KEYHASH() of each keyword is one more than the keyword's
+ * index in SEE_tok_keywords[]; no two keywords share an entry, and
+ * unused entries are zero. An identifier that hashes to a keyword's
+ * entry must still be compared with it. The table was generated from
+ * the list above and has to be regenerated if the list changes
+ * (t-lex checks that it is consistent).
+ */
+unsigned char SEE_tok_keyhash[256] = {
+	 0,  0,  0,  0,  0,  0,  0,  5,  0, 31,  0,  0,  0,  0,  0,  0,
+	 0,  0, 35,  0,  0, 48,  0,  0, 18,  0,  0, 52,  0, 50,  0,  0,
+	 1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 39,  0, 58,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 16,  0,  0,  0,
+	 0,  0, 49, 46, 24,  0, 15, 21,  0,  0,  0,  0,  0,  0,  0, 59,
+	22,  0,  0,  0, 47,  0,  0,  0, 32,  0,  0, 20,  0,  0,  0,  0,
+	53,  0,  0,  0, 41,  0,  0,  0,  0,  0,  0,  0,  0,  0,  7, 54,
+	 0, 45,  0,  0,  0,  0, 34, 29, 11,  0,  0,  0,  0,  0,  0, 43,
+	 0,  0,  0,  0,  0,  4, 51,  0,  0,  0, 40,  8,  0,  0,  0, 30,
+	 0,  0,  3, 19, 56,  0, 14,  0,  0,  0,  0, 37,  0,  0,  0,  0,
+	 0, 23,  0,  6, 25,  0,  0, 10,  0, 42,  0,  0, 36,  0,  0, 26,
+	 0,  0, 55,  0,  0,  0, 57, 13, 44,  0,  0,  0,  0, 28,  0, 33,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0, 38,  0,  0, 17, 27,  0,  0,
+	 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+	 0,  0,  0, 12,  0,  0,  0,  0,  0,  0,  0,  0,  0,  9,  0,  0,
+	 0,  0,  0,  0,  0, 60,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0
+};
+
 static struct token operators1[] = {
 	{ {'?'}, '?' },
 	{ {'{'}, '{' },
@@ -13,6 +13,11 @@ struct strtoken {
 	int token;
 };
 
+/* Hash of the len (2 or more) characters c, for SEE_tok_keyhash[] */
+#define SEE_TOK_KEYHASH(c, len)						\
+	(((c)[0] + 17 * (c)[1] + 22 * (c)[(len) - 1] + (len)) & 0xff)
+#define SEE_TOK_KEYMAX	12		/* longest keyword */
+
 struct token {
 	SEE_char_t identifier[4];
 	int token;
@@ -20,6 +25,7 @@ struct token {
 
 extern struct strtoken SEE_tok_keywords[];
 extern int SEE_tok_nkeywords;
+extern unsigned char SEE_tok_keyhash[256];
 extern struct token *SEE_tok_operators[];
 extern int SEE_tok_noperators;
 
@@ -49,12 +49,18 @@
 #include <see/system.h>
 #include <see/error.h>
 #include <see/interpreter.h>
+#include <see/intern.h>
 
 #include "lex.h"
 #include "stringdefs.h"
 #include "dtoa.h"
+#include "grisu.h"
 #include "nmath.h"
 
+static int string_tonumber(struct SEE_string *, struct SEE_value *);
+static struct SEE_string *number_tostring(struct SEE_interpreter *,
+	SEE_number_t);
+
 /*
  * Value type-converters and some numeric constants.
  */
@@ -169,6 +175,8 @@ SEE_ToNumber(interp, val, res)
 		break;
 	case SEE_STRING:
 	    {
+		if (string_tonumber(val->u.string, res))
+			break;
 		/* Use the scanner to evaluate a StrNumericLiteral */
 		if (!SEE_lex_number(interp, val->u.string, res))
 			SEE_SET_NUMBER(res, SEE_NaN);
@@ -190,6 +198,49 @@ SEE_ToNumber(interp, val, res)
 	SEE_ASSERT(interp, SEE_VALUE_GET_TYPE(res) == SEE_NUMBER);
 }
 
+/*
+ * Converts strings of the form [+-]digits[.digits] that have at most
+ * 15 significant digits and 22 fraction digits. Their digits make an
+ * integer below 2^53, and dividing that by an exact power of ten
+ * rounds correctly. Returns false for all other strings.
+ */
+static int
+string_tonumber(s, res)
+	struct SEE_string *s;
+	struct SEE_value *res;
+{
+	static const double tens[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+		1e20, 1e21, 1e22
+	};
+	const SEE_char_t *p = s->data, *end = s->data + s->length;
+	SEE_uint64_t m = 0;
+	int neg = 0, point = 0, ndigits = 0, nsig = 0, nfrac = 0;
+	double number;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	for (; p < end; p++)
+		if (*p >= '0' && *p <= '9') {
+			ndigits++;
+			if (m || *p != '0')
+				if (++nsig > 15)
+					return 0;
+			m = m * 10 + (*p - '0');
+			if (point)
+				nfrac++;
+		} else if (*p == '.' && !point)
+			point = 1;
+		else
+			return 0;
+	if (!ndigits || nfrac >= (int)(sizeof tens / sizeof tens[0]))
+		return 0;
+	number = (double)m / tens[nfrac];
+	SEE_SET_NUMBER(res, neg ? -number : number);
+	return 1;
+}
+
 /* 9.4 */
 void
 SEE_ToInteger(interp, val, res)
@@ -257,6 +308,120 @@ SEE_ToUint16(interp, val)
 	}
 }
 
+/*
+ * Converts a finite, non-zero number to a string (9.8.1). Integers are
+ * formatted directly into the string, and small ones are shared from
+ * the intern cache. Other numbers get their shortest digits from
+ * _SEE_grisu3(), or from the slower SEE_dtoa() when that fails.
+ */
+static struct SEE_string *
+number_tostring(interp, number)
+	struct SEE_interpreter *interp;
+	SEE_number_t number;
+{
+	char a[24], *a0, *endstr;
+	struct SEE_string *s;
+	SEE_uint64_t m;
+	int neg, sign, k, n, i, exponent;
+	int len;
+
+	neg = number < 0;
+	if (neg)
+		number = -number;
+
+	/* Integers below 2^53 are exact, so their digits are shortest */
+	if (number < 9007199254740992.0 && number == NUMBER_floor(number)) {
+		m = (SEE_uint64_t)number;
+		if (!neg && m <= 0xffffffff &&
+		    (s = _SEE_intern_uint(interp, (SEE_uint32_t)m)) != NULL)
+			return s;
+		i = sizeof a;
+		do {
+			a[--i] = '0' + (int)(m % 10);
+			m /= 10;
+		} while (m);
+		len = neg + (int)sizeof a - i;
+		s = SEE_string_new(interp, len);
+		if (neg)
+			s->data[s->length++] = '-';
+		while (i < (int)sizeof a)
+			s->data[s->length++] = a[i++];
+		return s;
+	}
+
+	k = _SEE_grisu3(number, a, &n);
+	if (!k) {
+		a0 = SEE_dtoa(number, DTOA_MODE_SHORT, 0, &n, &sign, &endstr);
+		k = (int)(endstr - a0);
+		SEE_ASSERT(interp, k <= (int)sizeof a);
+		memcpy(a, a0, k);
+		SEE_freedtoa(a0);
+	}
+
+	/* Numbers converted to strings are generally
+	 * small and short-lived. */
+	len = neg;
+	if (k <= n && n <= 21) {
+	    len += n;
+	} else if (0 < n && n <= 21) {
+	    len += k + 1;
+	} else if (-6 < n && n <= 0) {
+	    len += 2 + -n + k;
+	} else if (k == 1) {
+	    len += 1;
+	    goto add_exponent_len;
+	} else {
+	    len += k + 1;
+    add_exponent_len:
+	    len += 2; /* e[+-] */
+	    exponent = n > 0 ? n - 1 : 1 - n;
+	    /* n!=1 => exponent!=0 */
+	    while (exponent) {
+		len++;
+		exponent /= 10;
+	    }
+	}
+	/* --end-- */
+
+	s = SEE_string_new(interp, len);
+	if (neg)
+	    SEE_string_addch(s, '-');
+	if (k <= n && n <= 21) {
+	    for (i = 0; i < k; i++)
+		SEE_string_addch(s, a[i]);
+	    for (i = 0; i < n-k; i++)
+		SEE_string_addch(s, '0');
+	} else if (0 < n && n <= 21) {
+	    for (i = 0; i < n; i++)
+		SEE_string_addch(s, a[i]);
+	    SEE_string_addch(s, '.');
+	    for (; i < k; i++)
+		SEE_string_addch(s, a[i]);
+	} else if (-6 < n && n <= 0) {
+	    SEE_string_addch(s, '0');
+	    SEE_string_addch(s, '.');
+	    for (i = 0; i < -n; i++)
+		SEE_string_addch(s, '0');
+	    for (i = 0; i < k; i++)
+		SEE_string_addch(s, a[i]);
+	} else if (k == 1) {
+	    SEE_string_addch(s, a[0]);
+	    goto add_exponent;
+	} else {
+	    SEE_string_addch(s, a[0]);
+	    SEE_string_addch(s, '.');
+	    for (i = 1; i < k; i++)
+		SEE_string_addch(s, a[i]);
+    add_exponent:   SEE_string_addch(s, 'e');
+	    exponent = n - 1;
+	    if (exponent > 0)
+		SEE_string_addch(s, '+');
+	    SEE_string_append_int(s, exponent);
+	}
+	SEE_ASSERT(interp, len == s->length);
+	return s;
+}
+
 /* 9.8 */
 void
 SEE_ToString(interp, val, res)
@@ -274,94 +439,18 @@ SEE_ToString(interp, val, res)
 		SEE_SET_STRING(res, val->u.boolean ? STR(true) : STR(false));
 		break;
 	case SEE_NUMBER:					 /* 9.8.1 */
-		if (SEE_NUMBER_ISNAN(val)) {
+		if (SEE_NUMBER_ISNAN(val))
 			SEE_SET_STRING(res, STR(NaN));
-		} else if (val->u.number == 0) {
+		else if (val->u.number == 0)
 			SEE_SET_STRING(res, STR(zero_digit));
-		} else if (val->u.number < 0) {
-			struct SEE_value neg, negstr;
-			SEE_SET_NUMBER(&neg, -(val->u.number));
-			SEE_ToString(interp, &neg, &negstr);
-			SEE_SET_STRING(res, SEE_string_concat(interp,
-			    STR(minus), negstr.u.string));
-			SEE_string_free(interp, &negstr.u.string);
-		} else if (SEE_NUMBER_ISPINF(val)) {
+		else if (SEE_NUMBER_ISPINF(val))
 			SEE_SET_STRING(res, STR(Infinity));
-		} else {
-			char *a0, *a, *endstr;
-			struct SEE_string *s;
-			int sign, k, n, i, exponent;
-			int len;
-
-			a0 = SEE_dtoa(val->u.number, DTOA_MODE_SHORT_SW, 31, 
-				&n, &sign, &endstr);
-			k = (int)(endstr - a0);
-			a = SEE_STRING_ALLOCA(interp, char, k);
-			memcpy(a, a0, k);
-			SEE_freedtoa(a0);
-
-			/* Numbers converted to strings are generally
-			 * small and short-lived. */
-			len = 0;
-			if (k <= n && n <= 21) {
-			    len = n;
-			} else if (0 < n && n <= 21) {
-			    len = k + 1;
-			} else if (-6 < n && n <= 0) {
-			    len = 2 + -n + k;
-			} else if (k == 1) {
-			    len = 1;
-			    goto add_exponent_len;
-			} else {
-			    len = k + 1;
-	    add_exponent_len:
-			    len += 2; /* e[+-] */
-			    exponent = n > 0 ? n - 1 : 1 - n;
-			    /* n!=1 => exponent!=0 */
-			    while (exponent) {
-				len++;
-				exponent /= 10;
-			    }
-			}
-			/* --end-- */
-
-			s = SEE_string_new(interp, len);
-			SEE_ASSERT(interp, !sign);
-			if (k <= n && n <= 21) {
-			    for (i = 0; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			    for (i = 0; i < n-k; i++)
-				SEE_string_addch(s, '0');
-			} else if (0 < n && n <= 21) {
-			    for (i = 0; i < n; i++)
-				SEE_string_addch(s, a[i]);
-			    SEE_string_addch(s, '.');
-			    for (; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			} else if (-6 < n && n <= 0) {
-			    SEE_string_addch(s, '0');
-			    SEE_string_addch(s, '.');
-			    for (i = 0; i < -n; i++)
-				SEE_string_addch(s, '0');
-			    for (i = 0; i < k; i++)
-				SEE_string_addch(s, a[i]);
-			} else if (k == 1) {
-			    SEE_string_addch(s, a[0]);
-			    goto add_exponent;
-			} else {
-			    SEE_string_addch(s, a[0]);
-			    SEE_string_addch(s, '.');
-			    for (i = 1; i < k; i++)
-				SEE_string_addch(s, a[i]);
-	    add_exponent:   SEE_string_addch(s, 'e');
-			    exponent = n - 1;
-			    if (exponent > 0)
-				SEE_string_addch(s, '+');
-			    SEE_string_append_int(s, exponent);
-			}
-			SEE_ASSERT(interp, len == s->length);
-			SEE_SET_STRING(res, s);
-		} 
+		else if (SEE_NUMBER_ISNINF(val))
+			SEE_SET_STRING(res, SEE_string_concat(interp,
+			    STR(minus), STR(Infinity)));
+		else
+			SEE_SET_STRING(res, number_tostring(interp, 
+			    val->u.number));
 		break;
 	case SEE_STRING:
 		SEE_VALUE_COPY(res, val);
@@ -68,6 +68,9 @@ SEE_version()
 #if WITH_BOEHM_GC
 		" +gc"
 #endif
+#if WITH_SIMPLE_GC
+		" +simple-gc"
+#endif
 #if WITH_PCRE
 		" +pcre"
 #endif
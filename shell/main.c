@@ -23,6 +23,11 @@
 # include <unistd.h>
 #endif
 
+#if HAVE_SYS_STAT_H
+# include <sys/types.h>
+# include <sys/stat.h>
+#endif
+
 #if HAVE_GETOPT_H
 # include <getopt.h>
 #endif
@@ -48,13 +53,19 @@ extern int optind;
 static void debug(int);
 static void trace_enable(void);
 static int run_input(struct SEE_interpreter *, struct SEE_input *, 
-        struct SEE_value *);
+        const char *, struct SEE_value *);
+static void eval_cached(struct SEE_interpreter *, struct SEE_input *,
+        const char *, struct SEE_value *);
 static void run_file(struct SEE_interpreter *, char *);
 static void run_interactive(struct SEE_interpreter *);
 static void run_html(struct SEE_interpreter *, char *);
 static void run_string(struct SEE_interpreter *, char *);
+static void output_init(struct SEE_interpreter *);
+static void output_flush(void);
 
 static struct debug *debugger;
+static int use_cache;		/* -C: keep compiled programs in <file>c */
+static struct SEE_output output; /* print() output, when not to a tty */
 
 /* 
  * Enables the debugging flag given by character c.
@@ -140,7 +151,8 @@ trace_enable()
 
 /*
  * Runs the input given by inp, printing any exceptions
- * to stderr.
+ * to stderr. If filename is not NULL, the compiled program
+ * is cached (see eval_cached()).
  * This function first establishes a local exception catch context.
  * Next, it passes the unicode input provider ('inp') to the generic
  * evaluation procedure SEE_Global_eval which executes the program
@@ -151,9 +163,10 @@ trace_enable()
  * completion.
  */
 static int
-run_input(interp, inp, res)
+run_input(interp, inp, filename, res)
 	struct SEE_interpreter *interp;
 	struct SEE_input *inp;
+	const char *filename;
 	struct SEE_value *res;
 {
 	struct SEE_value v;
@@ -163,9 +176,16 @@ run_input(interp, inp, res)
         SEE_TRY (interp, ctxt) {
 	    if (debugger)
 	        debug_eval(interp, debugger, inp, res);
+	    else if (filename)
+	        eval_cached(interp, inp, filename, res);
 	    else
 	        SEE_Global_eval(interp, inp, res);
         }
+	if (interp->output) {
+	    /* Before any exception report on stderr */
+	    SEE_output_flush(interp->output);
+	    fflush(interp->output->file);
+	}
         if (SEE_CAUGHT(ctxt)) {
             fprintf(stderr, "exception:\n");
             SEE_TRY(interp, ctxt2) {
@@ -193,6 +213,56 @@ run_input(interp, inp, res)
         return 1;
 }
 
+/*
+ * Evaluates the program in a file, using the compiled form saved
+ * by an earlier run in the file named by appending 'c' to filename,
+ * if that is newer than the source. Otherwise the program is compiled
+ * and saved there for next time. Failing to save is not an error.
+ */
+static void
+eval_cached(interp, inp, filename, res)
+	struct SEE_interpreter *interp;
+	struct SEE_input *inp;
+	const char *filename;
+	struct SEE_value *res;
+{
+	struct SEE_program *program = NULL;
+	char *cachename;
+	FILE *cf;
+	SEE_try_context_t ctxt;
+#if HAVE_SYS_STAT_H
+	struct stat st, cst;
+#endif
+
+	cachename = SEE_NEW_STRING_ARRAY(interp, char, strlen(filename) + 2);
+	strcpy(cachename, filename);
+	strcat(cachename, "c");
+
+#if HAVE_SYS_STAT_H
+	if (stat(filename, &st) == 0 && stat(cachename, &cst) == 0 &&
+	    cst.st_mtime > st.st_mtime && (cf = fopen(cachename, "rb")))
+	{
+		program = SEE_program_load_file(interp, cf);
+		fclose(cf);
+	}
+#endif
+
+	if (!program) {
+		program = SEE_program_compile(interp, inp);
+		if ((cf = fopen(cachename, "wb"))) {
+		    SEE_TRY(interp, ctxt) {
+			if (SEE_program_save_file(interp, program, cf) == -1)
+			    perror(cachename);
+		    }
+		    fclose(cf);
+		    if (SEE_CAUGHT(ctxt))
+			remove(cachename);
+		}
+	}
+
+	SEE_program_eval(interp, program, res);
+}
+
 /*
  * Opens the file and runs the contents as if ECMAScript code.
  * This function converts a local file into a unicode input stream,
@@ -240,7 +310,8 @@ run_file(interp, filename)
 
 	inp = SEE_input_file(interp, f, filename, NULL);
 
-	ok = run_input(interp, inp, &res);
+	ok = run_input(interp, inp, 
+		use_cache && f != stdin ? filename : NULL, &res);
 	SEE_INPUT_CLOSE(inp);
 	if (!ok)
 		exit(3);	/* Runtime error (uncaught exception) */
@@ -283,7 +354,7 @@ run_interactive(interp)
 	    }
 	    inp = SEE_input_utf8(interp, line);
 	    inp->filename = SEE_intern_ascii(interp, "<interactive>");
-	    if (run_input(interp, inp, &res)) {
+	    if (run_input(interp, inp, NULL, &res)) {
 		printf(" = ");
 		SEE_PrintValue(interp, &res, stdout);
 		printf("\n");
@@ -307,7 +378,7 @@ run_string(interp, program)
 
 	inp = SEE_input_utf8(interp, program);
 	inp->filename = SEE_intern_ascii(interp, "<command-line>");
-	ok = run_input(interp, inp, &res);
+	ok = run_input(interp, inp, NULL, &res);
 	SEE_INPUT_CLOSE(inp);
 	if (!ok)
 		exit(3);	/* Runtime error (uncaught exception) */
@@ -394,7 +465,7 @@ run_html(interp, filename)
 		    inp = SEE_input_string(interp, s);
 		    inp->filename = filenamestr;
 		    inp->first_lineno = first_lineno;
-		    run_input(interp, inp, NULL);
+		    run_input(interp, inp, NULL, NULL);
 
 		    p = script_start;
 		    continue;
@@ -430,6 +501,31 @@ add_document_globals_once(interp)
 	}
 }
 
+/*
+ * Buffers the output of print() and document.write() when stdout
+ * is not a terminal, so that scripts that print a lot do not pay
+ * for a stdio call per fragment. The buffer is flushed after each
+ * script runs (see run_input()) and when the shell exits.
+ */
+static void
+output_init(interp)
+	struct SEE_interpreter *interp;
+{
+#if HAVE_ISATTY
+	if (isatty(1))
+	    return;
+#endif
+	SEE_output_init(&output, stdout);
+	interp->output = &output;
+	atexit(output_flush);
+}
+
+/* Writes out buffered output, at exit */
+static void
+output_flush()
+{
+	SEE_output_flush(&output);
+}
 
 int
 main(argc, argv)
@@ -453,6 +549,7 @@ main(argc, argv)
 #define INIT_INTERP_ONCE do {				\
 	if (!interp_initialised) {			\
 	    SEE_interpreter_init(&interp);		\
+	    output_init(&interp);			\
 	    interp_initialised = 1;			\
 	}						\
   } while (0)
@@ -466,8 +563,12 @@ main(argc, argv)
 	}						\
   } while (0)
 
-	while (!error && (ch = getopt(argc, argv, "c:d:e:f:gh:il:r:V")) != -1)
+	while (!error && (ch = getopt(argc, argv, "Cc:d:e:f:gh:il:r:V")) != -1)
 	    switch (ch) {
+	    case 'C':
+		use_cache = 1;
+		break;
+
 	    case 'c':
 		if (compat_tovalue(optarg, &SEE_system.default_compat_flags)
 			== -1)
@@ -501,6 +602,12 @@ main(argc, argv)
 
 	    case 'g':
 		INIT_INTERP_ONCE;
+		/* The debugger talks to the user on stdout */
+		if (interp.output) {
+		    SEE_output_flush(interp.output);
+		    fflush(interp.output->file);
+		    interp.output = NULL;
+		}
 	    	if (!debugger)
 			debugger = debug_new(&interp);
 		break;
@@ -550,7 +657,7 @@ main(argc, argv)
 
 	if (error) {
 	    fprintf(stderr, "usage: %s\n", argv[0]);
-	    fprintf(stderr, "       [-Vg] [-c flag]\n");
+	    fprintf(stderr, "       [-CVg] [-c flag]\n");
 	    fprintf(stderr, "       [-r maxrecurs]\n");
 #ifndef NDEBUG
 	    fprintf(stderr, "       [-d[ETcelmnprsv]]\n");
@@ -496,6 +496,13 @@ file_proto_write(interp, self, thisobj, argc, argv, res)
                 SEE_error_throw(interp, PRIVATE(interp)->FileError, 
                         "file is closed");
         SEE_ToString(interp, argv[0], &v);
+        /* Keep the order of print() output and writes to stdout/stderr */
+        if (interp->output && (interp->output->file == fo->file ||
+            fo->file == stderr))
+        {
+                SEE_output_flush(interp->output);
+                fflush(interp->output->file);
+        }
         for (len = 0; len < v.u.string->length; len++) {
             if (v.u.string->data[len] > 0xff)
                 SEE_error_throw(interp, interp->RangeError, 
@@ -521,8 +528,11 @@ file_proto_flush(interp, self, thisobj, argc, argv, res)
 {
         struct file_object *fo = tofile(interp, thisobj);
 
-        if (fo->file)
+        if (fo->file) {
+                if (interp->output && interp->output->file == fo->file)
+                        SEE_output_flush(interp->output);
                 fflush(fo->file);
+        }
         SEE_SET_UNDEFINED(res);
 }
 
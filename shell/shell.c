@@ -106,7 +106,8 @@ shell_strings()
 
 /*
  * A print function that prints all its string arguments to stdout.
- * A newline is printed at the end.
+ * A newline is printed at the end. Output goes through the
+ * interpreter's output buffer when the shell has given it one.
  */
 static void
 print_fn(interp, self, thisobj, argc, argv, res)
@@ -118,12 +119,20 @@ print_fn(interp, self, thisobj, argc, argv, res)
         struct SEE_value v;
 	int i;
 
-	for (i = 0; i < argc; i++) {
+	if (interp->output) {
+	    for (i = 0; i < argc; i++) {
+                SEE_ToString(interp, argv[i], &v);
+		SEE_output_string(interp, interp->output, v.u.string);
+	    }
+	    SEE_output_bytes(interp->output, "\n", 1);
+	} else {
+	    for (i = 0; i < argc; i++) {
                 SEE_ToString(interp, argv[i], &v);
                 SEE_string_fputs(v.u.string, stdout);
-        }
-	printf("\n");
-	fflush(stdout);
+	    }
+	    printf("\n");
+	    fflush(stdout);
+	}
         SEE_SET_UNDEFINED(res);
 }
 
@@ -284,6 +293,10 @@ shell_abort_fn(interp, self, thisobj, argc, argv, res)
 	char *msg;
 
 	SEE_parse_args(interp, argc, argv, "a", &msg);
+	if (interp->output) {
+		SEE_output_flush(interp->output);
+		fflush(interp->output->file);
+	}
 	SEE_ABORT(interp, msg);
         SEE_SET_UNDEFINED(res);
 }
@@ -427,8 +440,12 @@ document_write_fn(interp, self, thisobj, argc, argv, res)
 
         if (argc) {
                 SEE_ToString(interp, argv[0], &v);
-                SEE_string_fputs(v.u.string, stdout);
-		fflush(stdout);
+		if (interp->output)
+		    SEE_output_string(interp, interp->output, v.u.string);
+		else {
+                    SEE_string_fputs(v.u.string, stdout);
+		    fflush(stdout);
+		}
         }
         SEE_SET_UNDEFINED(res);
 }
@@ -29,4 +29,78 @@ test("i1.constructor", foo)
 test("(function(){123;})()", undefined);
 test("123", 123);
 
+// Locals and parameters are kept in activation slots
+function locals1(a, b) {
+	var c = a + b, d;
+	d = c * 2;
+	c += 1; d++; ++d; a--;
+	return [a, b, c, d].join();
+}
+test("locals1(1, 2)", "0,2,4,8")
+
+function locals2(a) {
+	var a;			/* shares the param's slot */
+	return a;
+}
+test("locals2(7)", 7)
+
+function locals3(a) {
+	var x = 1;
+	function get() { return x + a; }
+	function set(v) { x = v; }
+	set(10);
+	return get() + "," + x + "," + typeof get;
+}
+test("locals3(5)", "15,10,function")
+
+function locals4(a) {
+	var x = 3;
+	eval("x = x + a; var y = 2");
+	return x * y;
+}
+test("locals4(4)", 14)
+
+function locals5(a, b) {
+	var o = { x: "with" }, x = "local";
+	with (o) { var r = x; }
+	arguments[1] = "changed";
+	return [r, x, b, delete x, delete a].join();
+}
+test("locals5(1, 2)", "with,local,changed,false,false")
+
+function locals6() {
+	var k, s = "";
+	for (k in { p: 1 }) s += k;
+	for (var j in { q: 1 }) s += j;
+	try { throw "e"; } catch (k) { s += k; }
+	return s + k + j;
+}
+test("locals6()", "pqepq")
+
+function locals7(f) {
+	function f() { return "decl"; }
+	return typeof f;
+}
+test("locals7(1)", "function")
+
+/* The arguments object is created on first use (10.1.6, 10.1.8) */
+function args1(a) { return arguments.length + ";" + arguments[1]; }
+test("args1(1, 'x')", "2;x")
+function args2(a) { return eval("arguments[0]"); }
+test("args2('e')", "e")
+function args3(arguments) { return arguments; }
+test("args3('p')", "p")
+function args4() { var arguments; return typeof arguments; }
+test("args4()", "object")
+function args5() { var arguments = 5; return arguments; }
+test("args5()", 5)
+function args6(a) { return function () { return arguments[0]; }; }
+test("args6('outer')('inner')", "inner")
+function args7(a) { arguments[0] = "x"; return a; }
+test("args7('a')", "x")
+function args8() { return delete arguments; }
+test("args8()", false)
+function args9(a) { with ({}) return arguments.callee === args9; }
+test("args9()", true)
+
 finish()
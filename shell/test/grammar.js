@@ -154,6 +154,20 @@ test("x=y=0;try{" +
      " try { throw {a:1} } finally {x=2}; " +
      "} catch(e) {y=e.a}; x+y", 3);
 test("x=y=0; try{throw {a:2};y=1;} catch(e){x=e.a;y=-7;} finally{y=3}; x+y", 5);
+/* Instruction sequences that the executer runs as superinstructions */
+test("var r = ''; for (var i = 0; i < 3; i++) r += i; r", "012");
+test("var x = NaN, r = 0; if (x < 1) r = 1; if (x >= 1) r = 2; " +
+     "if (x <= x) r = 3; if (x == x) r = 4; if (x === x) r = 5; r", 0);
+test("var r = 0; if (-0 === 0) r = 1; r", 1);
+test("var r = 0; if ('b' > 'a') r = 1; r", 1);
+test("var r = 0; if (null == undefined) r = 1; r", 1);
+test("var r = 0; if (1 === '1') r = 1; r", 0);
+test("var s = '', a = { valueOf: function () { s += 'a'; return 5; } }, " +
+     "b = { valueOf: function () { s += 'b'; return 3; } }; " +
+     "(a - b) + s + (a + b) + s", "2ab8abab");
+test("var x = '1'; x++; x", 2);
+test("var x = 's'; x += 1; x", "s1");
+test("var o = { p: 1 }; o.p += 2; o.p", 3);
 compat("js15");
 test("var x='pass';a:{b:break a;x='fail';};x", 'pass');
 test("if (0) function foo(){}", undefined);
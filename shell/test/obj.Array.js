@@ -0,0 +1,135 @@
+describe("Array object tests")
+
+/* Lists the enumerable properties of an object, in enumeration order */
+function keys(o) {
+	var r = [];
+	for (var p in o)
+		r.push(p);
+	return r.join();
+}
+
+/* 15.4.2.1 */
+test("new Array(1,2,3).join()", "1,2,3")
+test("new Array(3).length", 3)
+test("keys(new Array(3))", "")
+test("[].length", 0)
+
+/* 15.4.5.1 elements and length */
+function fill(n) {
+	var a = [];
+	for (var i = 0; i < n; i++)
+		a[i] = i * 2;
+	return a;
+}
+test("fill(1000).length", 1000)
+test("fill(1000)[999]", 1998)
+test("fill(1000)['999']", 1998)
+test("fill(10)[10]", undefined)
+test("fill(10)[1.5]", undefined)
+test("fill(10)[-1]", undefined)
+test("var a = fill(3); a[1.5] = 'x'; keys(a).split(',').sort() + ';' + a.length",
+	"0,1,1.5,2;3")
+test("var a = fill(3); a[-1] = 'x'; a.length + ';' + a[-1]", "3;x")
+test("var a = fill(3); a['01'] = 'x'; a.length + ';' + a[1]", "3;2")
+
+/* Holes, and stores far beyond the end */
+test("var a = [0]; a[5] = 5; keys(a) + ';' + a.length", "0,5;6")
+test("var a = [0]; a[5] = 5; (3 in a) + ',' + (5 in a)", "false,true")
+test("var a = []; a[100000] = 'x'; keys(a) + ';' + a.length",
+	"100000;100001")
+test("var a = []; a[4294967294] = 'x'; a.length", 4294967295)
+test("var a = []; a[4294967295] = 'x'; a.length + ';' + a[4294967295]",
+	"0;x")
+test("var a = []; a[9] = 9; for (var i = 0; i < 9; i++) a[i] = i; a.join('')",
+	"0123456789")
+test("var a = []; a[200] = 'z'; for (var i = 0; i < 200; i++) a[i] = i; " +
+	"a.length + ';' + a[200] + ';' + keys(a).split(',').length", "201;z;201")
+test("var a = fill(5); delete a[2]; keys(a) + ';' + a.length", "0,1,3,4;5")
+test("var a = fill(5); delete a[4]; keys(a) + ';' + a.length", "0,1,2,3;5")
+test("var a = fill(5); delete a[2]; a[2] = 'x'; a.join()", "0,2,x,6,8")
+test("var a = fill(5); a.x = 1; a[5] = 10; keys(a).split(',').sort().join()",
+	"0,1,2,3,4,5,x")
+
+/* Holes see through to the prototype */
+test("Array.prototype[1] = 'p'; var a = [0]; a[2] = 2; var r = a[1]; " +
+	"delete Array.prototype[1]; r", "p")
+
+/* 15.4.5.2 truncating */
+test("var a = fill(10); a.length = 3; a.join() + ';' + a[5]",
+	"0,2,4;undefined")
+test("var a = fill(3); a[1000000] = 1; a.length = 2; keys(a)", "0,1")
+test("var a = fill(3); a.length = 5; a.length + ';' + keys(a)", "5;0,1,2")
+
+/* Methods on dense and sparse arrays */
+test("var a = fill(4); [a.pop(), a.length, a.join()].join(';')",
+	"6;3;0,2,4")
+test("var a = []; a[3] = 'x'; [a.pop(), a.length].join(';')", "x;3")
+test("var a = fill(2); [a.push(7, 8), a.join()].join(';')", "4;0,2,7,8")
+test("var a = fill(4); [a.shift(), a.length, a.join()].join(';')",
+	"0;3;2,4,6")
+test("var a = [1,,3]; [a.shift(), a.length, 0 in a].join(';')",
+	"1;2;false")
+test("fill(6).slice(1, 3).join()", "2,4")
+test("fill(6).slice(-2).join()", "8,10")
+test("var a = [1,,3].slice(0); (1 in a) + ';' + a.length", "false;3")
+test("var a = fill(6); [a.splice(1, 2).join(), a.join()].join(';')",
+	"2,4;0,6,8,10")
+test("var a = fill(4); [a.splice(1, 1, 'a', 'b').join(), a.join()].join(';')",
+	"2;0,a,b,4,6")
+test("var a = fill(4); [a.splice(1, 0, 'a').join(), a.length].join(';')",
+	";5")
+test("[3,1,2].sort().join()", "1,2,3")
+test("[3,undefined,1,2].sort().join()", "1,2,3,")
+test("[10,9,1].sort().join()", "1,10,9")
+test("[10,9,1].sort(function(x,y) { return x - y; }).join()", "1,9,10")
+test("var a = [3,,1]; a.sort(); a.length + ';' + a[0] + a[1] + ';' + (2 in a)",
+	"3;13;false")
+test("var a = fill(100).reverse(); a.sort(function(x,y) { return x - y; }); " +
+	"a[0] + ',' + a[99]", "0,198")
+test("var a = [2,1]; a.sort(function(x,y) { a.length = 0; return x - y; }); " +
+	"a.join()", "1,2")
+
+
+/* Sorting is stable, and uses the runs already in the input */
+function records(n) {
+	var a = [];
+	for (var i = 0; i < n; i++)
+		a[i] = { k: (i * 7919) % 13, i: i };
+	return a;
+}
+function ordered(a) {
+	for (var i = 1; i < a.length; i++)
+		if (a[i-1].k > a[i].k || (a[i-1].k == a[i].k && a[i-1].i > a[i].i))
+			return false;
+	return true;
+}
+test("var a = records(1000); a.sort(function(x,y) { return x.k - y.k; }); " +
+	"ordered(a)", true)
+test("var a = records(20); a.sort(function(x,y) { return x.k - y.k; }); " +
+	"ordered(a)", true)
+test("var a = []; for (var i = 0; i < 500; i++) a[i] = i % 100; " +
+	"a.sort(function(x,y) { return x - y; }); a[0]+','+a[5]+','+a[499]",
+	"0,1,99")
+test("var a = []; for (var i = 0; i < 300; i++) a[i] = 300 - i; a.sort(); " +
+	"a[0] + ',' + a[1] + ',' + a[299]", "1,10,99")
+test("var a = []; for (var i = 0; i < 300; i++) a[i] = i < 150 ? i : 1000-i; " +
+	"a.sort(function(x,y) { return x - y; }); a[149]+','+a[150]+','+a[299]",
+	"149,701,850")
+test("var a = ['b', undefined, 'a', , 'c']; a.sort(); " +
+	"a.join() + ';' + a.length + ';' + (3 in a) + (4 in a)",
+	"a,b,c,,;5;truefalse")
+test("var o = { 0: 'z', 2: 'x', 3: undefined, 5: 'y', length: 6 }; " +
+	"Array.prototype.sort.call(o); " +
+	"[o[0], o[1], o[2], 3 in o, o[3], 4 in o, 5 in o].join()",
+	"x,y,z,true,,false,false")
+test("var a = [3,1,2]; try { a.sort(function() { throw 'x'; }); } " +
+	"catch (e) {} a.join()", "3,1,2")
+test("var a = fill(100); try { a.sort(function(x, y) { " +
+	"if (x == 50) throw 'x'; return y - x; }); } catch (e) {} a[0]", 0)
+
+test("var a = []; for (var i = 0; i < 1000; i++) a[i] = 'ab'; " +
+	"var s = a.join('--'); s.length + s.substr(0, 7)", "3998ab--ab-")
+test("['a', null, 'b', undefined, 1].join('/')", "a//b//1")
+test("var a = ['a', 'b']; a[3] = 'd'; a.join()", "a,b,,d")
+
+finish()
@@ -128,4 +128,12 @@ test("encodeURIComponent('#')", hex('#'))
 test("encodeURIComponent(unescaped)", unescaped)
 test("encodeURIComponent(other)", hex(other))
 
+/* Multi-byte characters, including those with bit 4 of a trail byte set */
+test("encodeURIComponent('\\u00f0\\u20ac\\ud83d\\ude00')",
+	"%C3%B0%E2%82%AC%F0%9F%98%80")
+test("decodeURIComponent(encodeURIComponent('\\u00f0\\u07ff\\uffef'))",
+	"\u00f0\u07ff\uffef")
+test("escape('a b\\u0100')", "a%20b%u0100")
+test("unescape('a%20b%u0100%zz')", "a b\u0100%zz")
+
 finish()
@@ -82,4 +82,110 @@ test("Object.prototype.isPrototypeOf(new Number(123))", true)
 test("({p:false}).propertyIsEnumerable('p')", true)
 test("Object.propertyIsEnumerable('length')", false)
 
+/* Property access sites cache where they last found a property */
+function P() { this.a = 1; }
+P.prototype.m = function () { return "proto"; };
+function getm(o) { return o.m(); }
+function geta(o) { return o.a; }
+function seta(o, v) { o.a = v; }
+function cache1() {
+	var p = new P(), q = new P(), r = [];
+	r.push(getm(p), getm(q));
+	q.m = function () { return "own"; };	/* shadows the prototype */
+	r.push(getm(p), getm(q));
+	P.prototype.m = function () { return "new"; };
+	r.push(getm(p), getm(q));
+	delete q.m;
+	r.push(getm(q));
+	return r.join();
+}
+test("cache1()", "proto,proto,proto,own,new,own,new")
+
+function cache2() {
+	var r = [], objs = [{a:"x"}, {b:0, a:"y"}, new P(), {a:"z", c:1}];
+	for (var i = 0; i < 8; i++)		/* polymorphic site */
+		r.push(geta(objs[i % 4]));
+	for (i = 0; i < 4; i++)
+		seta(objs[i], i);
+	for (i = 0; i < 4; i++)
+		r.push(geta(objs[i]));
+	return r.join();
+}
+test("cache2()", "x,y,1,z,x,y,1,z,0,1,2,3")
+
+function cache3() {
+	var o = new P(), p = {}, r = [];
+	seta(o, 2); seta(o, 3);
+	r.push(geta(o));
+	delete o.a;
+	r.push(geta(o));
+	p.a = "proto";
+	o.__proto__ = p;		/* (JS compat mode only) */
+	r.push(geta(o) === undefined || geta(o) == "proto");
+	seta(o, 4);
+	r.push(geta(o), p.a);
+	return r.join();
+}
+test("cache3()", "3,,true,4,proto")
+
+function cache4() {
+	var r = [], s = "abc", n = 5;
+	for (var i = 0; i < 2; i++) {
+		r.push(geta(Math) === undefined);
+		r.push(typeof n.toFixed, s.length);
+	}
+	Math.a = "math";
+	r.push(geta(Math));
+	return r.join();
+}
+test("cache4()", "true,function,3,true,function,3,math")
+
+/* for-in over objects whose layout changes between enumerations */
+function keys(o) {
+	var r = [];
+	for (var k in o)
+		r.push(k);
+	return r.join();
+}
+function enum1() {
+	var r = [], o;
+	for (var i = 0; i < 3; i++) {
+		o = {port: i, host: "h", path: "/"};
+		r.push(keys(o));
+	}
+	delete o.host;
+	r.push(keys(o));
+	o.user = 1;
+	r.push(keys(o));
+	return r.join(";");
+}
+test("enum1()", "port,host,path;port,host,path;port,host,path;port,path;port,path,user")
+test("var o = {a:1, b:2, c:3, d:4}; delete o.a; keys(o)", "b,c,d")
+
+function enum2() {
+	function D() {}
+	var r = [], o = new D();
+	o.b = 1;
+	r.push(keys(o));
+	D.prototype.b = 2;
+	r.push(keys(o));
+	D.prototype.a = 3;
+	r.push(keys(o).split(",").sort().join());
+	delete D.prototype.a;
+	r.push(keys(o));
+	return r.join(";");
+}
+test("enum2()", "b;b;a,b;b")
+
+function enum3() {
+	var o = {a: 1, b: 2, c: 3}, r = [];
+	for (var k in o) {
+		r.push(k);
+		delete o.c;		/* deleted before being reached */
+		o.d = 4;
+	}
+	return r.join();
+}
+test("enum3()", "a,b")
+
 finish()
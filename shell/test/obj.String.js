@@ -0,0 +1,48 @@
+describe("String object tests")
+
+/* 11.6.1 building strings by appending and prepending */
+function build(n, f) {
+	var s = '';
+	for (var i = 0; i < n; i++)
+		s = f(s, i % 10);
+	return s;
+}
+test("build(10, function (s, c) { return s + c; })", "0123456789")
+test("build(10, function (s, c) { return c + s; })", "9876543210")
+test("build(5, function (s, c) { return '<' + s + '>'; })", "<<<<<>>>>>")
+test("build(1000, function (s, c) { return c + s; }).slice(-12)",
+	"109876543210")
+test("var s = build(1000, function (s, c) { s += c; return s; }); " +
+	"s.length + ';' + s.slice(-4)", "1000;6789")
+
+/* Strings that share storage do not see each other's changes */
+test("var s = 'ab' + 'cd'; var t = s + 'e'; var u = s + 'f'; " +
+	"[s, t, u].join()", "abcd,abcde,abcdf")
+test("var s = build(5, function (s) { return 'b' + s; }); " +
+	"var t = 'c' + s; var u = 'd' + s; [s, t, u].join()",
+	"bbbbb,cbbbbb,dbbbbb")
+test("var s = build(5, function (s) { return 'b' + s; }); " +
+	"var t = 'c' + s; var u = s + 'e'; var v = 'f' + t; [s, t, u, v].join()",
+	"bbbbb,cbbbbb,bbbbbe,fcbbbbb")
+
+/* Built strings compare and name properties like any other */
+test("var s = build(4, function (s) { return 'x' + s; }); " +
+	"(s == 'xxxx') + ';' + (s < 'xxxxx') + ';' + ({ xxxx: 1 })[s]",
+	"true;true;1")
+
+/* 15.5.4.6 String.prototype.concat() */
+test("'a'.concat('b', 1, null)", "ab1null")
+test("'x'.concat()", "x")
+test("new String('ab').concat('c')", "abc")
+test("String.prototype.concat.call(12, 3)", "123")
+test("var s = 'x' + 'y'; var t = s.concat('z'); var u = s.concat('w'); " +
+	"[s, t, u].join()", "xy,xyz,xyw")
+test("build(100, function (s, c) { return s.concat(c); }).slice(0, 12)",
+	"012345678901")
+
+/* 15.4.4.5 Array.prototype.join() of strings */
+test("[1,,null,undefined,'a'].join('-')", "1----a")
+test("var a = [1, { toString: function () { a.length = 1; return 'o'; } }, 3]; " +
+	"a.join()", "1,o,")
+
+finish()
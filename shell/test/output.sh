@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+# Checks that the shell's buffered print() output comes out before
+# what it later writes to stderr, when both go down the same pipe.
+#
+
+shell=${SEE_SHELL:-../see-shell}
+status=0
+
+order() {
+	first=`($shell -e "$1" 2>&1) 2>/dev/null | sed -n 1p`
+	if test "$first" = "a"; then
+		echo "PASS: $1"
+	else
+		echo "FAIL: $1"
+		echo "	first line was '$first', expected 'a'"
+		status=1
+	fi
+}
+
+order 'print("a"); null.x'
+order 'print("a"); throw "b"'
+order 'print("a"); abort("b")'
+
+exit $status
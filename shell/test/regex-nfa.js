@@ -0,0 +1,45 @@
+
+describe("Regular expressions matched by the automaton engine");
+
+var old_engine = Shell.regex_engine('nfa');
+test("Shell.regex_engine()", "nfa");
+
+/* Same matches and captures as the backtracker */
+test("String(/a|ab/.exec('abc'))", "a");
+test("String(/((a)|(ab))((c)|(bc))/.exec('abc'))", "abc,a,a,,bc,,bc");
+test("String(/a[a-z]{2,4}/.exec('abcdefghi'))", "abcde");
+test("String(/a[a-z]{2,4}?/.exec('abcdefghi'))", "abc");
+test("String(/(aa|aabaac|ba|b|c)*/.exec('aabaac'))", "aaba,ba");
+test("String(/(z)((a+)?(b+)?(c))*/.exec('zaacbbbcac'))", 
+	"zaacbbbcac,z,ac,a,,c");
+test("String(/(a*)*/.exec('b'))", ",");
+test("String(/(x*)*?y/.exec('xxy'))", "xxy,xx");
+test("String(/((a)|b)+/.exec('ab'))", "ab,b,");
+test("String(/^(?:a|ab)(c|bcd)(d*)$/.exec('abcd'))", "abcd,bcd,");
+test("String('ab'.split(/a*?/))", "a,b");
+test("String('ab'.split(/a*/))", ",b");
+test("'one two  three'.replace(/\\b(\\w)(\\w*)/g, '$2$1')",
+	"neo wot  hreet");
+test("'x\\nab\\ncd'.replace(/^\\w/gm, '#')", "#\n#b\n#d");
+test("/ABC$/i.exec('xxabc').index", 2);
+test("'caf\\u00e9 \\ud800\\udc00!'.search(/[\\u00e0-\\u00ff] ./)", 3);
+test("'aaa'.match(/a{2}|a/g).length", 2);
+
+/* Patterns that make the backtracker take exponential time */
+var long_a = (function () { var s = 'a';
+	while (s.length < 20000) s = s + s; return s; })();
+test("/(a+)+b/.test(long_a)", false);
+test("/^(a|aa)*$/.test(long_a + 'b')", false);
+test("/(a*)*b/.exec(long_a + 'b')[0].length", long_a.length + 1);
+test("/^(\\w+\\s?)*$/.test(long_a + '!')", false);
+test("long_a.replace(/(a|a)*?$/, 'x').length", 1);
+
+/* Backreferences and lookaheads fall back to the backtracker */
+test("String(/(a*)b\\1+/.exec('baaaac'))", "b,");
+test("String(/(?=(a+))a*b\\1/.exec('baaabac'))", "aba,a");
+test("String(/(.*?)a(?!(a+)b\\2c)\\2(.*)/.exec('baaabaac'))", 
+	"baaabaac,ba,,abaac");
+
+Shell.regex_engine(old_engine);
+
+finish()
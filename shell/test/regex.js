@@ -20,3 +20,52 @@ test("String('ab'.split(/a*?/))", "a,b");
 test("String('ab'.split(/a*/))", ",b");
 
 finish()
+
+describe("Regular expressions on long inputs and deep backtracking");
+
+var long_ab = (function () { var s = 'ab'; 
+	while (s.length < 100000) s = s + s; return s; })();
+test("/^(a|b)*c/.test(long_ab)", false);
+test("/(a|b)*c/.exec(long_ab + 'c')[0].length", long_ab.length + 1);
+test("/(a|b)*c/.exec(long_ab + 'c')[1]", "b");
+test("long_ab.replace(/(ab)+/, '$1')", "ab");
+test("/^(?:a(?=b)b)*$/.test(long_ab)", true);
+test("long_ab.split(/b/).length", long_ab.length / 2 + 1);
+test("String(/(a)?(b)?x|(a)(b)y/.exec('aby'))", "aby,,,a,b");
+test("String(/((a)|b)+/.exec('ab'))", "ab,b,");
+test("String(/(?!(a))(b)|(a)c/.exec('ac'))", "ac,,,a");
+test("String(/(a+)+b/.exec('aaaaaaaaaaaaaaaab'))", 
+	"aaaaaaaaaaaaaaaab,aaaaaaaaaaaaaaaa");
+test("String(/(x*)*?y/.exec('xxy'))", "xxy,xx");
+
+finish()
+
+describe("Regular expression searches that skip start positions");
+
+test("'xxabcxx'.search(/abc/)", 2);
+test("'xxabxx'.search(/abc/)", -1);
+test("'xxAbCxx'.search(/abc/i)", 2);
+test("'xx\\u0131x'.search(/[a-z]*i/i) >= 0", true);
+test("'zzzq'.search(/[pq]/)", 3);
+test("'zz\\u0100q'.search(/[\\u0100-\\u0200]/)", 2);
+test("'ab\\ud800\\udc00c'.search(new RegExp('\\ud800\\udc00'))", 2);
+test("'abc'.search(/$/)", 3);
+test("''.search(/x*/)", 0);
+test("'a\\nb\\nc'.search(/^c/)", -1);
+test("'a\\nb\\nc'.search(/^c/m)", 4);
+test("'ab\\nab'.replace(/^a/gm, 'X')", "Xb\nXb");
+test("'xaybxayc'.replace(/a(y|z)c/, '!')", "xaybx!");
+test("String('a1b22c333d'.match(/\\d+/g))", "1,22,333");
+test("String('one, two,three'.split(/,\\s*/))", "one,two,three");
+test("String('A<B>bold</B>'.split(/<(\\/)?([^<>]+)>/))", 
+	"A,,B,bold,/,B,");
+test("String(/(?=xy)x|b/.exec('abxy'))", "b");
+test("String(/x(?!y)/.exec('xyxz'))", "x");
+test("String(/(a|b)c+d/.exec('xbccd'))", "bccd,b");
+test("var r = /o/g; r.lastIndex = 5; r.exec('foo boo').index", 5);
+
+test("'a-b-c'.replace(/-/g, function (m, i) { return '[' + i + ']'; })",
+	"a[1]b[3]c")
+test("'abc'.replace(/b/, \"$`$'$&$$$1$\")", "aacb$$c")
+
+finish()
@@ -52,4 +52,25 @@ test("var s=0;b:{a:{try{s+=1;break b}finally{s+=2        }s+=4}s+=8}s", 3);
 test("var s=0;b:{a:{try{s+=1;break a}finally{s+=2;break b}s+=4}s+=8}s", 3);
 test("var s=0;   a:{try{throw 0}catch(e){s+=1; break a}s+=2}  s", 1);
 
+/* Exceptions caught in the frame that threw them, and in outer frames */
+test("var s=''; for (var i=0; i<3; i++) try{null.x}catch(e){s+=e.name} s",
+	"TypeErrorTypeErrorTypeError");
+test("var s=''; for (var i=0; i<3; i++) try{throw i}catch(e){s+=e} s",
+	"012");
+test("var s=0; try{try{throw 1}catch(e){throw e+1}}catch(e){s=e} s", 2);
+test("var s=''; try{for(var p in {a:1}) throw p}catch(e){s=e} s", "a");
+test("var s=''; try{with({x:'w'}) throw x}catch(e){s=e+typeof x} s",
+	"wundefined");
+test("var s=0; try{try{throw 1}finally{s+=2}}catch(e){s+=e} s", 3);
+test("var s=0; try{try{null.x}finally{s+=2}}catch(e){s+=1} s", 3);
+function deep(k) { if (!k) throw 'bottom'; return deep(k - 1); }
+function deepf(k) { try { return k ? deepf(k - 1) : deep(0); }
+		    finally { deepf.n++; } }
+test("try{deep(50)}catch(e){e}", "bottom");
+test("deepf.n=0; try{deepf(20)}catch(e){e+deepf.n}", "bottom21");
+test("var s=''; for (var i=0; i<3; i++) try{deep(10)}catch(e){s+=i} s",
+	"012");
+test("function f(){try{return deep(5)}catch(e){return 'f'+e}} f()+f()",
+	"fbottomfbottom");
+
 finish()
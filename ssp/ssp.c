@@ -2,35 +2,56 @@
 #include <string.h>
 #include <stdlib.h>
 #include <err.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <see/see.h>
 #include "httpd.h"
 #include "ssp.h"
-#include "pool.h"
 
 /*
- * An input stream around a SSP file.
- * This does two things. First it saves segments of text from the file into 
- * global strings named __inputN, where N is an increasing number.
- * Secondly it replaces the segments with javascript statements of the
- * form 'print(__inputN);'. The idea is that executing the script
- * will print the unescaped text.
+ * A compiled SSP file.
+ * The file is split, once, into static text and the code between "<%"
+ * and "%>". The static text is kept as the file's own bytes, and the
+ * code is compiled into a program in which each piece of static text
+ * is replaced by a statement of the form '__text(id,n);'. Calling
+ * __text() copies the nth piece of text of page id straight into the
+ * request's output buffer, so the text is never scanned as script, nor
+ * converted to a string, when the page is served.
  *
- * While processing, the input stream is in one of two states:
- *	COPY	- copying through javascript code without change
- *                until a '%>' is encountered 
- *	TEXT	- emitting the content of the text[] field
- *	NLS	- emitting newlines after the text[] field
+ * Compiled pages are kept in page_cache, keyed by path, until the
+ * file's modification time or size changes. They are shared by all
+ * request threads and are not changed once made. A page is freed
+ * when it has left the cache and no running request uses it.
  */
-struct ssp_input {
-	struct SEE_input input;
-	FILE *f;
-	enum { SSP_COPY, SSP_TEXT, SSP_NL } state;
-	int counter;			/* text segment id genertator */
-	char text[256];			/* inserted js code */
-	int textpos;			/* read position in text[] */
-	int nlcount;			/* newlines to insert after text[] */
-	int first;			/* set only when "<%" is seen */
-	int trail_needed;		/* indicates trailing ');' is needed*/
+struct chunk {
+	const char *data;		/* points into page->text */
+	SEE_size_t len;
+};
+
+struct page {
+	char *path;
+	time_t mtime;			/* of the file when compiled */
+	off_t size;
+	unsigned int id;		/* unique to this compilation */
+	char *text;			/* the file's contents */
+	struct chunk *chunks;		/* static text */
+	unsigned int nchunks;
+	char *script;			/* generated script, shown for ?raw */
+	void *program;			/* from SEE_program_save() */
+	SEE_size_t proglen;
+	int refs;			/* from the cache and from requests */
+	struct page *next;
+};
+static struct page *page_cache;
+static unsigned int page_serial;	/* last page id */
+static pthread_mutex_t page_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* A page used by a request, and its program loaded for the request */
+struct page_use {
+	struct page *page;
+	struct SEE_program *program;
+	struct page_use *next;
 };
 
 /*
@@ -38,256 +59,49 @@ struct ssp_input {
  */
 struct ssp_state {
 	FILE *fp;
-	struct pool *pool;
 	int headers_sent;		/* true if HTTP header sent */
 	int raw;			/* true if raw JS to be sent */
 	int response_code;		/* usually 200 */
+	struct page_use *pages;		/* pages used, held until done */
+	struct SEE_output output;	/* buffers the response body */
 };
 #define SSP_STATE(interp)  ((struct ssp_state *)(interp)->host_data)
 
 /* prototypes */
-static int read_text(struct ssp_input *inp);
-static struct SEE_input *ssp_input_new(struct SEE_interpreter *interp, 
-	const char *filename);
-static SEE_unicode_t ssp_next(struct SEE_input *input);
-static void ssp_close(struct SEE_input *input);
-static void *ssp_malloc(struct SEE_interpreter *, SEE_size_t);
-static void  ssp_free(struct SEE_interpreter *, void *);
 static struct SEE_object *make_headers_object(struct SEE_interpreter *,
 	struct header *);
-
-static struct SEE_inputclass ssp_inputclass = { ssp_next, ssp_close };
+static char *page_split(struct page *, SEE_size_t);
+static void page_free(struct page *);
+static struct page *page_compile(struct SEE_interpreter *, const char *,
+	struct stat *);
+static struct page *page_get(struct SEE_interpreter *, const char *);
+static void page_release(struct page *);
+static void template_init(void);
 
 /*
- * Sets up SEE so that it uses a per-interpreter allocator.
- * Our allocators remember what mallocs were performed, and
- * when a request is complete, we can simply dump all memory
- * associated with that interpreter. This is not a good approach
- * for long-running scripts, but for web-based applications it
- * is probably sufficient.
+ * An initialised interpreter that each request copies instead of
+ * initialising its own. It is set up by ssp_init(), is only
+ * read afterwards, and its memory lives for the life of the server.
  */
-void
-ssp_init()
-{
-	SEE_system.malloc          = ssp_malloc;
-	SEE_system.malloc_finalize = NULL;
-	SEE_system.malloc_string   = ssp_malloc;
-	SEE_system.free            = ssp_free;
-	SEE_system.gcollect        = NULL;
-}
+static struct SEE_interpreter template_interp;
+static struct ssp_state template_state;
 
 /*
- * Allocates storage for an interpreter. Allocated blocks
- * are wrapped in a linked list rooted in the interpreter's ssp_state.
+ * The most memory that one request's scripts may use. Past this,
+ * allocations throw a RangeError.
  */
-static void *
-ssp_malloc(interp, size)
-	struct SEE_interpreter *interp;
-	SEE_size_t size;
-{
-	if (!interp)
-		return malloc(size);
-	return pool_malloc(SSP_STATE(interp)->pool, size);
-}
+#define SSP_MEMORY_LIMIT	(16 * 1024 * 1024)
 
 /*
- * Sometimes SEE calls free(). It can be safely ignored.
+ * Prepares the template interpreter. Each request copies it into
+ * an arena of its own, so that when the request is complete, we can
+ * simply dump all memory associated with that interpreter, and so that
+ * a runaway script is stopped at SSP_MEMORY_LIMIT bytes.
  */
-static void 
-ssp_free(interp, ptr)
-	struct SEE_interpreter *interp;
-	void *ptr;
-{
-	if (!interp)
-		free(ptr);
-}
-
-/* Reads text up until EOF or "<%". Returns -1 if EOF was immediately 
- * read. Sets the text[] array to the JS code that will print the read
- * text. Also increments nlcount by the number of newlines in the
- * text segment */
-static int
-read_text(inp)
-	struct ssp_input *inp;
-{
-	int ch, ch2;
-	struct SEE_interpreter *interp = inp->input.interpreter;
-	struct SEE_string *str;
-	char label[32];
-	struct SEE_value v;
-	int textlen;
-	
-	inp->nlcount = 0;
-	inp->first = 0;
-	ch = getc(inp->f);
-	if (ch == EOF)
-		return -1;
-	str = SEE_string_new(interp, 0);
-	do {
-		if (ch == '<') {
-		    if ((ch2 = getc(inp->f)) == '%') {
-		    	inp->first = 1;
-		        break;
-		    }
-		    SEE_string_addch(str, '<');
-		    ch = ch2;
-		    if (ch == EOF)
-		    	break;
-		}
-	        SEE_string_addch(str, ch);
-		if (ch == '\n')
-			inp->nlcount++;
-	} while ((ch = getc(inp->f)) != EOF);
-
-	if (str->length) {
-		inp->counter++;
-		snprintf(label, sizeof label, "__input%u", inp->counter);
-		SEE_SET_STRING(&v, str);
-		SEE_OBJECT_PUTA(interp, interp->Global, label, &v, 
-			SEE_ATTR_DONTENUM | SEE_ATTR_READONLY | 
-			SEE_ATTR_DONTDELETE);
-		textlen = strlen(inp->text);
-		snprintf(inp->text + textlen, sizeof inp->text - textlen, 
-			";print(%s);", label);
-	} else
-		inp->text[0] = 0;
-
-	inp->textpos = 0;
-	return 0;
-}
-
-/* Creates an input object that generates JS program text from an SSP file */
-static struct SEE_input *
-ssp_input_new(interp, filename)
-	struct SEE_interpreter *interp;
-	const char *filename;
-{
-	struct ssp_input *inp = SEE_NEW(interp, struct ssp_input);
-
-	inp->input.inputclass = &ssp_inputclass;
-	inp->input.interpreter = interp;
-	inp->input.eof = 0;
-	inp->input.lookahead = 0;
-	inp->input.filename = SEE_string_sprintf(interp, "%s", filename);
-	inp->input.first_lineno = 1;
-	inp->f = fopen(filename, "rb");
-	if (!inp->f) {
-		warn("%s", filename);
-		return NULL;
-	}
-	inp->counter = 0;
-	inp->trail_needed = 0;
-	inp->text[0] = 0;
-
-	if (read_text(inp)) {
-		/* empty file */
-		inp->input.eof = 1;
-		return &inp->input;
-	}
-	inp->state = SSP_TEXT;
-
-	ssp_next(&inp->input);	/* prime */
-	return &inp->input;
-}
-
-/* Generates the next JS character from an SSP file */
-static SEE_unicode_t
-ssp_next(input)
-	struct SEE_input *input;
-{
-	struct ssp_input *inp = (struct ssp_input *)input;
-	int ch;
-	SEE_unicode_t ret = inp->input.lookahead;
-
-  again:
-
-	if (inp->state == SSP_TEXT) {
-		if (inp->text[inp->textpos] == 0) {
-			inp->text[0] = 0;
-			inp->state = SSP_NL;
-		} else {
-			inp->input.lookahead = inp->text[inp->textpos];
-			inp->textpos++;
-			return ret;
-		}
-	}
-
-	if (inp->state == SSP_NL) {
-		if (inp->nlcount == 0)
-			inp->state = SSP_COPY;
-		else {
-			inp->nlcount--;
-			inp->input.lookahead = '\n';
-			return ret;
-		}
-	}
-
-	ch = getc(inp->f);
-	if (ch == EOF) {
-		inp->input.eof = 1;
-		return ret;
-	}
-
-	/*
-	 * If the first character after <% is = then we insert
-	 * 'print(' and expect the following to be an ecmascript
-	 * expression. We also set the trail_needed flag so that
-	 * when the '%>' is encountered, a closing ')' is inserted.
-	 */
-	if (inp->first) {
-		inp->first = 0;
-		if (ch == '=') {
-		    inp->first = 0;
-		    snprintf(inp->text, sizeof inp->text, ";print(");
-		    inp->textpos = 0;
-		    inp->nlcount = 0;
-		    inp->trail_needed = 1;
-		    inp->state = SSP_TEXT;
-		    goto again;
-		}
-	}
-
-	if (ch == '%') {
-		ch = getc(inp->f);
-		if (ch == EOF) {
-			warnx("file ended with %%");
-			inp->input.eof = 1;
-			return ret;
-		} else if (ch == '>') {
-			if (inp->trail_needed) {
-				snprintf(inp->text, sizeof inp->text, ");");
-				inp->trail_needed = 0;
-			}
-			if (read_text(inp)) {
-			    inp->input.eof = 1;
-			    return ret;
-			}
-		} else {
-			inp->text[0] = '%';
-			inp->text[1] = ch;	/* XXX ch may be '%' */
-			inp->text[2] = 0;
-			inp->textpos = 0;
-			inp->nlcount = 0;
-		}
-		inp->state = SSP_TEXT;
-		goto again;
-	}
-
-	inp->input.lookahead = ch;
-	return ret;
-}
-
-/*
- * Closes the input stream. Releases resources allocated by
- * ssp_input_new().
- */
-static void
-ssp_close(input)
-	struct SEE_input *input;
+void
+ssp_init()
 {
-	struct ssp_input *inp = (struct ssp_input *)input;
-
-	fclose(inp->f);
+	template_init();
 }
 
 /*
@@ -310,7 +124,7 @@ ssp_flush_header(interp)
 
 /*
  * print() function provided to the interpreter environment.
- * Simply writes to the stdio file pointer given to this request.
+ * Writes to the request's output buffer.
  */
 static void
 print_fn(interp, self, thisobj, argc, argv, res)
@@ -324,7 +138,7 @@ print_fn(interp, self, thisobj, argc, argv, res)
 	SEE_parse_args(interp, argc, argv, "s", &s);
 	if (s) {
 		ssp_flush_header(interp);
-		SEE_string_fputs(s, SSP_STATE(interp)->fp);
+		SEE_output_string(interp, interp->output, s);
 	}
 	SEE_SET_UNDEFINED(res);
 }
@@ -347,42 +161,289 @@ make_headers_object(interp, headers)
 	return obj;
 }
 
-/* Includes a file, treating it as SSP */
+/*
+ * Splits the page's text into static chunks and code, and returns
+ * the script to compile, or NULL if out of memory. Each chunk becomes
+ * a call to __text() followed by the chunk's newlines, and "<%=expr%>"
+ * becomes a call to print(), so that the script's line numbers are
+ * those of the SSP file.
+ */
+static char *
+page_split(page, len)
+	struct page *page;
+	SEE_size_t len;
+{
+	const char *p, *q, *end = page->text + len;
+	char *script, *out;
+	unsigned int n;
+	int expr;
+
+	/* At most one chunk per "<%", and one after the last "%>" */
+	n = 1;
+	for (p = page->text; (p = memchr(p, '<', end - p)) != NULL; p++)
+		if (p + 1 < end && p[1] == '%')
+			n++;
+	page->chunks = (struct chunk *)malloc(n * sizeof (struct chunk));
+	script = (char *)malloc(len + n * 48 + 1);
+	if (!page->chunks || !script) {
+		free(script);
+		return NULL;
+	}
+
+	out = script;
+	n = 0;
+	for (p = page->text; p < end; ) {
+		/* Static text, up to "<%" */
+		for (q = p; (q = memchr(q, '<', end - q)) != NULL; q++)
+			if (q + 1 < end && q[1] == '%')
+				break;
+		if (!q)
+			q = end;
+		if (q > p) {
+			page->chunks[n].data = p;
+			page->chunks[n].len = q - p;
+			out += sprintf(out, ";__text(%u,%u);", page->id, n);
+			n++;
+			for (; p < q; p++)
+				if (*p == '\n')
+					*out++ = '\n';
+		}
+		if (q == end)
+			break;
+
+		/* Code, up to "%>" */
+		p = q + 2;
+		expr = p < end && *p == '=';
+		if (expr) {
+			p++;
+			out += sprintf(out, ";print(");
+		}
+		while (p < end && !(p[0] == '%' && p + 1 < end && p[1] == '>'))
+			*out++ = *p++;
+		if (p == end)
+			warnx("%s: missing %%>", page->path);
+		else
+			p += 2;
+		if (expr)
+			out += sprintf(out, ");");
+	}
+	*out = '\0';
+	page->nchunks = n;
+	return script;
+}
+
+/* Releases a page that nothing refers to */
 static void
-ssp_include(interp, path)
+page_free(page)
+	struct page *page;
+{
+	free(page->path);
+	free(page->text);
+	free(page->chunks);
+	free(page->script);
+	free(page->program);
+	free(page);
+}
+
+/*
+ * Reads and compiles an SSP file into a new page, referred to once.
+ * Throws an exception if the file cannot be read or compiled.
+ */
+static struct page *
+page_compile(interp, path, st)
 	struct SEE_interpreter *interp;
 	const char *path;
+	struct stat *st;
 {
+	struct page *page;
 	struct SEE_input *input;
+	struct SEE_program *program;
 	SEE_try_context_t ctxt;
-	struct SEE_value res;
+	SEE_size_t len;
+	void *buf;
+	FILE *f;
 
-	/* Start up the code input stream generator */
-	input = ssp_input_new(interp, path);
-	if (!input) {
-		SEE_error_throw(interp, interp->Error, 
-			"cannot create input stream for %s", path);
-		return;
+	page = (struct page *)calloc(1, sizeof *page);
+	if (!page || !(page->path = strdup(path)) ||
+	    !(page->text = malloc(st->st_size + 1)))
+	{
+		if (page)
+			page_free(page);
+		SEE_error_throw(interp, interp->Error, "%s: out of memory",
+			path);
+	}
+	page->mtime = st->st_mtime;
+	page->size = st->st_size;
+	page->refs = 1;
+	pthread_mutex_lock(&page_cache_lock);
+	page->id = ++page_serial;
+	pthread_mutex_unlock(&page_cache_lock);
+
+	f = fopen(path, "rb");
+	if (!f) {
+		warn("%s", path);
+		page_free(page);
+		SEE_error_throw(interp, interp->Error,
+			"cannot open %s", path);
+	}
+	len = fread(page->text, 1, st->st_size, f);
+	fclose(f);
+
+	page->script = page_split(page, len);
+	if (!page->script) {
+		page_free(page);
+		SEE_error_throw(interp, interp->Error, "%s: out of memory",
+			path);
 	}
 
-	/* Parse and execute the input in one go; trapping exceptions */
 	SEE_TRY(interp, ctxt) {
-	    if (SSP_STATE(interp)->raw)
-		/* Print the generated script (for debugging) */
-		while (!input->eof) {
-			int ch = SEE_INPUT_NEXT(input) & 0x7f;
-			putc(ch, SSP_STATE(interp)->fp);
-		}
-	    else
-		/* Execute the generated script */
-		SEE_Global_eval(interp, input, &res);
+		input = SEE_input_utf8(interp, page->script);
+		input->filename = SEE_string_sprintf(interp, "%s", path);
+		program = SEE_program_compile(interp, input);
+		SEE_INPUT_CLOSE(input);
+		buf = SEE_program_save(interp, program, &page->proglen);
+		if ((page->program = malloc(page->proglen)) != NULL)
+			memcpy(page->program, buf, page->proglen);
+	}
+	if (SEE_CAUGHT(ctxt) || !page->program) {
+		page_free(page);
+		SEE_DEFAULT_CATCH(interp, ctxt);
+		SEE_error_throw(interp, interp->Error, "%s: out of memory",
+			path);
+	}
+	return page;
+}
+
+/*
+ * Returns the compiled page for an SSP file, compiling it if it
+ * is not in the cache or has changed. The caller must release it.
+ */
+static struct page *
+page_get(interp, path)
+	struct SEE_interpreter *interp;
+	const char *path;
+{
+	struct page *page, **pp;
+	struct stat st;
+
+	if (stat(path, &st) != 0) {
+		warn("%s", path);
+		SEE_error_throw(interp, interp->Error,
+			"cannot open %s", path);
 	}
-	/* Finally: close the input */
-	SEE_INPUT_CLOSE(input);
-	/* Rethrow any exception */
-	SEE_DEFAULT_CATCH(interp, ctxt);
+
+	pthread_mutex_lock(&page_cache_lock);
+	for (page = page_cache; page; page = page->next)
+		if (strcmp(page->path, path) == 0) {
+			if (page->mtime != st.st_mtime ||
+			    page->size != st.st_size)
+				page = NULL;
+			else
+				page->refs++;
+			break;
+		}
+	pthread_mutex_unlock(&page_cache_lock);
+	if (page)
+		return page;
+
+	page = page_compile(interp, path, &st);
+
+	/* Replace any older page for the path */
+	pthread_mutex_lock(&page_cache_lock);
+	for (pp = &page_cache; *pp; pp = &(*pp)->next)
+		if (strcmp((*pp)->path, path) == 0) {
+			struct page *old = *pp;
+			*pp = old->next;
+			if (--old->refs == 0)
+				page_free(old);
+			break;
+		}
+	page->refs++;
+	page->next = page_cache;
+	page_cache = page;
+	pthread_mutex_unlock(&page_cache_lock);
+	return page;
 }
 
+/* Releases a request's reference to a page */
+static void
+page_release(page)
+	struct page *page;
+{
+	pthread_mutex_lock(&page_cache_lock);
+	if (--page->refs == 0)
+		page_free(page);
+	pthread_mutex_unlock(&page_cache_lock);
+}
+
+/*
+ * __text() function provided to the interpreter environment.
+ * Writes a static chunk of a page that this request has included.
+ */
+static void
+text_fn(interp, self, thisobj, argc, argv, res)
+	struct SEE_interpreter *interp;
+	struct SEE_object *self, *thisobj;
+	int argc;
+	struct SEE_value **argv, *res;
+{
+	SEE_uint32_t id, n;
+	struct page_use *u;
+	struct chunk *chunk;
+
+	SEE_parse_args(interp, argc, argv, "uu", &id, &n);
+	for (u = SSP_STATE(interp)->pages; u; u = u->next)
+		if (u->page->id == id)
+			break;
+	if (!u || n >= u->page->nchunks)
+		SEE_error_throw(interp, interp->Error,
+			"no text %u in page %u", n, id);
+	chunk = &u->page->chunks[n];
+	ssp_flush_header(interp);
+	SEE_output_bytes(interp->output, chunk->data, chunk->len);
+	SEE_SET_UNDEFINED(res);
+}
+
+/*
+ * Includes a file, treating it as SSP. A page already used by this
+ * request is run again without looking at the file.
+ */
+static void
+ssp_include(interp, path)
+	struct SEE_interpreter *interp;
+	const char *path;
+{
+	struct ssp_state *state = SSP_STATE(interp);
+	struct page_use *u;
+	struct SEE_value res;
+
+	for (u = state->pages; u; u = u->next)
+		if (strcmp(u->page->path, path) == 0)
+			break;
+	if (!u) {
+		u = SEE_NEW(interp, struct page_use);
+		u->page = page_get(interp, path);
+		u->program = NULL;
+		u->next = state->pages;
+		state->pages = u;
+	}
+
+	if (state->raw) {
+		/* Print the generated script (for debugging) */
+		ssp_flush_header(interp);
+		SEE_output_bytes(interp->output, u->page->script,
+			strlen(u->page->script));
+		return;
+	}
+	if (!u->program) {
+		u->program = SEE_program_load(interp, u->page->program,
+			u->page->proglen);
+		if (!u->program)
+			SEE_error_throw(interp, interp->Error,
+				"cannot load compiled %s", path);
+	}
+	SEE_program_eval(interp, u->program, &res);
+}
 
 /*
  * include(): includes and runs another file
@@ -402,11 +463,38 @@ include_fn(interp, self, thisobj, argc, argv, res)
 	SEE_SET_UNDEFINED(res);
 }
 
+/*
+ * Initialises the template interpreter, and inserts the print(),
+ * include() and __text() functions that every request's copy will have.
+ * The template is then frozen, so that requests running in their own
+ * threads can copy it at the same time.
+ */
+static void
+template_init()
+{
+	template_state.fp = NULL;
+	template_state.headers_sent = 0;
+	template_state.raw = 0;
+	template_state.response_code = 200;
+	template_state.pages = NULL;
+
+	template_interp.host_data = &template_state;
+	SEE_interpreter_init(&template_interp);
+	SEE_CFUNCTION_PUTA(&template_interp, template_interp.Global, 
+		"print", print_fn, 1, 0);
+	SEE_CFUNCTION_PUTA(&template_interp, template_interp.Global, 
+		"include", include_fn, 1, 0);
+	SEE_CFUNCTION_PUTA(&template_interp, template_interp.Global, 
+		"__text", text_fn, 2, SEE_ATTR_DONTENUM | SEE_ATTR_READONLY |
+		SEE_ATTR_DONTDELETE);
+	SEE_interpreter_freeze(&template_interp);
+}
+
 /*
  * Processes a request for an SSP file.
  * The URI is opened as a file relative to the current directory,
- * its contents converted into a (large) SEE script, and then
- * it is executed.
+ * compiled into a page (or found in the page cache), and then
+ * its program is executed.
  */
 void
 process_request(fp, method, uri, headers)
@@ -420,6 +508,8 @@ process_request(fp, method, uri, headers)
 	SEE_try_context_t ctxt;
 	struct SEE_value v;
 	struct ssp_state ssp_state;
+	struct SEE_arena *arena;
+	struct page_use *u;
 
 	s = strchr(uri, '?');
 	if (s) {
@@ -432,15 +522,22 @@ process_request(fp, method, uri, headers)
 	ssp_state.headers_sent = 0;
 	ssp_state.raw = strcmp(query_string, "raw") == 0;
 	ssp_state.response_code = 200;
-	ssp_state.pool = pool_new();
+	ssp_state.pages = NULL;
+	SEE_output_init(&ssp_state.output, fp);
 
-	/* Create an interpreter instance that uses our memory allocator */
+	/*
+	 * Create an interpreter instance that uses its own arena,
+	 * by copying the template. The copy already has print() and
+	 * include() in its global object.
+	 */
+	arena = SEE_arena_new(SSP_MEMORY_LIMIT);
+	if (!arena) {
+		warnx("%s: out of memory", uri);
+		return;
+	}
 	interp.host_data = &ssp_state;
-	SEE_interpreter_init(&interp);
-
-	/* Insert the print() function into the interpreter context */
-	SEE_CFUNCTION_PUTA(&interp, interp.Global, "print", print_fn, 1, 0);
-	SEE_CFUNCTION_PUTA(&interp, interp.Global, "include", include_fn, 1, 0);
+	SEE_interpreter_clone_arena(&interp, &template_interp, arena);
+	interp.output = &ssp_state.output;
 
 	/* Set QUERY_STRING and other global variable */
 	SEE_SET_STRING(&v, SEE_string_sprintf(&interp, "%s", query_string));
@@ -479,12 +576,14 @@ process_request(fp, method, uri, headers)
 		}
 	}
 
-	ssp_flush_header(interp);
+	ssp_flush_header(&interp);
+	SEE_output_flush(&ssp_state.output);
 	fflush(fp);
 
-
 	/* Release memory */
-	pool_destroy(SSP_STATE(&interp)->pool);
+	for (u = ssp_state.pages; u; u = u->next)
+		page_release(u->page);
+	SEE_arena_destroy(arena);
 }
 
 